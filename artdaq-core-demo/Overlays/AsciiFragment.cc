@@ -2,6 +2,13 @@
 
 #include "cetlib/exception.h"
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #if 0
 namespace {
   unsigned int pop_count (unsigned int n) {
@@ -12,13 +19,197 @@ namespace {
 }
 #endif
 
+namespace
+{
+	bool printable(char c)
+	{
+		return (c >= ' ' && c <= '~') || c == '\t' || c == '\n' || c == '\r';
+	}
+
+#if defined(__SSE2__)
+	// Mask of the bytes in v that are not printable(): not in [' ', '~'] as signed
+	// bytes (which also rejects everything at or above 0x80) nor tab, newline or return
+	inline __m128i unprintable(__m128i v)
+	{
+		__m128i const in_range = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(' ' - 1)),
+		                                       _mm_cmplt_epi8(v, _mm_set1_epi8('~' + 1)));
+		__m128i const space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+		                                                _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+		                                   _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+		return _mm_andnot_si128(_mm_or_si128(in_range, space), _mm_set1_epi8(-1));
+	}
+#endif
+
+#if defined(__AVX2__)
+	inline __m256i unprintable(__m256i v)
+	{
+		__m256i const in_range = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(' ' - 1)),
+		                                          _mm256_cmpgt_epi8(_mm256_set1_epi8('~' + 1), v));
+		__m256i const space = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+		                                                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+		                                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+		return _mm256_andnot_si256(_mm256_or_si256(in_range, space), _mm256_set1_epi8(-1));
+	}
+#endif
+}
+
+bool demo::AsciiFragment::all_printable() const
+{
+	char const* p = dataBegin();
+	char const* const end = dataEnd();
+
+#if defined(__AVX2__)
+	for (; end - p >= 32; p += 32)
+	{
+		__m256i const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+		if (!_mm256_testz_si256(unprintable(v), unprintable(v))) return false;
+	}
+#endif
+#if defined(__SSE2__)
+	for (; end - p >= 16; p += 16)
+	{
+		__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+		if (_mm_movemask_epi8(unprintable(v)) != 0) return false;
+	}
+#endif
+	for (; p < end; ++p)
+	{
+		if (!printable(*p)) return false;
+	}
+	return true;
+}
+
+size_t demo::AsciiFragment::count_line_breaks() const
+{
+	char const* p = dataBegin();
+	char const* const end = dataEnd();
+	size_t count = 0;
+
+#if defined(__AVX2__)
+	__m256i const nl32 = _mm256_set1_epi8('\n');
+	for (; end - p >= 32; p += 32)
+	{
+		__m256i const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+		count += __builtin_popcount(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl32))));
+	}
+#endif
+#if defined(__SSE2__)
+	__m128i const nl = _mm_set1_epi8('\n');
+	for (; end - p >= 16; p += 16)
+	{
+		__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+		count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+	}
+#endif
+	for (; p < end; ++p)
+	{
+		count += *p == '\n';
+	}
+	return count;
+}
+
+size_t demo::AsciiFragment::line_break_offsets(std::vector<size_t>& offsets) const
+{
+	offsets.clear();
+	char const* const begin = dataBegin();
+	char const* const end = dataEnd();
+	char const* p = begin;
+
+#if defined(__SSE2__)
+	__m128i const nl = _mm_set1_epi8('\n');
+	for (; end - p >= 16; p += 16)
+	{
+		__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+		for (unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)); mask != 0; mask &= mask - 1)
+		{
+			offsets.push_back(p - begin + __builtin_ctz(mask));
+		}
+	}
+#endif
+	for (; p < end; ++p)
+	{
+		if (*p == '\n') offsets.push_back(p - begin);
+	}
+	return offsets.size();
+}
+
+char const* demo::AsciiFragment::first_non_padding(char pad) const
+{
+	char const* p = dataBegin();
+	char const* const end = dataEnd();
+
+#if defined(__SSE2__)
+	__m128i const padding = _mm_set1_epi8(pad);
+	for (; end - p >= 16; p += 16)
+	{
+		__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+		unsigned const mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, padding));
+		if (mask != 0xFFFF) return p + __builtin_ctz(~mask);
+	}
+#endif
+	for (; p < end; ++p)
+	{
+		if (*p != pad) return p;
+	}
+	return end;
+}
+
+bool demo::AsciiFragment::sizes_consistent() const
+{
+	if (payload_size_bytes_() < sizeof(Header)) return false;
+	if (hdr_event_size() < hdr_size_words()) return false;
+	if (hdr_event_size() * sizeof(Header::data_t) > payload_size_bytes_()) return false;
+	if (compressed() && !compressedPayloadComplete(stored_begin_(), stored_bytes_())) return false;
+
+	Metadata const* metadata = metadata_();
+	return !metadata || metadata->charsInLine <= total_line_characters();
+}
+
+size_t demo::AsciiFragment::decompress_into(char* out, size_t capacity) const
+{
+	if (compressed())
+	{
+		return decompressPayload(stored_begin_(), std::min(stored_bytes_(), payload_size_bytes_() - sizeof(Header)),
+		                         reinterpret_cast<uint8_t*>(out), capacity);
+	}
+
+	size_t const n = total_line_characters();
+	if (n > capacity)
+	{
+		throw cet::exception("AsciiFragment") << "Line of " << n << " characters doesn't fit in " << capacity;
+	}
+	memcpy(out, dataBegin(), n);
+	return n;
+}
+
+bool demo::AsciiFragment::checksum_span(ChecksumSpan& span) const
+{
+	if (!checksummed()) return false;
+
+	span.begin = payload_();
+	span.bytes = hdr_event_size() * sizeof(Header::data_t);
+	span.complete = hdr_event_size() >= hdr_size_words() && span.bytes + sizeof(span.expected) <= payload_size_bytes_();
+	span.expected = 0;
+	if (span.complete) memcpy(&span.expected, span.begin + span.bytes, sizeof span.expected);
+	return true;
+}
+
+char const* demo::AsciiFragment::inflated_begin_() const
+{
+	// Don't trust event_size to stay within the payload
+	size_t const stored = std::min(stored_bytes_(), payload_size_bytes_() - sizeof(Header));
+	return reinterpret_cast<char const*>(inflated_.get(stored_begin_(), stored, total_line_characters()));
+}
+
 std::ostream& demo::operator <<(std::ostream& os, AsciiFragment const& f)
 {
 	os << "AsciiFragment event size: "
 		<< f.hdr_event_size()
 		<< ", line number: "
-		<< f.hdr_line_number()
-		<< "\n";
+		<< f.hdr_line_number();
+	if (f.compressed()) os << ", compressed line characters: " << f.total_line_characters();
+	if (f.checksummed()) os << ", checksum " << (f.checksum_ok() ? "good" : "bad");
+	os << "\n";
 
 	return os;
 }
@@ -2,6 +2,8 @@
 #define artdaq_demo_Overlays_AsciiFragment_hh
 
 #include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/Checksum.hh"
+#include "artdaq-core-demo/Overlays/CompressedPayload.hh"
 #include "cetlib/exception.h"
 
 #include <ostream>
@@ -30,6 +32,19 @@ namespace demo
 * AsciiFragment is an artdaq::Fragment overlay class designed to hold string data. It serves both
 * as an educational tool for showing how Fragment overlays works, and as a way to showcase artdaq's
 * data-handling ability, especially how the input data is replicated bit-for-bit in the output.
+*
+* The line may be stored compressed (see CompressedPayload.hh), which Header::compressed records.
+* Readers needn't care: dataBegin() decompresses the line into the overlay the first time it is
+* called, and the scans work on the decompressed line. An overlay that has done so doesn't see
+* later changes to a compressed line.
+*
+* The Fragment may also carry a CRC-32C of the Header and the stored line (see Checksum.hh), in
+* the four bytes after the Header::event_size characters. Header::checksummed records this, and
+* checksum_ok() checks it.
+*
+* AsciiFragmentWriter used to leave the bits of the Header after event_size unset, so in Fragments
+* written then they may hold anything. The flags are only believed if Header::format holds
+* Header::format_marker, which the writer now sets.
 */
 class demo::AsciiFragment
 {
@@ -78,12 +93,16 @@ public:
 		typedef uint64_t event_size_t; ///< Type for the event_size field
 		typedef uint64_t line_number_t; ///< Type for the line_number field
 
-		event_size_t event_size : 28; ///< The number of characters in the contained string
-		event_size_t unused_1 : 36; ///< Unused
+		event_size_t event_size : 28; ///< The size in characters of this Header and the stored line, which may be compressed
+		event_size_t compressed : 1; ///< Whether the line is stored compressed
+		event_size_t checksummed : 1; ///< Whether a CRC-32C of the Header and the stored line follows them
+		event_size_t unused_1 : 2; ///< Unused
+		event_size_t format : 32; ///< format_marker if the flags above were set by the writer
 
 		line_number_t line_number; ///< The line number of the string (in ASCII). Equal to Event number in artdaq-demo/Generators/AsciiSimulator_generator.cc. 
 
 		static size_t const size_words = 16ul; ///< Size of the Header object, in units of Header::data_t
+		static event_size_t const format_marker = 0x31435341; ///< "ASC1": the flags in this Header are meaningful
 	};
 
 	static_assert (sizeof (Header) == Header::size_words * sizeof (Header::data_t), "AsciiFragment::Header size changed");
@@ -94,7 +113,17 @@ public:
 	 * 
 	 * The constructor simply sets its const private member "artdaq_Fragment_" to refer to the artdaq::Fragment object
 	 */
-	explicit AsciiFragment(artdaq::Fragment const& f) : artdaq_Fragment_(f) {}
+	explicit AsciiFragment(artdaq::Fragment const& f)
+		: artdaq_Fragment_(&f), payload_begin_(nullptr), payload_bytes_(0), payload_metadata_(nullptr) {}
+
+	/**
+	 * \brief Overlay a payload that isn't in an artdaq::Fragment, such as one in a mapped file
+	 * \param payload Start of the payload, where the AsciiFragment::Header begins
+	 * \param payloadBytes Size of the payload
+	 * \param metadata The AsciiFragment::Metadata, or nullptr if there is none
+	 */
+	AsciiFragment(uint8_t const* payload, size_t payloadBytes, Metadata const* metadata = nullptr)
+		: artdaq_Fragment_(nullptr), payload_begin_(payload), payload_bytes_(payloadBytes), payload_metadata_(metadata) {}
 
 	// const getter functions for the data in the header
 
@@ -114,16 +143,22 @@ public:
 	 */
 	static constexpr size_t hdr_size_words() { return Header::size_words; }
 
-	/// The number of characters in the line
+	/**
+	 * \brief Whether the line is stored compressed
+	 * \return The Header::compressed flag, or false if Header::format isn't Header::format_marker
+	 */
+	bool compressed() const { return flags_valid_() && header_()->compressed; }
+
+	/// The number of characters in the line, after decompressing it if it is compressed
 	size_t total_line_characters() const
 	{
-		return (hdr_event_size() - hdr_size_words()) * chars_per_word_();
+		return compressed() ? compressedPayloadRawBytes(stored_begin_(), stored_bytes_()) : stored_bytes_();
 	}
 
-	/// Start of the line, returned as a pointer to the char type
+	/// Start of the line, returned as a pointer to the char type. A compressed line is decompressed the first time.
 	char const* dataBegin() const
 	{
-		return reinterpret_cast<char const *>(header_() + 1);
+		return compressed() ? inflated_begin_() : reinterpret_cast<char const *>(header_() + 1);
 	}
 
 	/// End of the line, returned as a pointer to the char type
@@ -132,6 +167,76 @@ public:
 		return dataBegin() + total_line_characters();
 	}
 
+	// Scans of the line. These use SSE2 or AVX2, whichever the build targets, so that
+	// long lines can be checked at close to memory bandwidth.
+
+	/**
+	 * \brief Check that the line is all printable ASCII
+	 * \return true if every character is between ' ' and '~', or is a tab, newline or carriage return
+	 */
+	bool all_printable() const;
+
+	/**
+	 * \brief Count the newline characters in the line
+	 * \return The number of '\\n' characters in the line
+	 */
+	size_t count_line_breaks() const;
+
+	/**
+	 * \brief Find the newline characters in the line
+	 * \param offsets Replaced with the offset from dataBegin() of each '\\n', in order
+	 * \return The number of '\\n' characters in the line
+	 */
+	size_t line_break_offsets(std::vector<size_t>& offsets) const;
+
+	/**
+	 * \brief Find the first character that isn't padding
+	 * \param pad The padding character, by default NUL
+	 * \return Pointer to the first character that isn't pad, or dataEnd() if there is none
+	 */
+	char const* first_non_padding(char pad = '\0') const;
+
+	/**
+	 * \brief Cross-check the sizes recorded for the line
+	 * \return true if the Fragment is big enough for the Header::event_size, and, if the
+	 * Fragment has AsciiFragment::Metadata, its charsInLine is no more than total_line_characters()
+	 */
+	bool sizes_consistent() const;
+
+	/**
+	 * \brief Copy the line into a buffer of the caller's, decompressing it if it is compressed
+	 * \param out Where to put the line
+	 * \param capacity Number of characters there is room for at out
+	 * \return The number of characters written, total_line_characters()
+	 * \exception cet::exception if the line doesn't fit, or is compressed and corrupt
+	 *
+	 * Unlike dataBegin(), this doesn't keep a decompressed copy in the overlay.
+	 */
+	size_t decompress_into(char* out, size_t capacity) const;
+
+	/**
+	 * \brief Whether the Fragment carries a checksum
+	 * \return The Header::checksummed flag, or false if Header::format isn't Header::format_marker
+	 */
+	bool checksummed() const { return flags_valid_() && header_()->checksummed; }
+
+	/**
+	 * \brief Find what the checksum covers: the Header and the line as stored
+	 * \param span Set to the bytes covered and the checksum after them, if there is one
+	 * \return false if the Fragment has no checksum
+	 */
+	bool checksum_span(ChecksumSpan& span) const;
+
+	/**
+	 * \brief Check the checksum
+	 * \return true if the Header and line match the checksum, or there is no checksum
+	 */
+	bool checksum_ok() const
+	{
+		ChecksumSpan span;
+		return !checksum_span(span) || checksumMatches(span);
+	}
+
 protected:
 	
 	/**
@@ -151,12 +256,76 @@ protected:
 	 */
 	Header const* header_() const
 	{
-		return reinterpret_cast<AsciiFragment::Header const *>(artdaq_Fragment_.dataBeginBytes());
+		return reinterpret_cast<AsciiFragment::Header const *>(payload_());
+	}
+
+	/**
+	 * \brief Get the start of the payload, from the artdaq::Fragment if there is one
+	 * \return Pointer to the start of the payload
+	 *
+	 * This is looked up each time, rather than saved, so that it follows the Fragment when a writer resizes it.
+	 */
+	uint8_t const* payload_() const
+	{
+		return artdaq_Fragment_ ? reinterpret_cast<uint8_t const*>(artdaq_Fragment_->dataBeginBytes()) : payload_begin_;
+	}
+
+	/**
+	 * \brief Get the size of the payload
+	 * \return Size of the payload in bytes
+	 */
+	size_t payload_size_bytes_() const
+	{
+		return artdaq_Fragment_ ? artdaq_Fragment_->dataSizeBytes() : payload_bytes_;
+	}
+
+	/**
+	 * \brief Get the start of the line as stored, which may be compressed
+	 * \return Pointer to the byte after the AsciiFragment::Header
+	 */
+	uint8_t const* stored_begin_() const
+	{
+		return reinterpret_cast<uint8_t const*>(header_() + 1);
+	}
+
+	/**
+	 * \brief Get the size of the line as stored, according to the Header::event_size
+	 * \return Number of characters stored after the AsciiFragment::Header
+	 */
+	size_t stored_bytes_() const
+	{
+		return (hdr_event_size() - hdr_size_words()) * chars_per_word_();
+	}
+
+	/**
+	 * \brief Whether the flags in the Header were set by a writer that knows about them
+	 * \return true if Header::format is Header::format_marker
+	 */
+	bool flags_valid_() const { return header_()->format == Header::format_marker; }
+
+	/**
+	 * \brief Get the AsciiFragment::Metadata
+	 * \return Pointer to the Metadata, or nullptr if there is none
+	 */
+	Metadata const* metadata_() const
+	{
+		if (!artdaq_Fragment_) return payload_metadata_;
+		return artdaq_Fragment_->hasMetadata() ? artdaq_Fragment_->metadata<Metadata>() : nullptr;
 	}
 
 private:
 
-	artdaq::Fragment const& artdaq_Fragment_;
+	/**
+	 * \brief Decompress the line into the overlay, if that hasn't been done yet
+	 * \return Start of the decompressed line
+	 */
+	char const* inflated_begin_() const;
+
+	artdaq::Fragment const* artdaq_Fragment_; ///< The overlaid Fragment, or nullptr when overlaying a raw payload
+	uint8_t const* payload_begin_; ///< Start of the raw payload, when there is no Fragment
+	size_t payload_bytes_; ///< Size of the raw payload, when there is no Fragment
+	Metadata const* payload_metadata_; ///< Metadata of the raw payload, when there is no Fragment
+	detail::LazyInflation inflated_; ///< The decompressed line, once dataBegin() has been called on a compressed one
 };
 
 #endif /* artdaq_demo_Overlays_AsciiFragment_hh */
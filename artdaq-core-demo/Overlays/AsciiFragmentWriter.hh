@@ -3,6 +3,9 @@
 
 #include "artdaq-core/Data/Fragment.hh"
 #include "artdaq-core-demo/Overlays/AsciiFragment.hh"
+#include "artdaq-core-demo/Overlays/FragmentPool.hh"
+
+#include <cstring>
 
 namespace demo
 {
@@ -35,6 +38,16 @@ public:
 	 */
 	explicit AsciiFragmentWriter(artdaq::Fragment& f);
 
+	/**
+	 * \brief AsciiFragmentWriter constructor for a Fragment whose AsciiFragment::Header is already allocated
+	 * \param f artdaq::Fragment object to overlay, such as one from FragmentPool::acquire()
+	 * \throws cet::exception if input Fragment does not contain AsciiFragment::Metadata, or is too small for the AsciiFragment::Header
+	 *
+	 * Any payload beyond the AsciiFragment::Header is dropped, keeping its storage, and the AsciiFragment::Header is
+	 * zeroed apart from its format marker.
+	 */
+	AsciiFragmentWriter(artdaq::Fragment& f, HeaderReserved);
+
 	// These functions form overload sets with const functions from
 	// demo::AsciiFragment
 
@@ -70,11 +83,32 @@ public:
 	}
 
 	/**
-	 * \brief Resize the Fragment so that it can contain nChars characters
+	 * \brief Resize the Fragment so that it can contain nChars characters, stored uncompressed
 	 * \param nChars Number of characters in resized Fragment
 	 */
 	void resize(size_t nChars);
 
+	/**
+	 * \brief Store a line compressed, instead of calling resize() and writing to dataBegin()
+	 * \param line The characters to store
+	 * \param nChars Number of characters
+	 * \return true if the line was stored compressed, false if it was stored as it is because compressing didn't make it smaller
+	 *
+	 * The line is compressed straight into the Fragment, which is grown to the largest size the
+	 * compressed line could be and then shrunk to fit. Afterwards, dataBegin() and dataEnd() of the
+	 * writer are those of the stored, compressed bytes.
+	 */
+	bool write_compressed(char const* line, size_t nChars);
+
+	/**
+	 * \brief Store a checksum of the Header and the line, as stored, after them
+	 *
+	 * Call this once the line and line number are written. The Fragment grows by four bytes to
+	 * hold the checksum. resize() and write_compressed() drop it, and writing to the line
+	 * afterwards makes it wrong.
+	 */
+	void write_checksum();
+
 private:
 	static size_t calc_event_size_words_(size_t nChars);
 
@@ -99,6 +133,23 @@ inline demo::AsciiFragmentWriter::AsciiFragmentWriter(artdaq::Fragment& f) :
 
 	// Allocate space for the header
 	artdaq_Fragment_.resizeBytes(sizeof(Header));
+	memset(header_(), 0, sizeof(Header));
+	header_()->format = Header::format_marker;
+}
+
+inline demo::AsciiFragmentWriter::AsciiFragmentWriter(artdaq::Fragment& f, HeaderReserved) :
+									AsciiFragment(f)
+									, artdaq_Fragment_(f)
+{
+	if (! f.hasMetadata() || f.dataSizeBytes() < sizeof(Header))
+	{
+		throw cet::exception("Error in AsciiFragmentWriter: Raw artdaq::Fragment object does not appear to consist of its own header + the AsciiFragment::Metadata object + space for the AsciiFragment::Header");
+	}
+
+	// Shrinking keeps the storage
+	artdaq_Fragment_.resizeBytes(sizeof(Header));
+	memset(header_(), 0, sizeof(Header));
+	header_()->format = Header::format_marker;
 }
 
 
@@ -111,7 +162,7 @@ inline char* demo::AsciiFragmentWriter::dataBegin()
 
 inline char* demo::AsciiFragmentWriter::dataEnd()
 {
-	return dataBegin() + total_line_characters();
+	return dataBegin() + stored_bytes_();
 }
 
 
@@ -119,6 +170,38 @@ inline void demo::AsciiFragmentWriter::resize(size_t nChars)
 {
 	artdaq_Fragment_.resizeBytes(sizeof(Header::data_t) * calc_event_size_words_(nChars));
 	header_()->event_size = calc_event_size_words_(nChars);
+	header_()->compressed = 0;
+	header_()->checksummed = 0;
+}
+
+inline bool demo::AsciiFragmentWriter::write_compressed(char const* line, size_t nChars)
+{
+	size_t const bound = compressedPayloadBound(nChars);
+	artdaq_Fragment_.resizeBytes(sizeof(Header) + bound);
+	size_t const stored = compressPayload(reinterpret_cast<uint8_t const*>(line), nChars,
+	                                      reinterpret_cast<uint8_t*>(header_() + 1), bound);
+
+	if (stored == 0 || stored >= nChars)
+	{
+		resize(nChars);
+		if (nChars > 0) memcpy(dataBegin(), line, nChars);
+		return false;
+	}
+
+	artdaq_Fragment_.resizeBytes(sizeof(Header::data_t) * calc_event_size_words_(stored));
+	header_()->event_size = calc_event_size_words_(stored);
+	header_()->compressed = 1;
+	header_()->checksummed = 0;
+	return true;
+}
+
+inline void demo::AsciiFragmentWriter::write_checksum()
+{
+	size_t const bytes = header_()->event_size * sizeof(Header::data_t);
+	artdaq_Fragment_.resizeBytes(bytes + sizeof(uint32_t));
+	header_()->checksummed = 1;
+	uint32_t const crc = crc32c(artdaq_Fragment_.dataBeginBytes(), bytes);
+	memcpy(artdaq_Fragment_.dataBeginBytes() + bytes, &crc, sizeof crc);
 }
 
 inline size_t demo::AsciiFragmentWriter::calc_event_size_words_(size_t nChars)
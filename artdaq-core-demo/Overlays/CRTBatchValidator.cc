@@ -0,0 +1,168 @@
+#include "artdaq-core-demo/Overlays/CRTBatchValidator.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+#include "artdaq-core-demo/Overlays/OverlayStats.hh"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+  typedef CRT::Fragment::header_t header_t;
+  typedef CRT::Fragment::hit_t hit_t;
+
+  static_assert(sizeof(hit_t) == 4, "SIMD hit checks assume 4-byte hits");
+
+  // Each hit, read as a little-endian 32-bit word, has the magic in bits
+  // 0-7, the channel in bits 8-15 and the signed ADC value in bits 16-31.
+  // A channel >= 64 has one of bits 14-15 set.
+  const uint32_t magic_mask = 0x000000ff;
+  const uint32_t channel_high_bits = 0x0000c000;
+
+  CRT::error_mask_t check_hit(const uint8_t * const p)
+  {
+    hit_t h;
+    memcpy(&h, p, sizeof h);
+    CRT::error_mask_t mask = 0;
+    if(h.magic != 'H')                 mask |= CRT::error_bit(CRT::bad_hit_magic);
+    if(h.channel >= CRT::n_channels)   mask |= CRT::error_bit(CRT::bad_channel);
+    if(h.adc >= CRT::adc_limit)        mask |= CRT::error_bit(CRT::bad_adc);
+    return mask;
+  }
+
+  // Check the n hits starting at p, which need not be aligned
+  CRT::error_mask_t check_hits(const uint8_t * const p, const unsigned int n)
+  {
+    CRT::error_mask_t mask = 0;
+    unsigned int i = 0;
+
+#if defined(__AVX2__)
+    {
+      const __m256i low = _mm256_set1_epi32(magic_mask);
+      const __m256i magic = _mm256_set1_epi32('H');
+      const __m256i chan = _mm256_set1_epi32(channel_high_bits);
+      const __m256i adcmax = _mm256_set1_epi32(CRT::adc_limit - 1);
+      __m256i badmagic = _mm256_setzero_si256();
+      __m256i badchan = _mm256_setzero_si256();
+      __m256i badadc = _mm256_setzero_si256();
+      for(; i + 8 <= n; i += 8){
+        const __m256i v = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(p + i*sizeof(hit_t)));
+        badmagic = _mm256_or_si256(badmagic,
+          _mm256_xor_si256(_mm256_and_si256(v, low), magic));
+        badchan = _mm256_or_si256(badchan, _mm256_and_si256(v, chan));
+        badadc = _mm256_or_si256(badadc,
+          _mm256_cmpgt_epi32(_mm256_srai_epi32(v, 16), adcmax));
+      }
+      if(!_mm256_testz_si256(badmagic, badmagic))
+        mask |= CRT::error_bit(CRT::bad_hit_magic);
+      if(!_mm256_testz_si256(badchan, badchan))
+        mask |= CRT::error_bit(CRT::bad_channel);
+      if(!_mm256_testz_si256(badadc, badadc))
+        mask |= CRT::error_bit(CRT::bad_adc);
+    }
+#endif
+
+#if defined(__SSE2__)
+    {
+      const __m128i low = _mm_set1_epi32(magic_mask);
+      const __m128i magic = _mm_set1_epi32('H');
+      const __m128i chan = _mm_set1_epi32(channel_high_bits);
+      const __m128i adcmax = _mm_set1_epi32(CRT::adc_limit - 1);
+      const __m128i zero = _mm_setzero_si128();
+      __m128i badmagic = zero, badchan = zero, badadc = zero;
+      for(; i + 4 <= n; i += 4){
+        const __m128i v = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p + i*sizeof(hit_t)));
+        badmagic = _mm_or_si128(badmagic,
+          _mm_xor_si128(_mm_and_si128(v, low), magic));
+        badchan = _mm_or_si128(badchan, _mm_and_si128(v, chan));
+        badadc = _mm_or_si128(badadc,
+          _mm_cmpgt_epi32(_mm_srai_epi32(v, 16), adcmax));
+      }
+      if(_mm_movemask_epi8(_mm_cmpeq_epi32(badmagic, zero)) != 0xffff)
+        mask |= CRT::error_bit(CRT::bad_hit_magic);
+      if(_mm_movemask_epi8(_mm_cmpeq_epi32(badchan, zero)) != 0xffff)
+        mask |= CRT::error_bit(CRT::bad_channel);
+      if(_mm_movemask_epi8(_mm_cmpeq_epi32(badadc, zero)) != 0xffff)
+        mask |= CRT::error_bit(CRT::bad_adc);
+    }
+#endif
+
+    for(; i < n; i++)
+      mask |= check_hit(p + i*sizeof(hit_t));
+
+    return mask;
+  }
+}
+
+CRT::error_mask_t CRT::validate(artdaq::Fragment const& frag)
+{
+  DEMO_OVERLAY_TIMER(demo::FragmentType::CRT, Validate);
+
+  const uint8_t * const begin = frag.dataBeginBytes();
+  const size_t size = frag.dataEndBytes() - begin;
+
+  if(size < sizeof(header_t)){
+    count_validation(error_bit(bad_size));
+    DEMO_OVERLAY_COUNT(demo::FragmentType::CRT, size, 0);
+    DEMO_OVERLAY_FAILED(demo::FragmentType::CRT);
+    return error_bit(bad_size);
+  }
+
+  header_t h;
+  memcpy(&h, begin, sizeof h);
+
+  error_mask_t mask = 0;
+  if(h.magic != 'M')                 mask |= error_bit(bad_header_magic);
+  if(h.nhit == 0)                    mask |= error_bit(no_hits);
+  if(h.nhit > max_hits)              mask |= error_bit(too_many_hits);
+  if(h.unixtime < earliest_unixtime) mask |= error_bit(early_unixtime);
+
+  const size_t hit_bytes = sizeof(header_t) + h.nhit*sizeof(hit_t);
+  const size_t expect_size = fragment_bytes(h.nhit);
+  const bool trailer = size == expect_size + sizeof(Fragment::trailer_t)
+    && Fragment(frag).has_checksum();
+
+  if(size != expect_size && !trailer) mask |= error_bit(bad_size);
+
+  // Only look at the hits if they are all there
+  if(size >= hit_bytes)
+    mask |= check_hits(begin + sizeof(header_t), h.nhit);
+
+  if(trailer && !Fragment(frag).good_checksum())
+    mask |= error_bit(bad_checksum);
+
+  count_validation(mask);
+  DEMO_OVERLAY_COUNT(demo::FragmentType::CRT, size, h.nhit);
+  if(mask) DEMO_OVERLAY_FAILED(demo::FragmentType::CRT);
+  return mask;
+}
+
+size_t CRT::validate_batch(artdaq::Fragment const* const frags, const size_t n,
+                           error_mask_t * const masks)
+{
+  size_t nbad = 0;
+  for(size_t i = 0; i < n; i++)
+    nbad += (masks[i] = validate(frags[i])) != 0;
+  return nbad;
+}
+
+size_t CRT::validate_batch(artdaq::Fragment const* const* const frags,
+                           const size_t n, error_mask_t * const masks)
+{
+  size_t nbad = 0;
+  for(size_t i = 0; i < n; i++)
+    nbad += (masks[i] = validate(*frags[i])) != 0;
+  return nbad;
+}
+
+std::vector<CRT::error_mask_t>
+CRT::validate_batch(artdaq::Fragments const& frags)
+{
+  std::vector<error_mask_t> masks(frags.size());
+  validate_batch(frags.data(), frags.size(), masks.data());
+  return masks;
+}
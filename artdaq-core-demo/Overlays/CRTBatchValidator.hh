@@ -0,0 +1,34 @@
+#ifndef artdaq_demo_Overlays_CRTBatchValidator_hh
+#define artdaq_demo_Overlays_CRTBatchValidator_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/CRTError.hh"
+
+#include <vector>
+
+// Validation of many CRT fragments at a time.  These apply the same checks
+// as CRT::Fragment::good_event(), but never print anything, check every hit
+// instead of stopping at the first bad one, and use SIMD instructions (AVX2
+// or SSE2, whichever the build targets) to check the hits.  The result for
+// each fragment is a mask of error_bit()s, zero if the fragment is good.
+// Each fragment validated is counted in CRT::validation_counts().
+
+namespace CRT
+{
+  // Validate one fragment
+  error_mask_t validate(artdaq::Fragment const& frag);
+
+  // Validate the n contiguous fragments starting at frags, writing one mask
+  // per fragment to masks.  Returns the number of bad fragments.
+  size_t validate_batch(artdaq::Fragment const* frags, size_t n,
+                        error_mask_t* masks);
+
+  // As above, for an array of n pointers to fragments
+  size_t validate_batch(artdaq::Fragment const* const* frags, size_t n,
+                        error_mask_t* masks);
+
+  // Validate every fragment in frags and return their masks
+  std::vector<error_mask_t> validate_batch(artdaq::Fragments const& frags);
+}
+
+#endif /* artdaq_demo_Overlays_CRTBatchValidator_hh */
@@ -0,0 +1,175 @@
+#include "artdaq-core-demo/Overlays/CRTChannelHistograms.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+const int CRT::ChannelHistograms::n_bins;
+
+CRT::ChannelHistograms::ChannelHistograms(const size_t n_modules) :
+  n_modules_(n_modules),
+  bins_(n_modules*n_channels*n_bins, 0),
+  n_(n_modules*n_channels, 0),
+  sum_(n_modules*n_channels, 0),
+  sum2_(n_modules*n_channels, 0),
+  out_of_range_(n_modules*n_channels, 0),
+  bad_module_(0),
+  bad_channel_(0)
+{
+}
+
+void CRT::ChannelHistograms::fill(const uint16_t module,
+                                  const uint8_t channel, const int16_t adc)
+{
+  if(module >= n_modules_){ bad_module_++; return; }
+  if(channel >= n_channels){ bad_channel_++; return; }
+
+  const size_t i = index(module, channel);
+  // Negative values become large, so this is one comparison
+  if(uint16_t(adc) >= n_bins){ out_of_range_[i]++; return; }
+
+  bins_[i*n_bins + adc]++;
+  n_[i]++;
+  sum_[i] += adc;
+  sum2_[i] += uint32_t(adc)*uint32_t(adc);
+}
+
+void CRT::ChannelHistograms::fill(DecodedHits const& hits)
+{
+  for(size_t f = 0; f < hits.n_fragments(); f++){
+    const uint32_t first = hits.hit_begin[f], last = hits.hit_begin[f+1];
+    const uint16_t module = hits.module_num[f];
+    if(module >= n_modules_){
+      bad_module_ += last - first;
+      continue;
+    }
+
+    // The fragment's channels are all in one module's block, which stays
+    // in cache for the whole fragment
+    const size_t base = index(module, 0);
+    uint32_t * const bins = bins_.data() + base*n_bins;
+    for(uint32_t h = first; h < last; h++){
+      const uint8_t channel = hits.channel[h];
+      const int16_t adc = hits.adc[h];
+      if(channel >= n_channels){ bad_channel_++; continue; }
+      if(uint16_t(adc) >= n_bins){ out_of_range_[base + channel]++; continue; }
+
+      bins[channel*n_bins + adc]++;
+      n_[base + channel]++;
+      sum_[base + channel] += adc;
+      sum2_[base + channel] += uint32_t(adc)*uint32_t(adc);
+    }
+  }
+}
+
+void CRT::ChannelHistograms::add(ChannelHistograms const& other)
+{
+  // Plain loops over equal-sized arrays, which the compiler vectorizes
+  for(size_t i = 0; i < bins_.size(); i++) bins_[i] += other.bins_[i];
+  for(size_t i = 0; i < n_.size(); i++){
+    n_[i] += other.n_[i];
+    sum_[i] += other.sum_[i];
+    sum2_[i] += other.sum2_[i];
+    out_of_range_[i] += other.out_of_range_[i];
+  }
+  bad_module_ += other.bad_module_;
+  bad_channel_ += other.bad_channel_;
+}
+
+void CRT::ChannelHistograms::clear()
+{
+  std::fill(bins_.begin(), bins_.end(), 0);
+  std::fill(n_.begin(), n_.end(), 0);
+  std::fill(sum_.begin(), sum_.end(), 0);
+  std::fill(sum2_.begin(), sum2_.end(), 0);
+  std::fill(out_of_range_.begin(), out_of_range_.end(), 0);
+  bad_module_ = bad_channel_ = 0;
+}
+
+double CRT::ChannelHistograms::pedestal(const uint16_t module,
+                                        const uint8_t channel) const
+{
+  const size_t i = index(module, channel);
+  return n_[i]? double(sum_[i])/n_[i]: 0;
+}
+
+double CRT::ChannelHistograms::rms(const uint16_t module,
+                                   const uint8_t channel) const
+{
+  const size_t i = index(module, channel);
+  if(!n_[i]) return 0;
+
+  // The sums are exact, and long double keeps the cancellation between
+  // the two terms harmless even for narrow pedestals far from zero
+  const long double mean = (long double)sum_[i]/n_[i];
+  const long double var = (long double)sum2_[i]/n_[i] - mean*mean;
+  return var > 0? double(std::sqrt(var)): 0;
+}
+
+CRT::ChannelMonitor::Filler::Filler(const size_t n_modules) :
+  banks_{ChannelHistograms(n_modules), ChannelHistograms(n_modules)},
+  active_(0)
+{
+  writers_[0] = writers_[1] = 0;
+}
+
+void CRT::ChannelMonitor::Filler::fill(DecodedHits const& hits)
+{
+  // Announce the fill, then make sure the set wasn't switched meanwhile.
+  // Paired with drain(), which switches and then looks for fills.
+  unsigned int b;
+  for(;;){
+    b = active_.load();
+    writers_[b].fetch_add(1);
+    if(active_.load() == b) break;
+    writers_[b].fetch_sub(1);
+  }
+
+  banks_[b].fill(hits);
+  writers_[b].fetch_sub(1);
+}
+
+void CRT::ChannelMonitor::Filler::drain(ChannelHistograms& to)
+{
+  const unsigned int b = active_.load();
+  active_.store(1 - b);
+
+  // A fill() that started before the switch finishes quickly
+  while(writers_[b].load() != 0) std::this_thread::yield();
+
+  to.add(banks_[b]);
+  banks_[b].clear();
+}
+
+CRT::ChannelMonitor::ChannelMonitor(const size_t n_modules) :
+  n_modules_(n_modules), total_(n_modules)
+{
+}
+
+CRT::ChannelMonitor::Filler& CRT::ChannelMonitor::filler()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  fillers_.emplace_back(new Filler(n_modules_));
+  return *fillers_.back();
+}
+
+void CRT::ChannelMonitor::collect()
+{
+  for(auto& f : fillers_) f->drain(total_);
+}
+
+CRT::ChannelHistograms CRT::ChannelMonitor::snapshot()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  collect();
+  return total_;
+}
+
+CRT::ChannelHistograms CRT::ChannelMonitor::take()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  collect();
+  ChannelHistograms taken(total_);
+  total_.clear();
+  return taken;
+}
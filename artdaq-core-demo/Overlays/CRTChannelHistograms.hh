@@ -0,0 +1,141 @@
+#ifndef artdaq_demo_Overlays_CRTChannelHistograms_hh
+#define artdaq_demo_Overlays_CRTChannelHistograms_hh
+
+#include "artdaq-core-demo/Overlays/CRTError.hh"
+#include "artdaq-core-demo/Overlays/CRTHitDecoder.hh"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ADC spectra and pedestals of every channel of every CRT module, for online
+// monitoring.  Each channel has a dense histogram with one integer bin per
+// ADC value, and integer sums of the ADC and its square, from which the
+// pedestal (mean) and RMS are exact.
+//
+// A ChannelHistograms is filled by one thread.  For filling from several
+// threads, ChannelMonitor gives each its own, and gathers them without
+// stopping the filling.
+
+namespace CRT
+{
+  class ChannelHistograms
+  {
+  public:
+    static const int n_bins = adc_limit; // one per ADC value
+
+    // Histograms for modules 0 to n_modules-1.  These take n_modules*1MB.
+    explicit ChannelHistograms(size_t n_modules);
+
+    size_t n_modules() const { return n_modules_; }
+
+    // Add one hit.  Hits from modules or channels out of range, or with an
+    // ADC value outside [0, n_bins), are counted but not binned.
+    void fill(uint16_t module, uint8_t channel, int16_t adc);
+
+    // Add every hit of some decoded fragments
+    void fill(DecodedHits const& hits);
+
+    // Add in another set of histograms for the same number of modules
+    void add(ChannelHistograms const& other);
+
+    // Empty every histogram, keeping the memory
+    void clear();
+
+    // The n_bins bins of a channel's histogram
+    const uint32_t * histogram(const uint16_t module,
+                               const uint8_t channel) const
+    {
+      return bins_.data() + index(module, channel)*n_bins;
+    }
+
+    // Number of hits binned for a channel
+    uint64_t entries(const uint16_t module, const uint8_t channel) const
+    {
+      return n_[index(module, channel)];
+    }
+
+    // Mean ADC value of a channel, or 0 if it has no hits
+    double pedestal(uint16_t module, uint8_t channel) const;
+
+    // RMS of the ADC values of a channel, or 0 if it has no hits
+    double rms(uint16_t module, uint8_t channel) const;
+
+    // Hits on a channel whose ADC value was outside [0, n_bins)
+    uint64_t out_of_range(const uint16_t module, const uint8_t channel) const
+    {
+      return out_of_range_[index(module, channel)];
+    }
+
+    // Hits with a module or channel number out of range
+    uint64_t bad_module() const { return bad_module_; }
+    uint64_t bad_channel() const { return bad_channel_; }
+
+  private:
+    size_t index(const uint16_t module, const uint8_t channel) const
+    {
+      return size_t(module)*n_channels + channel;
+    }
+
+    size_t n_modules_;
+    std::vector<uint32_t> bins_;         // by module, channel, ADC
+    std::vector<uint64_t> n_;            // the rest by module, channel
+    std::vector<uint64_t> sum_;
+    std::vector<uint64_t> sum2_;
+    std::vector<uint64_t> out_of_range_;
+    uint64_t bad_module_;
+    uint64_t bad_channel_;
+  };
+
+  // Histograms filled by several threads, each through its own Filler, and
+  // read out with snapshot() or take() at any time without making the
+  // fillers wait.  Each Filler has two sets of histograms: it fills one
+  // while the other is read out.  Switching between them costs a filler two
+  // atomic operations per fill() call.
+  class ChannelMonitor
+  {
+  public:
+    explicit ChannelMonitor(size_t n_modules);
+
+    class Filler
+    {
+    public:
+      explicit Filler(size_t n_modules);
+
+      // Add every hit of some decoded fragments.  Only one thread may use
+      // a Filler.
+      void fill(DecodedHits const& hits);
+
+    private:
+      friend class ChannelMonitor;
+
+      // Switch the filler to the other set, wait for any fill() of this
+      // set to finish, and add this set to 'to', emptying it
+      void drain(ChannelHistograms& to);
+
+      ChannelHistograms banks_[2];
+      std::atomic<unsigned int> active_;
+      std::atomic<unsigned int> writers_[2];
+    };
+
+    // Make a Filler for a thread to use.  It lasts as long as the monitor.
+    Filler& filler();
+
+    // Everything filled so far, or since the last take()
+    ChannelHistograms snapshot();
+
+    // The same, and start again from empty
+    ChannelHistograms take();
+
+  private:
+    void collect();
+
+    size_t n_modules_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Filler>> fillers_;
+    ChannelHistograms total_;
+  };
+}
+
+#endif /* artdaq_demo_Overlays_CRTChannelHistograms_hh */
@@ -0,0 +1,322 @@
+#include "artdaq-core-demo/Overlays/CRTClockCalibration.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTHitDecoder.hh"
+
+#include "cetlib/exception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+  // The fitted drift is used once it is known to within this fraction, and
+  // only if it is within max_drift of nominal; until then, a module's clock
+  // is taken to run at the nominal rate, with only its offset fitted.
+  const double drift_precision = 1e-6;
+  const double max_drift = 1e-3;
+
+  // Spread of where a second boundary is, in ticks^2, beyond that from not
+  // knowing where between two fragments it is
+  const double edge_jitter = 1;
+
+  const CRT::ModuleClock nominal = { 0, 0, 0, 0 };
+
+  // Ticks past base_ticks of a fragment, whose counter is unwrapped to the
+  // rollover that the module's clock puts closest to the middle of its Unix
+  // second
+  int64_t ticks_since(CRT::ModuleClock const& c, const int32_t unixtime,
+                      const uint32_t fifty_mhz_time)
+  {
+    const int64_t mid = static_cast<int64_t>(unixtime)*1000000000
+      + 500000000 - c.base_ns;
+    const int64_t expected = c.base_ticks + static_cast<int64_t>(
+      static_cast<double>(mid)/(CRT::ns_per_tick + c.drift));
+    return static_cast<int64_t>(CRT::nearest_ticks(fifty_mhz_time,
+      static_cast<uint64_t>(expected))) - c.base_ticks;
+  }
+
+  // Doubles hold integers exactly up to 2^53, and this trick converts
+  // between them and int64_t without instructions that SSE2 and AVX2 lack,
+  // for magnitudes under 2^51.  Ticks further than that from base_ticks,
+  // over a year, are converted without the drift.
+  const int64_t exact_limit = int64_t(1) << 51;
+  const int64_t magic_bits = 0x4338000000000000;
+  const double magic = 6755399441055744.0; // 2^52 + 2^51
+
+  // The nominal part of a time, and the ticks to which the drift applies
+  void split(CRT::ModuleClock const& c, const int64_t ticks,
+             int64_t& whole_ns, int64_t& drift_ticks, double& drift)
+  {
+    whole_ns = c.base_ns + CRT::ns_per_tick*ticks;
+    const bool exact = ticks > -exact_limit && ticks < exact_limit;
+    drift_ticks = exact? ticks: 0;
+    drift = exact? c.drift: 0;
+  }
+
+  int64_t drift_ns(const int64_t ticks, const double drift)
+  {
+    return static_cast<int64_t>(std::nearbyint(drift*ticks));
+  }
+
+  // ns[i] = whole_ns[i] + drift[i]*ticks[i], rounded to nearest
+  void apply_drift(const int64_t * whole_ns, const int64_t * ticks,
+                   const double * drift, const size_t n, int64_t * ns)
+  {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i bits4 = _mm256_set1_epi64x(magic_bits);
+    const __m256d magic4 = _mm256_set1_pd(magic);
+    for(; i + 4 <= n; i += 4){
+      const __m256i t = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(ticks + i));
+      const __m256d td = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_add_epi64(t, bits4)), magic4);
+      const __m256d d = _mm256_add_pd(
+        _mm256_mul_pd(td, _mm256_loadu_pd(drift + i)), magic4);
+      const __m256i r = _mm256_sub_epi64(_mm256_castpd_si256(d), bits4);
+      const __m256i w = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(whole_ns + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(ns + i),
+                          _mm256_add_epi64(w, r));
+    }
+#elif defined(__SSE2__)
+    const __m128i bits2 = _mm_set1_epi64x(magic_bits);
+    const __m128d magic2 = _mm_set1_pd(magic);
+    for(; i + 2 <= n; i += 2){
+      const __m128i t = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(ticks + i));
+      const __m128d td = _mm_sub_pd(
+        _mm_castsi128_pd(_mm_add_epi64(t, bits2)), magic2);
+      const __m128d d = _mm_add_pd(
+        _mm_mul_pd(td, _mm_loadu_pd(drift + i)), magic2);
+      const __m128i r = _mm_sub_epi64(_mm_castpd_si128(d), bits2);
+      const __m128i w = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(whole_ns + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(ns + i),
+                       _mm_add_epi64(w, r));
+    }
+#endif
+
+    for(; i < n; i++) ns[i] = whole_ns[i] + drift_ns(ticks[i], drift[i]);
+  }
+}
+
+CRT::ClockCalibration::ClockCalibration(const size_t n_modules,
+                                        const double memory_seconds) :
+  n_modules_(n_modules),
+  memory_ticks_(memory_seconds*ticks_per_second),
+  modules_(new Module[n_modules])
+{
+  if(!(memory_seconds > 0))
+    throw cet::exception("CRT::ClockCalibration")
+      << "Memory must be positive, not " << memory_seconds << " seconds";
+
+  for(size_t i = 0; i < n_modules_; i++){
+    modules_[i].published.seq.store(0, std::memory_order_relaxed);
+    clear_(modules_[i]);
+    publish_(modules_[i], nominal);
+  }
+}
+
+void CRT::ClockCalibration::clear_(Module& m)
+{
+  m.unwrap.reset();
+  m.have_last = false;
+  m.last_unixtime = 0;
+  m.last_ticks = 0;
+  m.ref_ticks = m.ref_ns = 0;
+  m.weight = m.mean_ticks = m.mean_ns = m.var_ticks = m.cov = 0;
+  m.last_edge = 0;
+  m.edges = 0;
+}
+
+void CRT::ClockCalibration::reset()
+{
+  for(size_t i = 0; i < n_modules_; i++){
+    std::lock_guard<std::mutex> lock(modules_[i].mutex);
+    clear_(modules_[i]);
+    publish_(modules_[i], nominal);
+  }
+}
+
+bool CRT::ClockCalibration::observe(const uint16_t module,
+                                    const int32_t unixtime,
+                                    const uint32_t fifty_mhz_time)
+{
+  if(module >= n_modules_) return false;
+
+  Module& m = modules_[module];
+  std::lock_guard<std::mutex> lock(m.mutex);
+
+  const int64_t ticks = static_cast<int64_t>(m.unwrap(unixtime, fifty_mhz_time));
+
+  // A second boundary is somewhere between two fragments whose Unix times
+  // differ by one.  Bigger steps, or ones the counter disagrees with, say
+  // nothing useful about where it is.
+  if(m.have_last && unixtime == m.last_unixtime + 1 && ticks > m.last_ticks
+     && ticks - m.last_ticks <= 2*static_cast<int64_t>(ticks_per_second))
+    fit_(m, m.last_ticks, ticks, unixtime);
+
+  m.have_last = true;
+  m.last_unixtime = unixtime;
+  m.last_ticks = ticks;
+  return true;
+}
+
+bool CRT::ClockCalibration::observe(artdaq::Fragment const& frag)
+{
+  if(frag.dataSizeBytes() < sizeof(Fragment::header_t)) return false;
+
+  const Fragment f(frag);
+  return observe(f.module_num(), f.unixtime(), f.fifty_mhz_time());
+}
+
+void CRT::ClockCalibration::observe(DecodedHits const& hits)
+{
+  for(size_t i = 0; i < hits.n_fragments(); i++)
+    observe(hits.module_num[i], hits.unixtime[i], hits.fifty_mhz_time[i]);
+}
+
+// Add the boundary at the start of second 'unixtime', which is after tick
+// 'before' and no later than 'after', to the fit, and publish the result
+void CRT::ClockCalibration::fit_(Module& m, const int64_t before,
+                                 const int64_t after, const int32_t unixtime)
+{
+  const int64_t boundary_ns = static_cast<int64_t>(unixtime)*1000000000;
+  if(m.edges == 0){
+    m.ref_ticks = before;
+    m.ref_ns = boundary_ns;
+  }
+
+  const double gap = static_cast<double>(after - before);
+  const double x = static_cast<double>(before - m.ref_ticks) + gap/2;
+  const double y = static_cast<double>(boundary_ns - m.ref_ns);
+  const double w = 1/(gap*gap/12 + edge_jitter);
+
+  const double decay = x > m.last_edge?
+    std::exp(-(x - m.last_edge)/memory_ticks_): 1;
+  m.last_edge = std::max(m.last_edge, x);
+
+  // Weighted running means and co-moments, as in West (1979), with the
+  // weights so far decayed first
+  m.weight = decay*m.weight + w;
+  const double dx = x - m.mean_ticks;
+  m.mean_ticks += w*dx/m.weight;
+  m.mean_ns += w*(y - m.mean_ns)/m.weight;
+  m.var_ticks = decay*m.var_ticks + w*dx*(x - m.mean_ticks);
+  m.cov = decay*m.cov + w*dx*(y - m.mean_ns);
+  m.edges++;
+
+  // With weights of one over the spread of each boundary, the slope's
+  // relative error is about 1/sqrt(var_ticks)
+  double slope = ns_per_tick;
+  if(m.var_ticks*drift_precision*drift_precision >= 1){
+    const double fitted = m.cov/m.var_ticks;
+    if(std::fabs(fitted/ns_per_tick - 1) <= max_drift) slope = fitted;
+  }
+
+  const double at = std::nearbyint(m.mean_ticks);
+  ModuleClock c;
+  c.base_ticks = m.ref_ticks + static_cast<int64_t>(at);
+  c.base_ns = m.ref_ns + static_cast<int64_t>(
+    std::nearbyint(m.mean_ns + slope*(at - m.mean_ticks)));
+  c.drift = slope - ns_per_tick;
+  c.edges = m.edges;
+  publish_(m, c);
+}
+
+// Only one thread publishes a module at a time, under its mutex.  Readers
+// retry if the count was odd, or changed, while they read.
+void CRT::ClockCalibration::publish_(Module& m, ModuleClock const& c)
+{
+  Published& p = m.published;
+  uint64_t drift_bits;
+  memcpy(&drift_bits, &c.drift, sizeof drift_bits);
+
+  const uint32_t seq = p.seq.load(std::memory_order_relaxed);
+  p.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  p.base_ticks.store(c.base_ticks, std::memory_order_relaxed);
+  p.base_ns.store(c.base_ns, std::memory_order_relaxed);
+  p.drift_bits.store(drift_bits, std::memory_order_relaxed);
+  p.edges.store(c.edges, std::memory_order_relaxed);
+  p.seq.store(seq + 2, std::memory_order_release);
+}
+
+CRT::ModuleClock CRT::ClockCalibration::read_(Published const& p)
+{
+  ModuleClock c;
+  for(;;){
+    const uint32_t seq = p.seq.load(std::memory_order_acquire);
+    c.base_ticks = p.base_ticks.load(std::memory_order_relaxed);
+    c.base_ns = p.base_ns.load(std::memory_order_relaxed);
+    const uint64_t drift_bits = p.drift_bits.load(std::memory_order_relaxed);
+    c.edges = p.edges.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(!(seq & 1) && p.seq.load(std::memory_order_relaxed) == seq){
+      memcpy(&c.drift, &drift_bits, sizeof c.drift);
+      return c;
+    }
+  }
+}
+
+CRT::ModuleClock CRT::ClockCalibration::clock(const uint16_t module) const
+{
+  return module < n_modules_? read_(modules_[module].published): nominal;
+}
+
+int64_t CRT::ClockCalibration::to_ns(const uint16_t module,
+                                     const int32_t unixtime,
+                                     const uint32_t fifty_mhz_time) const
+{
+  const ModuleClock c = clock(module);
+  int64_t whole_ns, drift_ticks;
+  double drift;
+  split(c, ticks_since(c, unixtime, fifty_mhz_time),
+        whole_ns, drift_ticks, drift);
+  return whole_ns + drift_ns(drift_ticks, drift);
+}
+
+void CRT::ClockCalibration::to_ns(const uint16_t * const module,
+                                  const int32_t * const unixtime,
+                                  const uint32_t * const fifty_mhz_time,
+                                  const size_t n, int64_t * const ns,
+                                  Scratch& scratch) const
+{
+  // Every module's model, as of now, with the nominal one after them for
+  // modules out of range
+  scratch.clocks.resize(n_modules_ + 1);
+  for(size_t i = 0; i < n_modules_; i++)
+    scratch.clocks[i] = read_(modules_[i].published);
+  scratch.clocks[n_modules_] = nominal;
+
+  scratch.whole_ns.resize(n);
+  scratch.ticks.resize(n);
+  scratch.drift.resize(n);
+
+  for(size_t i = 0; i < n; i++){
+    ModuleClock const& c =
+      scratch.clocks[std::min<size_t>(module[i], n_modules_)];
+    split(c, ticks_since(c, unixtime[i], fifty_mhz_time[i]),
+          scratch.whole_ns[i], scratch.ticks[i], scratch.drift[i]);
+  }
+
+  apply_drift(scratch.whole_ns.data(), scratch.ticks.data(),
+              scratch.drift.data(), n, ns);
+}
+
+void CRT::ClockCalibration::to_ns(DecodedHits const& hits,
+                                  std::vector<int64_t>& ns,
+                                  Scratch& scratch) const
+{
+  ns.resize(hits.n_fragments());
+  to_ns(hits.module_num.data(), hits.unixtime.data(),
+        hits.fifty_mhz_time.data(), hits.n_fragments(), ns.data(), scratch);
+}
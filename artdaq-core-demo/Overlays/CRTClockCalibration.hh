@@ -0,0 +1,144 @@
+#ifndef artdaq_demo_Overlays_CRTClockCalibration_hh
+#define artdaq_demo_Overlays_CRTClockCalibration_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/CRTTimestamp.hh"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace CRT
+{
+  struct DecodedHits;
+  class ClockCalibration;
+
+  const int64_t ns_per_tick = 1000000000/ticks_per_second;
+
+  // A module's clock model: the Unix time of its 50MHz tick count t is
+  //
+  //   base_ns + (20 + drift)*(t - base_ticks)  nanoseconds
+  //
+  // where t is the counter as unwrapped by a TimestampUnwrapper.  A module
+  // not yet calibrated has the nominal model, all zeros, under which the
+  // time is 20ns times combined_time().
+  struct ModuleClock
+  {
+    int64_t base_ticks;
+    int64_t base_ns;
+    double drift;     // ns per tick more than the nominal 20
+    uint32_t edges;   // second boundaries fitted, or 0 if uncalibrated
+
+    bool calibrated() const { return edges != 0; }
+  };
+}
+
+// Learns each module's clock model online from its fragments, and converts
+// batches of fragments to absolute times in nanoseconds since the Unix
+// epoch.
+//
+// The Unix time only says which second a fragment is in, but when a module's
+// Unix time steps from one fragment to the next, the second boundary lies
+// between their 50MHz counts.  Each such boundary is one point of a
+// weighted least squares fit of Unix time against ticks, weighted by how
+// closely the two fragments bracket it, and with older points forgotten
+// exponentially over 'memory_seconds'.  The fit gives the module's offset
+// from the Unix clock and how fast its oscillator really runs.
+//
+// observe() updates a module's model under a lock of its own, then
+// publishes it with a sequence count that readers check, so conversions
+// never wait for it.  A conversion copies the models of all modules at the
+// start, unwraps each fragment's counter with its module's model, and then
+// applies the models' drift in a pass using SSE2 or AVX2 if the build
+// targets them.
+class CRT::ClockCalibration
+{
+public:
+  // Calibrate modules numbered below n_modules; others keep the nominal
+  // model.
+  explicit ClockCalibration(size_t n_modules = 256,
+                            double memory_seconds = 3600);
+
+  // Learn from one fragment's pair of clocks.  Each module's fragments must
+  // be observed in time order, as recorded.  Several threads may observe
+  // at once, though not the same module.  Returns false if the module is
+  // out of range.
+  bool observe(uint16_t module, int32_t unixtime, uint32_t fifty_mhz_time);
+  bool observe(artdaq::Fragment const& frag);
+
+  // Learn from every fragment of a batch, in order
+  void observe(DecodedHits const& hits);
+
+  // The model now published for a module
+  ModuleClock clock(uint16_t module) const;
+
+  // Forget everything learned, as for a new run.  Not to be called while
+  // observing.
+  void reset();
+
+  // Scratch space for batch conversions, which can be reused from call to
+  // call
+  struct Scratch
+  {
+    std::vector<ModuleClock> clocks;
+    std::vector<int64_t> whole_ns, ticks;
+    std::vector<double> drift;
+  };
+
+  // The time in ns of one fragment
+  int64_t to_ns(uint16_t module, int32_t unixtime,
+                uint32_t fifty_mhz_time) const;
+
+  // The times in ns of n fragments, given as columns like those of
+  // DecodedHits
+  void to_ns(const uint16_t * module, const int32_t * unixtime,
+             const uint32_t * fifty_mhz_time, size_t n, int64_t * ns,
+             Scratch& scratch) const;
+
+  // The times of the fragments in 'hits', replacing the contents of 'ns'
+  void to_ns(DecodedHits const& hits, std::vector<int64_t>& ns,
+             Scratch& scratch) const;
+
+  size_t n_modules() const { return n_modules_; }
+
+private:
+  // The model as published: written only under 'seq' being odd
+  struct Published
+  {
+    std::atomic<uint32_t> seq;
+    std::atomic<int64_t> base_ticks, base_ns;
+    std::atomic<uint64_t> drift_bits;
+    std::atomic<uint32_t> edges;
+  };
+
+  // What observe() keeps for one module
+  struct Module
+  {
+    std::mutex mutex;
+    TimestampUnwrapper unwrap;
+    bool have_last;
+    int32_t last_unixtime;
+    int64_t last_ticks;
+
+    // The fit, relative to the first boundary: weighted means and
+    // co-moments of ticks and ns, and the total weight
+    int64_t ref_ticks, ref_ns;
+    double weight, mean_ticks, mean_ns, var_ticks, cov;
+    double last_edge;
+    uint32_t edges;
+
+    Published published;
+  };
+
+  static void clear_(Module& m);
+  void fit_(Module& m, int64_t before, int64_t after, int32_t unixtime);
+  static void publish_(Module& m, ModuleClock const& c);
+  static ModuleClock read_(Published const& p);
+
+  size_t n_modules_;
+  double memory_ticks_;
+  std::unique_ptr<Module[]> modules_;
+};
+
+#endif /* artdaq_demo_Overlays_CRTClockCalibration_hh */
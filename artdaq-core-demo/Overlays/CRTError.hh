@@ -0,0 +1,57 @@
+#ifndef artdaq_demo_Overlays_CRTError_hh
+#define artdaq_demo_Overlays_CRTError_hh
+
+#include <cstdint>
+#include <cstdio>
+
+namespace CRT
+{
+  // The kinds of problem that validation of a CRT fragment can find.
+  // Each one other than no_error has its own bit in an error_mask_t.
+  enum Error : uint8_t {
+    no_error = 0,
+    bad_size,         // fragment size doesn't match the number of hits
+    bad_header_magic, // header magic isn't 'M'
+    no_hits,          // header claims zero hits
+    too_many_hits,    // header claims more hits than there are channels
+    early_unixtime,   // Unix time is before we took any data
+    bad_hit_magic,    // some hit's magic isn't 'H'
+    bad_channel,      // some hit's channel is >= 64
+    bad_adc,          // some hit's ADC value is >= 4096
+    bad_checksum,     // a checksum doesn't match the fragment
+    n_errors
+  };
+
+  typedef uint16_t error_mask_t;
+
+  static_assert(n_errors - 1 <= 8*sizeof(error_mask_t),
+                "Too many CRT error kinds for error_mask_t");
+
+  // Return the bit representing the given error in an error_mask_t
+  constexpr error_mask_t error_bit(const Error e)
+  {
+    return e == no_error? 0: error_mask_t(1u << (e - 1));
+  }
+
+  // Limits that a good CRT fragment must respect
+  const unsigned int max_hits = 64;
+  const unsigned int n_channels = 64;
+  const int adc_limit = 4096;
+
+  // I know we didn't take data before 1 May 2018, so if a fragment says
+  // it did, the data must be corrupt.
+  const int32_t earliest_unixtime = 1525147200;
+
+  // Hex dumps of bad fragments are off unless turned on here, and are then
+  // limited to the given number per second across all threads.  Pass zero
+  // to turn them off again.
+  void set_hex_dump_rate(unsigned int max_per_second);
+
+  // Return true if a hex dump may be written now, and count it if so
+  bool hex_dump_allowed();
+
+  // Write the bytes [begin, end) to the given stream as hex and characters
+  void hex_dump(FILE * stream, const uint8_t * begin, const uint8_t * end);
+}
+
+#endif /* artdaq_demo_Overlays_CRTError_hh */
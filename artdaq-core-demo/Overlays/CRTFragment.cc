@@ -0,0 +1,198 @@
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+
+#include <cstdio>
+#include <cstring>
+
+const uint32_t CRT::Fragment::trailer_magic;
+
+namespace {
+  // Print a complaint about a problem found in a header or hit
+  void complain(CRT::ValidationResult const& r)
+  {
+    switch(r.error){
+      case CRT::bad_header_magic:
+        fprintf(stderr, "CRT header has wrong magic: %c\n", int(r.value));
+        break;
+      case CRT::no_hits:
+        fprintf(stderr, "CRT event has no hits\n");
+        break;
+      case CRT::too_many_hits:
+        fprintf(stderr, "CRT event has more hits (%d) than channels (%u)\n",
+                int(r.value), CRT::n_channels);
+        break;
+      case CRT::early_unixtime:
+        fprintf(stderr, "CRT Unix time (%d) is too early\n", int(r.value));
+        break;
+      case CRT::bad_hit_magic:
+        fprintf(stderr, "CRT hit has wrong magic: %c\n", int(r.value));
+        break;
+      case CRT::bad_channel:
+        fprintf(stderr, "CRT hit has bad channel %u >= %u\n",
+                unsigned(r.value), CRT::n_channels);
+        break;
+      case CRT::bad_adc:
+        // It is a 12-bit ADC.  This number probably represents the raw
+        // ADC value before pedestal subtraction, but in any case, the
+        // pedestal is positive, so the value still can't exceed 4095.
+        fprintf(stderr, "CRT hit has bad ADC value %d >= %d\n",
+                int(r.value), CRT::adc_limit);
+        break;
+      default:
+        fprintf(stderr, "CRT fragment has %s\n", CRT::error_name(r.error));
+        break;
+    }
+  }
+
+  // Print a complaint about a fragment whose size doesn't fit its hits
+  void complain_size(CRT::Fragment const& f)
+  {
+    if(f.size() < sizeof(CRT::Fragment::header_t)){
+      fprintf(stderr, "CRT fragment isn't as big (%dB) as header (%luB)\n",
+              f.size(), sizeof(CRT::Fragment::header_t));
+      return;
+    }
+
+    const unsigned int expect_size = CRT::fragment_bytes(f.header()->nhit);
+
+    fprintf(stderr, "CRT fragment: N hit (%d -> %dB) mismatches size %uB\n",
+            f.header()->nhit, expect_size, f.size());
+
+    // Dumping every bad fragment can stall the DAQ, so only do it if
+    // asked to, and not too often.
+    if(CRT::hex_dump_allowed())
+      CRT::hex_dump(stderr, f.data(), f.data() + f.size());
+  }
+}
+
+void CRT::Fragment::print_header() const
+{
+  if(size() < sizeof(header_t)){
+    fprintf(stderr, "CRT fragment smaller (%uB) than header (%luB), "
+            "can't print\n", size(), sizeof(header_t));
+    return;
+  }
+
+  printf("CRT header: Magic = '%c'\n"
+         "            n hit = %2u\n"
+         "            module = %5u\n"
+         "            Unix time  = %10d (0x%8x)\n"
+         "            50Mhz time = %10u (0x%8x)\n",
+         header()->magic, header()->nhit, header()->module_num,
+         header()->unixtime, header()->unixtime,
+         header()->fifty_mhz_time, header()->fifty_mhz_time);
+}
+
+void CRT::Fragment::print_hit(const int i) const
+{
+  // Is pointer arithmetic valid in the case that we're checking for?  Not
+  // sure what the standard says, but I think that practically this should
+  // work.
+  if((uint8_t *)hit(i) + sizeof(hit_t) > data() + size()){
+    fprintf(stderr, "Hit %d would be past end of fragment, can't print\n", i);
+    return;
+  }
+
+  printf("CRT hit %2d: Magic = '%c'\n"
+         "            channel = %2u\n"
+         "            ADC     = %4hd\n",
+         i, hit(i)->magic, hit(i)->channel, hit(i)->adc);
+}
+
+void CRT::Fragment::print_hits() const
+{
+  for(int i = 0; i < header()->nhit; i++)
+    print_hit(i);
+  puts("");
+}
+
+bool CRT::Fragment::good_header() const
+{
+  const ValidationResult r = check_header(*header());
+  if(!r.ok()) complain(r);
+  return r.ok();
+}
+
+bool CRT::Fragment::good_hit(const int i) const
+{
+  const ValidationResult r = check_hit(*hit(i), i);
+  if(!r.ok()) complain(r);
+  return r.ok();
+}
+
+bool CRT::Fragment::good_size() const
+{
+  if(check_size(data(), size()).ok()) return true;
+
+  complain_size(*this);
+  return false;
+}
+
+bool CRT::Fragment::has_checksum() const
+{
+  const size_t body = fragment_bytes(header()->nhit);
+  if(size() != body + sizeof(trailer_t)) return false;
+
+  trailer_t t;
+  memcpy(&t, data() + body, sizeof t);
+  return t.magic == trailer_magic;
+}
+
+bool CRT::Fragment::checksum_span(demo::ChecksumSpan& span) const
+{
+  if(size() < sizeof(header_t) || !has_checksum()) return false;
+
+  trailer_t t;
+  span.begin = data();
+  span.bytes = fragment_bytes(header()->nhit);
+  memcpy(&t, data() + span.bytes, sizeof t);
+  span.expected = t.checksum;
+  span.complete = true;
+  return true;
+}
+
+bool CRT::Fragment::good_checksum() const
+{
+  demo::ChecksumSpan span;
+  return !checksum_span(span) || demo::checksumMatches(span);
+}
+
+bool CRT::Fragment::good_event() const
+{
+  const ValidationResult r = check_event(data(), size());
+  if(r.ok()) return true;
+
+  switch(r.error){
+    case bad_size:
+      complain_size(*this);
+      break;
+    case bad_checksum:
+      fprintf(stderr, "CRT fragment checksum doesn't match\n");
+      break;
+    default:
+      complain(r);
+      break;
+  }
+  return false;
+}
+
+std::ostream& CRT::operator<<(std::ostream& os, Fragment const& f)
+{
+  if(f.size() < sizeof(Fragment::header_t))
+    return os << "CRT fragment too small (" << f.size() << "B) for header\n";
+
+  os << "CRT fragment module: " << f.module_num()
+     << ", hits: " << f.num_hits()
+     << ", Unix time: " << f.unixtime()
+     << ", 50MHz time: " << f.fifty_mhz_time()
+     << "\n";
+
+  for(unsigned int i = 0; i < f.num_hits(); i++){
+    if(reinterpret_cast<const uint8_t *>(f.hit(i) + 1)
+       > reinterpret_cast<const uint8_t *>(f.header()) + f.size())
+      break;
+    os << "  hit " << i << " channel: " << unsigned(f.channel(i))
+       << ", ADC: " << f.adc(i) << "\n";
+  }
+  return os;
+}
@@ -4,12 +4,16 @@
 #define artdaq_demo_Overlays_CRTFragment_hh
 
 #include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/Checksum.hh"
 
 #include <ostream>
 
 namespace CRT
 {
 	class Fragment;
+
+	// Print the header and hits to the given stream
+	std::ostream& operator<<(std::ostream&, Fragment const&);
 }
 
 class CRT::Fragment
@@ -30,6 +34,15 @@ public:
     int16_t adc;
   };
 
+  // A fragment may end with a trailer, after its hits and their padding,
+  // holding a CRC-32C of everything before it (see Checksum.hh).
+  struct trailer_t{
+    uint32_t magic; // must be trailer_magic
+    uint32_t checksum;
+  };
+
+  static const uint32_t trailer_magic = 0x43323343; // "C32C"
+
   // Return the module number for this fragment.  A CRT fragment consists
   // of a set of hits sharing a time stamp from one module.
   uint16_t module_num() const
@@ -44,13 +57,13 @@ public:
   }
 
   // Return the Unix timestamp (seconds since 1 Jan 1970)
-  int32_t unixtime()
+  int32_t unixtime() const
   {
     return header()->unixtime;
   }
 
   // Return the value of the 50MHz counter
-  uint32_t fifty_mhz_time()
+  uint32_t fifty_mhz_time() const
   {
     return header()->fifty_mhz_time;
   }
@@ -58,7 +71,7 @@ public:
   // Return the channel number of the ith hit.  That hit must exist.
   uint8_t channel(const int i) const
   {
-    return hit(i)->adc;
+    return hit(i)->channel;
   }
 
   // Return the ADC value of the ith hit.  That hit must exist.
@@ -69,176 +82,100 @@ public:
 
   // Print the header to stdout, even if it is bad, but not if it
   // isn't all there.
-  void print_header() const
-  {
-    if(size() < sizeof(header_t)){
-      fprintf(stderr, "CRT fragment smaller (%uB) than header (%luB), "
-              "can't print\n", size(), sizeof(header_t));
-      return;
-    }
-
-    printf("CRT header: Magic = '%c'\n"
-           "            n hit = %2u\n"
-           "            module = %5u\n"
-           "            Unix time  = %10d (0x%8x)\n"
-           "            50Mhz time = %10u (0x%8x)\n",
-           header()->magic, header()->nhit, header()->module_num,
-           header()->unixtime, header()->unixtime,
-           header()->fifty_mhz_time, header()->fifty_mhz_time);
-  }
+  void print_header() const;
 
   // Print the given hit to stdout, even if it is bad, but not if it
   // isn't all there.
-  void print_hit(const int i) const
-  {
-    // Is pointer arithmetic valid in the case that we're checking for?  Not
-    // sure what the standard says, but I think that practically this should
-    // work.
-    if((uint8_t *)hit(i) + sizeof(hit_t) > thefrag.dataEndBytes()){
-      fprintf(stderr, "Hit %d would be past end of fragment, can't print\n", i);
-      return;
-    }
-
-    printf("CRT hit %2d: Magic = '%c'\n"
-           "            channel = %2u\n"
-           "            ADC     = %4hd\n",
-           i, hit(i)->magic, hit(i)->channel, hit(i)->adc);
-  }
+  void print_hit(const int i) const;
 
   // Print all the hits
-  void print_hits() const
-  {
-    for(int i = 0; i < header()->nhit; i++)
-      print_hit(i);
-    puts("");
-  }
+  void print_hits() const;
 
   // Returns true if the header contains sensible values.  Otherwise,
   // prints a complaint and returns false.  Assumes header is complete
   // (check good_size() first).
-  bool good_header() const
-  {
-    const header_t * const h = header();
-    if(h->magic != 'M'){
-      fprintf(stderr, "CRT header has wrong magic: %c\n", h->magic);
-      return false;
-    }
-    if(h->nhit == 0){
-      fprintf(stderr, "CRT event has no hits\n");
-      return false;
-    }
-    if(h->nhit > 64){
-      fprintf(stderr, "CRT event has more hits (%d) than channels (64)\n",
-              h->nhit);
-      return false;
-    }
-    if(h->unixtime < 1525147200){
-      // I know we didn't take data before 1 May 2018, so if it says it did,
-      // the data must be corrupt.
-      fprintf(stderr, "CRT Unix time (%d) is too early\n", h->unixtime);
-      return false;
-    }
-    return true;
-  }
+  bool good_header() const;
 
   // Returns true if the hit contains sensible values.  Otherwise,
   // prints a complaint and returns false.  Assumes hit exists and
   // is complete (check good_size() first).
-  bool good_hit(const int i) const
-  {
-    const hit_t * const h = hit(i);
-    if(h->magic != 'H'){
-      fprintf(stderr, "CRT hit has wrong magic: %c\n", h->magic);
-      return false;
-    }
-    if(h->channel >= 64){
-      fprintf(stderr, "CRT hit has bad channel %u >= 64\n", h->channel);
-      return false;
-    }
-    if(h->adc >= 4096){
-      // It is a 12-bit ADC.  This number probably represents the raw
-      // ADC value before pedestal subtraction, but in any case, the
-      // pedestal is positive, so the value still can't exceed 4095.
-      fprintf(stderr, "CRT hit has bad ADC value %hd >= 4096\n", h->adc);
-      return false;
-    }
-    return true;
-  }
+  bool good_hit(const int i) const;
 
   // Return the size of the CRT fragment in bytes.
   unsigned int size() const
   {
-    return thefrag.dataEndBytes() - thefrag.dataBeginBytes();
+    return thefrag ? thefrag->dataEndBytes() - thefrag->dataBeginBytes()
+                   : payload_bytes;
   }
 
   // Returns true if the fragment is as big as the header says it is,
   // and false if it isn't, or it doesn't even have a full header.
   // i.e. if this is false, you're going to seg fault (or wish you had)
   // if you read the fragment.
-  bool good_size() const
-  {
-    if(size() < sizeof(header_t)){
-      fprintf(stderr, "CRT fragment isn't as big (%dB) as header (%luB)\n",
-              size(), sizeof(header_t));
-      return false;
-    }
-
-    const unsigned int expect_size =
-      (sizeof(header_t) + header()->nhit * sizeof(hit_t)
-       + sizeof(artdaq::RawDataType) - 1)
-       /sizeof(artdaq::RawDataType)
-       *sizeof(artdaq::RawDataType);
-
-    if(size() != expect_size){
-      fprintf(stderr, "CRT fragment: N hit (%d -> %dB) mismatches size %uB\n",
-              header()->nhit, expect_size, size());
-      for(char * c = (char *) thefrag.dataBeginBytes();
-                 c < (char *)thefrag.dataEndBytes();
-                 c++){
-        fprintf(stderr, "%02hhx/%c ", (unsigned char)*c,
-                isprint((unsigned char)*c)?(unsigned char)*c:'.');
-        if((c - (char*)thefrag.dataBeginBytes())%0x08 == 0x07)
-          fprintf(stderr, " ");
-        if((c - (char*)thefrag.dataBeginBytes())%0x10 == 0x0f)
-          fprintf(stderr, "\n");
-      }
-      fprintf(stderr, "\n");
-      return false;
-    }
-    return true;
-  }
+  bool good_size() const;
 
-  // Return true if the fragment contains a complete and sensible event.
-  bool good_event() const
-  {
-    if(!good_size()) return false;
+  // Returns true if the fragment ends with a checksum trailer, that is, if
+  // it has room for exactly one after its hits and their padding, and the
+  // trailer's magic is right.  Assumes the header is complete.
+  bool has_checksum() const;
 
-    if(!good_header()) return false;
+  // Find what the checksum covers, which is the header, hits and padding.
+  // Returns false if there is no trailer.
+  bool checksum_span(demo::ChecksumSpan& span) const;
 
-    for(unsigned int i = 0; i < header()->nhit; i++)
-      if(!good_hit(i))
-        return false;
+  // Returns true if the checksum matches, or there is no trailer
+  bool good_checksum() const;
 
-    return true;
-  }
+  // Return true if the fragment contains a complete and sensible event.
+  // For the same checks without the printing, see CRTValidation.hh.
+  bool good_event() const;
 
   // Return a pointer to hit 'i'.  Not range checked.
   const hit_t * hit(const int i) const
   {
     return reinterpret_cast<const hit_t *>
-      (thefrag.dataBeginBytes() + sizeof(header_t) + i*sizeof(hit_t));
+      (data() + sizeof(header_t) + i*sizeof(hit_t));
   }
 
   // Return a pointer to the header
   const header_t * header() const
   {
-    return reinterpret_cast<const header_t *>(thefrag.dataBeginBytes());
+    return reinterpret_cast<const header_t *>(data());
+  }
+
+  // Return a pointer to the start of the fragment's data, where the
+  // header is.  This is looked up in the artdaq::Fragment each time, if
+  // there is one, so that it is right even after the Fragment is resized.
+  const uint8_t * data() const
+  {
+    return thefrag ? reinterpret_cast<const uint8_t *>(thefrag->dataBeginBytes())
+                   : payload;
   }
 
-  explicit Fragment(artdaq::Fragment const& f) : thefrag(f) {}
+  explicit Fragment(artdaq::Fragment const& f) :
+    thefrag(&f), payload(nullptr), payload_bytes(0) {}
+
+  // Overlay data that isn't in an artdaq::Fragment, such as a fragment
+  // in a mapped file.  'data' is where the header starts.
+  Fragment(const uint8_t * data, const size_t size) :
+    thefrag(nullptr), payload(data), payload_bytes(size) {}
 
 private:
-  artdaq::Fragment const& thefrag;
+  artdaq::Fragment const* thefrag; // null if overlaying raw data
+  const uint8_t * payload;         // the raw data, if thefrag is null
+  size_t payload_bytes;
 };
 
+namespace CRT
+{
+  // Size in bytes of a CRT fragment with nhit hits, rounded up to whole
+  // artdaq::RawDataType words, not counting any checksum trailer
+  inline size_t fragment_bytes(const unsigned int nhit)
+  {
+    return (sizeof(Fragment::header_t) + nhit*sizeof(Fragment::hit_t)
+            + sizeof(artdaq::RawDataType) - 1)
+            /sizeof(artdaq::RawDataType)*sizeof(artdaq::RawDataType);
+  }
+}
+
 #endif /* artdaq_demo_Overlays_CRTFragment_hh */
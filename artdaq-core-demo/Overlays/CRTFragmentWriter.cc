@@ -0,0 +1,119 @@
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+
+CRT::BatchBuilder::BatchBuilder(const size_t max_fragments,
+                                const unsigned int max_hits_per_fragment,
+                                const bool checksums) :
+  max_fragments_(max_fragments), max_hits_(max_hits_per_fragment),
+  checksums_(checksums), offsets_(1, 0), open_(false)
+{
+  if(max_hits_per_fragment > max_hits)
+    throw cet::exception("CRT::BatchBuilder")
+      << "Fragments of " << max_hits_per_fragment
+      << " hits would have more than " << max_hits;
+
+  // Every fragment's header and hits, and its padding and trailer, fit in
+  // this many words, so nothing is ever reallocated
+  const size_t most_bytes = fragment_bytes(max_hits_)
+    + (checksums_? sizeof(Fragment::trailer_t): 0);
+  buffer_.resize(max_fragments*most_bytes/sizeof(artdaq::RawDataType));
+  offsets_.reserve(max_fragments + 1);
+}
+
+void CRT::BatchBuilder::begin(const uint16_t module_num, const int32_t unixtime,
+                              const uint32_t fifty_mhz_time)
+{
+  if(open_)
+    throw cet::exception("CRT::BatchBuilder")
+      << "Fragment " << size() << " was begun and not ended";
+  if(full())
+    throw cet::exception("CRT::BatchBuilder")
+      << "Batch is full with " << size() << " fragments";
+
+  Fragment::header_t h;
+  h.magic = 'M';
+  h.nhit = 0;
+  h.module_num = module_num;
+  h.unixtime = unixtime;
+  h.fifty_mhz_time = fifty_mhz_time;
+  memcpy(cursor_(), &h, sizeof h);
+  open_ = true;
+}
+
+void CRT::BatchBuilder::add_hit(const uint8_t channel, const int16_t adc)
+{
+  if(!open_)
+    throw cet::exception("CRT::BatchBuilder") << "No fragment begun";
+
+  Fragment::header_t * const h = open_header_();
+  if(h->nhit >= max_hits_)
+    throw cet::exception("CRT::BatchBuilder")
+      << "No room for hit " << h->nhit + 1 << " of " << max_hits_;
+
+  Fragment::hit_t hit;
+  hit.magic = 'H';
+  hit.channel = channel;
+  hit.adc = adc;
+  memcpy(cursor_() + sizeof *h + h->nhit*sizeof hit, &hit, sizeof hit);
+  h->nhit++;
+}
+
+size_t CRT::BatchBuilder::end()
+{
+  if(!open_)
+    throw cet::exception("CRT::BatchBuilder") << "No fragment begun";
+
+  open_ = false;
+  return finish_(open_header_()->nhit);
+}
+
+size_t CRT::BatchBuilder::add(Fragment::header_t const& header,
+                              const Fragment::hit_t * const hits,
+                              const unsigned int n)
+{
+  if(open_)
+    throw cet::exception("CRT::BatchBuilder")
+      << "Fragment " << size() << " was begun and not ended";
+  if(full())
+    throw cet::exception("CRT::BatchBuilder")
+      << "Batch is full with " << size() << " fragments";
+  if(n > max_hits_)
+    throw cet::exception("CRT::BatchBuilder")
+      << "Fragment of " << n << " hits has more than " << max_hits_;
+
+  Fragment::header_t h = header;
+  h.nhit = n;
+  memcpy(cursor_(), &h, sizeof h);
+  memcpy(cursor_() + sizeof h, hits, n*sizeof *hits);
+  return finish_(n);
+}
+
+size_t CRT::BatchBuilder::finish_(const unsigned int nhit)
+{
+  const size_t used = sizeof(Fragment::header_t) + nhit*sizeof(Fragment::hit_t);
+  size_t bytes = fragment_bytes(nhit);
+  memset(cursor_() + used, 0, bytes - used);
+
+  if(checksums_){
+    Fragment::trailer_t t;
+    t.magic = Fragment::trailer_magic;
+    t.checksum = demo::crc32c(cursor_(), bytes);
+    memcpy(cursor_() + bytes, &t, sizeof t);
+    bytes += sizeof t;
+  }
+
+  offsets_.push_back(offsets_.back() + bytes);
+  return size() - 1;
+}
+
+void CRT::BatchBuilder::copy_to(const size_t i, artdaq::Fragment& f) const
+{
+  const size_t n = offsets_[i+1] - offsets_[i];
+  f.resizeBytes(n);
+  memcpy(f.dataBeginBytes(), data() + offsets_[i], n);
+}
+
+void CRT::BatchBuilder::clear()
+{
+  offsets_.resize(1);
+  open_ = false;
+}
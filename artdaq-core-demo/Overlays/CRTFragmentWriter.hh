@@ -0,0 +1,191 @@
+#ifndef artdaq_demo_Overlays_CRTFragmentWriter_hh
+#define artdaq_demo_Overlays_CRTFragmentWriter_hh
+
+#include "artdaq-core-demo/Overlays/CRTError.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+
+#include "cetlib/exception.h"
+
+#include <cstring>
+#include <vector>
+
+// Construction of CRT fragments in place, instead of building the header
+// and hits somewhere else and copying them in.  FragmentWriter fills one
+// artdaq::Fragment; BatchBuilder fills one buffer with many fragments.
+
+namespace CRT
+{
+  class FragmentWriter;
+  class BatchBuilder;
+
+}
+
+// Writes a CRT fragment into an artdaq::Fragment.  The constructor sizes
+// the Fragment once for the most hits it will get, and a checksum trailer,
+// add_hit() writes each hit where it belongs, and finalize() shrinks the
+// Fragment to the hits added, which keeps its storage.  Nothing is copied.
+class CRT::FragmentWriter: public CRT::Fragment
+{
+public:
+  // Overlay f, which must have no payload yet, and write the header.
+  // Throws cet::exception if f has a payload or capacity is more than
+  // max_hits.
+  FragmentWriter(artdaq::Fragment& f, uint16_t module_num, int32_t unixtime,
+                 uint32_t fifty_mhz_time, unsigned int capacity = max_hits);
+
+  // Append a hit.  Throws cet::exception if there is no room.
+  void add_hit(const uint8_t channel, const int16_t adc)
+  {
+    if(header_()->nhit >= capacity_)
+      throw cet::exception("CRT::FragmentWriter")
+        << "No room for hit " << header_()->nhit + 1 << " of " << capacity_;
+
+    hit_t h;
+    h.magic = 'H';
+    h.channel = channel;
+    h.adc = adc;
+    memcpy(frag_.dataBeginBytes() + sizeof(header_t)
+           + header_()->nhit*sizeof(hit_t), &h, sizeof h);
+    header_()->nhit++;
+  }
+
+  // Shrink the Fragment to the hits added, zeroing the padding after them,
+  // and if asked, add a checksum trailer.  Hits can't be added afterwards.
+  void finalize(const bool checksum = false)
+  {
+    const unsigned int nhit = header_()->nhit;
+    const size_t body = fragment_bytes(nhit);
+    frag_.resizeBytes(body + (checksum? sizeof(trailer_t): 0));
+    const size_t used = sizeof(header_t) + nhit*sizeof(hit_t);
+    memset(frag_.dataBeginBytes() + used, 0, body - used);
+    if(checksum){
+      trailer_t t;
+      t.magic = trailer_magic;
+      t.checksum = demo::crc32c(frag_.dataBeginBytes(), body);
+      memcpy(frag_.dataBeginBytes() + body, &t, sizeof t);
+    }
+    capacity_ = nhit;
+  }
+
+private:
+  header_t * header_()
+  {
+    return reinterpret_cast<header_t *>(frag_.dataBeginBytes());
+  }
+
+  artdaq::Fragment& frag_;
+  unsigned int capacity_;
+};
+
+inline CRT::FragmentWriter::FragmentWriter(artdaq::Fragment& f,
+                                           const uint16_t module_num,
+                                           const int32_t unixtime,
+                                           const uint32_t fifty_mhz_time,
+                                           const unsigned int capacity) :
+  Fragment(f), frag_(f), capacity_(capacity)
+{
+  if(f.dataSizeBytes() > 0)
+    throw cet::exception("CRT::FragmentWriter")
+      << "artdaq::Fragment already has a payload of " << f.dataSizeBytes()
+      << " bytes";
+  if(capacity > max_hits)
+    throw cet::exception("CRT::FragmentWriter")
+      << "Capacity of " << capacity << " hits is more than " << max_hits;
+
+  frag_.resizeBytes(fragment_bytes(capacity) + sizeof(trailer_t));
+
+  header_t h;
+  h.magic = 'M';
+  h.nhit = 0;
+  h.module_num = module_num;
+  h.unixtime = unixtime;
+  h.fifty_mhz_time = fifty_mhz_time;
+  memcpy(header_(), &h, sizeof h);
+}
+
+// Many CRT fragments, one after another in one buffer that is allocated
+// once, each starting on an artdaq::RawDataType boundary.  The fragments
+// are read through CRT::Fragment overlays of the buffer, which stay valid
+// until clear(), or copied out into artdaq::Fragments.
+//
+// Build each fragment with begin(), add_hit() and end(), or all at once
+// with add().  Each one can be given a checksum trailer as it is finished.
+class CRT::BatchBuilder
+{
+public:
+  // Room for max_fragments fragments of up to max_hits_per_fragment hits,
+  // with checksum trailers if 'checksums' is true.  Throws cet::exception
+  // if max_hits_per_fragment is more than max_hits.
+  explicit BatchBuilder(size_t max_fragments,
+                        unsigned int max_hits_per_fragment = max_hits,
+                        bool checksums = false);
+
+  // Start a fragment.  Throws cet::exception if one is already started or
+  // the batch is full.
+  void begin(uint16_t module_num, int32_t unixtime, uint32_t fifty_mhz_time);
+
+  // Append a hit to the fragment begun.  Throws cet::exception if none is
+  // begun, or it already has max_hits_per_fragment hits.
+  void add_hit(uint8_t channel, int16_t adc);
+
+  // Finish the fragment begun, and return its index
+  size_t end();
+
+  // Add a whole fragment, copying its header, with nhit set to n, and its
+  // n hits.  Returns its index.  Throws cet::exception like begin() and
+  // add_hit().
+  size_t add(Fragment::header_t const& header, const Fragment::hit_t * hits,
+             unsigned int n);
+
+  // Number of fragments finished
+  size_t size() const { return offsets_.size() - 1; }
+
+  // Whether another fragment fits
+  bool full() const { return size() == max_fragments_; }
+
+  // The most hits a fragment can have
+  unsigned int max_hits_per_fragment() const { return max_hits_; }
+
+  // Overlay fragment i
+  Fragment fragment(const size_t i) const
+  {
+    return Fragment(data() + offsets_[i], offsets_[i+1] - offsets_[i]);
+  }
+
+  // Copy fragment i into f's payload, resizing it to fit
+  void copy_to(size_t i, artdaq::Fragment& f) const;
+
+  // All of the fragments, back to back
+  const uint8_t * data() const
+  {
+    return reinterpret_cast<const uint8_t *>(buffer_.data());
+  }
+  size_t bytes() const { return offsets_.back(); }
+
+  // Forget the fragments, keeping the buffer
+  void clear();
+
+private:
+  uint8_t * cursor_()
+  {
+    return reinterpret_cast<uint8_t *>(buffer_.data()) + offsets_.back();
+  }
+
+  Fragment::header_t * open_header_()
+  {
+    return reinterpret_cast<Fragment::header_t *>(cursor_());
+  }
+
+  // Pad the fragment at cursor_(), which has nhit hits, add its trailer
+  // if there is to be one, and return its index
+  size_t finish_(unsigned int nhit);
+
+  size_t max_fragments_;
+  unsigned int max_hits_;
+  bool checksums_;
+  std::vector<artdaq::RawDataType> buffer_;
+  std::vector<size_t> offsets_; // where each fragment starts, then the end
+  bool open_;
+};
+
+#endif /* artdaq_demo_Overlays_CRTFragmentWriter_hh */
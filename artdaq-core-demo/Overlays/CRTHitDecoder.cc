@@ -0,0 +1,150 @@
+#include "artdaq-core-demo/Overlays/CRTHitDecoder.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/OverlayStats.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+  typedef CRT::Fragment::header_t header_t;
+  typedef CRT::Fragment::hit_t hit_t;
+
+  static_assert(sizeof(hit_t) == 4, "SIMD hit unpacking assumes 4-byte hits");
+
+  // Return the number of hits the fragment holds, or -1 if it is too small
+  // to hold its header and all the hits the header claims.
+  int hits_present(artdaq::Fragment const& frag)
+  {
+    const size_t size = frag.dataEndBytes() - frag.dataBeginBytes();
+    if(size < sizeof(header_t)) return -1;
+    const unsigned int nhit =
+      reinterpret_cast<const header_t *>(frag.dataBeginBytes())->nhit;
+    if(size < sizeof(header_t) + nhit*sizeof(hit_t)) return -1;
+    return nhit;
+  }
+
+  // Split n hits starting at p, which need not be aligned, into channels
+  // and ADC values.
+  void unpack_hits(const uint8_t * const p, const unsigned int n,
+                   uint8_t * const channel, int16_t * const adc)
+  {
+    unsigned int i = 0;
+
+#if defined(__SSE2__)
+    // Each hit, as a little-endian 32-bit word, has the channel in bits 8-15
+    // and the ADC value in bits 16-31.  Shift those down and pack eight
+    // hits' worth into eight bytes of channels and eight words of ADC.
+    const __m128i low = _mm_set1_epi32(0xff);
+    for(; i + 8 <= n; i += 8){
+      const __m128i v0 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(p + i*sizeof(hit_t)));
+      const __m128i v1 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(p + (i + 4)*sizeof(hit_t)));
+
+      const __m128i a = _mm_packs_epi32(_mm_srai_epi32(v0, 16),
+                                        _mm_srai_epi32(v1, 16));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(adc + i), a);
+
+      const __m128i c = _mm_packs_epi32(
+        _mm_and_si128(_mm_srli_epi32(v0, 8), low),
+        _mm_and_si128(_mm_srli_epi32(v1, 8), low));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(channel + i),
+                       _mm_packus_epi16(c, c));
+    }
+#endif
+
+    for(; i < n; i++){
+      hit_t h;
+      memcpy(&h, p + i*sizeof(hit_t), sizeof h);
+      channel[i] = h.channel;
+      adc[i] = h.adc;
+    }
+  }
+
+  // Append a fragment already known to hold nhit hits
+  void append(artdaq::Fragment const& frag, const unsigned int nhit,
+              CRT::DecodedHits& out)
+  {
+    header_t h;
+    memcpy(&h, frag.dataBeginBytes(), sizeof h);
+
+    out.module_num.push_back(h.module_num);
+    out.unixtime.push_back(h.unixtime);
+    out.fifty_mhz_time.push_back(h.fifty_mhz_time);
+
+    const size_t first = out.channel.size();
+    out.channel.resize(first + nhit);
+    out.adc.resize(first + nhit);
+    unpack_hits(frag.dataBeginBytes() + sizeof(header_t), nhit,
+                out.channel.data() + first, out.adc.data() + first);
+
+    out.hit_begin.push_back(first + nhit);
+  }
+
+  // Make room for n more elements, if there isn't room already.  Reserving
+  // exactly what is needed on each call would reallocate on every call, so
+  // at least double the capacity instead.
+  template<typename T>
+  void reserve_more(std::vector<T>& v, const size_t n)
+  {
+    if(v.capacity() - v.size() >= n) return;
+    v.reserve(std::max(v.size() + n, 2*v.capacity()));
+  }
+
+  // Decode a run of fragments, growing each column at most once up front
+  template<typename Get>
+  size_t decode_run(Get get, const size_t n, CRT::DecodedHits& out)
+  {
+    DEMO_OVERLAY_TIMER(demo::FragmentType::CRT, Decode);
+
+    size_t nhit_total = 0;
+    for(size_t i = 0; i < n; i++){
+      const int nhit = hits_present(get(i));
+      if(nhit >= 0) nhit_total += nhit;
+    }
+
+    reserve_more(out.channel, nhit_total);
+    reserve_more(out.adc, nhit_total);
+    reserve_more(out.module_num, n);
+    reserve_more(out.unixtime, n);
+    reserve_more(out.fifty_mhz_time, n);
+    reserve_more(out.hit_begin, n);
+
+    size_t ndecoded = 0;
+    for(size_t i = 0; i < n; i++){
+      const int nhit = hits_present(get(i));
+      if(nhit < 0) continue;
+      append(get(i), nhit, out);
+      ndecoded++;
+    }
+    return ndecoded;
+  }
+}
+
+bool CRT::decode(artdaq::Fragment const& frag, DecodedHits& out)
+{
+  DEMO_OVERLAY_TIMER(demo::FragmentType::CRT, Decode);
+
+  const int nhit = hits_present(frag);
+  if(nhit < 0) return false;
+  append(frag, nhit, out);
+  return true;
+}
+
+size_t CRT::decode(artdaq::Fragment const* const frags, const size_t n,
+                   DecodedHits& out)
+{
+  return decode_run([frags](const size_t i) -> artdaq::Fragment const&
+                    { return frags[i]; }, n, out);
+}
+
+size_t CRT::decode(artdaq::Fragment const* const* const frags, const size_t n,
+                   DecodedHits& out)
+{
+  return decode_run([frags](const size_t i) -> artdaq::Fragment const&
+                    { return *frags[i]; }, n, out);
+}
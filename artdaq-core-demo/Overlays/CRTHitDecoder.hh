@@ -0,0 +1,63 @@
+#ifndef artdaq_demo_Overlays_CRTHitDecoder_hh
+#define artdaq_demo_Overlays_CRTHitDecoder_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+
+#include <vector>
+
+namespace CRT
+{
+  struct DecodedHits;
+
+  // Unpack the hits of a CRT fragment, appending them to out.  Returns false,
+  // and appends nothing, if the fragment isn't big enough to hold the header
+  // and all the hits it claims.  Doesn't otherwise validate the fragment;
+  // see CRTBatchValidator.hh for that.
+  bool decode(artdaq::Fragment const& frag, DecodedHits& out);
+
+  // Unpack n contiguous fragments, or n fragments given by pointer, into out.
+  // Fragments too small for their hits are skipped.  Returns the number of
+  // fragments decoded.
+  size_t decode(artdaq::Fragment const* frags, size_t n, DecodedHits& out);
+  size_t decode(artdaq::Fragment const* const* frags, size_t n,
+                DecodedHits& out);
+}
+
+// The hits of one or more CRT fragments, as plain arrays that loops can
+// vectorize over, instead of CRT::Fragment::hit_t records.  Per-hit columns
+// are indexed by hit; per-fragment columns by fragment.  The hits of
+// fragment f are [hit_begin[f], hit_begin[f+1]).
+//
+// Reuse one of these across calls: clear() keeps the allocated capacity.
+struct CRT::DecodedHits
+{
+  // Per hit
+  std::vector<uint8_t> channel;
+  std::vector<int16_t> adc;
+
+  // Per fragment
+  std::vector<uint16_t> module_num;
+  std::vector<int32_t> unixtime;
+  std::vector<uint32_t> fifty_mhz_time;
+
+  // Per fragment, plus one past the end
+  std::vector<uint32_t> hit_begin;
+
+  DecodedHits() : hit_begin(1, 0) {}
+
+  size_t n_fragments() const { return module_num.size(); }
+  size_t n_hits() const { return channel.size(); }
+
+  // Forget all hits, but keep the memory for reuse
+  void clear()
+  {
+    channel.clear();
+    adc.clear();
+    module_num.clear();
+    unixtime.clear();
+    fifty_mhz_time.clear();
+    hit_begin.assign(1, 0);
+  }
+};
+
+#endif /* artdaq_demo_Overlays_CRTHitDecoder_hh */
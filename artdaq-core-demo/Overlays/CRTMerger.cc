@@ -0,0 +1,212 @@
+#include "artdaq-core-demo/Overlays/CRTMerger.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+
+#include "cetlib/exception.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+  typedef std::pair<uint64_t, size_t> heap_entry;
+  typedef std::greater<heap_entry> min_first;
+}
+
+CRT::FragmentMerger::FragmentMerger(const size_t nstreams,
+                                    const size_t max_queued) :
+  streams_(nstreams), capacity_(max_queued), nqueued_(0), nfull_(0),
+  nopen_empty_(nstreams)
+{
+  if(max_queued == 0)
+    throw cet::exception("CRT::FragmentMerger: max_queued must be positive");
+
+  for(auto & s : streams_){
+    s.ring.resize(capacity_);
+    s.head = s.count = 0;
+    s.open = true;
+  }
+  heap_.reserve(nstreams);
+}
+
+bool CRT::FragmentMerger::push(const size_t stream,
+                               artdaq::Fragment const& frag)
+{
+  Stream & s = streams_.at(stream);
+  if(s.count == capacity_) return false;
+
+  CRT::Fragment const crt(frag);
+  TimedFragment & tf = s.ring[(s.head + s.count)%capacity_];
+  tf.time = s.unwrap(crt.unixtime(), crt.fifty_mhz_time());
+  tf.frag = &frag;
+  tf.stream = stream;
+
+  if(s.count == 0){
+    if(s.open) nopen_empty_--;
+    heap_.emplace_back(tf.time, stream);
+    std::push_heap(heap_.begin(), heap_.end(), min_first());
+  }
+  s.open = true;
+  if(++s.count == capacity_) nfull_++;
+  nqueued_++;
+  return true;
+}
+
+void CRT::FragmentMerger::close(const size_t stream)
+{
+  Stream & s = streams_.at(stream);
+  if(!s.open) return;
+  s.open = false;
+  if(s.count == 0) nopen_empty_--;
+}
+
+bool CRT::FragmentMerger::pop(TimedFragment& out)
+{
+  if(heap_.empty() || (nopen_empty_ > 0 && nfull_ == 0)) return false;
+  take(out);
+  return true;
+}
+
+bool CRT::FragmentMerger::pop_any(TimedFragment& out)
+{
+  if(heap_.empty()) return false;
+  take(out);
+  return true;
+}
+
+void CRT::FragmentMerger::take(TimedFragment& out)
+{
+  std::pop_heap(heap_.begin(), heap_.end(), min_first());
+  Stream & s = streams_[heap_.back().second];
+  heap_.pop_back();
+
+  out = s.ring[s.head];
+  if(s.count == capacity_) nfull_--;
+  s.head = (s.head + 1)%capacity_;
+  s.count--;
+  nqueued_--;
+
+  if(s.count > 0){
+    heap_.emplace_back(s.ring[s.head].time, out.stream);
+    std::push_heap(heap_.begin(), heap_.end(), min_first());
+  }
+  else if(s.open){
+    nopen_empty_++;
+  }
+}
+
+CRT::CoincidenceFinder::CoincidenceFinder(const uint64_t window,
+                                          const unsigned int min_modules,
+                                          const size_t max_fragments) :
+  window_(window), min_modules_(min_modules), max_fragments_(max_fragments),
+  dropped_(0), window_ring_(max_fragments), head_(0), count_(0),
+  open_(false)
+{
+  if(max_fragments == 0)
+    throw cet::exception("CRT::CoincidenceFinder: max_fragments must be positive");
+
+  group_.fragments.reserve(max_fragments_);
+}
+
+void CRT::CoincidenceFinder::push_window(TimedFragment const& tf,
+                                         const uint16_t module)
+{
+  window_ring_[(head_ + count_)%max_fragments_] = tf;
+  count_++;
+
+  for(auto & mc : module_counts_){
+    if(mc.first == module){
+      mc.second++;
+      return;
+    }
+  }
+  module_counts_.emplace_back(module, 1);
+}
+
+void CRT::CoincidenceFinder::pop_window()
+{
+  const uint16_t module = CRT::Fragment(*oldest().frag).module_num();
+  head_ = (head_ + 1)%max_fragments_;
+  count_--;
+
+  for(auto mc = module_counts_.begin(); mc != module_counts_.end(); ++mc){
+    if(mc->first == module){
+      if(--mc->second == 0) module_counts_.erase(mc);
+      return;
+    }
+  }
+}
+
+void CRT::CoincidenceFinder::join(TimedFragment const& tf,
+                                  const uint16_t module)
+{
+  if(group_.fragments.size() == max_fragments_){
+    dropped_++;
+    return;
+  }
+
+  if(group_.fragments.empty()) group_.begin = tf.time;
+  group_.end = tf.time;
+  group_.fragments.push_back(tf);
+
+  if(std::find(group_.modules.begin(), group_.modules.end(), module)
+     == group_.modules.end())
+    group_.modules.push_back(module);
+}
+
+bool CRT::CoincidenceFinder::add(TimedFragment const& tf, Coincidence& out)
+{
+  const uint16_t module = CRT::Fragment(*tf.frag).module_num();
+
+  // Slide the window up to this fragment
+  while(count_ > 0 && tf.time - oldest().time > window_) pop_window();
+  if(count_ == max_fragments_){
+    pop_window();
+    if(!open_) dropped_++; // otherwise it is in the coincidence already
+  }
+  push_window(tf, module);
+
+  const bool coincident = module_counts_.size() >= min_modules_;
+  if(open_){
+    if(coincident && tf.time - group_.end <= window_){
+      join(tf, module);
+      return false;
+    }
+
+    // The modules have stopped firing together.  Report the coincidence and
+    // start again from this fragment alone, so that none is reported twice.
+    close(out);
+    push_window(tf, module);
+    if(module_counts_.size() >= min_modules_){
+      open_ = true;
+      join(tf, module);
+    }
+    return true;
+  }
+
+  if(coincident){
+    open_ = true;
+    for(size_t i = 0; i < count_; i++){
+      TimedFragment const& w = window_ring_[(head_ + i)%max_fragments_];
+      join(w, CRT::Fragment(*w.frag).module_num());
+    }
+  }
+  return false;
+}
+
+bool CRT::CoincidenceFinder::flush(Coincidence& out)
+{
+  const bool found = open_;
+  if(found) close(out);
+  head_ = count_ = 0;
+  module_counts_.clear();
+  return found;
+}
+
+void CRT::CoincidenceFinder::close(Coincidence& out)
+{
+  std::swap(out, group_);
+  group_.fragments.clear();
+  group_.modules.clear();
+  open_ = false;
+  head_ = count_ = 0;
+  module_counts_.clear();
+}
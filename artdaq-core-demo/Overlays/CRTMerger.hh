@@ -0,0 +1,157 @@
+#ifndef artdaq_demo_Overlays_CRTMerger_hh
+#define artdaq_demo_Overlays_CRTMerger_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/CRTTimestamp.hh"
+
+#include <utility>
+#include <vector>
+
+namespace CRT
+{
+  // A CRT fragment along with its 64-bit time in 50MHz ticks (see
+  // CRTTimestamp.hh) and the merger input it came from
+  struct TimedFragment
+  {
+    uint64_t time;
+    artdaq::Fragment const* frag;
+    size_t stream;
+  };
+
+  class FragmentMerger;
+  struct Coincidence;
+  class CoincidenceFinder;
+}
+
+// Merges time-ordered streams of CRT fragments, typically one stream per
+// module, into a single time-ordered stream.  The earliest fragment can be
+// taken once every open stream has something queued, since nothing earlier
+// can then arrive.  A stream with nothing to say, such as a module that
+// stopped triggering, holds up the output until it is closed or until some
+// other stream fills up, so memory stays bounded by nstreams*max_queued
+// fragments.
+//
+// The merger stores pointers: each fragment must outlive its time in the
+// merger.
+class CRT::FragmentMerger
+{
+public:
+  explicit FragmentMerger(size_t nstreams, size_t max_queued = 1024);
+
+  // Queue a fragment on the given stream.  Fragments on one stream must be
+  // given in time order.  Returns false, and queues nothing, if the stream
+  // is full; pop() something and try again.
+  bool push(size_t stream, artdaq::Fragment const& frag);
+
+  // Stop waiting for data from a stream, e.g. at the end of a run.  Its
+  // queued fragments are still merged.  Pushing to it opens it again.
+  void close(size_t stream);
+
+  // Take the earliest queued fragment, if it is safe to: either every open
+  // stream has something queued or one is full.  Returns false if not.
+  bool pop(TimedFragment& out);
+
+  // Take the earliest queued fragment even if an earlier one could still
+  // arrive.  Use this to drain the merger.  Returns false if it is empty.
+  bool pop_any(TimedFragment& out);
+
+  // Return the number of fragments waiting in the merger
+  size_t size() const { return nqueued_; }
+
+private:
+  // A fixed-capacity FIFO of one stream's fragments
+  struct Stream
+  {
+    std::vector<TimedFragment> ring;
+    size_t head, count;
+    bool open;
+    TimestampUnwrapper unwrap;
+  };
+
+  void take(TimedFragment& out);
+
+  std::vector<Stream> streams_;
+
+  // Min-heap of (time of first queued fragment, stream) for every stream
+  // that has something queued
+  std::vector<std::pair<uint64_t, size_t> > heap_;
+
+  size_t capacity_;
+  size_t nqueued_;
+  size_t nfull_;       // streams with capacity_ fragments queued
+  size_t nopen_empty_; // open streams with nothing queued
+};
+
+// A group of fragments from at least the requested number of modules (see
+// CoincidenceFinder for which fragments it takes in)
+struct CRT::Coincidence
+{
+  uint64_t begin; // time of the first fragment
+  uint64_t end;   // time of the last fragment
+  std::vector<TimedFragment> fragments;
+  std::vector<uint16_t> modules; // distinct modules, in order of first hit
+};
+
+// Finds coincidences in a time-ordered stream of CRT fragments, such as the
+// output of a FragmentMerger, with a window that slides along with them:
+// it holds the fragments within 'window' ticks of the newest one.  A
+// coincidence opens as soon as those come from at least 'min_modules'
+// different modules, starting with all of them, and takes in every fragment
+// after that until the window no longer holds that many modules.  It is then
+// reported, and its fragments are not used again.  So a coincidence spans
+// more than 'window' ticks only if the modules keep firing together.
+// Because times are 64-bit tick counts, rollovers of the 50MHz counter don't
+// split or merge groups.
+//
+// Memory is bounded: the window and a coincidence each keep at most
+// max_fragments fragments.  When the window is full its oldest fragment
+// leaves it early, and once a coincidence is full any more fragments are
+// not kept; both are counted, unless the fragment leaving the window is in
+// a coincidence already.
+class CRT::CoincidenceFinder
+{
+public:
+  CoincidenceFinder(uint64_t window, unsigned int min_modules = 2,
+                    size_t max_fragments = 256);
+
+  // Add the next fragment.  If this closes a coincidence, it is swapped into
+  // 'out' and true is returned.
+  bool add(TimedFragment const& tf, Coincidence& out);
+
+  // Close the coincidence in progress, if any, at the end of the data, and
+  // empty the window.  Returns true and fills 'out' if there was one.
+  bool flush(Coincidence& out);
+
+  // Number of fragments that a full window or coincidence couldn't keep
+  size_t dropped() const { return dropped_; }
+
+private:
+  // Append to / remove the oldest of the fragments in the window, keeping
+  // module_counts_ up to date
+  void push_window(TimedFragment const& tf, uint16_t module);
+  void pop_window();
+  TimedFragment const& oldest() const { return window_ring_[head_]; }
+
+  // Add a fragment to the open coincidence
+  void join(TimedFragment const& tf, uint16_t module);
+
+  // Report the open coincidence and forget the fragments in the window
+  void close(Coincidence& out);
+
+  uint64_t window_;
+  unsigned int min_modules_;
+  size_t max_fragments_;
+  size_t dropped_;
+
+  // The fragments within window_ ticks of the newest, oldest first
+  std::vector<TimedFragment> window_ring_;
+  size_t head_, count_;
+
+  // How many fragments in the window each module has, for those with any
+  std::vector<std::pair<uint16_t, size_t> > module_counts_;
+
+  bool open_;
+  Coincidence group_;
+};
+
+#endif /* artdaq_demo_Overlays_CRTMerger_hh */
@@ -0,0 +1,327 @@
+#include "artdaq-core-demo/Overlays/CRTPackedFragment.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/OverlayStats.hh"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+const unsigned int CRT::PackedFragment::bits_per_hit;
+
+namespace {
+  typedef CRT::PackedFragment::header_t packed_header_t;
+  typedef CRT::Fragment::header_t header_t;
+  typedef CRT::Fragment::hit_t hit_t;
+
+  const uint64_t hit_mask = 0x3ffff;
+
+  // Bytes between the header and the hits, if there is a checksum
+  const size_t checksum_bytes = sizeof(uint32_t);
+
+  // Bytes of bit stream that n hits take
+  size_t hit_bytes(const unsigned int n)
+  {
+    return (n*CRT::PackedFragment::bits_per_hit + 7)/8;
+  }
+
+  size_t round_to_words(const size_t bytes)
+  {
+    return (bytes + sizeof(artdaq::RawDataType) - 1)
+      /sizeof(artdaq::RawDataType)*sizeof(artdaq::RawDataType);
+  }
+
+  CRT::ValidationResult result(const CRT::Error e, const int64_t value)
+  {
+    CRT::ValidationResult r;
+    r.error = e;
+    r.hit = -1;
+    r.value = value;
+    return r;
+  }
+
+  // The 18 bits of a hit whose ADC value is in [0, adc_limit)
+  uint64_t hit_bits(hit_t const& h)
+  {
+    return h.channel | uint64_t(uint16_t(h.adc) & 0xfff) << 6;
+  }
+
+  // Pack n good hits into the bit stream at out, four to every nine bytes,
+  // and zero the rest of the 'bytes' bytes at out
+  void pack_hits(const hit_t * const hits, const unsigned int n,
+                 uint8_t * out, const size_t bytes)
+  {
+    uint8_t * const end = out + bytes;
+    unsigned int i = 0;
+
+    for(; i + 4 <= n; i += 4, out += 9){
+      uint64_t v[4];
+      for(int k = 0; k < 4; k++)
+        v[k] = hit_bits(hits[i+k]);
+
+      // The fourth hit's top ten bits go in the ninth byte
+      const uint64_t w = v[0] | v[1] << 18 | v[2] << 36 | v[3] << 54;
+      memcpy(out, &w, sizeof w);
+      out[8] = v[3] >> 10;
+    }
+
+    uint64_t w = 0;
+    for(unsigned int k = 0; i + k < n; k++)
+      w |= hit_bits(hits[i+k]) << 18*k;
+    memcpy(out, &w, hit_bytes(n - i));
+    out += hit_bytes(n - i);
+
+    memset(out, 0, end - out);
+  }
+}
+
+size_t CRT::packed_size(const unsigned int nhit, const bool checksum)
+{
+  return round_to_words(sizeof(packed_header_t)
+                        + (checksum? checksum_bytes: 0) + hit_bytes(nhit));
+}
+
+uint32_t CRT::packed_checksum(const uint8_t * const data, const size_t size)
+{
+  const size_t skip = sizeof(packed_header_t) + checksum_bytes;
+  return demo::crc32c(data + skip, size - skip,
+                      demo::crc32c(data, sizeof(packed_header_t)));
+}
+
+size_t CRT::pack(const uint8_t * const data, const size_t size,
+                 uint8_t * const out, const bool checksum)
+{
+  if(!check_size(data, size).ok()) return 0;
+
+  Fragment const crt(data, size);
+  if(!check_header(*crt.header()).ok()) return 0;
+  // check_hit() lets negative ADC values through, but 12 bits can't hold
+  // them
+  for(unsigned int i = 0; i < crt.num_hits(); i++)
+    if(!check_hit(*crt.hit(i), i).ok() || crt.hit(i)->adc < 0) return 0;
+
+  packed_header_t h;
+  h.magic = checksum? packed_checksum_magic: packed_magic;
+  h.nhit = crt.header()->nhit;
+  h.module_num = crt.module_num();
+  h.unixtime = crt.unixtime();
+  h.fifty_mhz_time = crt.fifty_mhz_time();
+  memcpy(out, &h, sizeof h);
+
+  const size_t bytes = packed_size(h.nhit, checksum);
+  const size_t skip = sizeof h + (checksum? checksum_bytes: 0);
+  pack_hits(crt.hit(0), h.nhit, out + skip, bytes - skip);
+
+  if(checksum){
+    const uint32_t c = packed_checksum(out, bytes);
+    memcpy(out + sizeof h, &c, sizeof c);
+  }
+  return bytes;
+}
+
+bool CRT::pack(artdaq::Fragment const& in, artdaq::Fragment& out,
+               const bool checksum)
+{
+  const uint8_t * const data = in.dataBeginBytes();
+  const size_t size = in.dataEndBytes() - in.dataBeginBytes();
+
+  uint8_t buf[sizeof(packed_header_t) + checksum_bytes
+              + (max_hits*PackedFragment::bits_per_hit + 7)/8 + 8];
+  const size_t bytes = pack(data, size, buf, checksum);
+  if(!bytes) return false;
+
+  out.resizeBytes(bytes);
+  memcpy(out.dataBeginBytes(), buf, bytes);
+  out.setUserType(demo::FragmentType::CRTPACKED);
+  return true;
+}
+
+void CRT::unpack_packed_hits(const uint8_t * bits, const unsigned int n,
+                             uint8_t * const channel, int16_t * const adc)
+{
+  const uint8_t * const end = bits + hit_bytes(n);
+  unsigned int i = 0;
+
+#if defined(__SSSE3__)
+  // Eight hits, 18 bytes, at a time, as two groups of four hits in nine
+  // bytes.  Spread each group's hits into 32-bit lanes, three bytes to a
+  // lane, then shift lane k down by the 2k bits the hit is off a byte
+  // boundary.  The second group's load reads 25 bytes from the start.
+  const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 2, 3, 4, -1,
+                                       4, 5, 6, -1, 6, 7, 8, -1);
+  const __m128i lane0 = _mm_setr_epi32(-1, 0, 0, 0);
+  const __m128i lane1 = _mm_setr_epi32(0, -1, 0, 0);
+  const __m128i lane2 = _mm_setr_epi32(0, 0, -1, 0);
+  const __m128i lane3 = _mm_setr_epi32(0, 0, 0, -1);
+  const __m128i channel_mask = _mm_set1_epi32(0x3f);
+  const __m128i adc_mask = _mm_set1_epi32(0xfff);
+
+  const auto group = [&](const uint8_t * const p){
+    const __m128i v = _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), spread);
+    return _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(v, lane0),
+                   _mm_and_si128(_mm_srli_epi32(v, 2), lane1)),
+      _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 4), lane2),
+                   _mm_and_si128(_mm_srli_epi32(v, 6), lane3)));
+  };
+
+  for(; i + 8 <= n && end - bits >= 25; i += 8, bits += 18){
+    const __m128i h0 = group(bits), h1 = group(bits + 9);
+
+    const __m128i a = _mm_packs_epi32(
+      _mm_and_si128(_mm_srli_epi32(h0, 6), adc_mask),
+      _mm_and_si128(_mm_srli_epi32(h1, 6), adc_mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(adc + i), a);
+
+    const __m128i c = _mm_packs_epi32(_mm_and_si128(h0, channel_mask),
+                                      _mm_and_si128(h1, channel_mask));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(channel + i),
+                     _mm_packus_epi16(c, c));
+  }
+#endif
+
+  for(; i + 4 <= n; i += 4, bits += 9){
+    uint64_t w;
+    memcpy(&w, bits, sizeof w);
+    const uint64_t v[4] = { w, w >> 18, w >> 36, w >> 54 | uint64_t(bits[8]) << 10 };
+    for(int k = 0; k < 4; k++){
+      channel[i+k] = v[k] & 0x3f;
+      adc[i+k] = (v[k] >> 6) & 0xfff;
+    }
+  }
+
+  uint64_t w = 0;
+  memcpy(&w, bits, end - bits);
+  for(unsigned int k = 0; i + k < n; k++){
+    const uint64_t v = (w >> 18*k) & hit_mask;
+    channel[i+k] = v & 0x3f;
+    adc[i+k] = v >> 6;
+  }
+}
+
+CRT::ValidationResult CRT::check_packed(const uint8_t * const data,
+                                        const size_t size)
+{
+  if(size < sizeof(packed_header_t)) return result(bad_size, size);
+
+  packed_header_t h;
+  memcpy(&h, data, sizeof h);
+  const bool checksum = h.magic == packed_checksum_magic;
+  if(size != packed_size(h.nhit, checksum)) return result(bad_size, size);
+
+  if(h.magic != packed_magic &&
+     h.magic != packed_checksum_magic) return result(bad_header_magic, h.magic);
+  if(h.nhit == 0)                      return result(no_hits, h.nhit);
+  if(h.nhit > max_hits)                return result(too_many_hits, h.nhit);
+  if(h.unixtime < earliest_unixtime)   return result(early_unixtime, h.unixtime);
+
+  if(checksum){
+    uint32_t c;
+    memcpy(&c, data + sizeof h, sizeof c);
+    if(packed_checksum(data, size) != c) return result(bad_checksum, c);
+  }
+
+  return result(no_error, 0);
+}
+
+size_t CRT::unpack(const uint8_t * const data, const size_t size,
+                   uint8_t * const out)
+{
+  if(!check_packed(data, size).ok()) return 0;
+
+  PackedFragment const packed(data, size);
+  header_t h;
+  h.magic = 'M';
+  h.nhit = packed.header()->nhit;
+  h.module_num = packed.module_num();
+  h.unixtime = packed.unixtime();
+  h.fifty_mhz_time = packed.fifty_mhz_time();
+  memcpy(out, &h, sizeof h);
+
+  uint8_t channel[max_hits];
+  int16_t adc[max_hits];
+  unpack_packed_hits(packed.hits(), h.nhit, channel, adc);
+
+  uint8_t * p = out + sizeof h;
+  for(unsigned int i = 0; i < h.nhit; i++, p += sizeof(hit_t)){
+    hit_t hit;
+    hit.magic = 'H';
+    hit.channel = channel[i];
+    hit.adc = adc[i];
+    memcpy(p, &hit, sizeof hit);
+  }
+
+  const size_t bytes = round_to_words(sizeof h + h.nhit*sizeof(hit_t));
+  memset(p, 0, out + bytes - p);
+  return bytes;
+}
+
+bool CRT::decode(PackedFragment const& frag, DecodedHits& out)
+{
+  DEMO_OVERLAY_TIMER(demo::FragmentType::CRTPACKED, Decode);
+
+  if(frag.size() < sizeof(packed_header_t)) return false;
+  const unsigned int nhit = frag.num_hits();
+  if(frag.size() < size_t(frag.hits() - frag.data()) + hit_bytes(nhit))
+    return false;
+
+  out.module_num.push_back(frag.module_num());
+  out.unixtime.push_back(frag.unixtime());
+  out.fifty_mhz_time.push_back(frag.fifty_mhz_time());
+
+  const size_t first = out.channel.size();
+  out.channel.resize(first + nhit);
+  out.adc.resize(first + nhit);
+  unpack_packed_hits(frag.hits(), nhit,
+                     out.channel.data() + first, out.adc.data() + first);
+
+  out.hit_begin.push_back(first + nhit);
+  return true;
+}
+
+bool CRT::PackedFragment::good_size() const
+{
+  return size() >= sizeof(header_t)
+    && size() == packed_size(header()->nhit, has_checksum());
+}
+
+bool CRT::PackedFragment::good_event() const
+{
+  const ValidationResult r = check_packed(data(), size());
+
+  DEMO_OVERLAY_COUNT(demo::FragmentType::CRTPACKED, size(),
+                     r.ok()? num_hits(): 0);
+  if(r.ok()) return true;
+
+  DEMO_OVERLAY_FAILED(demo::FragmentType::CRTPACKED);
+  fprintf(stderr, "Packed CRT fragment has %s (%lld)\n",
+          error_name(r.error), (long long)r.value);
+  if(hex_dump_allowed())
+    hex_dump(stderr, data(), data() + size());
+  return false;
+}
+
+std::ostream& CRT::operator<<(std::ostream& os, PackedFragment const& f)
+{
+  if(f.size() < sizeof(PackedFragment::header_t))
+    return os << "Packed CRT fragment too small (" << f.size()
+              << "B) for header\n";
+
+  os << "Packed CRT fragment module: " << f.module_num()
+     << ", hits: " << f.num_hits()
+     << ", Unix time: " << f.unixtime()
+     << ", 50MHz time: " << f.fifty_mhz_time()
+     << (f.has_checksum()? ", with checksum": "")
+     << "\n";
+
+  // Print only the hits that are all there
+  const size_t before = f.hits() - f.data();
+  const size_t room = f.size() > before? f.size() - before: 0;
+  for(unsigned int i = 0; i < f.num_hits() && hit_bytes(i + 1) <= room; i++)
+    os << "  hit " << i << " channel: " << unsigned(f.channel(i))
+       << ", ADC: " << f.adc(i) << "\n";
+  return os;
+}
@@ -0,0 +1,180 @@
+#ifndef artdaq_demo_Overlays_CRTPackedFragment_hh
+#define artdaq_demo_Overlays_CRTPackedFragment_hh
+
+#include "artdaq-core-demo/Overlays/CRTHitDecoder.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+
+#include <cstring>
+#include <ostream>
+
+// A denser encoding of CRT fragments, for storage and the network.  A
+// CRT::Fragment hit takes 4 bytes, one of which is always 'H', but the
+// channel needs only 6 bits and the ADC value 12.  Here each hit is 18 bits,
+// the channel in bits 0-5 and the ADC value in bits 6-17, packed end to end
+// in a little-endian bit stream, so every 4 hits take 9 bytes.  The header
+// is laid out as the CRT::Fragment header, and the whole is padded to
+// artdaq::RawDataType words like a CRT::Fragment.  A full fragment of 64
+// hits takes 160 bytes instead of 272.
+//
+// The header magic is 'P', or 'Q' if a 32-bit CRC-32C (see Checksum.hh)
+// follows the header, before the hits.  It covers the header and
+// everything after the checksum, padding included, and stands in for the
+// per-hit magic as the way to spot corruption.  It costs a word for about
+// half the hit counts, and nothing for the others, whose padding has room
+// for it.  Without it a fragment is never bigger packed than unpacked;
+// with it, only a fragment of one hit is, by a word.
+//
+// Only good CRT fragments with no negative ADC values can be packed, and
+// they unpack to exactly what they were, with any padding zeroed.
+
+namespace CRT
+{
+  class PackedFragment;
+
+  // Print the header and hits to the given stream
+  std::ostream& operator<<(std::ostream&, PackedFragment const&);
+
+  const uint8_t packed_magic = 'P';
+  const uint8_t packed_checksum_magic = 'Q';
+
+  // Size in bytes of a packed fragment with nhit hits, with a checksum if
+  // asked, including padding
+  size_t packed_size(unsigned int nhit, bool checksum = true);
+
+  // Pack the CRT fragment of 'size' bytes at 'data' into 'out', which must
+  // have room for packed_size() of its hits.  Returns the number of bytes
+  // written, or zero if the fragment doesn't pass check_event() or has a
+  // negative ADC value.  Nothing is counted in the validation counters.
+  size_t pack(const uint8_t * data, size_t size, uint8_t * out,
+              bool checksum = true);
+
+  // The same from one artdaq::Fragment to another, whose payload is resized
+  // to fit and whose type is set to CRTPACKED.  Returns false, leaving 'out'
+  // alone, if the fragment isn't good.
+  bool pack(artdaq::Fragment const& in, artdaq::Fragment& out,
+            bool checksum = true);
+
+  // Unpack a packed fragment into 'out', which must have room for the
+  // CRT::Fragment, rounded up to whole words.  Returns the number of bytes
+  // written, or zero if the packed fragment doesn't pass check_packed().
+  size_t unpack(const uint8_t * data, size_t size, uint8_t * out);
+
+  // Unpack n hits from the bit stream at 'bits', which must hold
+  // (18*n + 7)/8 bytes, into the arrays 'channel' and 'adc'
+  void unpack_packed_hits(const uint8_t * bits, unsigned int n,
+                          uint8_t * channel, int16_t * adc);
+
+  // Append the hits of a packed fragment to 'out', as decode() does for a
+  // CRT::Fragment.  Returns false, and appends nothing, if the fragment
+  // isn't big enough to hold the header and all the hits it claims.
+  bool decode(PackedFragment const& frag, DecodedHits& out);
+
+  // The checksum of a packed fragment of 'size' bytes that has room for
+  // one, which is the CRC-32C of the header and of the bytes after the
+  // checksum
+  uint32_t packed_checksum(const uint8_t * data, size_t size);
+
+  // Check a packed fragment's size, header and checksum, if it has one.
+  // Hits can't be bad once packed, since every channel and ADC value that
+  // fits is valid.  Nothing is counted in the validation counters.
+  ValidationResult check_packed(const uint8_t * data, size_t size);
+}
+
+class CRT::PackedFragment
+{
+public:
+
+  struct header_t{
+    uint8_t magic; // 'P', or 'Q' if a checksum follows
+    uint8_t nhit;
+    uint16_t module_num;
+    int32_t unixtime;
+    uint32_t fifty_mhz_time;
+  };
+
+  static_assert(sizeof(header_t) == 12, "Packed CRT header must be 12 bytes");
+
+  static const unsigned int bits_per_hit = 18;
+
+  explicit PackedFragment(artdaq::Fragment const& f) :
+    thefrag(&f), payload(nullptr), payload_bytes(0) {}
+
+  // Overlay data that isn't in an artdaq::Fragment.  'data' is where the
+  // header starts.
+  PackedFragment(const uint8_t * data, const size_t size) :
+    thefrag(nullptr), payload(data), payload_bytes(size) {}
+
+  uint16_t module_num() const { return header()->module_num; }
+  size_t num_hits() const { return header()->nhit; }
+  int32_t unixtime() const { return header()->unixtime; }
+  uint32_t fifty_mhz_time() const { return header()->fifty_mhz_time; }
+  bool has_checksum() const { return header()->magic == packed_checksum_magic; }
+
+  // The checksum after the header.  There must be one.
+  uint32_t checksum() const
+  {
+    uint32_t c;
+    memcpy(&c, data() + sizeof(header_t), sizeof c);
+    return c;
+  }
+
+  // Return the channel number of the ith hit.  That hit must exist.
+  uint8_t channel(const int i) const
+  {
+    return packed_hit(i) & 0x3f;
+  }
+
+  // Return the ADC value of the ith hit.  That hit must exist.
+  int16_t adc(const int i) const
+  {
+    return (packed_hit(i) >> 6) & 0xfff;
+  }
+
+  // Return the size of the packed fragment in bytes
+  unsigned int size() const
+  {
+    return thefrag ? thefrag->dataEndBytes() - thefrag->dataBeginBytes()
+                   : payload_bytes;
+  }
+
+  // Returns true if the fragment is as big as the header says it is
+  bool good_size() const;
+
+  // Return true if the fragment has a sensible header of the right size
+  // and a matching checksum, if it has one.  Otherwise, prints a complaint
+  // and returns false.
+  bool good_event() const;
+
+  const header_t * header() const
+  {
+    return reinterpret_cast<const header_t *>(data());
+  }
+
+  // The packed hits, which follow the header and checksum
+  const uint8_t * hits() const
+  {
+    return data() + sizeof(header_t) + (has_checksum()? sizeof(uint32_t): 0);
+  }
+
+  const uint8_t * data() const
+  {
+    return thefrag ? reinterpret_cast<const uint8_t *>(thefrag->dataBeginBytes())
+                   : payload;
+  }
+
+private:
+  // The 18 bits of hit i.  Each hit starts within a byte of the previous
+  // one's end and spans at most 3 bytes, all of them within the hits.
+  uint32_t packed_hit(const int i) const
+  {
+    const unsigned int bit = i*bits_per_hit;
+    const uint8_t * const p = hits() + bit/8;
+    return ((p[0] | p[1] << 8 | uint32_t(p[2]) << 16) >> bit%8) & 0x3ffff;
+  }
+
+  artdaq::Fragment const* thefrag; // null if overlaying raw data
+  const uint8_t * payload;         // the raw data, if thefrag is null
+  size_t payload_bytes;
+};
+
+#endif /* artdaq_demo_Overlays_CRTPackedFragment_hh */
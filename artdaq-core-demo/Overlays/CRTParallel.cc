@@ -0,0 +1,217 @@
+#include "artdaq-core-demo/Overlays/CRTParallel.hh"
+#include "artdaq-core-demo/Overlays/CRTBatchValidator.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+// One batch of fragments, cut into chunks.  Each chunk is validated and
+// decoded into its own buffers by one thread; layout() then works out where
+// each chunk's results go in the BatchResult, and copy_chunk() puts them
+// there.
+struct CRT::ParallelProcessor::Batch
+{
+  struct Chunk
+  {
+    std::vector<artdaq::Fragment const*> good;
+    std::vector<uint32_t> index;
+    DecodedHits hits;
+    size_t fragment_offset;
+    size_t hit_offset;
+  };
+
+  std::vector<artdaq::Fragment const*> frags; // copy of the input, for streaming
+  artdaq::Fragment const* const* begin;
+  size_t n;
+  size_t chunk_size;
+  std::vector<Chunk> chunks;
+  BatchResult result;
+
+  std::atomic<size_t> remaining; // chunks not yet done, for streaming
+  bool done;                     // guarded by the ParallelStream's mutex
+
+  Batch() : begin(nullptr), n(0), chunk_size(1), remaining(0), done(false) {}
+
+  void prepare(artdaq::Fragment const* const* b, size_t nfrag, size_t csize)
+  {
+    begin = b;
+    n = nfrag;
+    chunk_size = csize;
+    chunks.resize((n + chunk_size - 1)/chunk_size); // keeps old capacity
+    result.masks.resize(n);
+  }
+
+  void run_chunk(size_t c)
+  {
+    Chunk& ch = chunks[c];
+    const size_t first = c*chunk_size;
+    const size_t count = std::min(chunk_size, n - first);
+
+    validate_batch(begin + first, count, result.masks.data() + first);
+
+    ch.good.clear();
+    ch.index.clear();
+    for(size_t i = first; i < first + count; i++){
+      if(result.masks[i]) continue;
+      ch.good.push_back(begin[i]);
+      ch.index.push_back(i);
+    }
+
+    ch.hits.clear();
+    decode(ch.good.data(), ch.good.size(), ch.hits);
+  }
+
+  void layout()
+  {
+    size_t nfrag = 0, nhit = 0;
+    for(auto& ch : chunks){
+      ch.fragment_offset = nfrag;
+      ch.hit_offset = nhit;
+      nfrag += ch.hits.n_fragments();
+      nhit += ch.hits.n_hits();
+    }
+
+    DecodedHits& h = result.hits;
+    h.channel.resize(nhit);
+    h.adc.resize(nhit);
+    h.module_num.resize(nfrag);
+    h.unixtime.resize(nfrag);
+    h.fifty_mhz_time.resize(nfrag);
+    h.hit_begin.resize(nfrag + 1);
+    h.hit_begin[0] = 0;
+    result.fragment_index.resize(nfrag);
+  }
+
+  template <typename T>
+  static void copy(std::vector<T> const& from, std::vector<T>& to,
+                   const size_t offset)
+  {
+    if(!from.empty())
+      memcpy(to.data() + offset, from.data(), from.size()*sizeof(T));
+  }
+
+  void copy_chunk(size_t c)
+  {
+    Chunk const& ch = chunks[c];
+    DecodedHits& h = result.hits;
+
+    copy(ch.hits.channel, h.channel, ch.hit_offset);
+    copy(ch.hits.adc, h.adc, ch.hit_offset);
+    copy(ch.hits.module_num, h.module_num, ch.fragment_offset);
+    copy(ch.hits.unixtime, h.unixtime, ch.fragment_offset);
+    copy(ch.hits.fifty_mhz_time, h.fifty_mhz_time, ch.fragment_offset);
+    copy(ch.index, result.fragment_index, ch.fragment_offset);
+
+    for(size_t f = 0; f < ch.hits.n_fragments(); f++)
+      h.hit_begin[ch.fragment_offset + f + 1] =
+        ch.hit_offset + ch.hits.hit_begin[f + 1];
+  }
+};
+
+CRT::ParallelProcessor::ParallelProcessor(const size_t nthreads,
+                                          const size_t chunk_size) :
+  pool_(nthreads), chunk_size_(chunk_size? chunk_size: 1), batch_(new Batch)
+{
+}
+
+CRT::ParallelProcessor::~ParallelProcessor()
+{
+}
+
+void CRT::ParallelProcessor::process(artdaq::Fragment const* const* frags,
+                                     const size_t n, BatchResult& out)
+{
+  Batch& b = *batch_;
+  std::swap(b.result, out); // reuse the caller's buffers
+  b.prepare(frags, n, chunk_size_);
+
+  pool_.parallel_for(b.chunks.size(), [&b](size_t c){ b.run_chunk(c); });
+  b.layout();
+  pool_.parallel_for(b.chunks.size(), [&b](size_t c){ b.copy_chunk(c); });
+
+  std::swap(b.result, out);
+}
+
+void CRT::ParallelProcessor::process(artdaq::Fragments const& frags,
+                                     BatchResult& out)
+{
+  std::vector<artdaq::Fragment const*> ptrs(frags.size());
+  for(size_t i = 0; i < frags.size(); i++) ptrs[i] = &frags[i];
+  process(ptrs.data(), ptrs.size(), out);
+}
+
+CRT::ParallelStream::ParallelStream(ParallelProcessor& processor,
+                                    const size_t max_in_flight) :
+  processor_(processor), head_(0), count_(0)
+{
+  for(size_t i = 0; i < std::max<size_t>(max_in_flight, 1); i++)
+    slots_.emplace_back(new ParallelProcessor::Batch);
+}
+
+CRT::ParallelStream::~ParallelStream()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  for(size_t i = 0; i < count_; i++){
+    ParallelProcessor::Batch const& b = *slots_[(head_ + i)%slots_.size()];
+    changed_.wait(lock, [&b]{ return b.done; });
+  }
+}
+
+void CRT::ParallelStream::submit(artdaq::Fragment const* const* frags,
+                                 const size_t n)
+{
+  ParallelProcessor::Batch* b;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this]{ return count_ < slots_.size(); });
+    b = slots_[(head_ + count_)%slots_.size()].get();
+    ++count_;
+  }
+
+  b->frags.assign(frags, frags + n);
+  b->prepare(b->frags.data(), n, processor_.chunk_size_);
+
+  // The last chunk to finish puts the results together.  Other batches
+  // keep the threads busy meanwhile.
+  auto finish = [this, b]{
+    b->layout();
+    for(size_t c = 0; c < b->chunks.size(); c++) b->copy_chunk(c);
+    std::lock_guard<std::mutex> lock(mutex_);
+    b->done = true;
+    changed_.notify_all();
+  };
+
+  if(b->chunks.empty()){
+    finish();
+    return;
+  }
+
+  b->remaining = b->chunks.size();
+  for(size_t c = 0; c < b->chunks.size(); c++)
+    processor_.pool_.submit([b, c, finish]{
+      b->run_chunk(c);
+      if(b->remaining.fetch_sub(1) == 1) finish();
+    });
+}
+
+bool CRT::ParallelStream::next(BatchResult& out)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  if(count_ == 0) return false;
+
+  ParallelProcessor::Batch& b = *slots_[head_];
+  changed_.wait(lock, [&b]{ return b.done; });
+
+  std::swap(b.result, out); // the slot gets out's buffers to reuse
+  b.done = false;
+  head_ = (head_ + 1)%slots_.size();
+  --count_;
+  changed_.notify_all();
+  return true;
+}
+
+size_t CRT::ParallelStream::in_flight() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return count_;
+}
@@ -0,0 +1,100 @@
+#ifndef artdaq_demo_Overlays_CRTParallel_hh
+#define artdaq_demo_Overlays_CRTParallel_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/CRTError.hh"
+#include "artdaq-core-demo/Overlays/CRTHitDecoder.hh"
+#include "artdaq-core-demo/Overlays/ThreadPool.hh"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Validation and decoding of CRT fragments spread over several threads.
+// A batch is cut into chunks of fragments, which the threads of a
+// work-stealing demo::ThreadPool validate (as validate_batch() does) and
+// decode (as decode() does).  The chunks' results are then put together in
+// the order of the input.
+
+namespace CRT
+{
+  // What processing a batch of fragments gives
+  struct BatchResult
+  {
+    // One per fragment in the batch, zero if the fragment is good
+    std::vector<error_mask_t> masks;
+
+    // The hits of the good fragments, in input order
+    DecodedHits hits;
+
+    // For each fragment in hits, its position in the batch
+    std::vector<uint32_t> fragment_index;
+  };
+
+  class ParallelProcessor
+  {
+  public:
+    // Use nthreads threads, or one per hardware thread if it is 0, and give
+    // them chunk_size fragments at a time.  Smaller chunks balance the load
+    // better; bigger ones cost less to hand out.
+    explicit ParallelProcessor(size_t nthreads = 0, size_t chunk_size = 64);
+    ~ParallelProcessor();
+
+    // Validate and decode n fragments, replacing the contents of out.
+    // Reusing out across calls saves reallocating it.
+    void process(artdaq::Fragment const* const* frags, size_t n,
+                 BatchResult& out);
+    void process(artdaq::Fragments const& frags, BatchResult& out);
+
+    // Number of threads doing the work
+    size_t threads() const { return pool_.size(); }
+
+  private:
+    friend class ParallelStream;
+    struct Batch;
+
+    demo::ThreadPool pool_;
+    size_t chunk_size_;
+    std::unique_ptr<Batch> batch_;
+  };
+
+  // For a stream of batches: each batch is processed while the caller goes
+  // on to submit the next, and results come back from next() in the order
+  // the batches were submitted.  At most max_in_flight batches are held at
+  // once, submit() waiting for next() to make room, which bounds the memory
+  // used however far the consumer falls behind.
+  class ParallelStream
+  {
+  public:
+    explicit ParallelStream(ParallelProcessor& processor,
+                            size_t max_in_flight = 4);
+
+    // Waits for the batches still being processed
+    ~ParallelStream();
+
+    ParallelStream(ParallelStream const&) = delete;
+    ParallelStream& operator=(ParallelStream const&) = delete;
+
+    // Start processing n fragments.  The array of pointers is copied, but
+    // the fragments must stay valid until next() has returned their result.
+    void submit(artdaq::Fragment const* const* frags, size_t n);
+
+    // Wait for the oldest batch and swap its result into out.  Returns
+    // false, leaving out alone, if there are no batches in flight.
+    bool next(BatchResult& out);
+
+    // Number of batches submitted and not yet returned by next()
+    size_t in_flight() const;
+
+  private:
+    ParallelProcessor& processor_;
+    std::vector<std::unique_ptr<ParallelProcessor::Batch>> slots_;
+    size_t head_;
+    size_t count_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+  };
+}
+
+#endif /* artdaq_demo_Overlays_CRTParallel_hh */
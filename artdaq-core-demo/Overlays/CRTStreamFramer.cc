@@ -0,0 +1,155 @@
+#include "artdaq-core-demo/Overlays/CRTStreamFramer.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const size_t CRT::StreamFramer::max_frame_bytes;
+
+namespace {
+  typedef CRT::Fragment::header_t header_t;
+  typedef CRT::Fragment::hit_t hit_t;
+
+  // The first 'M' in [p, end), or end if there is none
+  const uint8_t * find_magic(const uint8_t * p, const uint8_t * const end)
+  {
+#if defined(__SSE2__)
+    const __m128i magic = _mm_set1_epi8('M');
+    for(; end - p >= 16; p += 16){
+      const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), magic));
+      if(mask) return p + __builtin_ctz(mask);
+    }
+#endif
+    for(; p < end; p++)
+      if(*p == 'M') return p;
+    return end;
+  }
+}
+
+CRT::StreamFramer::StreamFramer(BatchBuilder& out) :
+  out_(out), in_sync_(true), full_(false), carry_bytes_(0)
+{
+}
+
+void CRT::StreamFramer::skip_(const uint8_t * const p, const uint8_t * const c)
+{
+  if(c == p) return;
+  stats_.skipped_bytes += c - p;
+  if(in_sync_) stats_.resyncs++;
+  in_sync_ = false;
+}
+
+const uint8_t * CRT::StreamFramer::frame_(const uint8_t * p,
+                                          const uint8_t * const end)
+{
+  hit_t hits[max_hits];
+
+  while(p < end){
+    const uint8_t * const c = find_magic(p, end);
+    skip_(p, c);
+    p = c;
+    if(end - c < static_cast<ptrdiff_t>(sizeof(header_t))) break;
+
+    header_t h;
+    memcpy(&h, c, sizeof h);
+    bool good = check_header(h).ok();
+
+    // Check as many hits as have arrived.  If they are all good but some
+    // are still to come, wait for them.
+    const size_t frame_bytes = good? sizeof h + h.nhit*sizeof(hit_t): 0;
+    const size_t have = std::min<size_t>(h.nhit,
+                                         (end - c - sizeof h)/sizeof(hit_t));
+    for(size_t i = 0; good && i < have; i++){
+      memcpy(&hits[i], c + sizeof h + i*sizeof(hit_t), sizeof(hit_t));
+      good = check_hit(hits[i], i).ok();
+    }
+
+    if(!good){
+      // Not a frame after all, so look again one byte on
+      stats_.rejected++;
+      skip_(c, c + 1);
+      p = c + 1;
+      continue;
+    }
+    if(static_cast<size_t>(end - c) < frame_bytes) break;
+
+    // A good frame too big for the output is dropped whole, without
+    // losing step
+    if(h.nhit > out_.max_hits_per_fragment()){
+      stats_.rejected++;
+      stats_.skipped_bytes += frame_bytes;
+      p = c + frame_bytes;
+      continue;
+    }
+
+    if(out_.full()){
+      full_ = true;
+      break;
+    }
+    out_.add(h, hits, h.nhit);
+    stats_.frames++;
+    stats_.hits += h.nhit;
+    in_sync_ = true;
+    p = c + frame_bytes;
+  }
+  return p;
+}
+
+size_t CRT::StreamFramer::push(const uint8_t * const data, const size_t size)
+{
+  full_ = false;
+  size_t consumed = 0;
+
+  // Complete the frame held over with the start of this chunk.  A frame
+  // starting in the carried bytes is decided within max_frame_bytes, so
+  // framing soon gets past them, and on into the chunk itself.
+  while(carry_bytes_ > 0 && consumed < size){
+    const size_t take = std::min(size - consumed, sizeof carry_ - carry_bytes_);
+    memcpy(carry_ + carry_bytes_, data + consumed, take);
+
+    const uint8_t * const stop = frame_(carry_, carry_ + carry_bytes_ + take);
+    const size_t framed = stop - carry_;
+
+    if(framed >= carry_bytes_){
+      consumed += framed - carry_bytes_;
+      carry_bytes_ = 0;
+    }
+    else{
+      const size_t rest = carry_bytes_ + take - framed;
+      memmove(carry_, stop, rest);
+      carry_bytes_ = rest;
+      consumed += take;
+    }
+
+    if(full_){
+      stats_.bytes += consumed;
+      return consumed;
+    }
+  }
+
+  if(carry_bytes_ == 0){
+    const uint8_t * const stop = frame_(data + consumed, data + size);
+    if(full_){
+      stats_.bytes += stop - data;
+      return stop - data;
+    }
+
+    // Hold on to a frame cut off by the end of the chunk
+    carry_bytes_ = data + size - stop;
+    memcpy(carry_, stop, carry_bytes_);
+  }
+
+  stats_.bytes += size;
+  return size;
+}
+
+void CRT::StreamFramer::reset()
+{
+  skip_(carry_, carry_ + carry_bytes_);
+  carry_bytes_ = 0;
+}
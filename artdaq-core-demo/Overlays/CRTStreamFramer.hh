@@ -0,0 +1,84 @@
+#ifndef artdaq_demo_Overlays_CRTStreamFramer_hh
+#define artdaq_demo_Overlays_CRTStreamFramer_hh
+
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+
+// Framing of the raw CRT readout stream, in which each CRT::Fragment
+// header_t is followed directly by its nhit hit_t records, with no padding.
+// The stream arrives in chunks of any size, and bytes may be lost or
+// corrupted, so the framer looks for 'M' header magic, and keeps only a
+// candidate frame whose header and every hit pass check_header() and
+// check_hit().  A candidate that fails is skipped one byte at a time, which
+// gets back in step at the next good frame.
+//
+// A frame is at most 268 bytes, so deciding on a candidate never needs
+// more than that.  Only a frame cut off at the end of a chunk is kept,
+// and it is completed from the start of the next chunk; the rest of each
+// chunk is framed where it is.
+
+namespace CRT
+{
+  class StreamFramer;
+
+  // Running totals for a StreamFramer
+  struct FramerStats
+  {
+    uint64_t bytes;         // bytes consumed
+    uint64_t frames;        // good frames emitted
+    uint64_t hits;          // hits in those frames
+    uint64_t skipped_bytes; // bytes not in any frame emitted
+    uint64_t rejected;      // candidate headers that weren't good frames,
+                            // or good ones with more hits than 'out' takes
+    uint64_t resyncs;       // times bytes were skipped after a good frame
+
+    FramerStats() : bytes(0), frames(0), hits(0), skipped_bytes(0),
+                    rejected(0), resyncs(0) {}
+  };
+}
+
+class CRT::StreamFramer
+{
+public:
+  // The largest frame: a header and max_hits hits
+  static const size_t max_frame_bytes =
+    sizeof(Fragment::header_t) + max_hits*sizeof(Fragment::hit_t);
+
+  // Emit frames into 'out', which must outlive the framer.  Frames with
+  // more hits than its max_hits_per_fragment are skipped.
+  explicit StreamFramer(BatchBuilder& out);
+
+  // Frame the next chunk of the stream.  Returns the number of bytes
+  // consumed, which is all of them unless 'out' fills up.  Then the rest
+  // should be pushed again once 'out' has been emptied.
+  size_t push(const uint8_t * data, size_t size);
+
+  // Drop any partial frame, as at a break in the stream, counting it as
+  // skipped
+  void reset();
+
+  // Bytes of a partial frame held for the next chunk
+  size_t pending() const { return carry_bytes_; }
+
+  FramerStats const& stats() const { return stats_; }
+
+private:
+  // Frame as much of [p, end) as possible.  Returns where framing stopped:
+  // at end, at a frame cut off by end, or at a frame that didn't fit in
+  // the output, in which case full_ is set.
+  const uint8_t * frame_(const uint8_t * p, const uint8_t * end);
+
+  // Note that the bytes [p, c) were skipped
+  void skip_(const uint8_t * p, const uint8_t * c);
+
+  BatchBuilder& out_;
+  FramerStats stats_;
+  bool in_sync_;
+  bool full_;
+
+  // A frame cut off at the end of the last chunk, and room to complete
+  // it from the next one
+  uint8_t carry_[2*max_frame_bytes];
+  size_t carry_bytes_;
+};
+
+#endif /* artdaq_demo_Overlays_CRTStreamFramer_hh */
@@ -0,0 +1,147 @@
+#include "artdaq-core-demo/Overlays/CRTTimeIndex.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#include "cetlib/exception.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+  struct Entry
+  {
+    uint64_t time;
+    uint16_t module;
+    uint32_t fragment;
+
+    bool operator<(Entry const& o) const
+    {
+      return time != o.time? time < o.time: fragment < o.fragment;
+    }
+  };
+
+  // Fill tree[k] and the subtrees below it in order from sorted[next]
+  void fill_tree(const std::vector<uint64_t>& sorted, size_t& next,
+                 const size_t k, std::vector<uint64_t>& tree,
+                 std::vector<uint32_t>& rank)
+  {
+    if(k >= tree.size()) return;
+    fill_tree(sorted, next, 2*k, tree, rank);
+    tree[k] = sorted[next];
+    rank[k] = next++;
+    fill_tree(sorted, next, 2*k + 1, tree, rank);
+  }
+}
+
+CRT::TimeIndex::TimeIndex(artdaq::Fragments const& frags) :
+  skipped_(0)
+{
+  if(frags.size() > UINT32_MAX)
+    throw cet::exception("CRT::TimeIndex")
+      << "Can't index " << frags.size() << " fragments";
+
+  std::unordered_map<uint16_t, TimestampUnwrapper> unwrap;
+  std::vector<Entry> entries;
+  entries.reserve(frags.size());
+  for(size_t i = 0; i < frags.size(); i++){
+    if(frags[i].type() != demo::FragmentType::CRT) continue;
+    if(!check_size(frags[i].dataBeginBytes(), frags[i].dataSizeBytes()).ok()){
+      skipped_++;
+      continue;
+    }
+
+    CRT::Fragment const crt(frags[i]);
+    Entry e;
+    e.module = crt.module_num();
+    e.time = unwrap[e.module](crt.unixtime(), crt.fifty_mhz_time());
+    e.fragment = i;
+    entries.push_back(e);
+  }
+  std::sort(entries.begin(), entries.end());
+
+  const size_t n = entries.size();
+  times_.resize(n);
+  modules_.resize(n);
+  fragments_.resize(n);
+  for(size_t i = 0; i < n; i++){
+    times_[i] = entries[i].time;
+    modules_[i] = entries[i].module;
+    fragments_[i] = entries[i].fragment;
+  }
+
+  tree_.resize(n + 1);
+  tree_rank_.resize(n + 1);
+  size_t next = 0;
+  fill_tree(times_, next, 1, tree_, tree_rank_);
+}
+
+size_t CRT::TimeIndex::lower_bound(const uint64_t t) const
+{
+  // Go left at each node no earlier than t, and right otherwise.  The
+  // answer is the last node where we went left, which is found by
+  // dropping the trailing right turns, and the left turn before them,
+  // from the bits of k.
+  const size_t n = times_.size();
+  const uint64_t * const tree = tree_.data();
+  size_t k = 1;
+  while(k <= n){
+    // Eight entries to a cache line: fetch the ones three levels down
+    __builtin_prefetch(tree + 8*k);
+    k = 2*k + (tree[k] < t);
+  }
+  k >>= __builtin_ffsll(~k);
+  return k == 0? n: tree_rank_[k];
+}
+
+CRT::TimeRange CRT::TimeIndex::range(const uint64_t begin,
+                                     const uint64_t end) const
+{
+  TimeRange r;
+  r.begin = lower_bound(begin);
+  r.end = end > begin? lower_bound_from(r.begin, end): r.begin;
+  return r;
+}
+
+size_t CRT::TimeIndex::lower_bound_from(const size_t from,
+                                        const uint64_t t) const
+{
+  // Gallop forward to bracket the answer, then search the bracket, so
+  // that the cost grows with the log of the distance moved
+  const size_t n = times_.size();
+  size_t lo = from, step = 1;
+  while(lo + step <= n && times_[lo + step - 1] < t){
+    lo += step;
+    step *= 2;
+  }
+  const size_t hi = std::min(lo + step, n);
+  return std::lower_bound(times_.begin() + lo, times_.begin() + hi, t)
+    - times_.begin();
+}
+
+void CRT::TimeIndex::windows(const uint64_t * const triggers, const size_t n,
+                             const uint64_t half_width, TimeRange * const out,
+                             std::vector<uint32_t>& order) const
+{
+  if(n > UINT32_MAX)
+    throw cet::exception("CRT::TimeIndex")
+      << "Can't look up " << n << " triggers at once";
+
+  order.resize(n);
+  std::iota(order.begin(), order.end(), 0);
+  if(!std::is_sorted(triggers, triggers + n))
+    std::sort(order.begin(), order.end(),
+              [triggers](const uint32_t a, const uint32_t b)
+              { return triggers[a] < triggers[b]; });
+
+  // Both ends of the window only move forward from one trigger to the next
+  size_t begin = 0, end = 0;
+  for(const uint32_t q : order){
+    const uint64_t t = triggers[q];
+    begin = lower_bound_from(begin, window_begin(t, half_width));
+    end = lower_bound_from(std::max(begin, end), window_end(t, half_width));
+    out[q].begin = begin;
+    out[q].end = end;
+  }
+}
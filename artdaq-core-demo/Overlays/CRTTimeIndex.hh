@@ -0,0 +1,100 @@
+#ifndef artdaq_demo_Overlays_CRTTimeIndex_hh
+#define artdaq_demo_Overlays_CRTTimeIndex_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/CRTTimestamp.hh"
+
+#include <vector>
+
+namespace CRT
+{
+  class TimeIndex;
+
+  // Entries [begin, end) of a TimeIndex, in time order
+  struct TimeRange
+  {
+    uint32_t begin, end;
+
+    uint32_t size() const { return end - begin; }
+    bool empty() const { return begin == end; }
+  };
+}
+
+// A read-only index of the CRT fragments in a collection by their 64-bit
+// time in 50MHz ticks (see CRTTimestamp.hh), for finding those near a
+// trigger without looking at every fragment.
+//
+// Each fragment's time, module and position in the collection are kept in
+// separate arrays sorted by time, so that a range of entries is read
+// straight through.  Single lookups binary search a copy of the times in
+// Eytzinger (breadth-first) order, in which the first few levels share a
+// few cache lines and the next ones are prefetched.  Batches of queries
+// are sorted first, and each one is searched for forwards from where the
+// one before it was found.
+class CRT::TimeIndex
+{
+public:
+  // Index the fragments of type CRT in 'frags'; any others are left out,
+  // as are CRT fragments too short for their header or hits, which are
+  // counted in skipped().
+  // Each module's fragments must be in time order, as recorded, for their
+  // 50MHz counters to be unwrapped (see TimestampUnwrapper).  Throws
+  // cet::exception if there are 2^32 or more of them.
+  explicit TimeIndex(artdaq::Fragments const& frags);
+
+  // Number of fragments indexed
+  size_t size() const { return times_.size(); }
+
+  // Number of CRT fragments left out because of their size
+  size_t skipped() const { return skipped_; }
+
+  // Entry i, in time order: its time in ticks, its module, and where its
+  // fragment is in the collection
+  uint64_t time(const size_t i) const { return times_[i]; }
+  uint16_t module(const size_t i) const { return modules_[i]; }
+  size_t fragment(const size_t i) const { return fragments_[i]; }
+
+  // The first entry with a time no earlier than t, or size() if none
+  size_t lower_bound(uint64_t t) const;
+
+  // Entries with begin <= time < end
+  TimeRange range(const uint64_t begin, const uint64_t end) const;
+
+  // Entries within half_width ticks of t, either side, inclusive
+  TimeRange window(const uint64_t t, const uint64_t half_width) const
+  {
+    return range(window_begin(t, half_width), window_end(t, half_width));
+  }
+
+  // The windows of n triggers at once, out[i] being that of triggers[i].
+  // The triggers needn't be in order, but are quickest if they are.
+  // 'order' is scratch space, which can be reused from call to call.
+  void windows(const uint64_t * triggers, size_t n, uint64_t half_width,
+               TimeRange * out, std::vector<uint32_t>& order) const;
+
+private:
+  static uint64_t window_begin(const uint64_t t, const uint64_t w)
+  {
+    return t > w? t - w: 0;
+  }
+  static uint64_t window_end(const uint64_t t, const uint64_t w)
+  {
+    return t + w >= t && t + w < UINT64_MAX? t + w + 1: UINT64_MAX;
+  }
+
+  // The first entry at or after 'from' with a time no earlier than t
+  size_t lower_bound_from(size_t from, uint64_t t) const;
+
+  std::vector<uint64_t> times_;
+  std::vector<uint16_t> modules_;
+  std::vector<uint32_t> fragments_;
+
+  // times_ in Eytzinger order, from element 1, and where each one is in
+  // times_
+  std::vector<uint64_t> tree_;
+  std::vector<uint32_t> tree_rank_;
+
+  size_t skipped_;
+};
+
+#endif /* artdaq_demo_Overlays_CRTTimeIndex_hh */
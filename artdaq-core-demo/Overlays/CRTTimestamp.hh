@@ -0,0 +1,81 @@
+#ifndef artdaq_demo_Overlays_CRTTimestamp_hh
+#define artdaq_demo_Overlays_CRTTimestamp_hh
+
+#include <cstdint>
+
+// Helpers for turning the two clocks in a CRT fragment header, the Unix
+// time in seconds and the free-running 32-bit 50MHz counter, into one 64-bit
+// count of 50MHz ticks.  The counter rolls over every 2^32 ticks (about 86
+// seconds), which is much longer than the one-second resolution of the Unix
+// time, so the Unix time tells us which rollover we are in.
+
+namespace CRT
+{
+  const uint64_t ticks_per_second = 50000000;
+
+  // Return a - b in 50MHz ticks, correctly across a counter rollover as long
+  // as the true difference is less than 2^31 ticks (about 43 seconds).
+  inline int32_t tick_difference(const uint32_t a, const uint32_t b)
+  {
+    return static_cast<int32_t>(a - b);
+  }
+
+  // Return the 64-bit tick count that has the given low 32 bits and is
+  // closest to 'expected'.
+  inline uint64_t nearest_ticks(const uint32_t fifty_mhz_time,
+                                const uint64_t expected)
+  {
+    return expected
+      + tick_difference(fifty_mhz_time, static_cast<uint32_t>(expected));
+  }
+
+  // Return the 50MHz counter extended to a 64-bit count of ticks since the
+  // Unix epoch, choosing the rollover that best matches the Unix time.  This
+  // needs no history, but is only consistent between fragments if the
+  // counter's offset from the Unix clock stays well away from half a
+  // rollover period; prefer a TimestampUnwrapper for streams of fragments.
+  inline uint64_t combined_time(const int32_t unixtime,
+                                const uint32_t fifty_mhz_time)
+  {
+    return nearest_ticks(fifty_mhz_time,
+                         static_cast<uint64_t>(unixtime)*ticks_per_second
+                         + ticks_per_second/2);
+  }
+
+  // Extends the 50MHz counter of one module's fragments, taken in time
+  // order, to a continuous 64-bit tick count.  The first fragment is placed
+  // with combined_time(), after which each fragment is placed relative to the
+  // previous one, so the result never jumps at a rollover even as the
+  // module's clock drifts relative to the Unix time.
+  class TimestampUnwrapper
+  {
+  public:
+    TimestampUnwrapper() : started_(false), last_unixtime_(0), last_ticks_(0)
+    {}
+
+    uint64_t operator()(const int32_t unixtime, const uint32_t fifty_mhz_time)
+    {
+      if(!started_){
+        started_ = true;
+        last_ticks_ = combined_time(unixtime, fifty_mhz_time);
+      }
+      else{
+        const int64_t elapsed = static_cast<int64_t>(unixtime) - last_unixtime_;
+        last_ticks_ = nearest_ticks(fifty_mhz_time,
+          last_ticks_ + elapsed*static_cast<int64_t>(ticks_per_second));
+      }
+      last_unixtime_ = unixtime;
+      return last_ticks_;
+    }
+
+    // Forget the history, as for a new run
+    void reset() { started_ = false; }
+
+  private:
+    bool started_;
+    int32_t last_unixtime_;
+    uint64_t last_ticks_;
+  };
+}
+
+#endif /* artdaq_demo_Overlays_CRTTimestamp_hh */
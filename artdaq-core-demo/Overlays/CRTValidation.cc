@@ -0,0 +1,202 @@
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+#include "artdaq-core-demo/Overlays/OverlayStats.hh"
+#include "artdaq-core-demo/Overlays/ThreadShards.hh"
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+
+namespace {
+  // One thread's validation counters.  Only the owning thread writes them,
+  // so a relaxed load and store is enough to increment.
+  struct Counters
+  {
+    typedef CRT::ValidationCounts Snapshot;
+
+    std::atomic<uint64_t> checked;
+    std::atomic<uint64_t> errors[CRT::n_errors];
+
+    Counters() : checked(0)
+    {
+      for(auto & e : errors) e.store(0, std::memory_order_relaxed);
+    }
+
+    void add_to(Snapshot& s) const
+    {
+      s.checked += checked.load(std::memory_order_relaxed);
+      for(int i = 0; i < CRT::n_errors; i++)
+        s.errors[i] += errors[i].load(std::memory_order_relaxed);
+    }
+  };
+
+  typedef demo::detail::ThreadShards<Counters> shards;
+
+  void bump(std::atomic<uint64_t>& c)
+  {
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  CRT::ValidationResult result(const CRT::Error e, const int hit,
+                               const int64_t value)
+  {
+    CRT::ValidationResult r;
+    r.error = e;
+    r.hit = hit;
+    r.value = value;
+    return r;
+  }
+
+  const CRT::ValidationResult good = result(CRT::no_error, -1, 0);
+
+  // The second of the latest dump in the high 32 bits, and the number of
+  // dumps in that second in the low 32, so that both change together
+  std::atomic<unsigned int> dump_rate(0);
+  std::atomic<uint64_t> dump_state(0);
+}
+
+CRT::ValidationCounts::ValidationCounts() : checked(0)
+{
+  for(auto & e : errors) e = 0;
+}
+
+const char * CRT::error_name(const Error e)
+{
+  switch(e){
+    case no_error:         return "no error";
+    case bad_size:         return "bad size";
+    case bad_header_magic: return "bad header magic";
+    case no_hits:          return "no hits";
+    case too_many_hits:    return "too many hits";
+    case early_unixtime:   return "early Unix time";
+    case bad_hit_magic:    return "bad hit magic";
+    case bad_channel:      return "bad channel";
+    case bad_adc:          return "bad ADC value";
+    case bad_checksum:     return "bad checksum";
+    case n_errors:         break;
+  }
+  return "unknown error";
+}
+
+CRT::ValidationResult CRT::check_size(const uint8_t * const data,
+                                      const size_t size)
+{
+  if(size < sizeof(Fragment::header_t)) return result(bad_size, -1, size);
+
+  // The size may include a checksum trailer, if it has the right magic
+  const size_t expect_size =
+    fragment_bytes(reinterpret_cast<const Fragment::header_t *>(data)->nhit);
+  if(size == expect_size) return good;
+  if(size == expect_size + sizeof(Fragment::trailer_t)
+     && Fragment(data, size).has_checksum()) return good;
+
+  return result(bad_size, -1, size);
+}
+
+CRT::ValidationResult CRT::check_header(Fragment::header_t const& h)
+{
+  if(h.magic != 'M')                 return result(bad_header_magic, -1, h.magic);
+  if(h.nhit == 0)                    return result(no_hits, -1, h.nhit);
+  if(h.nhit > max_hits)              return result(too_many_hits, -1, h.nhit);
+  if(h.unixtime < earliest_unixtime) return result(early_unixtime, -1, h.unixtime);
+  return good;
+}
+
+CRT::ValidationResult CRT::check_hit(Fragment::hit_t const& h, const int i)
+{
+  if(h.magic != 'H')               return result(bad_hit_magic, i, h.magic);
+  if(h.channel >= n_channels)      return result(bad_channel, i, h.channel);
+  if(h.adc >= adc_limit)           return result(bad_adc, i, h.adc);
+  return good;
+}
+
+CRT::ValidationResult CRT::check_event(artdaq::Fragment const& frag)
+{
+  return check_event(frag.dataBeginBytes(),
+                     frag.dataEndBytes() - frag.dataBeginBytes());
+}
+
+CRT::ValidationResult CRT::check_event(const uint8_t * data, const size_t size)
+{
+  DEMO_OVERLAY_TIMER(demo::FragmentType::CRT, Validate);
+
+  ValidationResult r = check_size(data, size);
+
+  if(r.ok()){
+    Fragment const crt(data, size);
+    r = check_header(*crt.header());
+    for(unsigned int i = 0; r.ok() && i < crt.num_hits(); i++)
+      r = check_hit(*crt.hit(i), i);
+    if(r.ok() && !crt.good_checksum())
+      r = result(bad_checksum, -1, crt.size());
+  }
+
+  count_validation(r.error);
+  DEMO_OVERLAY_COUNT(demo::FragmentType::CRT, size,
+                     size >= sizeof(Fragment::header_t)? data[1]: 0);
+  if(!r.ok()) DEMO_OVERLAY_FAILED(demo::FragmentType::CRT);
+  return r;
+}
+
+CRT::ValidationCounts CRT::validation_counts()
+{
+  return shards::snapshot();
+}
+
+void CRT::count_validation(const Error e)
+{
+  Counters & c = shards::local();
+  bump(c.checked);
+  bump(c.errors[e]);
+}
+
+void CRT::count_validation(const error_mask_t mask)
+{
+  Counters & c = shards::local();
+  bump(c.checked);
+  if(mask == 0) bump(c.errors[no_error]);
+  for(int e = no_error + 1; e < n_errors; e++)
+    if(mask & error_bit(static_cast<Error>(e)))
+      bump(c.errors[e]);
+}
+
+void CRT::set_hex_dump_rate(const unsigned int max_per_second)
+{
+  dump_rate.store(max_per_second, std::memory_order_relaxed);
+}
+
+bool CRT::hex_dump_allowed()
+{
+  const unsigned int rate = dump_rate.load(std::memory_order_relaxed);
+  if(rate == 0) return false;
+
+  const uint64_t now = std::chrono::duration_cast<std::chrono::seconds>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+  uint64_t state = dump_state.load(std::memory_order_relaxed);
+  uint64_t next;
+  do{
+    // A thread that read the clock before another started a new second
+    // counts in that one, rather than taking the count back
+    if((now & 0xffffffff) > state >> 32)
+      next = (now & 0xffffffff) << 32 | 1;
+    else if((state & 0xffffffff) < rate)
+      next = state + 1;
+    else
+      return false;
+  }while(!dump_state.compare_exchange_weak(state, next,
+                                           std::memory_order_relaxed));
+  return true;
+}
+
+void CRT::hex_dump(FILE * const stream, const uint8_t * const begin,
+                   const uint8_t * const end)
+{
+  for(const uint8_t * c = begin; c < end; c++){
+    fprintf(stream, "%02hhx/%c ", *c, isprint(*c)? *c: '.');
+    if((c - begin)%0x08 == 0x07)
+      fprintf(stream, " ");
+    if((c - begin)%0x10 == 0x0f)
+      fprintf(stream, "\n");
+  }
+  fprintf(stream, "\n");
+}
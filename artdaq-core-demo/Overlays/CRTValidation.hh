@@ -0,0 +1,67 @@
+#ifndef artdaq_demo_Overlays_CRTValidation_hh
+#define artdaq_demo_Overlays_CRTValidation_hh
+
+#include "artdaq-core-demo/Overlays/CRTError.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+
+// Validation of CRT fragments that reports what is wrong instead of printing
+// it.  The checks are those of CRT::Fragment::good_size(), good_header() and
+// good_hit(), and like good_event(), check_event() stops at the first problem.
+//
+// Each check_event() is counted, along with its result, in per-thread
+// counters that validation_counts() adds up on demand.
+
+namespace CRT
+{
+  // What, if anything, is wrong with a CRT fragment
+  struct ValidationResult
+  {
+    Error error;
+    int hit;       // index of the offending hit, or -1 if not about a hit
+    int64_t value; // the offending value, e.g. the bad channel number
+
+    bool ok() const { return error == no_error; }
+  };
+
+  // Return a short description of the error, e.g. "bad channel"
+  const char * error_name(Error e);
+
+  // Check that a fragment of 'size' bytes starting at 'data' holds its
+  // header and exactly the hits it claims, rounded up to whole
+  // artdaq::RawDataType words, and perhaps a checksum trailer after them.
+  // The value is the size in bytes.
+  ValidationResult check_size(const uint8_t * data, size_t size);
+
+  // Check the header's contents.  The value is the offending field.
+  ValidationResult check_header(Fragment::header_t const& h);
+
+  // Check the contents of hit number i.  The value is the offending field.
+  ValidationResult check_hit(Fragment::hit_t const& h, int i);
+
+  // Check the size, header, each hit and then any checksum, stopping at the
+  // first problem
+  ValidationResult check_event(artdaq::Fragment const& frag);
+
+  // The same, for a fragment's data outside of an artdaq::Fragment
+  ValidationResult check_event(const uint8_t * data, size_t size);
+
+  // Running totals of validation results
+  struct ValidationCounts
+  {
+    uint64_t checked;           // fragments checked
+    uint64_t errors[n_errors];  // fragments failing, by error; errors[0] is
+                                // the number found good
+
+    ValidationCounts();
+  };
+
+  // Add up the counts from all threads so far
+  ValidationCounts validation_counts();
+
+  // Count a validation done outside check_event(): a fragment with the given
+  // error, or with the given mask of error_bit()s.
+  void count_validation(Error e);
+  void count_validation(error_mask_t mask);
+}
+
+#endif /* artdaq_demo_Overlays_CRTValidation_hh */
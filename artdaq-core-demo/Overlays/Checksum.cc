@@ -0,0 +1,264 @@
+#include "artdaq-core-demo/Overlays/Checksum.hh"
+
+#include "artdaq-core-demo/Overlays/OverlayVisitor.hh"
+
+#include <algorithm>
+#include <cstring>
+
+// The SSE4.2 code is built whatever the build targets, and used if the CPU running it has
+// the instruction
+#if defined(__x86_64__) && defined(__GNUC__)
+#define DEMO_CRC32C_HARDWARE
+#define DEMO_TARGET_SSE42 __attribute__((target("sse4.2")))
+#include <nmmintrin.h>
+#endif
+
+namespace
+{
+	// The CRC-32C polynomial, bit-reversed
+	uint32_t const poly = 0x82f63b78;
+
+	uint64_t read64(uint8_t const* p)
+	{
+		uint64_t v;
+		memcpy(&v, p, sizeof v);
+		return v;
+	}
+
+	// Tables for eight bytes at a time: bytes[k][b] is the CRC of byte b followed by k zero
+	// bytes
+	struct SliceTables
+	{
+		uint32_t bytes[8][256];
+
+		SliceTables()
+		{
+			for (uint32_t b = 0; b < 256; ++b)
+			{
+				uint32_t c = b;
+				for (int i = 0; i < 8; ++i) c = c & 1 ? (c >> 1) ^ poly : c >> 1;
+				bytes[0][b] = c;
+			}
+			for (uint32_t b = 0; b < 256; ++b)
+			{
+				for (int k = 1; k < 8; ++k) bytes[k][b] = (bytes[k - 1][b] >> 8) ^ bytes[0][bytes[k - 1][b] & 0xff];
+			}
+		}
+	};
+
+	SliceTables const& sliceTables()
+	{
+		static SliceTables const tables;
+		return tables;
+	}
+
+	// Extend a CRC, as kept while running (that is, not inverted), over n bytes
+	uint32_t extendSoftware(uint32_t crc, uint8_t const* p, size_t n)
+	{
+		auto const& t = sliceTables().bytes;
+		for (; n >= 8; n -= 8, p += 8)
+		{
+			uint64_t const w = read64(p) ^ crc;
+			crc = t[7][w & 0xff] ^ t[6][(w >> 8) & 0xff] ^ t[5][(w >> 16) & 0xff] ^ t[4][(w >> 24) & 0xff] ^
+			      t[3][(w >> 32) & 0xff] ^ t[2][(w >> 40) & 0xff] ^ t[1][(w >> 48) & 0xff] ^ t[0][w >> 56];
+		}
+		for (; n > 0; --n) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+		return crc;
+	}
+
+#if defined(DEMO_CRC32C_HARDWARE)
+	bool hasHardware()
+	{
+		static bool const has = [] {
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("sse4.2") != 0;
+		}();
+		return has;
+	}
+
+	// The three streams are this long, or, for what is left after those, this short
+	size_t const long_block = 8192;
+	size_t const short_block = 256;
+
+	// Tables that move a CRC past a block of zeros: zeros[k][b] is the result for the CRC
+	// b << 8k. The CRC is linear, so the result for any CRC is the XOR of those for its bytes.
+	struct ShiftTables
+	{
+		uint32_t zeros[4][256];
+
+		explicit ShiftTables(size_t block)
+		{
+			uint8_t const zero[short_block] = {};
+			uint32_t bit[32];
+			for (int i = 0; i < 32; ++i)
+			{
+				uint32_t c = 1u << i;
+				for (size_t done = 0; done < block; done += short_block) c = extendSoftware(c, zero, short_block);
+				bit[i] = c;
+			}
+			for (int k = 0; k < 4; ++k)
+			{
+				for (uint32_t b = 0; b < 256; ++b)
+				{
+					uint32_t c = 0;
+					for (int i = 0; i < 8; ++i)
+					{
+						if (b >> i & 1) c ^= bit[8 * k + i];
+					}
+					zeros[k][b] = c;
+				}
+			}
+		}
+
+		uint32_t operator()(uint32_t crc) const
+		{
+			return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^ zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+		}
+	};
+
+	ShiftTables const& longShift()
+	{
+		static ShiftTables const tables(long_block);
+		return tables;
+	}
+
+	ShiftTables const& shortShift()
+	{
+		static ShiftTables const tables(short_block);
+		return tables;
+	}
+
+	// Run three streams of one block each, and join their CRCs as if they had been one stream
+	DEMO_TARGET_SSE42 uint32_t extendThree(uint32_t crc, uint8_t const* p, size_t block, ShiftTables const& shift)
+	{
+		uint64_t c0 = crc, c1 = 0, c2 = 0;
+		for (size_t i = 0; i < block; i += 8)
+		{
+			c0 = _mm_crc32_u64(c0, read64(p + i));
+			c1 = _mm_crc32_u64(c1, read64(p + block + i));
+			c2 = _mm_crc32_u64(c2, read64(p + 2 * block + i));
+		}
+		return shift(shift(static_cast<uint32_t>(c0)) ^ static_cast<uint32_t>(c1)) ^ static_cast<uint32_t>(c2);
+	}
+
+	DEMO_TARGET_SSE42 uint32_t extendHardware(uint32_t crc, uint8_t const* p, size_t n)
+	{
+		for (; n >= 3 * long_block; n -= 3 * long_block, p += 3 * long_block) crc = extendThree(crc, p, long_block, longShift());
+		for (; n >= 3 * short_block; n -= 3 * short_block, p += 3 * short_block) crc = extendThree(crc, p, short_block, shortShift());
+
+		uint64_t c = crc;
+		for (; n >= 8; n -= 8, p += 8) c = _mm_crc32_u64(c, read64(p));
+		crc = static_cast<uint32_t>(c);
+		for (; n > 0; --n) crc = _mm_crc32_u8(crc, *p++);
+		return crc;
+	}
+
+	// The words all three buffers have are done together, and the rest of each on its own
+	DEMO_TARGET_SSE42 void batchHardware(uint8_t const* const* data, size_t const* sizes, uint32_t* out)
+	{
+		size_t const common = std::min(sizes[0], std::min(sizes[1], sizes[2])) / 8 * 8;
+		uint64_t c0 = ~0u, c1 = ~0u, c2 = ~0u;
+		for (size_t j = 0; j < common; j += 8)
+		{
+			c0 = _mm_crc32_u64(c0, read64(data[0] + j));
+			c1 = _mm_crc32_u64(c1, read64(data[1] + j));
+			c2 = _mm_crc32_u64(c2, read64(data[2] + j));
+		}
+		out[0] = ~extendHardware(static_cast<uint32_t>(c0), data[0] + common, sizes[0] - common);
+		out[1] = ~extendHardware(static_cast<uint32_t>(c1), data[1] + common, sizes[1] - common);
+		out[2] = ~extendHardware(static_cast<uint32_t>(c2), data[2] + common, sizes[2] - common);
+	}
+#else
+	bool hasHardware() { return false; }
+#endif
+
+	uint32_t extend(uint32_t crc, uint8_t const* p, size_t n)
+	{
+#if defined(DEMO_CRC32C_HARDWARE)
+		if (hasHardware()) return extendHardware(crc, p, n);
+#endif
+		return extendSoftware(crc, p, n);
+	}
+}
+
+uint32_t demo::crc32c(void const* data, size_t n, uint32_t crc)
+{
+	return ~extend(~crc, static_cast<uint8_t const*>(data), n);
+}
+
+uint32_t demo::detail::crc32cSoftware(void const* data, size_t n, uint32_t crc)
+{
+	return ~extendSoftware(~crc, static_cast<uint8_t const*>(data), n);
+}
+
+bool demo::detail::crc32cHardware()
+{
+	return hasHardware();
+}
+
+void demo::crc32cBatch(uint8_t const* const* data, size_t const* sizes, size_t n, uint32_t* out)
+{
+	size_t i = 0;
+
+#if defined(DEMO_CRC32C_HARDWARE)
+	if (hasHardware())
+	{
+		for (; i + 3 <= n; i += 3) batchHardware(data + i, sizes + i, out + i);
+	}
+#endif
+
+	for (; i < n; ++i) out[i] = crc32c(data[i], sizes[i]);
+}
+
+size_t demo::verifyChecksums(artdaq::Fragment const* const* frags, size_t n, ChecksumStatus* status)
+{
+	// Gather a chunk of spans at a time, so that they can be checksummed together without
+	// allocating
+	size_t const chunk = 48;
+	uint8_t const* begin[chunk];
+	size_t bytes[chunk];
+	uint32_t expected[chunk];
+	uint32_t crc[chunk];
+	size_t which[chunk];
+
+	ChecksumSpan s;
+	auto const findSpan = overloaded(
+	    [&s](AsciiFragment const& f) { return f.checksum_span(s); },
+	    [&s](UDPFragment const& f) { return f.checksum_span(s); },
+	    [&s](CRT::Fragment const& f) { return f.checksum_span(s); },
+	    [](artdaq::Fragment const&) { return false; });
+
+	size_t nbad = 0;
+	for (size_t first = 0; first < n; first += chunk)
+	{
+		size_t const last = std::min(n, first + chunk);
+		size_t m = 0;
+		for (size_t i = first; i < last; ++i)
+		{
+			if (!visit(*frags[i], findSpan))
+			{
+				status[i] = ChecksumStatus::None;
+				continue;
+			}
+			if (!s.complete)
+			{
+				status[i] = ChecksumStatus::Bad;
+				++nbad;
+				continue;
+			}
+			begin[m] = s.begin;
+			bytes[m] = s.bytes;
+			expected[m] = s.expected;
+			which[m++] = i;
+		}
+
+		crc32cBatch(begin, bytes, m, crc);
+		for (size_t j = 0; j < m; ++j)
+		{
+			bool const good = crc[j] == expected[j];
+			status[which[j]] = good ? ChecksumStatus::Good : ChecksumStatus::Bad;
+			nbad += !good;
+		}
+	}
+	return nbad;
+}
@@ -0,0 +1,97 @@
+#ifndef artdaq_core_demo_Overlays_Checksum_hh
+#define artdaq_core_demo_Overlays_Checksum_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli) checksums of Fragment payloads. AsciiFragment, UDPFragment and
+// CRT::Fragment can each carry one, which their writers fill in on request; Fragments
+// without one are read as before. On x86-64 the CRC uses the SSE4.2 crc32 instruction if
+// the CPU has it, whatever the build targets, running three streams at once to hide its
+// latency, and otherwise a slicing-by-8 table lookup.
+
+namespace demo
+{
+	/**
+	 * \brief The bytes of a Fragment that its checksum covers, and the checksum stored with them
+	 */
+	struct ChecksumSpan
+	{
+		uint8_t const* begin; ///< Start of the bytes covered
+		size_t bytes; ///< Number of bytes covered
+		uint32_t expected; ///< The CRC-32C stored in the Fragment
+		bool complete; ///< false if the payload is too short for the bytes covered and the checksum
+	};
+
+	/**
+	 * \brief Whether a checksum is present and right
+	 */
+	enum class ChecksumStatus : uint8_t
+	{
+		None, ///< The Fragment has no checksum, or is of a type that can't have one
+		Good, ///< The checksum matches
+		Bad ///< The checksum doesn't match, or the Fragment is too short to hold what it covers
+	};
+
+	/**
+	 * \brief CRC-32C of a buffer, or of the next piece of a longer one
+	 * \param data The bytes
+	 * \param n Number of bytes
+	 * \param crc CRC-32C of the bytes before these, if continuing; 0 to start
+	 * \return CRC-32C of all the bytes so far
+	 */
+	uint32_t crc32c(void const* data, size_t n, uint32_t crc = 0);
+
+	/**
+	 * \brief CRC-32C of each of many buffers
+	 * \param data Start of each buffer
+	 * \param sizes Size of each buffer
+	 * \param n Number of buffers
+	 * \param out CRC-32C of each buffer
+	 *
+	 * With SSE4.2, the buffers are taken three at a time and checksummed together, which is
+	 * quicker than one by one for buffers too short to be split up.
+	 */
+	void crc32cBatch(uint8_t const* const* data, size_t const* sizes, size_t n, uint32_t* out);
+
+	namespace detail
+	{
+		/**
+		 * \brief CRC-32C by table lookup, as crc32c() computes it without SSE4.2
+		 * \param data The bytes
+		 * \param n Number of bytes
+		 * \param crc CRC-32C of the bytes before these, if continuing; 0 to start
+		 * \return CRC-32C of all the bytes so far
+		 */
+		uint32_t crc32cSoftware(void const* data, size_t n, uint32_t crc = 0);
+
+		/**
+		 * \brief Whether crc32c() and crc32cBatch() use the SSE4.2 crc32 instruction
+		 * \return true if built for x86-64 and the CPU running it has SSE4.2
+		 */
+		bool crc32cHardware();
+	}
+
+	/**
+	 * \brief Check a checksum
+	 * \param span What the checksum covers, from an overlay's checksum_span()
+	 * \return true if the bytes are all there and match the checksum
+	 */
+	inline bool checksumMatches(ChecksumSpan const& span)
+	{
+		return span.complete && crc32c(span.begin, span.bytes) == span.expected;
+	}
+
+	/**
+	 * \brief Check the checksums of many Fragments of the types in this package
+	 * \param frags Pointers to the Fragments
+	 * \param n Number of Fragments
+	 * \param status Whether each Fragment has a checksum, and if so whether it is right
+	 * \return Number of Fragments whose status is ChecksumStatus::Bad
+	 */
+	size_t verifyChecksums(artdaq::Fragment const* const* frags, size_t n, ChecksumStatus* status);
+}
+
+#endif /* artdaq_core_demo_Overlays_Checksum_hh */
@@ -0,0 +1,273 @@
+#include "artdaq-core-demo/Overlays/CompressedPayload.hh"
+
+#include "cetlib/exception.h"
+
+#include <cstring>
+#include <memory>
+
+namespace
+{
+	// Limits from the LZ4 block format: a match is at least 4 bytes, the last 5 bytes
+	// are always literals, and no match starts in the last 12 bytes.
+	size_t const min_match = 4;
+	size_t const last_literals = 5;
+	size_t const match_find_limit = 12;
+	size_t const max_offset = 65535;
+
+	int const max_hash_log = 12;
+
+	uint32_t read32(uint8_t const* p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof v);
+		return v;
+	}
+
+	uint32_t hash(uint32_t v, int log)
+	{
+		return (v * 2654435761u) >> (32 - log);
+	}
+
+	// Fewer hash buckets for short inputs, so that clearing the table doesn't cost
+	// more than compressing a small datagram
+	int hashLog(size_t n)
+	{
+		return n <= 1024 ? 8 : n <= 16384 ? 10 : max_hash_log;
+	}
+
+	// Bytes that extend a length of 15 or more in a token nibble
+	uint8_t* putLength(uint8_t* op, size_t len)
+	{
+		for (; len >= 255; len -= 255) *op++ = 255;
+		*op++ = static_cast<uint8_t>(len);
+		return op;
+	}
+
+	// Read the bytes extending a length, returning false if they run off the end
+	bool getLength(uint8_t const*& ip, uint8_t const* end, size_t& len)
+	{
+		unsigned b;
+		do
+		{
+			if (ip >= end) return false;
+			b = *ip++;
+			len += b;
+		} while (b == 255);
+		return true;
+	}
+
+	// How far the bytes at a and b, which may run to limit, keep matching
+	uint8_t const* matchEnd(uint8_t const* a, uint8_t const* b, uint8_t const* limit)
+	{
+		while (limit - a >= 8)
+		{
+			uint64_t x, y;
+			memcpy(&x, a, sizeof x);
+			memcpy(&y, b, sizeof y);
+			if (x != y) return a + (__builtin_ctzll(x ^ y) >> 3);
+			a += 8;
+			b += 8;
+		}
+		while (a < limit && *a == *b)
+		{
+			++a;
+			++b;
+		}
+		return a;
+	}
+
+	// Read the CompressedPayloadHeader, throwing if compressedPayloadComplete() would be false
+	demo::CompressedPayloadHeader checkedHeader(uint8_t const* stored, size_t storedBytes)
+	{
+		demo::CompressedPayloadHeader h;
+		if (storedBytes < sizeof h)
+		{
+			throw cet::exception("CompressedPayload") << "Compressed payload is truncated: only " << storedBytes << " bytes";
+		}
+		memcpy(&h, stored, sizeof h);
+		if (h.compressed_bytes > storedBytes - sizeof h)
+		{
+			throw cet::exception("CompressedPayload") << "Compressed payload is truncated: only " << storedBytes << " bytes";
+		}
+		if (h.raw_bytes > demo::lz4DecompressBound(h.compressed_bytes))
+		{
+			throw cet::exception("CompressedPayload") << "Compressed payload is corrupt: " << h.compressed_bytes
+			                                          << " bytes can't decompress to " << h.raw_bytes;
+		}
+		return h;
+	}
+}
+
+size_t demo::lz4Compress(uint8_t const* src, size_t n, uint8_t* dst, size_t capacity)
+{
+	uint8_t const* const end = src + n;
+	uint8_t const* anchor = src;
+	uint8_t* op = dst;
+	uint8_t* const oend = dst + capacity;
+
+	if (n > match_find_limit)
+	{
+		int const log = hashLog(n);
+		uint32_t table[1 << max_hash_log];
+		memset(table, 0, sizeof(uint32_t) << log);
+
+		uint8_t const* const mflimit = end - match_find_limit;
+		uint8_t const* const matchlimit = end - last_literals;
+		uint8_t const* ip = src + 1;
+
+		while (ip < mflimit)
+		{
+			uint32_t const seq = read32(ip);
+			uint32_t const h = hash(seq, log);
+			uint8_t const* ref = src + table[h];
+			table[h] = static_cast<uint32_t>(ip - src);
+
+			if (static_cast<size_t>(ip - ref) > max_offset || read32(ref) != seq)
+			{
+				// Step further the longer it has been since the last match, so that
+				// incompressible data goes by quickly
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			while (ip > anchor && ref > src && ip[-1] == ref[-1])
+			{
+				--ip;
+				--ref;
+			}
+			uint8_t const* const m = matchEnd(ip + min_match, ref + min_match, matchlimit);
+
+			size_t const lit = ip - anchor;
+			size_t const len = m - ip - min_match;
+			if (static_cast<size_t>(oend - op) < 1 + lit / 255 + 1 + lit + 2 + len / 255 + 1) return 0;
+
+			uint8_t* const token = op++;
+			*token = static_cast<uint8_t>((lit >= 15 ? 15 : lit) << 4);
+			if (lit >= 15) op = putLength(op, lit - 15);
+			memcpy(op, anchor, lit);
+			op += lit;
+
+			size_t const offset = ip - ref;
+			*op++ = static_cast<uint8_t>(offset);
+			*op++ = static_cast<uint8_t>(offset >> 8);
+			*token |= static_cast<uint8_t>(len >= 15 ? 15 : len);
+			if (len >= 15) op = putLength(op, len - 15);
+
+			ip = anchor = m;
+			if (ip < mflimit) table[hash(read32(ip - 2), log)] = static_cast<uint32_t>(ip - 2 - src);
+		}
+	}
+
+	size_t const lit = end - anchor;
+	if (static_cast<size_t>(oend - op) < 1 + lit / 255 + 1 + lit) return 0;
+	*op++ = static_cast<uint8_t>((lit >= 15 ? 15 : lit) << 4);
+	if (lit >= 15) op = putLength(op, lit - 15);
+	if (lit) memcpy(op, anchor, lit);
+	op += lit;
+	return op - dst;
+}
+
+bool demo::lz4Decompress(uint8_t const* src, size_t n, uint8_t* dst, size_t size)
+{
+	uint8_t const* ip = src;
+	uint8_t const* const iend = src + n;
+	uint8_t* op = dst;
+	uint8_t* const oend = dst + size;
+
+	for (;;)
+	{
+		if (ip >= iend) return false;
+		unsigned const token = *ip++;
+
+		size_t lit = token >> 4;
+		if (lit == 15 && !getLength(ip, iend, lit)) return false;
+		if (lit > static_cast<size_t>(iend - ip) || lit > static_cast<size_t>(oend - op)) return false;
+		if (lit) memcpy(op, ip, lit);
+		ip += lit;
+		op += lit;
+
+		// The last sequence is only literals
+		if (ip == iend) return op == oend;
+
+		if (iend - ip < 2) return false;
+		size_t const offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (offset == 0 || offset > static_cast<size_t>(op - dst)) return false;
+
+		size_t len = token & 15;
+		if (len == 15 && !getLength(ip, iend, len)) return false;
+		len += min_match;
+		if (len > static_cast<size_t>(oend - op)) return false;
+
+		// A match may overlap the bytes it produces, so copy 8 bytes at a time only
+		// when they are at least 8 bytes back
+		uint8_t const* match = op - offset;
+		if (offset >= 8)
+		{
+			for (; len >= 8; len -= 8, op += 8, match += 8) memcpy(op, match, 8);
+		}
+		for (; len > 0; --len) *op++ = *match++;
+	}
+}
+
+size_t demo::compressPayload(uint8_t const* raw, size_t rawBytes, uint8_t* out, size_t capacity)
+{
+	CompressedPayloadHeader h;
+	if (rawBytes > UINT32_MAX || capacity < sizeof h) return 0;
+
+	size_t const block = lz4Compress(raw, rawBytes, out + sizeof h, capacity - sizeof h);
+	if (block == 0) return 0;
+
+	h.raw_bytes = static_cast<uint32_t>(rawBytes);
+	h.compressed_bytes = static_cast<uint32_t>(block);
+	memcpy(out, &h, sizeof h);
+	return sizeof h + block;
+}
+
+size_t demo::compressedPayloadRawBytes(uint8_t const* stored, size_t storedBytes)
+{
+	CompressedPayloadHeader h;
+	if (storedBytes < sizeof h) return 0;
+	memcpy(&h, stored, sizeof h);
+	return h.raw_bytes;
+}
+
+bool demo::compressedPayloadComplete(uint8_t const* stored, size_t storedBytes)
+{
+	CompressedPayloadHeader h;
+	if (storedBytes < sizeof h) return false;
+	memcpy(&h, stored, sizeof h);
+	return h.compressed_bytes <= storedBytes - sizeof h && h.raw_bytes <= lz4DecompressBound(h.compressed_bytes);
+}
+
+size_t demo::decompressPayload(uint8_t const* stored, size_t storedBytes, uint8_t* out, size_t capacity)
+{
+	CompressedPayloadHeader const h = checkedHeader(stored, storedBytes);
+	if (h.raw_bytes > capacity)
+	{
+		throw cet::exception("CompressedPayload") << "Compressed payload decompresses to " << h.raw_bytes
+												  << " bytes, but there is only room for " << capacity;
+	}
+	if (!lz4Decompress(stored + sizeof h, h.compressed_bytes, out, h.raw_bytes))
+	{
+		throw cet::exception("CompressedPayload") << "Compressed payload is corrupt";
+	}
+	return h.raw_bytes;
+}
+
+std::vector<uint8_t> const* demo::detail::LazyInflation::inflate_(uint8_t const* stored, size_t storedBytes,
+                                                                 size_t paddedBytes) const
+{
+	// paddedBytes comes from the header's raw_bytes, so check that before allocating it
+	checkedHeader(stored, storedBytes);
+	std::unique_ptr<std::vector<uint8_t>> data(new std::vector<uint8_t>(paddedBytes, 0));
+	decompressPayload(stored, storedBytes, data->data(), paddedBytes);
+
+	// Another thread may have got there first, in which case use its copy
+	std::vector<uint8_t>* expected = nullptr;
+	if (data_.compare_exchange_strong(expected, data.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+	{
+		return data.release();
+	}
+	return expected;
+}
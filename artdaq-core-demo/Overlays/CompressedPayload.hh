@@ -0,0 +1,164 @@
+#ifndef artdaq_core_demo_Overlays_CompressedPayload_hh
+#define artdaq_core_demo_Overlays_CompressedPayload_hh
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compression of AsciiFragment and UDPFragment payloads, with a block codec
+// built in so that no compression library is needed.  The compressed
+// data is in the LZ4 block format, so other LZ4 block decoders can read it;
+// test/CompressedPayload_t.cc checks both ways against blocks made by the reference lz4.
+// The compressor is a single-pass greedy matcher that favours speed over
+// ratio, similar to LZ4's fast mode.
+
+namespace demo
+{
+	/**
+	 * \brief Start of a compressed payload. The LZ4 block follows it directly.
+	 */
+	struct CompressedPayloadHeader
+	{
+		uint32_t raw_bytes; ///< Size of the payload before compression
+		uint32_t compressed_bytes; ///< Size of the LZ4 block after this header
+	};
+
+	static_assert(sizeof(CompressedPayloadHeader) == 8, "CompressedPayloadHeader size changed");
+
+	/**
+	 * \brief Largest LZ4 block that lz4Compress() can make from n bytes
+	 * \param n Number of bytes to compress
+	 * \return Bytes of output space that are always enough
+	 */
+	inline size_t lz4CompressBound(size_t n) { return n + n / 255 + 16; }
+
+	/**
+	 * \brief Most bytes an LZ4 block of n bytes can decompress to
+	 * \param n Size of the block
+	 * \return A bound on the decompressed size: each byte of the block adds at most 255
+	 */
+	inline size_t lz4DecompressBound(size_t n) { return 255 * n + 16; }
+
+	/**
+	 * \brief Compress into an LZ4 block
+	 * \param src Bytes to compress
+	 * \param n Number of bytes to compress
+	 * \param dst Where to put the block
+	 * \param capacity Bytes available at dst
+	 * \return Size of the block, or 0 if it doesn't fit in capacity
+	 */
+	size_t lz4Compress(uint8_t const* src, size_t n, uint8_t* dst, size_t capacity);
+
+	/**
+	 * \brief Decompress an LZ4 block, checking every length and offset against the buffers
+	 * \param src The block
+	 * \param n Size of the block
+	 * \param dst Where to put the decompressed bytes
+	 * \param size Expected number of decompressed bytes
+	 * \return true if the block is well-formed and decompresses to exactly size bytes
+	 */
+	bool lz4Decompress(uint8_t const* src, size_t n, uint8_t* dst, size_t size);
+
+	/**
+	 * \brief Largest compressed payload, CompressedPayloadHeader included, that compressPayload() can make
+	 * \param rawBytes Size of the payload before compression
+	 * \return Bytes of output space that are always enough
+	 */
+	inline size_t compressedPayloadBound(size_t rawBytes)
+	{
+		return sizeof(CompressedPayloadHeader) + lz4CompressBound(rawBytes);
+	}
+
+	/**
+	 * \brief Compress a payload, writing its CompressedPayloadHeader and then the LZ4 block
+	 * \param raw The payload
+	 * \param rawBytes Size of the payload
+	 * \param out Where to put the compressed payload
+	 * \param capacity Bytes available at out
+	 * \return Size of the compressed payload, or 0 if it doesn't fit in capacity
+	 */
+	size_t compressPayload(uint8_t const* raw, size_t rawBytes, uint8_t* out, size_t capacity);
+
+	/**
+	 * \brief Get the size a compressed payload decompresses to
+	 * \param stored The compressed payload
+	 * \param storedBytes Bytes available at stored
+	 * \return CompressedPayloadHeader::raw_bytes, or 0 if the CompressedPayloadHeader isn't all there
+	 */
+	size_t compressedPayloadRawBytes(uint8_t const* stored, size_t storedBytes);
+
+	/**
+	 * \brief Check that a compressed payload's LZ4 block is within the bytes available, and could decompress to the size claimed
+	 * \param stored The compressed payload
+	 * \param storedBytes Bytes available at stored
+	 * \return Whether the CompressedPayloadHeader and the block it describes are all there, and
+	 * CompressedPayloadHeader::raw_bytes is no more than lz4DecompressBound() of the block
+	 *
+	 * Check this before allocating raw_bytes for the payload, so that a corrupt header can't ask for gigabytes.
+	 */
+	bool compressedPayloadComplete(uint8_t const* stored, size_t storedBytes);
+
+	/**
+	 * \brief Decompress a compressed payload
+	 * \param stored The compressed payload
+	 * \param storedBytes Bytes available at stored
+	 * \param out Where to put the decompressed payload
+	 * \param capacity Bytes available at out
+	 * \return Size of the decompressed payload
+	 * \exception cet::exception if the payload is corrupt or doesn't fit in capacity
+	 */
+	size_t decompressPayload(uint8_t const* stored, size_t storedBytes, uint8_t* out, size_t capacity);
+
+	namespace detail
+	{
+		/**
+		 * \brief A payload decompressed on first use, safely from any number of threads
+		 *
+		 * Until then it is a single null pointer, so overlays of uncompressed payloads, which
+		 * never use it, stay small and cheap to make. Threads that race to decompress first each
+		 * do so, and all but one throw their copy away.
+		 *
+		 * Copies start out empty, so an overlay holding one can be copied freely and
+		 * each copy decompresses for itself if it is used.
+		 */
+		class LazyInflation
+		{
+		public:
+			LazyInflation()
+				: data_(nullptr) {}
+
+			LazyInflation(LazyInflation const&)
+				: data_(nullptr) {}
+
+			LazyInflation& operator=(LazyInflation const&)
+			{
+				delete data_.exchange(nullptr, std::memory_order_acq_rel);
+				return *this;
+			}
+
+			~LazyInflation() { delete data_.load(std::memory_order_relaxed); }
+
+			/**
+			 * \brief Get the decompressed payload, decompressing it the first time
+			 * \param stored The compressed payload
+			 * \param storedBytes Bytes available at stored
+			 * \param paddedBytes Size of the buffer to decompress into, at least the raw size, the rest zeroed
+			 * \return Start of the decompressed payload
+			 * \exception cet::exception if the payload is corrupt
+			 */
+			uint8_t const* get(uint8_t const* stored, size_t storedBytes, size_t paddedBytes) const
+			{
+				std::vector<uint8_t> const* data = data_.load(std::memory_order_acquire);
+				return (data ? data : inflate_(stored, storedBytes, paddedBytes))->data();
+			}
+
+		private:
+			std::vector<uint8_t> const* inflate_(uint8_t const* stored, size_t storedBytes, size_t paddedBytes) const;
+
+			mutable std::atomic<std::vector<uint8_t>*> data_; ///< The decompressed payload, or nullptr until get() is first called
+		};
+	}
+}
+
+#endif /* artdaq_core_demo_Overlays_CompressedPayload_hh */
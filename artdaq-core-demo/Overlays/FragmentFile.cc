@@ -0,0 +1,325 @@
+#include "artdaq-core-demo/Overlays/FragmentFile.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#include "cetlib/exception.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr uint64_t demo::FragmentFileFormat::magic;
+constexpr uint32_t demo::FragmentFileFormat::version;
+constexpr size_t demo::FragmentFileFormat::alignment;
+
+namespace
+{
+	char const zeros[demo::FragmentFileFormat::alignment] = {};
+
+	size_t const buffer_bytes = 1 << 20;
+
+	bool type_then_sequence(demo::FragmentFileReader::Record const* a, demo::FragmentFileReader::Record const* b)
+	{
+		return a->type() != b->type() ? a->type() < b->type() : a->sequenceID() < b->sequenceID();
+	}
+
+	// Whether the metadata and payload of a record fit in the given number of bytes after its header.
+	// Compares by subtraction, so sizes read from a damaged file can't overflow.
+	bool body_fits(demo::FragmentFileFormat::RecordHeader const& r, uint64_t room)
+	{
+		uint64_t const metadata = demo::FragmentFileFormat::padded_size(r.metadata_bytes);
+		return metadata <= room && demo::FragmentFileFormat::padded_size(r.payload_bytes) <= room - metadata;
+	}
+}
+
+demo::FragmentFileWriter::FragmentFileWriter(std::string const& path)
+	: path_(path)
+	, file_(fopen(path.c_str(), "wb"))
+	, offset_(0)
+	, offsets_()
+{
+	if (!file_)
+	{
+		throw cet::exception("FragmentFileWriter") << "Cannot create " << path_ << ": " << strerror(errno);
+	}
+	setvbuf(file_, nullptr, _IOFBF, buffer_bytes);
+
+	// Rewritten with the index position by close()
+	FragmentFileFormat::FileHeader const header{FragmentFileFormat::magic, FragmentFileFormat::version, 0, 0, 0};
+	write_(&header, sizeof(header));
+}
+
+demo::FragmentFileWriter::~FragmentFileWriter()
+{
+	try
+	{
+		close();
+	}
+	catch (...)
+	{
+		// Destructors can't report errors; call close() to see them
+	}
+}
+
+void demo::FragmentFileWriter::write_(void const* data, size_t nBytes)
+{
+	if (nBytes != 0 && fwrite(data, 1, nBytes, file_) != nBytes)
+	{
+		throw cet::exception("FragmentFileWriter") << "Error writing " << path_ << ": " << strerror(errno);
+	}
+	offset_ += nBytes;
+}
+
+void demo::FragmentFileWriter::write(artdaq::Fragment const& frag)
+{
+	uint8_t const* metadata = nullptr;
+	size_t metadataBytes = 0;
+	if (frag.hasMetadata())
+	{
+		metadata = reinterpret_cast<uint8_t const*>(frag.metadata<artdaq::RawDataType>());
+		metadataBytes = reinterpret_cast<uint8_t const*>(frag.dataBeginBytes()) - metadata;
+	}
+	write(frag.type(), frag.sequenceID(), frag.fragmentID(), frag.timestamp(),
+		  metadata, metadataBytes, frag.dataBeginBytes(), frag.dataSizeBytes());
+}
+
+void demo::FragmentFileWriter::write(artdaq::Fragment::type_t type, artdaq::Fragment::sequence_id_t sequenceID,
+									 artdaq::Fragment::fragment_id_t fragmentID, artdaq::Fragment::timestamp_t timestamp,
+									 void const* metadata, size_t metadataBytes, void const* payload, size_t payloadBytes)
+{
+	if (!file_)
+	{
+		throw cet::exception("FragmentFileWriter") << "Cannot write to " << path_ << " after closing it";
+	}
+	if (metadataBytes > UINT32_MAX || payloadBytes > UINT32_MAX)
+	{
+		throw cet::exception("FragmentFileWriter") << "Fragment with " << metadataBytes << " bytes of metadata and "
+												   << payloadBytes << " bytes of payload is too large";
+	}
+
+	FragmentFileFormat::RecordHeader header;
+	memset(&header, 0, sizeof(header));
+	header.sequence_id = sequenceID;
+	header.timestamp = timestamp;
+	header.fragment_id = fragmentID;
+	header.type = type;
+	header.metadata_bytes = metadataBytes;
+	header.payload_bytes = payloadBytes;
+
+	offsets_.push_back(offset_);
+	write_(&header, sizeof(header));
+	write_(metadata, metadataBytes);
+	write_(zeros, FragmentFileFormat::padded_size(metadataBytes) - metadataBytes);
+	write_(payload, payloadBytes);
+	write_(zeros, FragmentFileFormat::padded_size(payloadBytes) - payloadBytes);
+}
+
+void demo::FragmentFileWriter::close()
+{
+	if (!file_) return;
+
+	FragmentFileFormat::FileHeader const header{FragmentFileFormat::magic, FragmentFileFormat::version, 0,
+												offset_, offsets_.size()};
+	FILE* const file = file_;
+	try
+	{
+		write_(offsets_.data(), offsets_.size() * sizeof(uint64_t));
+		if (fseek(file_, 0, SEEK_SET) != 0)
+		{
+			throw cet::exception("FragmentFileWriter") << "Cannot rewind " << path_ << ": " << strerror(errno);
+		}
+		write_(&header, sizeof(header));
+	}
+	catch (...)
+	{
+		file_ = nullptr;
+		fclose(file);
+		throw;
+	}
+
+	file_ = nullptr;
+	if (fclose(file) != 0)
+	{
+		throw cet::exception("FragmentFileWriter") << "Error closing " << path_ << ": " << strerror(errno);
+	}
+}
+
+void demo::FragmentFileReader::Record::require_type_(artdaq::Fragment::type_t type) const
+{
+	if (header_->type != type)
+	{
+		throw cet::exception("FragmentFileReader") << "Record of sequence ID " << header_->sequence_id << " has type "
+												   << static_cast<int>(header_->type) << ", not "
+												   << fragmentTypeName(static_cast<FragmentType>(type));
+	}
+}
+
+CRT::Fragment demo::FragmentFileReader::Record::crt() const
+{
+	require_type_(FragmentType::CRT);
+	return CRT::Fragment(payload(), payloadBytes());
+}
+
+demo::AsciiFragment demo::FragmentFileReader::Record::ascii() const
+{
+	require_type_(FragmentType::ASCII);
+	return AsciiFragment(payload(), payloadBytes(), metadata<AsciiFragment::Metadata>());
+}
+
+demo::UDPFragment demo::FragmentFileReader::Record::udp() const
+{
+	require_type_(FragmentType::UDP);
+	return UDPFragment(payload(), payloadBytes(), metadata<UDPFragment::Metadata>());
+}
+
+demo::UDPContainerFragment demo::FragmentFileReader::Record::udpContainer() const
+{
+	require_type_(FragmentType::UDPCONTAINER);
+	return UDPContainerFragment(payload(), payloadBytes());
+}
+
+CRT::PackedFragment demo::FragmentFileReader::Record::crtPacked() const
+{
+	require_type_(FragmentType::CRTPACKED);
+	return CRT::PackedFragment(payload(), payloadBytes());
+}
+
+demo::FragmentFileReader::FragmentFileReader(std::string const& path)
+	: path_(path)
+	, map_(nullptr)
+	, map_bytes_(0)
+	, truncated_(false)
+	, records_()
+	, index_()
+{
+	int const fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw cet::exception("FragmentFileReader") << "Cannot open " << path_ << ": " << strerror(errno);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		int const err = errno;
+		::close(fd);
+		throw cet::exception("FragmentFileReader") << "Cannot stat " << path_ << ": " << strerror(err);
+	}
+	map_bytes_ = st.st_size;
+	if (map_bytes_ < sizeof(FragmentFileFormat::FileHeader))
+	{
+		::close(fd);
+		throw cet::exception("FragmentFileReader") << path_ << " is too small to be a Fragment file";
+	}
+
+	void* const map = mmap(nullptr, map_bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+	int const err = errno;
+	::close(fd);
+	if (map == MAP_FAILED)
+	{
+		throw cet::exception("FragmentFileReader") << "Cannot map " << path_ << ": " << strerror(err);
+	}
+	map_ = static_cast<uint8_t const*>(map);
+
+	try
+	{
+		auto header = reinterpret_cast<FragmentFileFormat::FileHeader const*>(map_);
+		if (header->magic != FragmentFileFormat::magic || header->version != FragmentFileFormat::version)
+		{
+			throw cet::exception("FragmentFileReader") << path_ << " is not a version " << FragmentFileFormat::version
+													   << " Fragment file";
+		}
+
+		if (header->index_offset != 0)
+		{
+			if (header->index_offset % FragmentFileFormat::alignment != 0 || header->index_offset > map_bytes_ ||
+				(map_bytes_ - header->index_offset) / sizeof(uint64_t) < header->n_records)
+			{
+				throw cet::exception("FragmentFileReader") << "The index of " << path_ << " is past the end of the file";
+			}
+			auto offsets = reinterpret_cast<uint64_t const*>(map_ + header->index_offset);
+			records_.reserve(header->n_records);
+			for (size_t i = 0; i < header->n_records; ++i)
+			{
+				add_record_(offsets[i]);
+			}
+		}
+		else
+		{
+			uint64_t offset = sizeof(FragmentFileFormat::FileHeader);
+			while (offset < map_bytes_)
+			{
+				auto const r = reinterpret_cast<FragmentFileFormat::RecordHeader const*>(map_ + offset);
+				if (map_bytes_ - offset < sizeof(*r))
+				{
+					truncated_ = true;
+					break;
+				}
+				if (!body_fits(*r, map_bytes_ - offset - sizeof(*r)))
+				{
+					truncated_ = true;
+					break;
+				}
+				add_record_(offset);
+				offset += sizeof(*r) + FragmentFileFormat::padded_size(r->metadata_bytes) +
+						  FragmentFileFormat::padded_size(r->payload_bytes);
+			}
+		}
+	}
+	catch (...)
+	{
+		munmap(const_cast<uint8_t*>(map_), map_bytes_);
+		throw;
+	}
+
+	index_.reserve(records_.size());
+	for (auto const& r : records_)
+	{
+		index_.push_back(&r);
+	}
+	std::stable_sort(index_.begin(), index_.end(), type_then_sequence);
+}
+
+demo::FragmentFileReader::~FragmentFileReader()
+{
+	munmap(const_cast<uint8_t*>(map_), map_bytes_);
+}
+
+void demo::FragmentFileReader::add_record_(uint64_t offset)
+{
+	if (offset % FragmentFileFormat::alignment != 0 || offset < sizeof(FragmentFileFormat::FileHeader) ||
+		offset > map_bytes_ || map_bytes_ - offset < sizeof(FragmentFileFormat::RecordHeader))
+	{
+		throw cet::exception("FragmentFileReader") << "Bad record offset " << offset << " in " << path_;
+	}
+
+	auto const r = reinterpret_cast<FragmentFileFormat::RecordHeader const*>(map_ + offset);
+	if (!body_fits(*r, map_bytes_ - offset - sizeof(*r)))
+	{
+		throw cet::exception("FragmentFileReader") << "Record at offset " << offset << " runs past the end of " << path_;
+	}
+	records_.emplace_back(r);
+}
+
+demo::FragmentFileReader::Range demo::FragmentFileReader::find(artdaq::Fragment::type_t type) const
+{
+	auto const first = std::lower_bound(index_.begin(), index_.end(), type,
+										[](Record const* r, artdaq::Fragment::type_t t) { return r->type() < t; });
+	auto const last = std::upper_bound(first, index_.end(), type,
+									   [](artdaq::Fragment::type_t t, Record const* r) { return t < r->type(); });
+	return Range{index_.data() + (first - index_.begin()), index_.data() + (last - index_.begin())};
+}
+
+demo::FragmentFileReader::Range demo::FragmentFileReader::find(artdaq::Fragment::type_t type,
+																 artdaq::Fragment::sequence_id_t sequenceID) const
+{
+	Range const ofType = find(type);
+	auto const first = std::lower_bound(ofType.first, ofType.last, sequenceID,
+										[](Record const* r, artdaq::Fragment::sequence_id_t s) { return r->sequenceID() < s; });
+	auto const last = std::upper_bound(first, ofType.last, sequenceID,
+									   [](artdaq::Fragment::sequence_id_t s, Record const* r) { return s < r->sequenceID(); });
+	return Range{first, last};
+}
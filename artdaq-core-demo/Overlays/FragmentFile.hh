@@ -0,0 +1,309 @@
+#ifndef artdaq_core_demo_Overlays_FragmentFile_hh
+#define artdaq_core_demo_Overlays_FragmentFile_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/AsciiFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTPackedFragment.hh"
+#include "artdaq-core-demo/Overlays/UDPContainerFragment.hh"
+#include "artdaq-core-demo/Overlays/UDPFragment.hh"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace demo
+{
+	struct FragmentFileFormat;
+	class FragmentFileWriter;
+	class FragmentFileReader;
+}
+
+/**
+ * \brief Layout of a file of Fragments, for saving and replaying data without art
+ *
+ *     FileHeader | RecordHeader, metadata, payload | RecordHeader, metadata, payload | ... | index
+ *
+ * The metadata and payload of each record are padded to 8 bytes, so every RecordHeader, and every
+ * payload, is 8-byte aligned, as in an artdaq::Fragment. The index, written when the file is closed,
+ * is the uint64_t offset of each RecordHeader. A file that wasn't closed has no index, and can still
+ * be read by scanning its records.
+ */
+struct demo::FragmentFileFormat
+{
+	static constexpr uint64_t magic = 0x474152464f4d4544ull; ///< "DEMOFRAG", read as a little-endian uint64_t
+	static constexpr uint32_t version = 1; ///< Version of the layout
+	static constexpr size_t alignment = 8; ///< Alignment of each record, metadata and payload
+
+	/**
+	 * \brief Start of the file
+	 */
+	struct FileHeader
+	{
+		uint64_t magic; ///< FragmentFileFormat::magic
+		uint32_t version; ///< FragmentFileFormat::version
+		uint32_t unused; ///< Pads the header to 8-byte words
+		uint64_t index_offset; ///< File offset of the index, or 0 if the file has no index
+		uint64_t n_records; ///< Number of records in the index
+	};
+
+	static_assert (sizeof(FileHeader) == 32, "FragmentFileFormat::FileHeader size changed");
+
+	/**
+	 * \brief Describes one Fragment, whose metadata and payload follow it
+	 */
+	struct RecordHeader
+	{
+		uint64_t sequence_id; ///< The Fragment's sequence ID
+		uint64_t timestamp; ///< The Fragment's timestamp
+		uint16_t fragment_id; ///< The Fragment's fragment ID
+		uint8_t type; ///< The Fragment's type
+		uint8_t unused_1; ///< Unused
+		uint32_t metadata_bytes; ///< Size of the metadata, before padding
+		uint32_t payload_bytes; ///< Size of the payload, before padding
+		uint32_t unused_2; ///< Pads the header to 8-byte words
+	};
+
+	static_assert (sizeof(RecordHeader) == 32, "FragmentFileFormat::RecordHeader size changed");
+
+	/**
+	 * \brief Round a size up to the alignment of the next part of the file
+	 * \param nBytes Size of some metadata or payload
+	 * \return Bytes it takes in the file
+	 */
+	static constexpr size_t padded_size(size_t nBytes)
+	{
+		return (nBytes + alignment - 1) & ~(alignment - 1);
+	}
+};
+
+/**
+ * \brief Writes Fragments to a file in the FragmentFileFormat
+ *
+ * Writes are buffered. The index is written by close(), or by the destructor.
+ */
+class demo::FragmentFileWriter
+{
+public:
+	/**
+	 * \brief FragmentFileWriter Constructor
+	 * \param path File to create, or to replace if it exists
+	 * \exception cet::exception if the file can't be created
+	 */
+	explicit FragmentFileWriter(std::string const& path);
+
+	/**
+	 * \brief Close the file if close() hasn't been called, ignoring any error
+	 */
+	~FragmentFileWriter();
+
+	FragmentFileWriter(FragmentFileWriter const&) = delete;
+	FragmentFileWriter& operator=(FragmentFileWriter const&) = delete;
+
+	/**
+	 * \brief Write a Fragment
+	 * \param frag Fragment to write, with its metadata if it has any
+	 * \exception cet::exception if the write fails
+	 */
+	void write(artdaq::Fragment const& frag);
+
+	/**
+	 * \brief Write a Fragment given in pieces, for data that isn't in an artdaq::Fragment
+	 * \param type The Fragment's type
+	 * \param sequenceID The Fragment's sequence ID
+	 * \param fragmentID The Fragment's fragment ID
+	 * \param timestamp The Fragment's timestamp
+	 * \param metadata The metadata, or nullptr if there is none
+	 * \param metadataBytes Size of the metadata
+	 * \param payload The payload
+	 * \param payloadBytes Size of the payload
+	 * \exception cet::exception if the write fails
+	 */
+	void write(artdaq::Fragment::type_t type, artdaq::Fragment::sequence_id_t sequenceID,
+			   artdaq::Fragment::fragment_id_t fragmentID, artdaq::Fragment::timestamp_t timestamp,
+			   void const* metadata, size_t metadataBytes, void const* payload, size_t payloadBytes);
+
+	/**
+	 * \brief Write the index and close the file
+	 * \exception cet::exception if the write fails
+	 */
+	void close();
+
+	/**
+	 * \brief Get the number of Fragments written
+	 * \return The number of Fragments written
+	 */
+	size_t size() const { return offsets_.size(); }
+
+private:
+	void write_(void const* data, size_t nBytes);
+
+	std::string path_;
+	FILE* file_;
+	uint64_t offset_;
+	std::vector<uint64_t> offsets_;
+};
+
+/**
+ * \brief Reads a file in the FragmentFileFormat by mapping it into memory
+ *
+ * The overlays handed out point straight into the mapped file, so reading a Fragment copies
+ * nothing, and touches only the pages it uses. They are valid for the life of the reader.
+ */
+class demo::FragmentFileReader
+{
+public:
+	/**
+	 * \brief One Fragment in the file
+	 */
+	class Record
+	{
+	public:
+		/**
+		 * \brief Record Constructor
+		 * \param h Header of the record, which its metadata and payload follow
+		 */
+		explicit Record(FragmentFileFormat::RecordHeader const* h) : header_(h) {}
+
+		artdaq::Fragment::type_t type() const { return header_->type; } ///< The Fragment's type
+		artdaq::Fragment::sequence_id_t sequenceID() const { return header_->sequence_id; } ///< The Fragment's sequence ID
+		artdaq::Fragment::fragment_id_t fragmentID() const { return header_->fragment_id; } ///< The Fragment's fragment ID
+		artdaq::Fragment::timestamp_t timestamp() const { return header_->timestamp; } ///< The Fragment's timestamp
+
+		/**
+		 * \brief Get the metadata
+		 * \return Pointer to the metadata, or nullptr if there is none
+		 */
+		uint8_t const* metadata() const
+		{
+			return header_->metadata_bytes ? reinterpret_cast<uint8_t const*>(header_ + 1) : nullptr;
+		}
+
+		size_t metadataBytes() const { return header_->metadata_bytes; } ///< Size of the metadata
+
+		/**
+		 * \brief Get the metadata as the given type
+		 * \return Pointer to the metadata, or nullptr if there isn't enough of it for a T
+		 */
+		template <typename T>
+		T const* metadata() const
+		{
+			return metadataBytes() >= sizeof(T) ? reinterpret_cast<T const*>(metadata()) : nullptr;
+		}
+
+		/**
+		 * \brief Get the payload
+		 * \return Pointer to the start of the payload
+		 */
+		uint8_t const* payload() const
+		{
+			return reinterpret_cast<uint8_t const*>(header_ + 1) + FragmentFileFormat::padded_size(header_->metadata_bytes);
+		}
+
+		size_t payloadBytes() const { return header_->payload_bytes; } ///< Size of the payload
+
+		/**
+		 * \brief Overlay a CRT Fragment
+		 * \exception cet::exception if the record isn't a CRT Fragment
+		 */
+		CRT::Fragment crt() const;
+
+		/**
+		 * \brief Overlay an AsciiFragment
+		 * \exception cet::exception if the record isn't an ASCII Fragment
+		 */
+		AsciiFragment ascii() const;
+
+		/**
+		 * \brief Overlay a UDPFragment
+		 * \exception cet::exception if the record isn't a UDP Fragment
+		 */
+		UDPFragment udp() const;
+
+		/**
+		 * \brief Overlay a UDPContainerFragment
+		 * \exception cet::exception if the record isn't a UDPCONTAINER Fragment
+		 */
+		UDPContainerFragment udpContainer() const;
+
+		/**
+		 * \brief Overlay a packed CRT Fragment
+		 * \exception cet::exception if the record isn't a CRTPACKED Fragment
+		 */
+		CRT::PackedFragment crtPacked() const;
+
+	private:
+		void require_type_(artdaq::Fragment::type_t type) const;
+
+		FragmentFileFormat::RecordHeader const* header_;
+	};
+
+	/**
+	 * \brief A range of records from the index, in order of type, then sequence ID, then position in the file
+	 */
+	struct Range
+	{
+		Record const* const* first; ///< The first record in the range
+		Record const* const* last; ///< Past the last record in the range
+
+		Record const* const* begin() const { return first; } ///< For range-based for
+		Record const* const* end() const { return last; } ///< For range-based for
+		size_t size() const { return last - first; } ///< Number of records in the range
+	};
+
+	/**
+	 * \brief FragmentFileReader Constructor
+	 * \param path File to read
+	 * \exception cet::exception if the file can't be mapped, or isn't in the FragmentFileFormat
+	 *
+	 * Uses the file's index if it has one. Otherwise, scans the records, stopping at a
+	 * truncated one, as left by a writer that didn't finish.
+	 */
+	explicit FragmentFileReader(std::string const& path);
+
+	/**
+	 * \brief Unmap the file
+	 */
+	~FragmentFileReader();
+
+	FragmentFileReader(FragmentFileReader const&) = delete;
+	FragmentFileReader& operator=(FragmentFileReader const&) = delete;
+
+	size_t size() const { return records_.size(); } ///< Number of Fragments in the file
+	Record const& operator[](size_t i) const { return records_[i]; } ///< Fragment i, in file order
+	std::vector<Record>::const_iterator begin() const { return records_.begin(); } ///< Fragments in file order
+	std::vector<Record>::const_iterator end() const { return records_.end(); } ///< Fragments in file order
+
+	/**
+	 * \brief Whether the file had no index and ended part way through a record
+	 * \return true if the last, incomplete record was dropped
+	 */
+	bool truncated() const { return truncated_; }
+
+	/**
+	 * \brief Find the Fragments of a type
+	 * \param type Fragment type to find
+	 * \return The Fragments of that type, in order of sequence ID
+	 */
+	Range find(artdaq::Fragment::type_t type) const;
+
+	/**
+	 * \brief Find the Fragments of a type with a sequence ID
+	 * \param type Fragment type to find
+	 * \param sequenceID Sequence ID to find
+	 * \return The matching Fragments, e.g. one from each board, in file order
+	 */
+	Range find(artdaq::Fragment::type_t type, artdaq::Fragment::sequence_id_t sequenceID) const;
+
+private:
+	void add_record_(uint64_t offset);
+
+	std::string path_;
+	uint8_t const* map_;
+	size_t map_bytes_;
+	bool truncated_;
+	std::vector<Record> records_;
+	std::vector<Record const*> index_;
+};
+
+#endif /* artdaq_core_demo_Overlays_FragmentFile_hh */
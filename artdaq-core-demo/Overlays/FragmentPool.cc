@@ -0,0 +1,62 @@
+#include "artdaq-core-demo/Overlays/FragmentPool.hh"
+
+#include <cstring>
+
+artdaq::FragmentPtr demo::FragmentPool::allocate_() const
+{
+	artdaq::FragmentPtr frag(new artdaq::Fragment(prototype_));
+
+	// Grow to full size and back: the vector keeps the capacity. Growing may move the storage
+	// without initialising it, so zero the header as release() does.
+	frag->resizeBytes(capacity_bytes_);
+	frag->resizeBytes(header_bytes_);
+	memset(frag->dataBeginBytes(), 0, frag->dataSizeBytes());
+	return frag;
+}
+
+artdaq::FragmentPtr demo::FragmentPool::acquire()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		++stats_.acquired;
+		if (!free_.empty())
+		{
+			artdaq::FragmentPtr frag = std::move(free_.back());
+			free_.pop_back();
+			return frag;
+		}
+		++stats_.allocated;
+	}
+	return allocate_();
+}
+
+void demo::FragmentPool::release(artdaq::FragmentPtr frag)
+{
+	if (!frag) return;
+
+	// Only Fragments laid out like ours can be reused. The prototype always has metadata, and
+	// metadataAddress() throws for a Fragment without any.
+	size_t const metadata_words = prototype_.dataAddress() - prototype_.metadataAddress();
+	if (!frag->hasMetadata() || static_cast<size_t>(frag->dataAddress() - frag->metadataAddress()) != metadata_words)
+	{
+		return;
+	}
+
+	// Put it back the way acquire() hands it out. Shrinking does not reallocate.
+	frag->resizeBytes(header_bytes_);
+	memcpy(frag->headerAddress(), prototype_.headerAddress(),
+	       (prototype_.dataAddress() - prototype_.headerAddress()) * sizeof(artdaq::RawDataType));
+	memset(frag->dataBeginBytes(), 0, frag->dataSizeBytes());
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	++stats_.released;
+	free_.push_back(std::move(frag));
+}
+
+demo::FragmentPool::Stats demo::FragmentPool::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	Stats s = stats_;
+	s.available = free_.size();
+	return s;
+}
@@ -0,0 +1,121 @@
+#ifndef artdaq_core_demo_Overlays_FragmentPool_hh
+#define artdaq_core_demo_Overlays_FragmentPool_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+
+#include <mutex>
+#include <vector>
+
+namespace demo
+{
+	class FragmentPool;
+
+	/**
+	 * \brief Tag for the writer constructors that take a Fragment whose overlay header
+	 * is already allocated, such as one from FragmentPool::acquire()
+	 */
+	struct HeaderReserved
+	{
+	};
+
+	constexpr HeaderReserved headerReserved{}; ///< Instance of HeaderReserved to pass to writer constructors
+}
+
+/**
+ * \brief A recycling pool of Fragments, each ready for an overlay writer
+ *
+ * Every Fragment handed out by acquire() has the pool's type and Metadata, has its overlay
+ * header allocated and zeroed, and has capacity for a payload of the configured size, so
+ * that writing a payload up to that size does not allocate. Consumers give Fragments back
+ * with release() once done with them, and the pool reuses their storage.
+ *
+ * For example, with an AsciiFragmentWriter:
+ * \code
+ * demo::FragmentPool pool(demo::FragmentType::ASCII, metadata, sizeof(demo::AsciiFragment::Header), max_chars);
+ * auto frag = pool.acquire();
+ * demo::AsciiFragmentWriter writer(*frag, demo::headerReserved);
+ * writer.resize(nChars);
+ * ...
+ * pool.release(std::move(frag));
+ * \endcode
+ *
+ * FragmentPool is thread-safe.
+ */
+class demo::FragmentPool
+{
+public:
+	/**
+	 * \brief Statistics on the use of a FragmentPool
+	 */
+	struct Stats
+	{
+		size_t allocated; ///< Number of Fragments the pool has had to allocate
+		size_t acquired; ///< Number of calls to acquire()
+		size_t released; ///< Number of Fragments returned with release()
+		size_t available; ///< Number of Fragments waiting in the pool
+	};
+
+	/**
+	 * \brief FragmentPool Constructor
+	 * \tparam Metadata Type of the overlay's Metadata
+	 * \param type Fragment type code for the pooled Fragments
+	 * \param metadata Metadata for every Fragment when it is handed out
+	 * \param header_bytes Size of the overlay's header, which is kept allocated
+	 * \param payload_bytes Payload size, not counting the header, to reserve room for
+	 * \param initial Number of Fragments to allocate up front
+	 */
+	template <typename Metadata>
+	FragmentPool(artdaq::Fragment::type_t type, Metadata const& metadata, size_t header_bytes, size_t payload_bytes,
+	             size_t initial = 0);
+
+	/**
+	 * \brief Get a Fragment, reusing a released one if there is one
+	 * \return A Fragment with the pool's type and Metadata and a zeroed overlay header
+	 */
+	artdaq::FragmentPtr acquire();
+
+	/**
+	 * \brief Give a Fragment back to the pool
+	 * \param frag The Fragment, which should have come from acquire(). Fragments with a different
+	 * amount of Metadata are simply freed.
+	 */
+	void release(artdaq::FragmentPtr frag);
+
+	/**
+	 * \brief Get statistics on the use of the pool
+	 * \return A Stats object
+	 */
+	Stats stats() const;
+
+private:
+	artdaq::FragmentPtr allocate_() const;
+
+	artdaq::Fragment prototype_;
+	size_t header_bytes_;
+	size_t capacity_bytes_;
+
+	mutable std::mutex mutex_;
+	std::vector<artdaq::FragmentPtr> free_;
+	Stats stats_;
+};
+
+template <typename Metadata>
+demo::FragmentPool::FragmentPool(artdaq::Fragment::type_t type, Metadata const& metadata, size_t header_bytes,
+                                 size_t payload_bytes, size_t initial)
+	: prototype_(0, 0, type)
+	, header_bytes_(header_bytes)
+	, capacity_bytes_(header_bytes + payload_bytes)
+	, stats_()
+{
+	prototype_.setMetadata(metadata);
+	prototype_.resizeBytes(header_bytes_, 0);
+
+	free_.reserve(initial);
+	for (size_t i = 0; i < initial; ++i)
+	{
+		free_.push_back(allocate_());
+	}
+	stats_.allocated = initial;
+}
+
+#endif /* artdaq_core_demo_Overlays_FragmentPool_hh */
@@ -0,0 +1,554 @@
+#ifndef artdaq_core_demo_Overlays_FragmentQueue_hh
+#define artdaq_core_demo_Overlays_FragmentQueue_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Lock-free queues for handing Fragments (or anything else that can be moved,
+// such as FragmentPtrs from a FragmentPool) from one thread to another,
+// e.g. from a receiving thread to decoding threads.
+
+namespace demo
+{
+	/**
+	 * \brief Size of the cache lines that the queues keep the producer's and consumer's data apart by
+	 */
+	constexpr size_t cache_line_bytes = 64;
+
+	class Backoff;
+	struct QueueStats;
+	template <typename T> class SPSCQueue;
+	template <typename T> class MPSCQueue;
+
+	typedef SPSCQueue<artdaq::FragmentPtr> FragmentSPSCQueue; ///< Hands FragmentPtrs from one thread to one other
+	typedef MPSCQueue<artdaq::FragmentPtr> FragmentMPSCQueue; ///< Hands FragmentPtrs from several threads to one
+}
+
+/**
+ * \brief Waits for a condition that another thread will make true, first spinning, then yielding, then sleeping
+ *
+ * Short waits, the common case for a queue that keeps up, are caught by spinning without giving
+ * up the CPU. Longer waits give it up, more and more, so that a stalled consumer doesn't burn a core.
+ */
+class demo::Backoff
+{
+public:
+	static constexpr unsigned spins = 64; ///< Number of pause() calls that spin
+	static constexpr unsigned yields = 16; ///< Number of pause() calls after the spins that yield
+	static constexpr unsigned max_sleep_us = 1000; ///< Longest sleep, in microseconds
+
+	Backoff() : count_(0) {}
+
+	/**
+	 * \brief Wait a little, longer the more times this has been called since reset()
+	 */
+	void pause()
+	{
+		if (count_ < spins)
+		{
+#if defined(__SSE2__)
+			_mm_pause();
+#endif
+		}
+		else if (count_ < spins + yields)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			unsigned const doublings = std::min(count_ - spins - yields, 10u);
+			unsigned const us = 1u << doublings;
+			unsigned const most = max_sleep_us;
+			std::this_thread::sleep_for(std::chrono::microseconds(us < most ? us : most));
+		}
+		++count_;
+	}
+
+	/**
+	 * \brief Start again with spinning
+	 */
+	void reset() { count_ = 0; }
+
+private:
+	unsigned count_;
+};
+
+/**
+ * \brief How full a queue is, and has been
+ */
+struct demo::QueueStats
+{
+	size_t capacity; ///< Most items the queue holds
+	size_t size; ///< Items in the queue now
+	size_t high_water; ///< Most items the queue has held at once
+	uint64_t pushed; ///< Items pushed so far
+	uint64_t popped; ///< Items popped so far
+	uint64_t full; ///< Pushes that found too little room
+	uint64_t empty; ///< Pops that found nothing
+};
+
+/**
+ * \brief A bounded, lock-free queue from one producer thread to one consumer thread
+ *
+ * A ring buffer whose head (written by the consumer) and tail (written by the producer) are kept
+ * on separate cache lines. Each side keeps a copy of the other's index, and reads the real one
+ * only when its copy says the queue is full or empty, so in the steady state the two threads
+ * don't share cache lines at all. Batched push and pop publish many items with one store.
+ *
+ * Popped slots are left holding moved-from items until they are reused.
+ */
+template <typename T>
+class demo::SPSCQueue
+{
+public:
+	/**
+	 * \brief SPSCQueue Constructor
+	 * \param capacity Most items the queue holds, rounded up to a power of two
+	 */
+	explicit SPSCQueue(size_t capacity);
+
+	SPSCQueue(SPSCQueue const&) = delete;
+	SPSCQueue& operator=(SPSCQueue const&) = delete;
+
+	/**
+	 * \brief Push an item if there's room. Producer only.
+	 * \param item Item to move into the queue
+	 * \return false, leaving item alone, if the queue is full
+	 */
+	bool try_push(T&& item) { return try_push(&item, 1) == 1; }
+
+	/**
+	 * \brief Push as many of n items as there's room for. Producer only.
+	 * \param items Items to move into the queue
+	 * \param n Number of items
+	 * \return Number of items pushed, which are the first ones
+	 */
+	size_t try_push(T* items, size_t n);
+
+	/**
+	 * \brief Pop an item if there is one. Consumer only.
+	 * \param item Set to the item
+	 * \return false if the queue is empty
+	 */
+	bool try_pop(T& item) { return try_pop(&item, 1) == 1; }
+
+	/**
+	 * \brief Pop up to n items. Consumer only.
+	 * \param items Where to move the items
+	 * \param n Most items to pop
+	 * \return Number of items popped
+	 */
+	size_t try_pop(T* items, size_t n);
+
+	/**
+	 * \brief Push an item, waiting with Backoff for room. Producer only.
+	 * \param item Item to move into the queue
+	 */
+	void push(T&& item)
+	{
+		Backoff backoff;
+		while (!try_push(std::move(item))) backoff.pause();
+	}
+
+	/**
+	 * \brief Pop an item, waiting with Backoff for one. Consumer only.
+	 * \param item Set to the item
+	 * \param timeout Longest time to wait
+	 * \return false if the wait timed out
+	 */
+	bool pop(T& item, std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
+
+	size_t capacity() const { return mask_ + 1; } ///< Most items the queue holds
+
+	/**
+	 * \brief Get the number of items in the queue, which may already have changed
+	 * \return The number of items in the queue
+	 */
+	size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+	/**
+	 * \brief Get statistics of the queue's use. Safe to call from any thread.
+	 * \return The statistics so far
+	 */
+	QueueStats stats() const;
+
+private:
+	// Only the owning thread writes these, so they need no read-modify-write
+	static void bump_(std::atomic<uint64_t>& counter) { counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+	size_t const mask_;
+	std::unique_ptr<T[]> slots_;
+
+	char pad0_[cache_line_bytes];
+
+	// Producer's cache line
+	std::atomic<size_t> tail_;
+	size_t cached_head_;
+	std::atomic<uint64_t> full_;
+	std::atomic<size_t> high_water_;
+
+	char pad1_[cache_line_bytes];
+
+	// Consumer's cache line
+	std::atomic<size_t> head_;
+	size_t cached_tail_;
+	std::atomic<uint64_t> empty_;
+
+	char pad2_[cache_line_bytes];
+};
+
+/**
+ * \brief A bounded, lock-free queue from any number of producer threads to one consumer thread
+ *
+ * This is Dmitry Vyukov's bounded queue: each slot has a sequence number saying whether it is
+ * free for the producer claiming that position, or filled for the consumer. Producers claim
+ * positions with a compare-and-swap on the tail, which is on its own cache line, apart from the
+ * consumer's head. With one consumer, popping needs no atomic read-modify-write.
+ */
+template <typename T>
+class demo::MPSCQueue
+{
+public:
+	/**
+	 * \brief MPSCQueue Constructor
+	 * \param capacity Most items the queue holds, rounded up to a power of two
+	 */
+	explicit MPSCQueue(size_t capacity);
+
+	MPSCQueue(MPSCQueue const&) = delete;
+	MPSCQueue& operator=(MPSCQueue const&) = delete;
+
+	/**
+	 * \brief Push an item if there's room. Any thread.
+	 * \param item Item to move into the queue
+	 * \return false, leaving item alone, if the queue is full
+	 */
+	bool try_push(T&& item) { return try_push(&item, 1) == 1; }
+
+	/**
+	 * \brief Push as many of n items as there's room for, in consecutive positions. Any thread.
+	 * \param items Items to move into the queue
+	 * \param n Number of items
+	 * \return Number of items pushed, which are the first ones
+	 */
+	size_t try_push(T* items, size_t n);
+
+	/**
+	 * \brief Pop an item if there is one. Consumer only.
+	 * \param item Set to the item
+	 * \return false if the queue is empty
+	 */
+	bool try_pop(T& item) { return try_pop(&item, 1) == 1; }
+
+	/**
+	 * \brief Pop up to n items. Consumer only.
+	 * \param items Where to move the items
+	 * \param n Most items to pop
+	 * \return Number of items popped
+	 */
+	size_t try_pop(T* items, size_t n);
+
+	/**
+	 * \brief Push an item, waiting with Backoff for room. Any thread.
+	 * \param item Item to move into the queue
+	 */
+	void push(T&& item)
+	{
+		Backoff backoff;
+		while (!try_push(std::move(item))) backoff.pause();
+	}
+
+	/**
+	 * \brief Pop an item, waiting with Backoff for one. Consumer only.
+	 * \param item Set to the item
+	 * \param timeout Longest time to wait
+	 * \return false if the wait timed out
+	 */
+	bool pop(T& item, std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
+
+	size_t capacity() const { return mask_ + 1; } ///< Most items the queue holds
+
+	/**
+	 * \brief Get the number of items claimed by producers and not yet popped, which may already have changed
+	 * \return The number of items in the queue
+	 */
+	size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+	/**
+	 * \brief Get statistics of the queue's use. Safe to call from any thread.
+	 * \return The statistics so far
+	 */
+	QueueStats stats() const;
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	size_t const mask_;
+	std::unique_ptr<Cell[]> cells_;
+
+	char pad0_[cache_line_bytes];
+
+	// Producers' cache line
+	std::atomic<size_t> tail_;
+	std::atomic<uint64_t> full_;
+	std::atomic<size_t> high_water_;
+
+	char pad1_[cache_line_bytes];
+
+	// Consumer's cache line
+	std::atomic<size_t> head_;
+	std::atomic<uint64_t> empty_;
+
+	char pad2_[cache_line_bytes];
+};
+
+namespace demo
+{
+	namespace detail
+	{
+		/**
+		 * \brief Round a queue capacity up to a power of two
+		 * \param n Capacity asked for
+		 * \return The capacity to use, at least 2
+		 */
+		inline size_t queue_capacity(size_t n)
+		{
+			size_t c = 2;
+			while (c < n) c <<= 1;
+			return c;
+		}
+
+		/**
+		 * \brief Wait with Backoff until try_pop succeeds or the timeout passes
+		 */
+		template <typename Queue, typename T>
+		bool pop_with_backoff(Queue& q, T& item, std::chrono::nanoseconds timeout)
+		{
+			if (q.try_pop(item)) return true;
+
+			auto const start = std::chrono::steady_clock::now();
+			Backoff backoff;
+			for (;;)
+			{
+				backoff.pause();
+				if (q.try_pop(item)) return true;
+				if (timeout != std::chrono::nanoseconds::max() && std::chrono::steady_clock::now() - start >= timeout) return false;
+			}
+		}
+
+		/**
+		 * \brief Raise a high-water mark shared by several threads
+		 */
+		inline void raise_high_water(std::atomic<size_t>& mark, size_t level)
+		{
+			size_t old = mark.load(std::memory_order_relaxed);
+			while (level > old && !mark.compare_exchange_weak(old, level, std::memory_order_relaxed))
+			{
+			}
+		}
+	}
+}
+
+template <typename T>
+demo::SPSCQueue<T>::SPSCQueue(size_t capacity)
+	: mask_(detail::queue_capacity(capacity) - 1)
+	, slots_(new T[mask_ + 1])
+	, pad0_()
+	, tail_(0)
+	, cached_head_(0)
+	, full_(0)
+	, high_water_(0)
+	, pad1_()
+	, head_(0)
+	, cached_tail_(0)
+	, empty_(0)
+	, pad2_()
+{
+}
+
+template <typename T>
+size_t demo::SPSCQueue<T>::try_push(T* items, size_t n)
+{
+	size_t const tail = tail_.load(std::memory_order_relaxed);
+	if (capacity() - (tail - cached_head_) < n)
+	{
+		cached_head_ = head_.load(std::memory_order_acquire);
+	}
+	size_t const k = std::min(n, capacity() - (tail - cached_head_));
+	if (k < n) bump_(full_);
+
+	for (size_t i = 0; i < k; ++i)
+	{
+		slots_[(tail + i) & mask_] = std::move(items[i]);
+	}
+	tail_.store(tail + k, std::memory_order_release);
+
+	size_t const level = tail + k - cached_head_;
+	if (level > high_water_.load(std::memory_order_relaxed)) high_water_.store(level, std::memory_order_relaxed);
+	return k;
+}
+
+template <typename T>
+size_t demo::SPSCQueue<T>::try_pop(T* items, size_t n)
+{
+	size_t const head = head_.load(std::memory_order_relaxed);
+	if (cached_tail_ - head < n)
+	{
+		cached_tail_ = tail_.load(std::memory_order_acquire);
+	}
+	size_t const k = std::min(n, cached_tail_ - head);
+	if (k == 0)
+	{
+		bump_(empty_);
+		return 0;
+	}
+
+	for (size_t i = 0; i < k; ++i)
+	{
+		items[i] = std::move(slots_[(head + i) & mask_]);
+	}
+	head_.store(head + k, std::memory_order_release);
+	return k;
+}
+
+template <typename T>
+bool demo::SPSCQueue<T>::pop(T& item, std::chrono::nanoseconds timeout)
+{
+	return detail::pop_with_backoff(*this, item, timeout);
+}
+
+template <typename T>
+demo::QueueStats demo::SPSCQueue<T>::stats() const
+{
+	size_t const popped = head_.load(std::memory_order_acquire);
+	size_t const pushed = tail_.load(std::memory_order_acquire);
+	return QueueStats{capacity(), pushed - popped, high_water_.load(std::memory_order_relaxed),
+					  pushed, popped, full_.load(std::memory_order_relaxed), empty_.load(std::memory_order_relaxed)};
+}
+
+template <typename T>
+demo::MPSCQueue<T>::MPSCQueue(size_t capacity)
+	: mask_(detail::queue_capacity(capacity) - 1)
+	, cells_(new Cell[mask_ + 1])
+	, pad0_()
+	, tail_(0)
+	, full_(0)
+	, high_water_(0)
+	, pad1_()
+	, head_(0)
+	, empty_(0)
+	, pad2_()
+{
+	for (size_t i = 0; i <= mask_; ++i)
+	{
+		cells_[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+template <typename T>
+size_t demo::MPSCQueue<T>::try_push(T* items, size_t n)
+{
+	size_t pos = tail_.load(std::memory_order_relaxed);
+	size_t k;
+	for (;;)
+	{
+		// Count the free cells from pos on. The consumer frees them in order,
+		// so they are consecutive.
+		k = 0;
+		bool stale = false;
+		while (k < n)
+		{
+			size_t const seq = cells_[(pos + k) & mask_].sequence.load(std::memory_order_acquire);
+			intptr_t const diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + k);
+			if (diff == 0)
+			{
+				++k;
+				continue;
+			}
+			stale = diff > 0; // another producer has claimed it
+			break;
+		}
+
+		if (k == 0)
+		{
+			if (!stale)
+			{
+				full_.fetch_add(1, std::memory_order_relaxed);
+				return 0;
+			}
+			pos = tail_.load(std::memory_order_relaxed);
+			continue;
+		}
+		if (tail_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) break;
+	}
+	if (k < n) full_.fetch_add(1, std::memory_order_relaxed);
+
+	// Read the head before publishing: the consumer can't pass pos until then, so pos + k - head
+	// doesn't wrap. The read may be stale, overstating the level, but never beyond capacity.
+	size_t const head = head_.load(std::memory_order_relaxed);
+
+	for (size_t i = 0; i < k; ++i)
+	{
+		Cell& cell = cells_[(pos + i) & mask_];
+		cell.item = std::move(items[i]);
+		cell.sequence.store(pos + i + 1, std::memory_order_release);
+	}
+
+	detail::raise_high_water(high_water_, std::min(pos + k - head, capacity()));
+	return k;
+}
+
+template <typename T>
+size_t demo::MPSCQueue<T>::try_pop(T* items, size_t n)
+{
+	size_t const head = head_.load(std::memory_order_relaxed);
+	size_t k = 0;
+	for (; k < n; ++k)
+	{
+		Cell& cell = cells_[(head + k) & mask_];
+		if (cell.sequence.load(std::memory_order_acquire) != head + k + 1) break;
+		items[k] = std::move(cell.item);
+		cell.sequence.store(head + k + capacity(), std::memory_order_release);
+	}
+
+	if (k == 0)
+	{
+		empty_.store(empty_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return 0;
+	}
+	head_.store(head + k, std::memory_order_release);
+	return k;
+}
+
+template <typename T>
+bool demo::MPSCQueue<T>::pop(T& item, std::chrono::nanoseconds timeout)
+{
+	return detail::pop_with_backoff(*this, item, timeout);
+}
+
+template <typename T>
+demo::QueueStats demo::MPSCQueue<T>::stats() const
+{
+	size_t const popped = head_.load(std::memory_order_acquire);
+	size_t const pushed = tail_.load(std::memory_order_acquire);
+	return QueueStats{capacity(), pushed - popped, high_water_.load(std::memory_order_relaxed),
+					  pushed, popped, full_.load(std::memory_order_relaxed), empty_.load(std::memory_order_relaxed)};
+}
+
+#endif /* artdaq_core_demo_Overlays_FragmentQueue_hh */
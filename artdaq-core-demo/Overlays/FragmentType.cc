@@ -1,30 +1,46 @@
 #include "artdaq-core-demo/Overlays/FragmentType.hh"
 
-#include <algorithm>
-#include <cassert>
+#include <cstring>
 #include <string>
 #include <vector>
 
+static_assert(demo::detail::lookupFragmentType("crt", 3) == demo::FragmentType::CRT,
+              "FragmentType lookup should ignore case");
+static_assert(demo::detail::lookupFragmentType("TOY2", 4) == demo::FragmentType::TOY2,
+              "FragmentType lookup should match the whole name");
+static_assert(demo::detail::lookupFragmentType("TOY", 3) == demo::FragmentType::INVALID,
+              "FragmentType lookup should not match a prefix");
+
 demo::FragmentType
-demo::toFragmentType(std::string t_string)
+demo::toFragmentType(std::string const& t_string)
 {
-	std::transform(t_string.begin(),
-	               t_string.end(),
-	               t_string.begin(),
-	               toupper);
-	auto it = std::find(names.begin(), names.end(), t_string);
-	return (it == names.end()) ?
-		       FragmentType::INVALID :
-		       static_cast<FragmentType>(artdaq::Fragment::FirstUserFragmentType +
-		                                 (it - names.begin()));
+	return detail::lookupFragmentType(t_string.data(), t_string.size());
+}
+
+demo::FragmentType
+demo::toFragmentType(char const* name, size_t len)
+{
+	return detail::lookupFragmentType(name, len);
+}
+
+demo::FragmentType
+demo::toFragmentType(char const* name)
+{
+	return detail::lookupFragmentType(name, strlen(name));
 }
 
 std::string
 demo::fragmentTypeToString(FragmentType val)
+{
+	return fragmentTypeName(val);
+}
+
+char const*
+demo::fragmentTypeName(FragmentType val)
 {
 	if (val < FragmentType::INVALID)
 	{
-		return names[val - FragmentType::MISSED];
+		return detail::fragmentTypeNames[val - FragmentType::MISSED];
 	}
 	else
 	{
@@ -35,9 +51,9 @@ demo::fragmentTypeToString(FragmentType val)
 std::map<artdaq::Fragment::type_t, std::string> demo::makeFragmentTypeMap()
 {
 	auto output = artdaq::Fragment::MakeSystemTypeMap();
-	for (auto name : names)
+	for (auto name : detail::fragmentTypeNames)
 	{
 		output[toFragmentType(name)] = name;
 	}
 	return output;
-}
\ No newline at end of file
+}
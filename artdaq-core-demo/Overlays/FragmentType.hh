@@ -2,13 +2,10 @@
 #define artdaq_demo_Overlays_FragmentType_hh
 #include "artdaq-core/Data/Fragment.hh"
 
+#include <iterator>
+
 namespace demo
 {
-	/**
-	 * \brief List of names (in the order defined below) of the User types defined in artdaq_core_demo
-	 */
-	std::vector<std::string> const names{"MISSED", "TOY1", "TOY2", "ASCII", "UDP", "UNKNOWN"};
-
 	/**
 	 * \brief Implementation details namespace
 	 */
@@ -24,14 +21,87 @@ namespace demo
 			TOY2,
 			ASCII,
 			UDP,
+			CRT,
+			UDPCONTAINER,
+			CRTPACKED,
 			INVALID // Should always be last.
 		};
 
 		// Safety check.
 		static_assert(artdaq::Fragment::isUserFragmentType(FragmentType::INVALID - 1),
 			"Too many user-defined fragments!");
+
+		/**
+		 * \brief Names of the FragmentTypes, indexed by type - MISSED. INVALID is "UNKNOWN".
+		 *
+		 * Unlike demo::names, which is built from it, this needs no construction and no allocation.
+		 */
+		constexpr char const* const fragmentTypeNames[] = {"MISSED", "TOY1", "TOY2", "ASCII", "UDP", "CRT", "UDPCONTAINER", "CRTPACKED", "UNKNOWN"};
+
+		static_assert(sizeof(fragmentTypeNames) / sizeof(fragmentTypeNames[0]) == FragmentType::INVALID - FragmentType::MISSED + 1,
+			"fragmentTypeNames must have one entry per FragmentType");
+
+		/**
+		 * \brief Upper-case an ASCII letter, leaving anything else alone
+		 * \param c Character to convert
+		 * \return The upper-case character
+		 */
+		constexpr char toUpper(char c)
+		{
+			return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+		}
+
+		/**
+		 * \brief Compare a string to an upper-case name, ignoring the case of the string
+		 * \param name NUL-terminated upper-case name
+		 * \param s String to compare, not necessarily NUL-terminated
+		 * \param len Length of s
+		 * \return Whether s matches name
+		 *
+		 * Written as a single return, recursively, so that it is C++11 constexpr.
+		 */
+		constexpr bool matchesName(char const* name, char const* s, size_t len)
+		{
+			return len == 0 ? name[0] == '\0'
+			                : name[0] != '\0' && name[0] == toUpper(s[0]) && matchesName(name + 1, s + 1, len - 1);
+		}
+
+		/**
+		 * \brief Look up a FragmentType by name among fragmentTypeNames[i] and those after it
+		 * \param s Name to look up, not necessarily NUL-terminated
+		 * \param len Length of the name, which is not zero
+		 * \param first First character of the name, upper-cased
+		 * \param i Index in fragmentTypeNames to start at
+		 * \return The FragmentType with that name, or INVALID if there is none
+		 */
+		constexpr FragmentType lookupFragmentTypeFrom(char const* s, size_t len, char first, size_t i)
+		{
+			return i == sizeof(fragmentTypeNames) / sizeof(fragmentTypeNames[0])
+			           ? FragmentType::INVALID
+			           : (fragmentTypeNames[i][0] == first && matchesName(fragmentTypeNames[i], s, len))
+			                 ? static_cast<FragmentType>(FragmentType::MISSED + i)
+			                 : lookupFragmentTypeFrom(s, len, first, i + 1);
+		}
+
+		/**
+		 * \brief Look up a FragmentType by name, case-insensitively, without allocating
+		 * \param s Name to look up, not necessarily NUL-terminated
+		 * \param len Length of the name
+		 * \return The FragmentType with that name, or INVALID if there is none
+		 *
+		 * The names are few and short, so compare only those whose first character matches.
+		 */
+		constexpr FragmentType lookupFragmentType(char const* s, size_t len)
+		{
+			return len == 0 ? FragmentType::INVALID : lookupFragmentTypeFrom(s, len, toUpper(s[0]), 0);
+		}
 	}
 
+	/**
+	 * \brief List of names (in the order of detail::FragmentType) of the User types defined in artdaq_core_demo
+	 */
+	std::vector<std::string> const names(std::begin(detail::fragmentTypeNames), std::end(detail::fragmentTypeNames));
+
 	using detail::FragmentType;
 
 	/**
@@ -39,15 +109,37 @@ namespace demo
 	 * \param t_string Name of the Fragment type to lookup
 	 * \return artdaq::Fragment::type_t corresponding to string, or INVALID if not found
 	 */
-	FragmentType toFragmentType(std::string t_string);
+	FragmentType toFragmentType(std::string const& t_string);
+
+	/**
+	 * \brief Lookup the type code for a fragment by its name, case-insensitively and without allocating
+	 * \param name Name of the Fragment type to lookup, not necessarily NUL-terminated
+	 * \param len Length of the name
+	 * \return artdaq::Fragment::type_t corresponding to the name, or INVALID if not found
+	 */
+	FragmentType toFragmentType(char const* name, size_t len);
+
+	/**
+	 * \brief Lookup the type code for a fragment by its NUL-terminated name, without allocating
+	 * \param name Name of the Fragment type to lookup
+	 * \return artdaq::Fragment::type_t corresponding to the name, or INVALID if not found
+	 */
+	FragmentType toFragmentType(char const* name);
 
 	/**
 	 * \brief Look up the name of the given FragmentType
 	 * \param val FragmentType to look up
-	 * \return Name of the given type (from the names vector)
+	 * \return Name of the given type (from detail::fragmentTypeNames)
 	 */
 	std::string fragmentTypeToString(FragmentType val);
 
+	/**
+	 * \brief Look up the name of the given FragmentType without allocating
+	 * \param val FragmentType to look up
+	 * \return Name of the given type, in static storage
+	 */
+	char const* fragmentTypeName(FragmentType val);
+
 	/**
 	 * \brief Create a list of all Fragment types defined by this package, in the format that RawInput expects
 	 * \return A list of all Fragment types defined by this package, in the format that RawInput expects
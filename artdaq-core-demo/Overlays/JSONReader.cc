@@ -0,0 +1,421 @@
+#include "artdaq-core-demo/Overlays/JSONReader.hh"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+constexpr size_t demo::JSONReader::max_depth;
+
+namespace
+{
+	bool is_space(char c)
+	{
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	bool is_number_char(char c)
+	{
+		return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+	}
+
+	int hex_digit(char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+
+	bool read_hex4(char const* p, char const* end, uint32_t& out)
+	{
+		if (end - p < 4) return false;
+		out = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			int const d = hex_digit(p[i]);
+			if (d < 0) return false;
+			out = (out << 4) | d;
+		}
+		return true;
+	}
+
+	// Decode one character of a JSON string starting at p, writing its UTF-8 bytes to buf
+	// (at most 4) and advancing p. An escape's output is never longer than the escape.
+	size_t decode_one(char const*& p, char const* end, char* buf)
+	{
+		if (*p != '\\' || end - p < 2)
+		{
+			buf[0] = *p++;
+			return 1;
+		}
+		char const c = p[1];
+		p += 2;
+		switch (c)
+		{
+			case 'b': buf[0] = '\b'; return 1;
+			case 'f': buf[0] = '\f'; return 1;
+			case 'n': buf[0] = '\n'; return 1;
+			case 'r': buf[0] = '\r'; return 1;
+			case 't': buf[0] = '\t'; return 1;
+			case 'u': break;
+			default: buf[0] = c; return 1;
+		}
+
+		uint32_t cp;
+		if (!read_hex4(p, end, cp))
+		{
+			buf[0] = 'u';
+			return 1;
+		}
+		p += 4;
+		uint32_t low;
+		if (cp >= 0xd800 && cp < 0xdc00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u' &&
+			read_hex4(p + 2, end, low) && low >= 0xdc00 && low < 0xe000)
+		{
+			cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+			p += 6;
+		}
+
+		if (cp < 0x80)
+		{
+			buf[0] = char(cp);
+			return 1;
+		}
+		if (cp < 0x800)
+		{
+			buf[0] = char(0xc0 | (cp >> 6));
+			buf[1] = char(0x80 | (cp & 0x3f));
+			return 2;
+		}
+		if (cp < 0x10000)
+		{
+			buf[0] = char(0xe0 | (cp >> 12));
+			buf[1] = char(0x80 | ((cp >> 6) & 0x3f));
+			buf[2] = char(0x80 | (cp & 0x3f));
+			return 3;
+		}
+		buf[0] = char(0xf0 | (cp >> 18));
+		buf[1] = char(0x80 | ((cp >> 12) & 0x3f));
+		buf[2] = char(0x80 | ((cp >> 6) & 0x3f));
+		buf[3] = char(0x80 | (cp & 0x3f));
+		return 4;
+	}
+}
+
+bool demo::JSONValue::asInt64(int64_t& out) const
+{
+	if (type != Type::Number || begin == end) return false;
+
+	char const* p = begin;
+	bool const negative = *p == '-';
+	if (negative) ++p;
+	if (p == end) return false;
+
+	// Accumulate as a negative number so that INT64_MIN fits
+	int64_t value = 0;
+	for (; p != end; ++p)
+	{
+		if (*p < '0' || *p > '9') return false;
+		int const d = *p - '0';
+		if (value < (INT64_MIN + d) / 10) return false;
+		value = value * 10 - d;
+	}
+	if (!negative && value == INT64_MIN) return false;
+	out = negative ? value : -value;
+	return true;
+}
+
+bool demo::JSONValue::asDouble(double& out) const
+{
+	// strtod needs a terminated string, and the text usually isn't one
+	char buf[64];
+	size_t const n = end - begin;
+	if (type != Type::Number || n == 0 || n >= sizeof(buf)) return false;
+	memcpy(buf, begin, n);
+	buf[n] = '\0';
+
+	char* stop;
+	errno = 0;
+	double const value = strtod(buf, &stop);
+	if (stop != buf + n || errno == ERANGE) return false;
+	out = value;
+	return true;
+}
+
+bool demo::JSONValue::equals(char const* s) const
+{
+	if (type != Type::String) return false;
+
+	char buf[4];
+	char const* p = begin;
+	while (p != end)
+	{
+		size_t const n = decode_one(p, end, buf);
+		for (size_t i = 0; i < n; ++i, ++s)
+			if (*s != buf[i]) return false;
+	}
+	return *s == '\0';
+}
+
+size_t demo::JSONValue::unescape(char* out) const
+{
+	char* o = out;
+	char const* p = begin;
+	while (p != end)
+		o += decode_one(p, end, o);
+	return o - out;
+}
+
+demo::JSONReader::JSONReader(char const* begin, char const* end)
+	: p_(begin)
+	, end_(end)
+	, error_(nullptr)
+	, container_begin_(nullptr)
+	, expect_(Expect::Value)
+	, depth_(0)
+	, last_(Event::End)
+	, value_{JSONValue::Type::Null, begin, begin}
+{
+	stack_[0] = '\0';
+}
+
+demo::JSONReader::Event demo::JSONReader::error_at_(char const* p)
+{
+	error_ = p;
+	expect_ = Expect::Done;
+	return last_ = Event::Error;
+}
+
+void demo::JSONReader::value_done_()
+{
+	expect_ = depth_ == 0 ? Expect::Done : Expect::CommaOrEnd;
+}
+
+demo::JSONReader::Event demo::JSONReader::end_container_(char close)
+{
+	if (depth_ == 0 || stack_[depth_ - 1] != (close == '}' ? '{' : '[')) return error_at_(p_);
+	++p_;
+	--depth_;
+	value_done_();
+	return last_ = close == '}' ? Event::EndObject : Event::EndArray;
+}
+
+bool demo::JSONReader::scan_string_(JSONValue& v)
+{
+	// p_ is just past the opening quote. Look for the closing quote, skipping escapes,
+	// and reject raw control characters.
+	char const* p = p_;
+	v.type = JSONValue::Type::String;
+	v.begin = p;
+
+#if defined(__SSE2__)
+	__m128i const quote = _mm_set1_epi8('"');
+	__m128i const backslash = _mm_set1_epi8('\\');
+	__m128i const control = _mm_set1_epi8(0x1f);
+	while (end_ - p >= 16)
+	{
+		__m128i const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+		__m128i const special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+			_mm_cmpeq_epi8(_mm_max_epu8(x, control), control));
+		int const mask = _mm_movemask_epi8(special);
+		if (mask == 0)
+		{
+			p += 16;
+			continue;
+		}
+		p += __builtin_ctz(mask);
+		if (*p == '"')
+		{
+			v.end = p;
+			p_ = p + 1;
+			return true;
+		}
+		if (*p != '\\')
+		{
+			error_at_(p);
+			return false;
+		}
+		p += 2;
+	}
+#endif
+
+	while (p < end_)
+	{
+		char const c = *p;
+		if (c == '"')
+		{
+			v.end = p;
+			p_ = p + 1;
+			return true;
+		}
+		if (c == '\\')
+			p += 2;
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			error_at_(p);
+			return false;
+		}
+		else
+			++p;
+	}
+	error_at_(end_);
+	return false;
+}
+
+demo::JSONReader::Event demo::JSONReader::scalar_()
+{
+	char const c = *p_;
+	if (c == '"')
+	{
+		++p_;
+		if (!scan_string_(value_)) return last_;
+		value_done_();
+		return last_ = Event::Value;
+	}
+
+	if (c == '-' || (c >= '0' && c <= '9'))
+	{
+		char const* p = p_ + 1;
+		while (p != end_ && is_number_char(*p)) ++p;
+		value_ = JSONValue{JSONValue::Type::Number, p_, p};
+		p_ = p;
+		value_done_();
+		return last_ = Event::Value;
+	}
+
+	struct Literal
+	{
+		char const* text;
+		size_t size;
+		JSONValue::Type type;
+	};
+	static Literal const literals[] = {
+		{"true", 4, JSONValue::Type::True},
+		{"false", 5, JSONValue::Type::False},
+		{"null", 4, JSONValue::Type::Null}};
+	for (auto const& lit : literals)
+	{
+		if (c == lit.text[0] && size_t(end_ - p_) >= lit.size && memcmp(p_, lit.text, lit.size) == 0)
+		{
+			value_ = JSONValue{lit.type, p_, p_ + lit.size};
+			p_ += lit.size;
+			value_done_();
+			return last_ = Event::Value;
+		}
+	}
+	return error_at_(p_);
+}
+
+demo::JSONReader::Event demo::JSONReader::next()
+{
+	if (error_) return Event::Error;
+
+	while (p_ != end_ && is_space(*p_)) ++p_;
+
+	if (expect_ == Expect::Done)
+	{
+		if (p_ != end_) return error_at_(p_);
+		return last_ = Event::End;
+	}
+	if (p_ == end_) return error_at_(p_);
+
+	char const c = *p_;
+	if (expect_ == Expect::CommaOrEnd)
+	{
+		if (c == '}' || c == ']') return end_container_(c);
+		if (c != ',') return error_at_(p_);
+		++p_;
+		while (p_ != end_ && is_space(*p_)) ++p_;
+		if (p_ == end_) return error_at_(p_);
+		expect_ = stack_[depth_ - 1] == '{' ? Expect::Key : Expect::Value;
+	}
+	else if (expect_ == Expect::KeyOrEnd && c == '}')
+		return end_container_(c);
+	else if (expect_ == Expect::ValueOrEnd && c == ']')
+		return end_container_(c);
+
+	if (expect_ == Expect::Key || expect_ == Expect::KeyOrEnd)
+	{
+		if (*p_ != '"') return error_at_(p_);
+		++p_;
+		if (!scan_string_(value_)) return last_;
+		while (p_ != end_ && is_space(*p_)) ++p_;
+		if (p_ == end_ || *p_ != ':') return error_at_(p_);
+		++p_;
+		expect_ = Expect::Value;
+		return last_ = Event::Key;
+	}
+
+	// A value
+	if (*p_ == '{' || *p_ == '[')
+	{
+		if (depth_ == max_depth) return error_at_(p_);
+		bool const object = *p_ == '{';
+		stack_[depth_++] = *p_;
+		container_begin_ = p_++;
+		expect_ = object ? Expect::KeyOrEnd : Expect::ValueOrEnd;
+		return last_ = object ? Event::StartObject : Event::StartArray;
+	}
+	return scalar_();
+}
+
+bool demo::JSONReader::skip()
+{
+	if (last_ == Event::Key) next();
+
+	if (last_ == Event::Value) return true;
+	if (last_ != Event::StartObject && last_ != Event::StartArray) return false;
+
+	JSONValue const whole{last_ == Event::StartObject ? JSONValue::Type::Object : JSONValue::Type::Array,
+						  container_begin_, nullptr};
+	size_t const outer = depth_ - 1;
+	for (;;)
+	{
+		Event const ev = next();
+		if (ev == Event::Error || ev == Event::End) return false;
+		if ((ev == Event::EndObject || ev == Event::EndArray) && depth_ == outer) break;
+	}
+	value_ = whole;
+	value_.end = p_;
+	return true;
+}
+
+bool demo::findJSONValue(char const* begin, char const* end, char const* path, JSONValue& value)
+{
+	JSONReader reader(begin, end);
+	JSONReader::Event ev = reader.next();
+	char const* key = path;
+
+	for (;;)
+	{
+		if (*key == '\0')
+		{
+			if (ev == JSONReader::Event::Value ||
+				((ev == JSONReader::Event::StartObject || ev == JSONReader::Event::StartArray) && reader.skip()))
+			{
+				value = reader.value();
+				return true;
+			}
+			return false;
+		}
+		if (ev != JSONReader::Event::StartObject) return false;
+
+		size_t const key_size = strcspn(key, ".");
+		for (;;)
+		{
+			ev = reader.next();
+			if (ev != JSONReader::Event::Key) return false;
+			JSONValue const& k = reader.value();
+			if (size_t(k.end - k.begin) == key_size && memcmp(k.begin, key, key_size) == 0) break;
+			if (!reader.skip()) return false;
+		}
+		key += key_size;
+		if (*key == '.') ++key;
+		ev = reader.next();
+	}
+}
@@ -0,0 +1,173 @@
+#ifndef artdaq_core_demo_Overlays_JSONReader_hh
+#define artdaq_core_demo_Overlays_JSONReader_hh
+
+#include <cstddef>
+#include <cstdint>
+
+namespace demo
+{
+	class JSONReader;
+	struct JSONValue;
+
+	/**
+	 * \brief Find a value in a JSON document by its path of object keys, without allocating
+	 * \param begin Start of the JSON text
+	 * \param end End of the JSON text
+	 * \param path Keys separated by '.', e.g. "status.voltage". Keys containing '.' or escapes cannot be matched.
+	 * \param value Set to the value found
+	 * \return true if the value was found, false if it wasn't or the JSON is malformed before it
+	 */
+	bool findJSONValue(char const* begin, char const* end, char const* path, JSONValue& value);
+}
+
+/**
+ * \brief A value found in JSON text, pointing into that text
+ */
+struct demo::JSONValue
+{
+	/**
+	 * \brief The kind of JSON value
+	 */
+	enum class Type : uint8_t
+	{
+		Object,
+		Array,
+		String,
+		Number,
+		True,
+		False,
+		Null
+	};
+
+	Type type; ///< The kind of value
+	char const* begin; ///< Start of the value's text. For strings, just inside the quotes, with escapes left in.
+	char const* end; ///< End of the value's text. For strings, the closing quote.
+
+	/**
+	 * \brief Convert a Number to an integer
+	 * \param out Set to the value if it is an integer that fits
+	 * \return Whether the conversion succeeded
+	 */
+	bool asInt64(int64_t& out) const;
+
+	/**
+	 * \brief Convert a Number to a double
+	 * \param out Set to the value
+	 * \return Whether the conversion succeeded
+	 */
+	bool asDouble(double& out) const;
+
+	/**
+	 * \brief Compare a String, with its escapes decoded, to a NUL-terminated string
+	 * \param s String to compare to
+	 * \return Whether this is a String equal to s
+	 */
+	bool equals(char const* s) const;
+
+	/**
+	 * \brief Decode a String's escapes into a caller's buffer
+	 * \param out Buffer, which needs no more than end - begin bytes
+	 * \return Number of bytes written, which are not NUL-terminated
+	 */
+	size_t unescape(char* out) const;
+};
+
+/**
+ * \brief A streaming (pull) JSON parser that works in place on the JSON text
+ *
+ * Each call to next() returns the next event in the document: the start or end of an
+ * object or array, an object key, or a scalar value. Keys and scalars are reported as
+ * pointers into the text, so nothing is copied or allocated. The scan for the end of
+ * each string, which is where most of the bytes in typical documents are, uses SSE2.
+ *
+ * Nesting is limited to max_depth levels.
+ */
+class demo::JSONReader
+{
+public:
+	/**
+	 * \brief What next() found
+	 */
+	enum class Event : uint8_t
+	{
+		StartObject,
+		EndObject,
+		StartArray,
+		EndArray,
+		Key, ///< An object key; value() is a String JSONValue spanning the key without its quotes
+		Value, ///< A scalar value; value() describes it
+		End, ///< The end of the document
+		Error ///< Malformed JSON; errorPosition() says where
+	};
+
+	static constexpr size_t max_depth = 64; ///< Deepest nesting of objects and arrays supported
+
+	/**
+	 * \brief JSONReader Constructor
+	 * \param begin Start of the JSON text
+	 * \param end End of the JSON text
+	 */
+	JSONReader(char const* begin, char const* end);
+
+	/**
+	 * \brief Parse up to the next event
+	 * \return The event. After End or Error, returns the same again.
+	 */
+	Event next();
+
+	/**
+	 * \brief Get the key or scalar value from the last Key or Value event
+	 * \return A JSONValue pointing into the text
+	 */
+	JSONValue const& value() const { return value_; }
+
+	/**
+	 * \brief Skip the rest of the object or array just started, or do nothing after a scalar
+	 * \return false if the JSON is malformed
+	 *
+	 * After StartObject or StartArray, skips to just past the matching end, setting value() to
+	 * the whole object or array.
+	 */
+	bool skip();
+
+	/**
+	 * \brief Get the current nesting depth
+	 * \return Number of objects and arrays enclosing the current position
+	 */
+	size_t depth() const { return depth_; }
+
+	/**
+	 * \brief Get where the JSON was found to be malformed
+	 * \return Pointer to the offending character, or nullptr if there is no error
+	 */
+	char const* errorPosition() const { return error_; }
+
+private:
+	enum class Expect : uint8_t
+	{
+		Value,
+		ValueOrEnd,
+		Key,
+		KeyOrEnd,
+		CommaOrEnd,
+		Done
+	};
+
+	Event error_at_(char const* p);
+	Event end_container_(char close);
+	void value_done_();
+	bool scan_string_(JSONValue& v);
+	Event scalar_();
+
+	char const* p_;
+	char const* end_;
+	char const* error_;
+	char const* container_begin_;
+	Expect expect_;
+	size_t depth_;
+	char stack_[max_depth];
+	Event last_;
+	JSONValue value_;
+};
+
+#endif /* artdaq_core_demo_Overlays_JSONReader_hh */
@@ -0,0 +1,99 @@
+#include "artdaq-core-demo/Overlays/OverlayDecoders.hh"
+
+#include "artdaq-core-demo/Overlays/AsciiFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTPackedFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+#include "artdaq-core-demo/Overlays/OverlayStats.hh"
+#include "artdaq-core-demo/Overlays/UDPContainerFragment.hh"
+#include "artdaq-core-demo/Overlays/UDPFragment.hh"
+
+namespace
+{
+	// The checks count each Fragment in the overlay statistics (see OverlayStats.hh)
+
+	bool checkAscii(artdaq::Fragment const& frag)
+	{
+		DEMO_OVERLAY_TIMER(demo::FragmentType::ASCII, Validate);
+		demo::AsciiFragment const f(frag);
+		bool const ok = frag.dataSizeBytes() >= sizeof(demo::AsciiFragment::Header) &&
+		                f.hdr_event_size() >= f.hdr_size_words() &&
+		                f.hdr_event_size() * sizeof(demo::AsciiFragment::Header::data_t) <= frag.dataSizeBytes() &&
+		                f.checksum_ok();
+		DEMO_OVERLAY_COUNT(demo::FragmentType::ASCII, frag.dataSizeBytes(), ok ? f.total_line_characters() : 0);
+		if (!ok) DEMO_OVERLAY_FAILED(demo::FragmentType::ASCII);
+		return ok;
+	}
+
+	// For UDP Fragments of all four types alike
+	bool checkUDP(artdaq::Fragment const& frag)
+	{
+		DEMO_OVERLAY_TIMER(static_cast<demo::FragmentType>(frag.type()), Validate);
+		demo::UDPFragment const f(frag);
+		bool const ok = frag.dataSizeBytes() >= sizeof(demo::UDPFragment::Header) &&
+		                f.hdr_event_size() >= f.hdr_size_words() &&
+		                f.hdr_event_size() * sizeof(demo::UDPFragment::Header::data_t) <= frag.dataSizeBytes() &&
+		                f.checksum_ok();
+		DEMO_OVERLAY_COUNT(static_cast<demo::FragmentType>(frag.type()), frag.dataSizeBytes(), ok ? f.udp_data_words() * sizeof(demo::UDPFragment::Header::data_t) : 0);
+		if (!ok) DEMO_OVERLAY_FAILED(static_cast<demo::FragmentType>(frag.type()));
+		return ok;
+	}
+
+	bool checkCRT(artdaq::Fragment const& frag)
+	{
+		return CRT::check_event(frag).ok();
+	}
+
+	bool checkUDPContainer(artdaq::Fragment const& frag)
+	{
+		DEMO_OVERLAY_TIMER(demo::FragmentType::UDPCONTAINER, Validate);
+		demo::UDPContainerFragment const f(frag);
+		bool const ok = f.consistent();
+		DEMO_OVERLAY_COUNT(demo::FragmentType::UDPCONTAINER, frag.dataSizeBytes(), ok ? f.n_datagrams() : 0);
+		if (!ok) DEMO_OVERLAY_FAILED(demo::FragmentType::UDPCONTAINER);
+		return ok;
+	}
+
+	bool checkCRTPacked(artdaq::Fragment const& frag)
+	{
+		DEMO_OVERLAY_TIMER(demo::FragmentType::CRTPACKED, Validate);
+		size_t const size = frag.dataSizeBytes();
+		bool const ok = CRT::check_packed(frag.dataBeginBytes(), size).ok();
+		DEMO_OVERLAY_COUNT(demo::FragmentType::CRTPACKED, size, ok ? CRT::PackedFragment(frag).num_hits() : 0);
+		if (!ok) DEMO_OVERLAY_FAILED(demo::FragmentType::CRTPACKED);
+		return ok;
+	}
+
+	template <typename Overlay>
+	void dump(std::ostream& os, artdaq::Fragment const& frag)
+	{
+		os << Overlay(frag);
+	}
+
+	// Indexed by type code - FirstUserFragmentType. Types without an overlay in this
+	// package have null functions.
+	demo::OverlayDecoder const decoders[] = {
+		{demo::FragmentType::MISSED, "MISSED", nullptr, nullptr},
+		{demo::FragmentType::TOY1, "TOY1", nullptr, nullptr},
+		{demo::FragmentType::TOY2, "TOY2", nullptr, nullptr},
+		{demo::FragmentType::ASCII, "ASCII", checkAscii, dump<demo::AsciiFragment>},
+		{demo::FragmentType::UDP, "UDP", checkUDP, dump<demo::UDPFragment>},
+		{demo::FragmentType::CRT, "CRT", checkCRT, dump<CRT::Fragment>},
+		{demo::FragmentType::UDPCONTAINER, "UDPCONTAINER", checkUDPContainer, dump<demo::UDPContainerFragment>},
+		{demo::FragmentType::CRTPACKED, "CRTPACKED", checkCRTPacked, dump<CRT::PackedFragment>},
+	};
+
+	static_assert(sizeof(decoders) / sizeof(decoders[0]) ==
+	              demo::FragmentType::INVALID - demo::FragmentType::MISSED,
+	              "Every demo::FragmentType needs an entry in the overlay decoder table");
+}
+
+demo::OverlayDecoder const* demo::findOverlayDecoder(artdaq::Fragment::type_t type)
+{
+	size_t const index = type - FragmentType::MISSED;
+	if (type < FragmentType::MISSED || index >= sizeof(decoders) / sizeof(decoders[0]))
+	{
+		return nullptr;
+	}
+	return decoders[index].check ? &decoders[index] : nullptr;
+}
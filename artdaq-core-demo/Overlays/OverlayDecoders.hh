@@ -0,0 +1,52 @@
+#ifndef artdaq_demo_Overlays_OverlayDecoders_hh
+#define artdaq_demo_Overlays_OverlayDecoders_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#include <ostream>
+
+namespace demo
+{
+	/**
+	 * \brief Type-erased access to the overlay class for one FragmentType
+	 *
+	 * Code that handles a mix of Fragment types can look up the entry for each Fragment
+	 * instead of switching on the type code and constructing overlays itself.
+	 */
+	struct OverlayDecoder
+	{
+		FragmentType type; ///< The FragmentType this entry handles
+		char const* name; ///< Name of the FragmentType, as in demo::names
+
+		/**
+		 * \brief Check that a Fragment is complete and consistent for its overlay
+		 * \return true if the overlay can be used safely on the Fragment
+		 */
+		bool (*check)(artdaq::Fragment const&);
+
+		/**
+		 * \brief Write the overlay's description of a Fragment, as its operator<< does
+		 */
+		void (*dump)(std::ostream&, artdaq::Fragment const&);
+	};
+
+	/**
+	 * \brief Look up the overlay for a Fragment type code
+	 * \param type The artdaq::Fragment type code
+	 * \return Pointer to the OverlayDecoder for the type, or nullptr if this package has no overlay for it
+	 */
+	OverlayDecoder const* findOverlayDecoder(artdaq::Fragment::type_t type);
+
+	/**
+	 * \brief Look up the overlay for a Fragment by its type code
+	 * \param frag The Fragment to look up
+	 * \return Pointer to the OverlayDecoder for the Fragment, or nullptr if this package has no overlay for it
+	 */
+	inline OverlayDecoder const* findOverlayDecoder(artdaq::Fragment const& frag)
+	{
+		return findOverlayDecoder(frag.type());
+	}
+}
+
+#endif /* artdaq_demo_Overlays_OverlayDecoders_hh */
@@ -0,0 +1,175 @@
+#include "artdaq-core-demo/Overlays/OverlayStats.hh"
+#include "artdaq-core-demo/Overlays/ThreadShards.hh"
+
+#include <atomic>
+#include <sstream>
+
+constexpr size_t demo::Log2Histogram::n_bins;
+constexpr size_t demo::OverlayStats::n_types;
+
+namespace
+{
+	// Only the owning thread writes these, so a relaxed load and store is enough to add
+	void add(std::atomic<uint64_t>& c, uint64_t n)
+	{
+		c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	struct HistogramShard
+	{
+		std::atomic<uint64_t> bins[demo::Log2Histogram::n_bins];
+		std::atomic<uint64_t> sum;
+
+		HistogramShard() : sum(0)
+		{
+			for (auto& b : bins) b.store(0, std::memory_order_relaxed);
+		}
+
+		void fill(uint64_t value)
+		{
+			add(bins[demo::Log2Histogram::bin(value)], 1);
+			add(sum, value);
+		}
+
+		void add_to(demo::Log2Histogram& h) const
+		{
+			for (size_t i = 0; i < demo::Log2Histogram::n_bins; ++i)
+			{
+				h.bins[i] += bins[i].load(std::memory_order_relaxed);
+			}
+			h.sum += sum.load(std::memory_order_relaxed);
+		}
+	};
+
+	struct TypeShard
+	{
+		std::atomic<uint64_t> fragments;
+		std::atomic<uint64_t> failed;
+		HistogramShard bytes;
+		HistogramShard items;
+		HistogramShard nanoseconds[demo::n_overlay_phases];
+
+		TypeShard() : fragments(0), failed(0) {}
+	};
+
+	// One thread's statistics
+	struct Shard
+	{
+		typedef demo::OverlayStats Snapshot;
+
+		TypeShard types[demo::OverlayStats::n_types];
+
+		void add_to(Snapshot& s) const
+		{
+			for (size_t t = 0; t < demo::OverlayStats::n_types; ++t)
+			{
+				s.types[t].fragments += types[t].fragments.load(std::memory_order_relaxed);
+				s.types[t].failed += types[t].failed.load(std::memory_order_relaxed);
+				types[t].bytes.add_to(s.types[t].bytes);
+				types[t].items.add_to(s.types[t].items);
+				for (size_t p = 0; p < demo::n_overlay_phases; ++p)
+				{
+					types[t].nanoseconds[p].add_to(s.types[t].nanoseconds[p]);
+				}
+			}
+		}
+	};
+
+	typedef demo::detail::ThreadShards<Shard> shards;
+
+	// The calling thread's statistics for a type, or nullptr for a type code this package doesn't define
+	TypeShard* local(demo::FragmentType type)
+	{
+		size_t const t = type - demo::FragmentType::MISSED;
+		return t < demo::OverlayStats::n_types ? &shards::local().types[t] : nullptr;
+	}
+
+	void write_histogram(std::ostream& os, char const* metric, char const* type, demo::Log2Histogram const& h)
+	{
+		uint64_t cumulative = 0;
+		for (size_t b = 0; b + 1 < demo::Log2Histogram::n_bins; ++b)
+		{
+			cumulative += h.bins[b];
+			// Bin b holds values below 2^b, and they are integers
+			os << metric << "_bucket{type=\"" << type << "\",le=\"" << (uint64_t(1) << b) - 1 << "\"} " << cumulative << "\n";
+		}
+		cumulative += h.bins[demo::Log2Histogram::n_bins - 1];
+		os << metric << "_bucket{type=\"" << type << "\",le=\"+Inf\"} " << cumulative << "\n";
+		os << metric << "_sum{type=\"" << type << "\"} " << h.sum << "\n";
+		os << metric << "_count{type=\"" << type << "\"} " << cumulative << "\n";
+	}
+}
+
+demo::Log2Histogram::Log2Histogram()
+	: sum(0)
+{
+	for (auto& b : bins) b = 0;
+}
+
+uint64_t demo::Log2Histogram::count() const
+{
+	uint64_t n = 0;
+	for (auto b : bins) n += b;
+	return n;
+}
+
+demo::OverlayTypeStats::OverlayTypeStats()
+	: fragments(0)
+	, failed(0)
+{
+}
+
+void demo::OverlayStats::write(std::ostream& os) const
+{
+	static char const* const phase_metrics[n_overlay_phases] = {"demo_overlay_validate_ns", "demo_overlay_decode_ns"};
+
+	for (size_t t = 0; t < n_types; ++t)
+	{
+		OverlayTypeStats const& s = types[t];
+		bool used = s.fragments != 0 || s.failed != 0;
+		for (auto const& h : s.nanoseconds) used = used || h.count() != 0;
+		if (!used) continue;
+
+		char const* const name = detail::fragmentTypeNames[t];
+		os << "demo_overlay_fragments_total{type=\"" << name << "\"} " << s.fragments << "\n";
+		os << "demo_overlay_failed_total{type=\"" << name << "\"} " << s.failed << "\n";
+		write_histogram(os, "demo_overlay_bytes", name, s.bytes);
+		write_histogram(os, "demo_overlay_items", name, s.items);
+		for (size_t p = 0; p < n_overlay_phases; ++p)
+		{
+			write_histogram(os, phase_metrics[p], name, s.nanoseconds[p]);
+		}
+	}
+}
+
+std::string demo::OverlayStats::text() const
+{
+	std::ostringstream os;
+	write(os);
+	return os.str();
+}
+
+demo::OverlayStats demo::overlayStats()
+{
+	return shards::snapshot();
+}
+
+void demo::countOverlayFragment(FragmentType type, uint64_t bytes, uint64_t items)
+{
+	if (TypeShard* s = local(type))
+	{
+		add(s->fragments, 1);
+		s->bytes.fill(bytes);
+		s->items.fill(items);
+	}
+}
+
+void demo::countOverlayFailure(FragmentType type)
+{
+	if (TypeShard* s = local(type)) add(s->failed, 1);
+}
+
+void demo::countOverlayTime(FragmentType type, OverlayPhase phase, uint64_t ns)
+{
+	if (TypeShard* s = local(type)) s->nanoseconds[static_cast<size_t>(phase)].fill(ns);
+}
@@ -0,0 +1,190 @@
+#ifndef artdaq_core_demo_Overlays_OverlayStats_hh
+#define artdaq_core_demo_Overlays_OverlayStats_hh
+
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Counters and histograms of the Fragments that the overlays handle, kept per
+// thread and added up on demand by demo::overlayStats().
+//
+// The code in this package records them with the DEMO_OVERLAY_* macros below,
+// which expand to nothing unless DEMO_OVERLAY_STATS is defined (see the
+// DEMO_OVERLAY_STATS CMake option), so by default they cost nothing at all.
+
+namespace demo
+{
+	/**
+	 * \brief A histogram with power-of-two bins
+	 *
+	 * Bin 0 counts zeros, and bin b > 0 counts values in [2^(b-1), 2^b). The last bin also
+	 * counts everything larger.
+	 */
+	struct Log2Histogram
+	{
+		static constexpr size_t n_bins = 33; ///< Enough for any 32-bit value
+
+		uint64_t bins[n_bins]; ///< Count of values in each bin
+		uint64_t sum; ///< Sum of the values
+
+		Log2Histogram();
+
+		/**
+		 * \brief Find the bin for a value
+		 * \param value Value to bin
+		 * \return The bin it falls in
+		 */
+		static size_t bin(uint64_t value)
+		{
+			size_t const b = value == 0 ? 0 : 64 - __builtin_clzll(value);
+			return b < n_bins ? b : n_bins - 1;
+		}
+
+		/**
+		 * \brief Get the number of values
+		 * \return The sum of the bins
+		 */
+		uint64_t count() const;
+	};
+
+	/**
+	 * \brief What an overlay was doing when it was timed
+	 */
+	enum class OverlayPhase : uint8_t
+	{
+		Validate,
+		Decode,
+		n_phases
+	};
+
+	constexpr size_t n_overlay_phases = static_cast<size_t>(OverlayPhase::n_phases); ///< Number of OverlayPhases
+
+	/**
+	 * \brief Statistics of one FragmentType
+	 */
+	struct OverlayTypeStats
+	{
+		uint64_t fragments; ///< Fragments handled
+		uint64_t failed; ///< Fragments that failed validation
+		Log2Histogram bytes; ///< Payload sizes, in bytes
+		Log2Histogram items; ///< Hits, characters or datagrams, depending on the type
+		Log2Histogram nanoseconds[n_overlay_phases]; ///< Time spent in each OverlayPhase, per call
+
+		OverlayTypeStats();
+	};
+
+	/**
+	 * \brief Statistics of all the FragmentTypes, as a plain struct
+	 */
+	struct OverlayStats
+	{
+		static constexpr size_t n_types = FragmentType::INVALID - FragmentType::MISSED; ///< Number of FragmentTypes
+
+		OverlayTypeStats types[n_types]; ///< Indexed by FragmentType - MISSED
+
+		/**
+		 * \brief Get the statistics of a FragmentType
+		 * \param type The FragmentType
+		 * \return Its statistics
+		 */
+		OverlayTypeStats const& operator[](FragmentType type) const { return types[type - FragmentType::MISSED]; }
+
+		/**
+		 * \brief Write the statistics of the types with any Fragments in Prometheus's text format
+		 * \param os Stream to write to
+		 *
+		 * Counters are demo_overlay_fragments_total and demo_overlay_failed_total, and histograms
+		 * (with cumulative "le" buckets, _sum and _count) are demo_overlay_bytes, demo_overlay_items,
+		 * demo_overlay_validate_ns and demo_overlay_decode_ns, all labelled with the type's name.
+		 */
+		void write(std::ostream& os) const;
+
+		/**
+		 * \brief Get the statistics as text
+		 * \return What write() writes
+		 */
+		std::string text() const;
+	};
+
+	/**
+	 * \brief Add up the statistics from all threads so far
+	 * \return The statistics
+	 */
+	OverlayStats overlayStats();
+
+	/**
+	 * \brief Count a Fragment that an overlay handled
+	 * \param type The Fragment's type
+	 * \param bytes Size of its payload
+	 * \param items Number of hits, characters or datagrams in it
+	 */
+	void countOverlayFragment(FragmentType type, uint64_t bytes, uint64_t items);
+
+	/**
+	 * \brief Count a Fragment that failed validation
+	 * \param type The Fragment's type
+	 */
+	void countOverlayFailure(FragmentType type);
+
+	/**
+	 * \brief Record the time of one call of an overlay
+	 * \param type The FragmentType
+	 * \param phase What the overlay was doing
+	 * \param ns Time taken, in nanoseconds
+	 */
+	void countOverlayTime(FragmentType type, OverlayPhase phase, uint64_t ns);
+
+	/**
+	 * \brief Records the time from its construction to its destruction with countOverlayTime()
+	 */
+	class OverlayTimer
+	{
+	public:
+		/**
+		 * \brief Start timing
+		 * \param type The FragmentType
+		 * \param phase What the overlay is doing
+		 */
+		OverlayTimer(FragmentType type, OverlayPhase phase)
+			: type_(type), phase_(phase), start_(std::chrono::steady_clock::now()) {}
+
+		/**
+		 * \brief Stop timing and record the time
+		 */
+		~OverlayTimer()
+		{
+			auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+			countOverlayTime(type_, phase_, ns.count());
+		}
+
+		OverlayTimer(OverlayTimer const&) = delete;
+		OverlayTimer& operator=(OverlayTimer const&) = delete;
+
+	private:
+		FragmentType type_;
+		OverlayPhase phase_;
+		std::chrono::steady_clock::time_point start_;
+	};
+}
+
+#define DEMO_OVERLAY_CONCAT_(a, b) a##b
+#define DEMO_OVERLAY_CONCAT(a, b) DEMO_OVERLAY_CONCAT_(a, b)
+
+#if defined(DEMO_OVERLAY_STATS)
+/// Count a Fragment of the given type, payload bytes and items
+#define DEMO_OVERLAY_COUNT(type, bytes, items) ::demo::countOverlayFragment((type), (bytes), (items))
+/// Count a Fragment of the given type that failed validation
+#define DEMO_OVERLAY_FAILED(type) ::demo::countOverlayFailure((type))
+/// Time the rest of the enclosing scope as the given type and OverlayPhase
+#define DEMO_OVERLAY_TIMER(type, phase) \
+	::demo::OverlayTimer DEMO_OVERLAY_CONCAT(demo_overlay_timer_, __LINE__)((type), ::demo::OverlayPhase::phase)
+#else
+#define DEMO_OVERLAY_COUNT(type, bytes, items) ((void)0)
+#define DEMO_OVERLAY_FAILED(type) ((void)0)
+#define DEMO_OVERLAY_TIMER(type, phase) ((void)0)
+#endif
+
+#endif /* artdaq_core_demo_Overlays_OverlayStats_hh */
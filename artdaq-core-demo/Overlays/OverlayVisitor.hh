@@ -0,0 +1,262 @@
+#ifndef artdaq_demo_Overlays_OverlayVisitor_hh
+#define artdaq_demo_Overlays_OverlayVisitor_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/AsciiFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTPackedFragment.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/UDPContainerFragment.hh"
+#include "artdaq-core-demo/Overlays/UDPFragment.hh"
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Dispatch on a Fragment's type to a handler for its overlay, instead of a
+// hand-written switch on artdaq::Fragment::type() in every analyzer:
+//
+//   demo::visit(frag, demo::overloaded(
+//       [&](demo::AsciiFragment const& a) { ... },
+//       [&](CRT::Fragment const& crt) { ... },
+//       [&](artdaq::Fragment const& other) { ... }));
+//
+// The types and overlays come from one list, demo::Overlays, and the
+// dispatch is a single indirect call through a table indexed by type.
+// The visitor must accept an artdaq::Fragment const&, which it is given
+// for types with no overlay in the list, and for overlays it has no handler
+// for.  Every handler must return the same type as that one, or something
+// convertible to it.
+//
+// visitBatch() does the same for many Fragments, grouping them by type
+// first so that each handler runs over all of its Fragments in one loop.
+
+namespace demo
+{
+	/**
+	 * \brief Binds a FragmentType to the overlay class that reads it
+	 */
+	template <FragmentType Type, typename Overlay>
+	struct OverlayBinding
+	{
+		static constexpr FragmentType type = Type; ///< The type code
+		typedef Overlay overlay_type; ///< The overlay, constructible from artdaq::Fragment const&
+	};
+
+	/**
+	 * \brief A compile-time list of OverlayBindings
+	 */
+	template <typename... Bindings>
+	struct OverlayList
+	{
+	};
+
+	/**
+	 * \brief The overlays in this package, by type
+	 */
+	typedef OverlayList<OverlayBinding<FragmentType::ASCII, AsciiFragment>,
+	                    OverlayBinding<FragmentType::UDP, UDPFragment>,
+	                    OverlayBinding<FragmentType::CRT, CRT::Fragment>,
+	                    OverlayBinding<FragmentType::UDPCONTAINER, UDPContainerFragment>,
+	                    OverlayBinding<FragmentType::CRTPACKED, CRT::PackedFragment>>
+	    Overlays;
+
+	namespace detail
+	{
+		template <typename... Fs>
+		struct Overloaded;
+
+		template <typename F>
+		struct Overloaded<F> : F
+		{
+			explicit Overloaded(F f)
+				: F(std::move(f)) {}
+			using F::operator();
+		};
+
+		template <typename F, typename... Rest>
+		struct Overloaded<F, Rest...> : F, Overloaded<Rest...>
+		{
+			explicit Overloaded(F f, Rest... rest)
+				: F(std::move(f)), Overloaded<Rest...>(std::move(rest)...) {}
+			using F::operator();
+			using Overloaded<Rest...>::operator();
+		};
+
+		template <typename T>
+		struct Identity
+		{
+			typedef T type;
+		};
+
+		/// The overlay bound to Type in List, or void if there is none
+		template <FragmentType Type, typename List>
+		struct FindOverlay : Identity<void>
+		{
+		};
+
+		template <FragmentType Type, typename Binding, typename... Rest>
+		struct FindOverlay<Type, OverlayList<Binding, Rest...>>
+			: std::conditional<Binding::type == Type,
+			                   Identity<typename Binding::overlay_type>,
+			                   FindOverlay<Type, OverlayList<Rest...>>>::type
+		{
+		};
+
+		/// Whether a V can be called with an Arg
+		template <typename V, typename Arg, typename = void>
+		struct IsCallable : std::false_type
+		{
+		};
+
+		template <typename V, typename Arg>
+		struct IsCallable<V, Arg, decltype(void(std::declval<V&>()(std::declval<Arg>())))> : std::true_type
+		{
+		};
+
+		size_t const n_overlay_types = FragmentType::INVALID - FragmentType::MISSED;
+
+		/// Index of a Fragment's type in the dispatch tables, or n_overlay_types if it isn't one of ours
+		inline size_t overlayTypeIndex(artdaq::Fragment const& frag)
+		{
+			size_t const index = static_cast<size_t>(frag.type()) - FragmentType::MISSED;
+			return frag.type() < FragmentType::MISSED || index >= n_overlay_types ? n_overlay_types : index;
+		}
+
+		/// Calls the visitor for one type: with the Overlay if it has a handler for it, else with the Fragment
+		template <typename Overlay, typename R, typename V>
+		struct Handler
+		{
+			static R call(artdaq::Fragment const& frag, V& visitor)
+			{
+				return call_(frag, visitor, IsCallable<V, Overlay const&>());
+			}
+
+			static void run(artdaq::Fragment const* const* frags, size_t n, V& visitor)
+			{
+				for (size_t i = 0; i < n; ++i) call(*frags[i], visitor);
+			}
+
+		private:
+			static R call_(artdaq::Fragment const& frag, V& visitor, std::true_type)
+			{
+				Overlay const overlay(frag);
+				return visitor(overlay);
+			}
+
+			static R call_(artdaq::Fragment const& frag, V& visitor, std::false_type)
+			{
+				return visitor(frag);
+			}
+		};
+
+		template <typename R, typename V>
+		struct Handler<void, R, V>
+		{
+			static R call(artdaq::Fragment const& frag, V& visitor) { return visitor(frag); }
+
+			static void run(artdaq::Fragment const* const* frags, size_t n, V& visitor)
+			{
+				for (size_t i = 0; i < n; ++i) visitor(*frags[i]);
+			}
+		};
+
+		template <typename List, typename R, typename V, size_t I>
+		using HandlerAt = Handler<typename FindOverlay<static_cast<FragmentType>(FragmentType::MISSED + I), List>::type, R, V>;
+
+		template <typename List, typename R, typename V, size_t... I>
+		R visit(artdaq::Fragment const& frag, V& visitor, std::index_sequence<I...>)
+		{
+			typedef R (*Call)(artdaq::Fragment const&, V&);
+			static constexpr Call table[] = {&HandlerAt<List, R, V, I>::call..., &Handler<void, R, V>::call};
+			return table[overlayTypeIndex(frag)](frag, visitor);
+		}
+
+		template <typename List, typename V, size_t... I>
+		void visitBatch(artdaq::Fragment const* const* frags, size_t n, V& visitor,
+		                std::vector<artdaq::Fragment const*>& scratch, std::index_sequence<I...>)
+		{
+			typedef decltype(std::declval<V&>()(std::declval<artdaq::Fragment const&>())) R;
+			typedef void (*Run)(artdaq::Fragment const* const*, size_t, V&);
+			static constexpr Run table[] = {&HandlerAt<List, R, V, I>::run..., &Handler<void, R, V>::run};
+
+			// A counting sort by type, which keeps each type's Fragments in their order
+			size_t start[n_overlay_types + 3] = {};
+			for (size_t i = 0; i < n; ++i) ++start[overlayTypeIndex(*frags[i]) + 2];
+			for (size_t t = 2; t < n_overlay_types + 3; ++t) start[t] += start[t - 1];
+
+			scratch.resize(n);
+			for (size_t i = 0; i < n; ++i) scratch[start[overlayTypeIndex(*frags[i]) + 1]++] = frags[i];
+
+			// start[t] is now where type t begins, and start[t + 1] where it ends
+			for (size_t t = 0; t <= n_overlay_types; ++t)
+			{
+				if (start[t + 1] > start[t]) table[t](scratch.data() + start[t], start[t + 1] - start[t], visitor);
+			}
+		}
+	}
+
+	/**
+	 * \brief Combine handlers, usually lambdas, into one visitor that has all their overloads
+	 * \param fs The handlers
+	 * \return A visitor for visit() or visitBatch()
+	 *
+	 * This stands in for the C++17 idiom of aggregate initialization, "overloaded{...}".
+	 */
+	template <typename... Fs>
+	detail::Overloaded<typename std::decay<Fs>::type...> overloaded(Fs&&... fs)
+	{
+		return detail::Overloaded<typename std::decay<Fs>::type...>(std::forward<Fs>(fs)...);
+	}
+
+	/**
+	 * \brief Call the visitor with the overlay for a Fragment's type
+	 * \tparam List The OverlayList to dispatch on, by default all the overlays in this package
+	 * \param frag The Fragment
+	 * \param visitor Called with the overlay if List has one for the type and the visitor has a
+	 * handler for it, and otherwise with frag
+	 * \return What the visitor returns
+	 */
+	template <typename List = Overlays, typename Visitor>
+	auto visit(artdaq::Fragment const& frag, Visitor&& visitor) -> decltype(visitor(frag))
+	{
+		typedef typename std::remove_reference<Visitor>::type V;
+		return detail::visit<List, decltype(visitor(frag)), V>(frag, visitor, std::make_index_sequence<detail::n_overlay_types>());
+	}
+
+	/**
+	 * \brief Call the visitor for many Fragments, grouped by type
+	 * \tparam List The OverlayList to dispatch on, by default all the overlays in this package
+	 * \param frags Pointers to the Fragments
+	 * \param n Number of Fragments
+	 * \param visitor As for visit(). What it returns is ignored.
+	 * \param scratch Storage for the grouped Fragments, which can be reused from call to call
+	 *
+	 * The visitor sees the Fragments in order of FragmentType, those with types not from this
+	 * package last, and in their original order within each type.
+	 */
+	template <typename List = Overlays, typename Visitor>
+	void visitBatch(artdaq::Fragment const* const* frags, size_t n, Visitor&& visitor,
+	                std::vector<artdaq::Fragment const*>& scratch)
+	{
+		typedef typename std::remove_reference<Visitor>::type V;
+		detail::visitBatch<List, V>(frags, n, visitor, scratch, std::make_index_sequence<detail::n_overlay_types>());
+	}
+
+	/**
+	 * \brief Call the visitor for many Fragments, grouped by type
+	 * \tparam List The OverlayList to dispatch on, by default all the overlays in this package
+	 * \param frags The Fragments
+	 * \param visitor As for visit(). What it returns is ignored.
+	 */
+	template <typename List = Overlays, typename Visitor>
+	void visitBatch(artdaq::Fragments const& frags, Visitor&& visitor)
+	{
+		std::vector<artdaq::Fragment const*> pointers(frags.size());
+		for (size_t i = 0; i < frags.size(); ++i) pointers[i] = &frags[i];
+		std::vector<artdaq::Fragment const*> scratch;
+		visitBatch<List>(pointers.data(), pointers.size(), visitor, scratch);
+	}
+}
+
+#endif /* artdaq_demo_Overlays_OverlayVisitor_hh */
@@ -0,0 +1,182 @@
+#include "artdaq-core-demo/Overlays/ThreadPool.hh"
+
+#include <exception>
+
+namespace
+{
+	// Which pool, and which of its workers, the current thread is
+	thread_local demo::ThreadPool const* current_pool = nullptr;
+	thread_local size_t current_worker = 0;
+
+	size_t const not_a_worker = ~size_t(0);
+}
+
+demo::ThreadPool::ThreadPool(size_t nThreads)
+	: workers_()
+	, next_queue_(0)
+	, pending_(0)
+	, executed_(0)
+	, stolen_(0)
+	, sleep_mutex_()
+	, wake_()
+	, stop_(false)
+{
+	if (nThreads == 0) nThreads = std::thread::hardware_concurrency();
+	if (nThreads == 0) nThreads = 1;
+
+	// All the queues exist before any worker looks for work in them
+	for (size_t i = 0; i < nThreads; ++i)
+	{
+		workers_.emplace_back(new Worker);
+	}
+	for (size_t i = 0; i < nThreads; ++i)
+	{
+		workers_[i]->thread = std::thread(&ThreadPool::run_, this, i);
+	}
+}
+
+demo::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (auto& w : workers_)
+	{
+		w->thread.join();
+	}
+}
+
+void demo::ThreadPool::submit(Task task)
+{
+	size_t const queue = current_pool == this ? current_worker
+	                                          : next_queue_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+	{
+		std::lock_guard<std::mutex> lock(workers_[queue]->mutex);
+		workers_[queue]->tasks.push_back(std::move(task));
+		pending_.fetch_add(1);
+	}
+
+	// Taking the lock orders this with a worker deciding to sleep, so the wakeup isn't lost
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+	}
+	wake_.notify_one();
+}
+
+bool demo::ThreadPool::take_(size_t self, Task& task)
+{
+	if (self != not_a_worker)
+	{
+		Worker& w = *workers_[self];
+		std::lock_guard<std::mutex> lock(w.mutex);
+		if (!w.tasks.empty())
+		{
+			task = std::move(w.tasks.back());
+			w.tasks.pop_back();
+			pending_.fetch_sub(1);
+			return true;
+		}
+	}
+
+	// Steal the oldest task from another queue, starting at a different one for each thief
+	size_t const n = workers_.size();
+	size_t const start = self != not_a_worker ? self + 1 : next_queue_.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < n; ++i)
+	{
+		size_t const victim = (start + i) % n;
+		if (victim == self) continue;
+
+		Worker& w = *workers_[victim];
+		std::lock_guard<std::mutex> lock(w.mutex);
+		if (!w.tasks.empty())
+		{
+			task = std::move(w.tasks.front());
+			w.tasks.pop_front();
+			pending_.fetch_sub(1);
+			stolen_.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void demo::ThreadPool::run_(size_t self)
+{
+	current_pool = this;
+	current_worker = self;
+
+	Task task;
+	for (;;)
+	{
+		if (take_(self, task))
+		{
+			task();
+			task = nullptr;
+			executed_.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		if (pending_.load() != 0) continue;
+		if (stop_) return;
+		wake_.wait(lock);
+	}
+}
+
+void demo::ThreadPool::parallel_for(size_t n, std::function<void(size_t)> const& body)
+{
+	struct State
+	{
+		std::atomic<size_t> remaining;
+		std::mutex mutex;
+		std::condition_variable done;
+		std::exception_ptr error;
+	} state;
+	state.remaining = n;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		submit([&state, &body, i] {
+			try
+			{
+				body(i);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(state.mutex);
+				if (!state.error) state.error = std::current_exception();
+			}
+			// Under the lock, so that the caller can't return and destroy state before this is done with it
+			std::lock_guard<std::mutex> lock(state.mutex);
+			if (state.remaining.fetch_sub(1) == 1) state.done.notify_all();
+		});
+	}
+
+	// Help rather than block, so that this also works when called from a worker
+	size_t const self = current_pool == this ? current_worker : not_a_worker;
+	Task task;
+	while (state.remaining.load() != 0)
+	{
+		if (take_(self, task))
+		{
+			task();
+			task = nullptr;
+			executed_.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+
+		// What's left is running on other threads
+		std::unique_lock<std::mutex> lock(state.mutex);
+		state.done.wait(lock, [&state] { return state.remaining.load() == 0; });
+	}
+
+	std::lock_guard<std::mutex> lock(state.mutex);
+	if (state.error) std::rethrow_exception(state.error);
+}
+
+demo::ThreadPool::Stats demo::ThreadPool::stats() const
+{
+	return Stats{executed_.load(std::memory_order_relaxed), stolen_.load(std::memory_order_relaxed)};
+}
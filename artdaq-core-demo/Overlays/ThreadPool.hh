@@ -0,0 +1,107 @@
+#ifndef artdaq_core_demo_Overlays_ThreadPool_hh
+#define artdaq_core_demo_Overlays_ThreadPool_hh
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace demo
+{
+	class ThreadPool;
+}
+
+/**
+ * \brief A pool of worker threads that balance their load by work stealing
+ *
+ * Each worker has its own queue of tasks. A worker runs the newest task in its own queue,
+ * and when that is empty, steals the oldest task from another worker's queue. Tasks submitted
+ * from a worker go to its own queue; others are spread over the queues in turn. So uneven
+ * tasks, such as Fragments with very different numbers of hits, keep every worker busy
+ * without a single shared queue that all of them contend for.
+ */
+class demo::ThreadPool
+{
+public:
+	typedef std::function<void()> Task; ///< A unit of work
+
+	/**
+	 * \brief Counts of what the workers have done
+	 */
+	struct Stats
+	{
+		uint64_t executed; ///< Tasks run
+		uint64_t stolen; ///< Tasks run by a thread other than the worker they were queued for
+	};
+
+	/**
+	 * \brief ThreadPool Constructor
+	 * \param nThreads Number of worker threads, or 0 for one per hardware thread
+	 */
+	explicit ThreadPool(size_t nThreads = 0);
+
+	/**
+	 * \brief Run the tasks still queued, then stop the workers
+	 */
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool& operator=(ThreadPool const&) = delete;
+
+	/**
+	 * \brief Get the number of worker threads
+	 * \return The number of worker threads
+	 */
+	size_t size() const { return workers_.size(); }
+
+	/**
+	 * \brief Queue a task to run on a worker
+	 * \param task The task, which must not throw
+	 */
+	void submit(Task task);
+
+	/**
+	 * \brief Run body(i) for each i in [0, n) on the workers, and wait for all of them
+	 * \param n Number of calls
+	 * \param body Function to call, which must be safe to call from several threads at once
+	 * \exception Rethrows the first exception thrown by body, after all calls have finished
+	 *
+	 * The calling thread runs queued tasks while it waits, so this may be called from a task.
+	 */
+	void parallel_for(size_t n, std::function<void(size_t)> const& body);
+
+	/**
+	 * \brief Get counts of what the workers have done
+	 * \return The counts so far
+	 */
+	Stats stats() const;
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::thread thread;
+	};
+
+	void run_(size_t self);
+	bool take_(size_t self, Task& task);
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::atomic<size_t> next_queue_;
+	std::atomic<size_t> pending_; ///< Tasks in all the queues
+	std::atomic<uint64_t> executed_;
+	std::atomic<uint64_t> stolen_;
+
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+	bool stop_;
+};
+
+#endif /* artdaq_core_demo_Overlays_ThreadPool_hh */
@@ -0,0 +1,93 @@
+#ifndef artdaq_demo_Overlays_ThreadShards_hh
+#define artdaq_demo_Overlays_ThreadShards_hh
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace demo
+{
+	namespace detail
+	{
+		template <typename Shard>
+		class ThreadShards;
+	}
+}
+
+/**
+ * \brief Per-thread copies ("shards") of a set of counters, summed on demand
+ *
+ * Each thread that calls local() gets its own Shard, so updating counters never
+ * contends with other threads. snapshot() adds up every live shard, plus the final
+ * values of shards whose threads have exited. There is one set of shards per Shard type.
+ *
+ * Shard must be default-constructible, define a Snapshot type that is default-constructible
+ * to zero, and provide "void add_to(Snapshot&) const". Shard members that snapshot() reads
+ * while their owning thread writes them should be relaxed atomics.
+ */
+template <typename Shard>
+class demo::detail::ThreadShards
+{
+public:
+	typedef typename Shard::Snapshot Snapshot; ///< The type that shards are summed into
+
+	/**
+	 * \brief Get the calling thread's shard
+	 * \return Reference to the calling thread's shard, valid until the thread exits
+	 */
+	static Shard& local()
+	{
+		thread_local Holder holder;
+		return holder.shard;
+	}
+
+	/**
+	 * \brief Sum all shards, live and retired
+	 * \return The sum of all shards
+	 */
+	static Snapshot snapshot()
+	{
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		Snapshot total = r.retired;
+		for (auto shard : r.live) shard->add_to(total);
+		return total;
+	}
+
+private:
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<Shard const*> live;
+		Snapshot retired;
+	};
+
+	static Registry& registry()
+	{
+		static Registry r;
+		return r;
+	}
+
+	// Registers its shard for the life of its thread
+	struct Holder
+	{
+		Shard shard;
+
+		Holder()
+		{
+			Registry& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.live.push_back(&shard);
+		}
+
+		~Holder()
+		{
+			Registry& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			shard.add_to(r.retired);
+			r.live.erase(std::find(r.live.begin(), r.live.end(), &shard));
+		}
+	};
+};
+
+#endif /* artdaq_demo_Overlays_ThreadShards_hh */
@@ -0,0 +1,135 @@
+#include "artdaq-core-demo/Overlays/UDPBatchReceiver.hh"
+
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/UDPFragmentWriter.hh"
+#include "cetlib/exception.h"
+
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+	// Metadata for Fragments received on fd: the port and address it is bound to, as reported
+	// by getsockname(), or zeros if that fails
+	demo::UDPFragment::Metadata localMetadata(int fd)
+	{
+		demo::UDPFragment::Metadata metadata;
+		metadata.port = 0;
+		metadata.address = 0;
+		metadata.unused = 0;
+
+		sockaddr_in local;
+		socklen_t len = sizeof(local);
+		if (getsockname(fd, reinterpret_cast<sockaddr*>(&local), &len) == 0 && local.sin_family == AF_INET)
+		{
+			metadata.port = ntohs(local.sin_port);
+			metadata.address = local.sin_addr.s_addr;
+		}
+		return metadata;
+	}
+}
+
+demo::UDPBatchReceiver::UDPBatchReceiver(int fd, size_t batch_size, size_t max_datagram_bytes,
+                                         UDPFragment::Header::data_type_t data_type)
+	: fd_(fd)
+	, max_datagram_bytes_(max_datagram_bytes)
+	, data_type_(data_type)
+	, received_(0)
+	, truncated_(0)
+	, pool_(FragmentType::UDP, localMetadata(fd), sizeof(UDPFragment::Header),
+	        max_datagram_bytes + sizeof(UDPFragment::Header::data_t), batch_size)
+	, slots_(batch_size)
+	, msgs_(batch_size)
+	, iovecs_(batch_size)
+{
+	if (batch_size == 0)
+	{
+		throw cet::exception("UDPBatchReceiver") << "Batch size must be positive";
+	}
+
+	for (auto& slot : slots_)
+	{
+		slot = makeFragment_();
+	}
+}
+
+artdaq::FragmentPtr demo::UDPBatchReceiver::makeFragment_()
+{
+	artdaq::FragmentPtr frag = pool_.acquire();
+
+	// The pool reserved room for the full payload, so this doesn't allocate; receive() only
+	// ever rewrites the header
+	UDPFragmentWriter writer(*frag, headerReserved);
+	writer.set_hdr_type(data_type_);
+	writer.resize(max_datagram_bytes_);
+	return frag;
+}
+
+uint8_t* demo::UDPBatchReceiver::payload_(artdaq::Fragment& f) const
+{
+	return f.dataBeginBytes() + sizeof(UDPFragment::Header);
+}
+
+size_t demo::UDPBatchReceiver::receive(int flags, timespec* timeout)
+{
+	received_ = 0;
+
+	for (size_t i = 0; i < slots_.size(); ++i)
+	{
+		iovecs_[i].iov_base = payload_(*slots_[i]);
+		iovecs_[i].iov_len = max_datagram_bytes_;
+
+		msghdr& hdr = msgs_[i].msg_hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.msg_iov = &iovecs_[i];
+		hdr.msg_iovlen = 1;
+		msgs_[i].msg_len = 0;
+	}
+
+	int const n = recvmmsg(fd_, msgs_.data(), msgs_.size(), flags, timeout);
+	if (n < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+		throw cet::exception("UDPBatchReceiver") << "recvmmsg failed: " << strerror(errno);
+	}
+
+	size_t const word = sizeof(UDPFragment::Header::data_t);
+	for (int i = 0; i < n; ++i)
+	{
+		artdaq::Fragment& frag = *slots_[i];
+
+		size_t bytes = msgs_[i].msg_len;
+		if (msgs_[i].msg_hdr.msg_flags & MSG_TRUNC)
+		{
+			++truncated_;
+			bytes = max_datagram_bytes_;
+		}
+
+		auto header = reinterpret_cast<UDPFragment::Header*>(frag.dataBeginBytes());
+		header->event_size = (bytes + word - 1) / word + UDPFragment::hdr_size_words();
+
+		// Readers such as UDPFragment::textEnd() expect the rest of the last word to be NUL, not
+		// whatever an earlier datagram, or the allocator, left there
+		uint8_t* const end = frag.dataBeginBytes() + header->event_size * word;
+		memset(payload_(frag) + bytes, 0, end - (payload_(frag) + bytes));
+	}
+
+	received_ = n;
+	return received_;
+}
+
+artdaq::FragmentPtr demo::UDPBatchReceiver::release(size_t i)
+{
+	if (i >= received_)
+	{
+		throw cet::exception("UDPBatchReceiver") << "No datagram " << i << " in the last batch of " << received_;
+	}
+
+	artdaq::FragmentPtr frag = makeFragment_();
+	std::swap(frag, slots_[i]);
+
+	// Shrinking does not reallocate
+	auto header = reinterpret_cast<UDPFragment::Header const*>(frag->dataBeginBytes());
+	frag->resizeBytes(header->event_size * sizeof(UDPFragment::Header::data_t));
+	return frag;
+}
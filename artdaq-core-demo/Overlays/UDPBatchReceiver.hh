@@ -0,0 +1,125 @@
+#ifndef artdaq_core_demo_Overlays_UDPBatchReceiver_hh
+#define artdaq_core_demo_Overlays_UDPBatchReceiver_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/FragmentPool.hh"
+#include "artdaq-core-demo/Overlays/UDPFragment.hh"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <vector>
+
+namespace demo
+{
+	class UDPBatchReceiver;
+}
+
+/**
+ * \brief Receives batches of UDP datagrams straight into preallocated UDPFragments
+ *
+ * UDPBatchReceiver keeps a pool of UDP Fragments, each with its UDPFragment::Metadata and
+ * Header in place and room for the largest datagram. receive() reads up to a batch of
+ * datagrams with one recvmmsg() call, each directly into the payload of its own Fragment,
+ * and then fills in Header::event_size in place. No scratch buffer, copy or reallocation is
+ * involved. The Metadata port and address are those the socket is bound to, as reported by
+ * getsockname() when the UDPBatchReceiver is made; the address is 0 for a socket bound to
+ * all interfaces.
+ *
+ * The Fragments being received into keep their full size between calls, so only the
+ * UDPFragment header describes how much of the payload is valid until the Fragment is taken
+ * with release(), which trims it to size. A released Fragment keeps the storage for the
+ * largest datagram, and its slot is refilled from a FragmentPool, so consumers should hand
+ * Fragments back with recycle() when done with them. Then receiving allocates nothing once
+ * enough Fragments are in circulation.
+ */
+class demo::UDPBatchReceiver
+{
+public:
+	/**
+	 * \brief UDPBatchReceiver Constructor
+	 * \param fd A bound UDP socket. The UDPBatchReceiver does not take ownership of it.
+	 * \param batch_size Maximum number of datagrams to receive per call
+	 * \param max_datagram_bytes Size of the largest expected datagram. Longer ones are truncated.
+	 * \param data_type Value for the UDPFragment::Header type field of received Fragments
+	 */
+	UDPBatchReceiver(int fd, size_t batch_size, size_t max_datagram_bytes = 65507,
+	                 UDPFragment::Header::data_type_t data_type = 0);
+
+	/**
+	 * \brief Receive up to batch_size datagrams with one system call
+	 * \param flags Flags for recvmmsg(). The default waits for one datagram, then takes whatever else has arrived.
+	 * \param timeout Timeout for recvmmsg(), or nullptr for none
+	 * \return The number of datagrams received, which may be 0 on timeout, interrupt or a non-blocking socket with nothing waiting
+	 * \throws cet::exception if recvmmsg() fails for any other reason
+	 *
+	 * recvmmsg() only checks timeout after each datagram arrives, so it limits how long the
+	 * call waits for the rest of a batch, not for the first datagram: on an idle socket it
+	 * blocks forever. To bound that wait, set SO_RCVTIMEO on the socket, which makes
+	 * receive() return 0 when it expires, or pass MSG_DONTWAIT.
+	 *
+	 * Fragments from the previous call that were not released are overwritten.
+	 */
+	size_t receive(int flags = MSG_WAITFORONE, timespec* timeout = nullptr);
+
+	/**
+	 * \brief Get the number of datagrams received by the last receive()
+	 * \return The number of datagrams received by the last receive()
+	 */
+	size_t size() const { return received_; }
+
+	/**
+	 * \brief Access a Fragment from the last receive() in place
+	 * \param i Index of the datagram, less than size()
+	 * \return The Fragment holding datagram i. Its storage may extend past the datagram.
+	 */
+	artdaq::Fragment const& fragment(size_t i) const { return *slots_[i]; }
+
+	/**
+	 * \brief Take ownership of a Fragment from the last receive()
+	 * \param i Index of the datagram, less than size()
+	 * \return The Fragment holding datagram i, trimmed to the datagram's size
+	 *
+	 * The slot is refilled from the FragmentPool, which only allocates if no Fragment has been
+	 * given back with recycle().
+	 */
+	artdaq::FragmentPtr release(size_t i);
+
+	/**
+	 * \brief Give back a Fragment taken with release() once done with it, so its storage is reused
+	 * \param frag The Fragment. Fragments from elsewhere are accepted if laid out like a UDP
+	 * Fragment, and freed otherwise.
+	 *
+	 * recycle() may be called from any thread.
+	 */
+	void recycle(artdaq::FragmentPtr frag) { pool_.release(std::move(frag)); }
+
+	/**
+	 * \brief Get statistics on the FragmentPool the slots are refilled from
+	 * \return The pool's statistics
+	 */
+	FragmentPool::Stats poolStats() const { return pool_.stats(); }
+
+	/**
+	 * \brief Get the number of datagrams that did not fit in max_datagram_bytes
+	 * \return The number of truncated datagrams received so far
+	 */
+	size_t truncated() const { return truncated_; }
+
+private:
+	artdaq::FragmentPtr makeFragment_();
+	uint8_t* payload_(artdaq::Fragment& f) const;
+
+	int fd_;
+	size_t max_datagram_bytes_;
+	UDPFragment::Header::data_type_t data_type_;
+	size_t received_;
+	size_t truncated_;
+
+	FragmentPool pool_;
+	std::vector<artdaq::FragmentPtr> slots_;
+	std::vector<mmsghdr> msgs_;
+	std::vector<iovec> iovecs_;
+};
+
+#endif /* artdaq_core_demo_Overlays_UDPBatchReceiver_hh */
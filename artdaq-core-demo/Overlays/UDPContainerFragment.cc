@@ -0,0 +1,67 @@
+#include "artdaq-core-demo/Overlays/UDPContainerFragment.hh"
+
+#include "cetlib/exception.h"
+
+constexpr size_t demo::UDPContainerFragment::max_datagram_bytes;
+constexpr size_t demo::UDPContainerFragment::alignment;
+
+demo::UDPContainerFragment::Datagram demo::UDPContainerFragment::datagram(size_t i) const
+{
+	if (i >= n_datagrams())
+	{
+		throw cet::exception("UDPContainerFragment") << "Datagram " << i << " requested, but there are only " << n_datagrams();
+	}
+
+	if (indexed())
+	{
+		return Datagram(reinterpret_cast<DatagramHeader const*>(payload_() + index_()[i]));
+	}
+
+	const_iterator it = begin();
+	for (size_t j = 0; j < i; ++j) ++it;
+	return *it;
+}
+
+bool demo::UDPContainerFragment::consistent() const
+{
+	size_t const total = payload_size_bytes_();
+	if (total < sizeof(Header)) return false;
+
+	Header const* h = header_();
+	if (h->used_bytes < sizeof(Header) || h->used_bytes > total || h->used_bytes % alignment != 0) return false;
+
+	if (h->index_offset != 0 &&
+		(h->index_offset < h->used_bytes || h->index_offset > total || h->index_offset % sizeof(uint32_t) != 0 ||
+		 (total - h->index_offset) / sizeof(uint32_t) < h->n_datagrams))
+	{
+		return false;
+	}
+
+	// Walk the datagrams, checking each against the index as we go
+	size_t offset = sizeof(Header);
+	size_t n = 0;
+	while (offset < h->used_bytes)
+	{
+		if (h->used_bytes - offset < sizeof(DatagramHeader) || n == h->n_datagrams) return false;
+		if (h->index_offset != 0 && index_()[n] != offset) return false;
+
+		auto dh = reinterpret_cast<DatagramHeader const*>(payload_() + offset);
+		offset += sizeof(DatagramHeader) + padded_size(dh->size);
+		if (offset > h->used_bytes) return false;
+		++n;
+	}
+	return n == h->n_datagrams;
+}
+
+std::ostream& demo::operator <<(std::ostream& os, UDPContainerFragment const& f)
+{
+	os << "UDPContainerFragment n_datagrams: "
+		<< f.n_datagrams()
+		<< ", used_bytes: "
+		<< f.used_bytes()
+		<< ", indexed: "
+		<< f.indexed()
+		<< "\n";
+
+	return os;
+}
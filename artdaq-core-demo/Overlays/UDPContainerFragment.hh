@@ -0,0 +1,262 @@
+#ifndef artdaq_core_demo_Overlays_UDPContainerFragment_hh
+#define artdaq_core_demo_Overlays_UDPContainerFragment_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+
+#include <iterator>
+#include <ostream>
+
+// Implementation of "UDPContainerFragment", an artdaq::Fragment overlay class
+
+namespace demo
+{
+	class UDPContainerFragment;
+
+	/// Let the "<<" operator dump the UDPContainerFragment's data to stdout
+	std::ostream& operator <<(std::ostream&, UDPContainerFragment const&);
+}
+
+/**
+ * \brief A Fragment holding many UDP datagrams, each with the port, address and time it was received
+ *
+ * A UDPFragment holds one datagram, so for small datagrams most of each Fragment is artdaq
+ * Fragment header and UDPFragment::Metadata. This packs datagrams one after another:
+ *
+ *     Header | DatagramHeader, data, padding | DatagramHeader, data, padding | ... | index
+ *
+ * Each datagram's data is padded to a multiple of 8 bytes so that every DatagramHeader is aligned.
+ * The index, written when the writer is finalized, is a uint32_t byte offset (from the start of
+ * the payload) of each DatagramHeader, giving random access. Without it, the datagrams can still be
+ * read in order.
+ */
+class demo::UDPContainerFragment
+{
+public:
+
+	/**
+	 * \brief The UDPContainerFragment::Header describes the packed datagrams
+	 */
+	struct Header
+	{
+		typedef uint32_t data_t; ///< The fundamental unit of Header data
+
+		data_t n_datagrams; ///< Number of datagrams in the Fragment
+		data_t used_bytes; ///< Bytes used by the Header and the datagrams, not including the index
+		data_t index_offset; ///< Byte offset of the index from the start of the payload, or 0 if there is no index
+		data_t unused; ///< Pads the Header to 16 bytes, a multiple of the alignment
+
+		static size_t const size_words = 4ul; ///< Size of the UDPContainerFragment::Header, in units of Header::data_t
+	};
+
+	static_assert (sizeof(Header) == Header::size_words * sizeof(Header::data_t), "UDPContainerFragment::Header size changed");
+
+	/**
+	 * \brief Describes one datagram, whose data follows it
+	 */
+	struct DatagramHeader
+	{
+		uint64_t timestamp; ///< When the datagram was received, in units chosen by the writer
+		uint32_t address; ///< The IPv4 address the datagram was received on
+		uint16_t port; ///< The port on which the datagram was received
+		uint16_t size; ///< Size of the datagram's data, in bytes
+	};
+
+	static_assert (sizeof(DatagramHeader) == 16, "UDPContainerFragment::DatagramHeader size changed");
+
+	static constexpr size_t max_datagram_bytes = 65535; ///< Largest datagram that DatagramHeader::size can describe
+	static constexpr size_t alignment = 8; ///< Alignment of each DatagramHeader within the payload
+
+	/**
+	 * \brief One datagram in the Fragment, pointing into the Fragment's payload
+	 */
+	class Datagram
+	{
+	public:
+		/**
+		 * \brief Datagram Constructor
+		 * \param h Header of the datagram, which its data follows
+		 */
+		explicit Datagram(DatagramHeader const* h) : header_(h) {}
+
+		uint64_t timestamp() const { return header_->timestamp; } ///< When the datagram was received
+		uint32_t address() const { return header_->address; } ///< The IPv4 address the datagram was received on
+		uint16_t port() const { return header_->port; } ///< The port on which the datagram was received
+		size_t size() const { return header_->size; } ///< Size of the datagram, in bytes
+
+		/**
+		 * \brief Returns a const pointer to the start of the datagram
+		 * \return const byte pointer to the start of the datagram
+		 */
+		uint8_t const* dataBegin() const { return reinterpret_cast<uint8_t const*>(header_ + 1); }
+
+		/**
+		 * \brief Returns a const pointer to the end of the datagram
+		 * \return const byte pointer to the end of the datagram
+		 */
+		uint8_t const* dataEnd() const { return dataBegin() + size(); }
+
+		/**
+		 * \brief Get the header of the datagram following this one
+		 * \return Pointer to where the next DatagramHeader starts
+		 */
+		DatagramHeader const* next() const
+		{
+			return reinterpret_cast<DatagramHeader const*>(dataBegin() + padded_size(size()));
+		}
+
+	private:
+		DatagramHeader const* header_;
+	};
+
+	/**
+	 * \brief Iterates over the datagrams in order, without using the index
+	 */
+	class const_iterator
+	{
+	public:
+		typedef std::input_iterator_tag iterator_category; ///< Datagrams are made on the fly
+		typedef Datagram value_type; ///< Iterating gives Datagrams
+		typedef std::ptrdiff_t difference_type; ///< Not meaningful for this iterator
+		typedef Datagram const* pointer; ///< Not meaningful for this iterator
+		typedef Datagram reference; ///< Dereferencing gives a Datagram by value
+
+		/**
+		 * \brief const_iterator Constructor
+		 * \param h Header of the datagram to point to
+		 */
+		explicit const_iterator(DatagramHeader const* h) : header_(h) {}
+
+		Datagram operator*() const { return Datagram(header_); } ///< Get the current Datagram
+		const_iterator& operator++() ///< Advance to the next Datagram
+		{
+			header_ = Datagram(header_).next();
+			return *this;
+		}
+		const_iterator operator++(int) ///< Advance to the next Datagram
+		{
+			const_iterator const old = *this;
+			++*this;
+			return old;
+		}
+		bool operator==(const_iterator const& o) const { return header_ == o.header_; } ///< Compare positions
+		bool operator!=(const_iterator const& o) const { return header_ != o.header_; } ///< Compare positions
+
+	private:
+		DatagramHeader const* header_;
+	};
+
+	/**
+	 * \brief Round a datagram size up to the alignment of the next DatagramHeader
+	 * \param nBytes Size of a datagram
+	 * \return Bytes the datagram takes in the payload
+	 */
+	static constexpr size_t padded_size(size_t nBytes)
+	{
+		return (nBytes + alignment - 1) & ~(alignment - 1);
+	}
+
+	/**
+	 * \brief The UDPContainerFragment constructor
+	 * \param f The raw artdaq::Fragment object to overlay
+	 */
+	explicit UDPContainerFragment(artdaq::Fragment const& f)
+		: artdaq_Fragment_(&f), payload_begin_(nullptr), payload_bytes_(0) {}
+
+	/**
+	 * \brief Overlay a payload that isn't in an artdaq::Fragment, such as one in a mapped file
+	 * \param payload Start of the payload, where the UDPContainerFragment::Header begins
+	 * \param payloadBytes Size of the payload
+	 */
+	UDPContainerFragment(uint8_t const* payload, size_t payloadBytes)
+		: artdaq_Fragment_(nullptr), payload_begin_(payload), payload_bytes_(payloadBytes) {}
+
+	/**
+	 * \brief Get the number of datagrams in the Fragment
+	 * \return The Header::n_datagrams field
+	 */
+	size_t n_datagrams() const { return header_()->n_datagrams; }
+
+	/**
+	 * \brief Get the number of bytes used by the Header and datagrams
+	 * \return The Header::used_bytes field
+	 */
+	size_t used_bytes() const { return header_()->used_bytes; }
+
+	/**
+	 * \brief Whether the Fragment has an index of its datagrams
+	 * \return true if datagram(i) can use the index
+	 */
+	bool indexed() const { return header_()->index_offset != 0; }
+
+	const_iterator begin() const { return const_iterator(first_()); } ///< Iterator to the first datagram
+	const_iterator end() const { return const_iterator(reinterpret_cast<DatagramHeader const*>(payload_() + used_bytes())); } ///< Iterator past the last datagram
+
+	/**
+	 * \brief Get a datagram by position, using the index if there is one
+	 * \param i Position of the datagram
+	 * \return The datagram
+	 * \exception cet::exception if i is out of range
+	 */
+	Datagram datagram(size_t i) const;
+
+	/**
+	 * \brief Check that the Header, datagrams and index are consistent with the Fragment's size
+	 * \return true if the overlay can be used safely on the Fragment
+	 */
+	bool consistent() const;
+
+protected:
+
+	/**
+	 * \brief Get a const pointer to the start of the payload
+	 * \return Pointer to the UDPContainerFragment::Header
+	 */
+	uint8_t const* payload_() const
+	{
+		return artdaq_Fragment_ ? reinterpret_cast<uint8_t const*>(artdaq_Fragment_->dataBeginBytes()) : payload_begin_;
+	}
+
+	/**
+	 * \brief Get the size of the payload
+	 * \return Size of the payload in bytes
+	 */
+	size_t payload_size_bytes_() const
+	{
+		return artdaq_Fragment_ ? artdaq_Fragment_->dataSizeBytes() : payload_bytes_;
+	}
+
+	/**
+	 * \brief Get a const pointer to the UDPContainerFragment::Header
+	 * \return A const pointer to the UDPContainerFragment::Header
+	 */
+	Header const* header_() const
+	{
+		return reinterpret_cast<Header const*>(payload_());
+	}
+
+	/**
+	 * \brief Get a const pointer to the first DatagramHeader
+	 * \return Pointer to just past the UDPContainerFragment::Header
+	 */
+	DatagramHeader const* first_() const
+	{
+		return reinterpret_cast<DatagramHeader const*>(header_() + 1);
+	}
+
+	/**
+	 * \brief Get a const pointer to the index
+	 * \return Pointer to the index, which is only valid if indexed()
+	 */
+	uint32_t const* index_() const
+	{
+		return reinterpret_cast<uint32_t const*>(payload_() + header_()->index_offset);
+	}
+
+private:
+
+	artdaq::Fragment const* artdaq_Fragment_; ///< The overlaid Fragment, or nullptr when overlaying a raw payload
+	uint8_t const* payload_begin_; ///< Start of the raw payload, when there is no Fragment
+	size_t payload_bytes_; ///< Size of the raw payload, when there is no Fragment
+};
+
+#endif /* artdaq_core_demo_Overlays_UDPContainerFragment_hh */
@@ -0,0 +1,198 @@
+#ifndef artdaq_core_demo_Overlays_UDPContainerFragmentWriter_hh
+#define artdaq_core_demo_Overlays_UDPContainerFragmentWriter_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/UDPContainerFragment.hh"
+
+#include "cetlib/exception.h"
+
+#include <cstring>
+#include <limits>
+
+namespace demo
+{
+	class UDPContainerFragmentWriter;
+}
+
+/**
+ * \brief Class derived from UDPContainerFragment which appends datagrams to the Fragment
+ *
+ * The Fragment's payload is grown by doubling, so appending costs amortized constant time,
+ * and datagrams can be received directly into the space append() returns. finalize() writes
+ * the index and trims the payload to what is used. As in the other writers, the non-const
+ * members hide the const members of the parent class.
+ */
+class demo::UDPContainerFragmentWriter: public demo::UDPContainerFragment
+{
+public:
+
+	/**
+	 * \brief UDPContainerFragmentWriter constructor
+	 * \param f The artdaq::Fragment to overlay
+	 * \param reserveBytes Payload bytes to allocate up front, to avoid growing it later
+	 * \throws cet::exception if the Fragment already has a payload
+	 */
+	explicit UDPContainerFragmentWriter(artdaq::Fragment& f, size_t reserveBytes = 0);
+
+	/**
+	 * \brief Append a datagram without its data
+	 * \param nBytes Size of the datagram
+	 * \param port The port on which the datagram was received
+	 * \param address The IPv4 address the datagram was received on
+	 * \param timestamp When the datagram was received
+	 * \return Where to write the datagram's nBytes of data. This is invalidated by the next append().
+	 * \throws cet::exception if the datagram is too large, or finalize() has been called
+	 *
+	 * To receive into the Fragment, append the largest size expected, receive into the
+	 * returned space, then truncateLast() to the size received.
+	 */
+	uint8_t* append(size_t nBytes, uint16_t port, uint32_t address, uint64_t timestamp);
+
+	/**
+	 * \brief Append a datagram, copying its data
+	 * \param data The datagram
+	 * \param nBytes Size of the datagram
+	 * \param port The port on which the datagram was received
+	 * \param address The IPv4 address the datagram was received on
+	 * \param timestamp When the datagram was received
+	 */
+	void append(void const* data, size_t nBytes, uint16_t port, uint32_t address, uint64_t timestamp)
+	{
+		memcpy(append(nBytes, port, address, timestamp), data, nBytes);
+	}
+
+	/**
+	 * \brief Shrink the last datagram appended
+	 * \param nBytes New size of the datagram, no larger than it was
+	 */
+	void truncateLast(size_t nBytes);
+
+	/**
+	 * \brief Write the index of the datagrams and release unused space
+	 *
+	 * No more datagrams can be appended afterwards.
+	 */
+	void finalize();
+
+	/**
+	 * \brief Get a pointer to the UDPContainerFragment::Header object for writing
+	 * \return A pointer to the UDPContainerFragment::Header object
+	 */
+	Header* header_()
+	{
+		assert(artdaq_Fragment_.dataSizeBytes() >= sizeof(Header));
+		return reinterpret_cast<Header*>(artdaq_Fragment_.dataBeginBytes());
+	}
+
+private:
+	/**
+	 * \brief Get a pointer to the start of the payload for writing
+	 * \return Pointer to the UDPContainerFragment::Header
+	 */
+	uint8_t* payload_()
+	{
+		return reinterpret_cast<uint8_t*>(artdaq_Fragment_.dataBeginBytes());
+	}
+
+	/**
+	 * \brief Make sure the payload has room for the given number of bytes, at least doubling it if it has to grow
+	 * \param nBytes Payload bytes needed
+	 */
+	void reserve_(size_t nBytes);
+
+	size_t last_offset_; ///< Byte offset of the last DatagramHeader, or 0 if none has been appended
+
+	// Note that this non-const reference hides the const reference in the base class
+	artdaq::Fragment& artdaq_Fragment_;
+};
+
+inline demo::UDPContainerFragmentWriter::UDPContainerFragmentWriter(artdaq::Fragment& f, size_t reserveBytes) :
+	UDPContainerFragment(f)
+	, last_offset_(0)
+	, artdaq_Fragment_(f)
+{
+	if (f.dataSizeBytes() > 0)
+	{
+		throw cet::exception("Error in UDPContainerFragmentWriter: Raw artdaq::Fragment object already has a payload");
+	}
+
+	artdaq_Fragment_.resizeBytes(reserveBytes > sizeof(Header) ? reserveBytes : sizeof(Header));
+	memset(header_(), 0, sizeof(Header));
+	header_()->used_bytes = sizeof(Header);
+}
+
+inline void demo::UDPContainerFragmentWriter::reserve_(size_t nBytes)
+{
+	if (nBytes > std::numeric_limits<Header::data_t>::max())
+	{
+		throw cet::exception("UDPContainerFragmentWriter") << "Payload of " << nBytes << " bytes is too large for a UDPContainerFragment";
+	}
+
+	size_t const capacity = artdaq_Fragment_.dataSizeBytes();
+	if (nBytes > capacity)
+	{
+		artdaq_Fragment_.resizeBytes(nBytes > 2 * capacity ? nBytes : 2 * capacity);
+	}
+}
+
+inline uint8_t* demo::UDPContainerFragmentWriter::append(size_t nBytes, uint16_t port, uint32_t address, uint64_t timestamp)
+{
+	if (nBytes > max_datagram_bytes)
+	{
+		throw cet::exception("UDPContainerFragmentWriter") << "Datagram of " << nBytes << " bytes is larger than the maximum of " << max_datagram_bytes;
+	}
+	if (header_()->index_offset != 0)
+	{
+		throw cet::exception("UDPContainerFragmentWriter") << "Cannot append to a finalized UDPContainerFragment";
+	}
+
+	size_t const offset = header_()->used_bytes;
+	size_t const padded = padded_size(nBytes);
+	reserve_(offset + sizeof(DatagramHeader) + padded);
+
+	auto dh = reinterpret_cast<DatagramHeader*>(payload_() + offset);
+	dh->timestamp = timestamp;
+	dh->address = address;
+	dh->port = port;
+	dh->size = nBytes;
+
+	uint8_t* data = reinterpret_cast<uint8_t*>(dh + 1);
+	memset(data + nBytes, 0, padded - nBytes);
+
+	Header* h = header_();
+	h->used_bytes = offset + sizeof(DatagramHeader) + padded;
+	++h->n_datagrams;
+	last_offset_ = offset;
+	return data;
+}
+
+inline void demo::UDPContainerFragmentWriter::truncateLast(size_t nBytes)
+{
+	assert(last_offset_ != 0);
+	auto dh = reinterpret_cast<DatagramHeader*>(payload_() + last_offset_);
+	assert(nBytes <= dh->size);
+
+	dh->size = nBytes;
+	size_t const padded = padded_size(nBytes);
+	memset(reinterpret_cast<uint8_t*>(dh + 1) + nBytes, 0, padded - nBytes);
+	header_()->used_bytes = last_offset_ + sizeof(DatagramHeader) + padded;
+}
+
+inline void demo::UDPContainerFragmentWriter::finalize()
+{
+	if (header_()->index_offset != 0) return;
+
+	size_t const index_offset = header_()->used_bytes;
+	size_t const n = header_()->n_datagrams;
+	artdaq_Fragment_.resizeBytes(index_offset + n * sizeof(uint32_t));
+
+	auto index = reinterpret_cast<uint32_t*>(payload_() + index_offset);
+	size_t i = 0;
+	for (auto it = begin(); it != end(); ++it)
+	{
+		index[i++] = (*it).dataBegin() - sizeof(DatagramHeader) - payload_();
+	}
+	header_()->index_offset = index_offset;
+}
+
+#endif /* artdaq_core_demo_Overlays_UDPContainerFragmentWriter_hh */
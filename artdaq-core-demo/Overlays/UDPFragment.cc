@@ -1,12 +1,64 @@
 #include "artdaq-core-demo/Overlays/UDPFragment.hh"
 
+#include "cetlib/exception.h"
+
+#include <algorithm>
+#include <cstring>
+
+demo::JSONReader demo::UDPFragment::json() const
+{
+	if (data_type() != DataType::JSON)
+	{
+		throw cet::exception("UDPFragment") << "Payload data type is " << hdr_data_type() << ", not JSON";
+	}
+	return JSONReader(textBegin(), textEnd());
+}
+
+size_t demo::UDPFragment::decompress_into(uint8_t* out, size_t capacity) const
+{
+	if (compressed())
+	{
+		return decompressPayload(stored_begin_(), std::min(stored_bytes_(), payload_size_bytes_() - sizeof(Header)), out, capacity);
+	}
+
+	size_t const n = udp_data_words() * bytes_per_word_();
+	if (n > capacity)
+	{
+		throw cet::exception("UDPFragment") << "Payload of " << n << " bytes doesn't fit in " << capacity;
+	}
+	memcpy(out, dataBegin(), n);
+	return n;
+}
+
+bool demo::UDPFragment::checksum_span(ChecksumSpan& span) const
+{
+	if (!checksummed()) return false;
+
+	span.begin = payload_();
+	span.bytes = hdr_event_size() * bytes_per_word_();
+	span.complete = hdr_event_size() >= hdr_size_words() && span.bytes + sizeof(span.expected) <= payload_size_bytes_();
+	span.expected = 0;
+	if (span.complete) memcpy(&span.expected, span.begin + span.bytes, sizeof span.expected);
+	return true;
+}
+
+uint8_t const* demo::UDPFragment::inflated_begin_() const
+{
+	// Don't trust event_size to stay within the payload. The decompressed payload is
+	// padded with NULs to whole words, as it would be if it were stored uncompressed.
+	size_t const stored = std::min(stored_bytes_(), payload_size_bytes_() - sizeof(Header));
+	return inflated_.get(stored_begin_(), stored, udp_data_words() * bytes_per_word_());
+}
+
 std::ostream& demo::operator <<(std::ostream& os, UDPFragment const& f)
 {
 	os << "UDPFragment_event_size: "
 		<< f.hdr_event_size()
 		<< ", data_type: "
-		<< f.hdr_data_type()
-		<< "\n";
+		<< f.hdr_data_type();
+	if (f.compressed()) os << ", compressed payload bytes: " << f.udp_data_words() * sizeof(UDPFragment::Header::data_t);
+	if (f.checksummed()) os << ", checksum " << (f.checksum_ok() ? "good" : "bad");
+	os << "\n";
 
 	return os;
 }
@@ -2,6 +2,10 @@
 #define artdaq_core_demo_Overlays_UDPFragment_hh
 
 #include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core-demo/Overlays/Checksum.hh"
+#include "artdaq-core-demo/Overlays/CompressedPayload.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/JSONReader.hh"
 
 #include <ostream>
 
@@ -17,6 +21,26 @@ namespace demo
 
 /**
  * \brief A Fragment designed to contain data received from the network in UDP datagrams
+ *
+ * The datagram may be stored compressed (see CompressedPayload.hh), and the Fragment may carry a
+ * CRC-32C of the Header and the stored payload (see Checksum.hh), kept in the word after the
+ * Header::event_size words and checked by checksum_ok(). Both are marked by flags in the high bits
+ * of the Header::type field, the low bits of which hold the DataType, and the Fragment type stays
+ * FragmentType::UDP:
+ *
+ * | Header::type bits             | Meaning                          |
+ * | ----------------------------- | -------------------------------- |
+ * | Header::data_type_mask, 0x3   | The DataType                     |
+ * | Header::checksummed_flag, 0x4 | A CRC-32C follows the payload    |
+ * | Header::compressed_flag, 0x8  | The payload is stored compressed |
+ *
+ * Writers from before the flags existed only stored a DataType, 0, 1 or 2, in the field, so their
+ * flag bits are clear. Unlike AsciiFragment, the Header has no spare bits that old writers may have
+ * left holding anything, so it needs no format marker to say the flags are meaningful.
+ *
+ * Readers of this overlay needn't care about compression: dataBegin() decompresses the datagram into
+ * the overlay the first time it is called. An overlay that has done so doesn't see later changes to a
+ * compressed datagram.
  */
 class demo::UDPFragment
 {
@@ -27,15 +51,16 @@ public:
 	*
 	* The AsciiFragment::Metadata struct is used to store information about the
 	* upstream environment from where the fragment came. In the case of UDPFragment,
-	* this is the port and address at which the data was received.
+	* this is the local port and address at which the data was received, in host and network
+	* byte order respectively, not those of the sender.
 	*/
 	struct Metadata
 	{
 		typedef uint64_t data_t; ///< The fundamental unit of Metadata data
 
-		data_t port : 16; ///< The port on which the data was received
-		data_t address : 32; ///< The IPv4 address the data was received on
-		data_t unused : 16; ///< Unused bits of the data_t field
+		data_t port : 16; ///< The local port on which the data was received
+		data_t address : 32; ///< The local IPv4 address the data was received on, or 0 if not known
+		data_t unused : 16; ///< Unused bits of the data_t field. Old writers left them unset, so they may hold anything.
 
 		static size_t const size_words = 1ull; ///< Size of the UDPFragment::Metadata object, in units of Metadata::data_t
 	};
@@ -63,20 +88,44 @@ public:
 		typedef uint32_t data_type_t; ///< Type of the type field
 
 		event_size_t event_size : 28; ///< The size of the payload, in words
-		event_size_t type : 4; ///< The type of the payload data, 0: Raw, 1: JSON, 2: String.
+		event_size_t type : 4; ///< The type of the payload data, 0: Raw, 1: JSON, 2: String, in the data_type_mask bits, and flags
 
 		static size_t const size_words = 1ul; ///< Size of the UDPFragment::Header, in units of Header::data_t
+
+		static data_type_t const data_type_mask = 0x3; ///< The bits of the type field holding the DataType
+		static data_type_t const checksummed_flag = 0x4; ///< Set in the type field if a checksum follows the payload. Old writers only set 0, 1 or 2.
+		static data_type_t const compressed_flag = 0x8; ///< Set in the type field if the payload is stored compressed. Old writers only set 0, 1 or 2.
 	};
 
 	static_assert (sizeof(Header) == Header::size_words * sizeof(Header::data_t), "UDPFragment::Header size changed");
 
+	/**
+	 * \brief The values of the Header::type field
+	 */
+	enum class DataType : Header::data_type_t
+	{
+		Raw = 0,
+		JSON = 1,
+		String = 2
+	};
+
 	/**
 	* \brief The UDPFragment constructor
 	* \param f The raw artdaq::Fragment object to overlay
 	*
 	* The constructor simply sets its const private member "artdaq_Fragment_" to refer to the artdaq::Fragment object
 	*/
-	explicit UDPFragment(artdaq::Fragment const& f) : artdaq_Fragment_(f) {}
+	explicit UDPFragment(artdaq::Fragment const& f)
+		: artdaq_Fragment_(&f), payload_begin_(nullptr), payload_bytes_(0), payload_metadata_(nullptr) {}
+
+	/**
+	 * \brief Overlay a payload that isn't in an artdaq::Fragment, such as one in a mapped file
+	 * \param payload Start of the payload, where the UDPFragment::Header begins
+	 * \param payloadBytes Size of the payload
+	 * \param metadata The UDPFragment::Metadata, or nullptr if there is none
+	 */
+	UDPFragment(uint8_t const* payload, size_t payloadBytes, Metadata const* metadata = nullptr)
+		: artdaq_Fragment_(nullptr), payload_begin_(payload), payload_bytes_(payloadBytes), payload_metadata_(metadata) {}
 
 	/**
 	 * \brief Get the current value of the Header::event_size field
@@ -84,32 +133,44 @@ public:
 	 */
 	Header::event_size_t hdr_event_size() const { return header_()->event_size; }
 	/**
-	 * \brief Get the current value of the Header::type field
-	 * \return The current value of the Header::type field (const)
+	 * \brief Get the current value of the Header::type field, without its flags
+	 * \return The current value of the Header::data_type_mask bits of the Header::type field (const)
+	 */
+	Header::data_type_t hdr_data_type() const { return header_()->type & Header::data_type_mask; }
+	/**
+	 * \brief Get the type of the payload data
+	 * \return hdr_data_type() as a DataType
 	 */
-	Header::data_type_t hdr_data_type() const { return header_()->type; }
+	DataType data_type() const { return static_cast<DataType>(hdr_data_type()); }
 	/**
 	* \brief Gets the size_words variable from the artdaq::Header
 	* \return The size of the Fragment payload
 	*/
 	static constexpr size_t hdr_size_words() { return Header::size_words; }
 
+	/**
+	 * \brief Whether the payload is stored compressed
+	 * \return Whether Header::compressed_flag is set in the Header::type field
+	 */
+	bool compressed() const { return (header_()->type & Header::compressed_flag) != 0; }
+
 	/**
 	 * \brief Get the number of words in the UDPFragment payload
-	 * \return The number of Header::data_t words in the UDPFragment payload (const)
+	 * \return The number of Header::data_t words in the UDPFragment payload (const), after decompressing it if it is compressed
 	 */
 	size_t udp_data_words() const
 	{
-		return hdr_event_size() - hdr_size_words();
+		return compressed() ? (compressedPayloadRawBytes(stored_begin_(), stored_bytes_()) + bytes_per_word_() - 1) / bytes_per_word_()
+		                    : hdr_event_size() - hdr_size_words();
 	}
 
 	/**
 	 * \brief Returns a const pointer to the start of the UDP payload
-	 * \return const byte pointer to the start of the UDP payload
+	 * \return const byte pointer to the start of the UDP payload. A compressed payload is decompressed the first time.
 	 */
 	uint8_t const* dataBegin() const
 	{
-		return reinterpret_cast<uint8_t const *>(header_() + 1);
+		return compressed() ? inflated_begin_() : reinterpret_cast<uint8_t const *>(header_() + 1);
 	}
 
 	/**
@@ -121,6 +182,83 @@ public:
 		return dataBegin() + udp_data_words() * bytes_per_word_();
 	}
 
+	/**
+	 * \brief Returns a pointer to the start of a String or JSON payload
+	 * \return const char pointer to the start of the UDP payload
+	 */
+	char const* textBegin() const
+	{
+		return reinterpret_cast<char const*>(dataBegin());
+	}
+
+	/**
+	 * \brief Returns a pointer to the end of a String or JSON payload, before any NUL padding
+	 * \return const char pointer to the end of the text
+	 *
+	 * The payload is a whole number of words, so text is padded (or terminated) with NULs,
+	 * which are not part of the text.
+	 */
+	char const* textEnd() const
+	{
+		char const* b = textBegin();
+		char const* e = reinterpret_cast<char const*>(dataEnd());
+		while (e != b && e[-1] == '\0') --e;
+		return e;
+	}
+
+	/**
+	 * \brief Get a streaming parser over a JSON payload
+	 * \return A JSONReader over the text of the payload
+	 * \exception cet::exception if the payload isn't JSON
+	 */
+	JSONReader json() const;
+
+	/**
+	 * \brief Find a value in a JSON payload, without copying or allocating
+	 * \param path Keys separated by '.', e.g. "status.voltage"
+	 * \param value Set to the value found, pointing into the payload
+	 * \return false if the payload isn't JSON, is malformed, or doesn't have the value
+	 */
+	bool jsonValue(char const* path, JSONValue& value) const
+	{
+		return data_type() == DataType::JSON && findJSONValue(textBegin(), textEnd(), path, value);
+	}
+
+	/**
+	 * \brief Copy the payload into a buffer of the caller's, decompressing it if it is compressed
+	 * \param out Where to put the payload
+	 * \param capacity Number of bytes there is room for at out
+	 * \return The number of bytes written: for a compressed payload, its size before compression,
+	 * otherwise udp_data_words() words
+	 * \exception cet::exception if the payload doesn't fit, or is compressed and corrupt
+	 *
+	 * Unlike dataBegin(), this doesn't keep a decompressed copy in the overlay.
+	 */
+	size_t decompress_into(uint8_t* out, size_t capacity) const;
+
+	/**
+	 * \brief Whether the Fragment carries a checksum
+	 * \return Whether Header::checksummed_flag is set in the Header::type field
+	 */
+	bool checksummed() const { return (header_()->type & Header::checksummed_flag) != 0; }
+
+	/**
+	 * \brief Find what the checksum covers: the Header and the payload as stored
+	 * \param span Set to the bytes covered and the checksum after them, if there is one
+	 * \return false if the Fragment has no checksum
+	 */
+	bool checksum_span(ChecksumSpan& span) const;
+
+	/**
+	 * \brief Check the checksum
+	 * \return true if the Header and payload match the checksum, or there is no checksum
+	 */
+	bool checksum_ok() const
+	{
+		ChecksumSpan span;
+		return !checksum_span(span) || checksumMatches(span);
+	}
+
 protected:
 	
 	/**
@@ -142,12 +280,70 @@ protected:
 	 */
 	Header const* header_() const
 	{
-		return reinterpret_cast<UDPFragment::Header const *>(artdaq_Fragment_.dataBeginBytes());
+		return reinterpret_cast<UDPFragment::Header const *>(payload_());
+	}
+
+	/**
+	 * \brief Get the start of the payload, from the artdaq::Fragment if there is one
+	 * \return Pointer to the start of the payload
+	 *
+	 * This is looked up each time, rather than saved, so that it follows the Fragment when a writer resizes it.
+	 */
+	uint8_t const* payload_() const
+	{
+		return artdaq_Fragment_ ? reinterpret_cast<uint8_t const*>(artdaq_Fragment_->dataBeginBytes()) : payload_begin_;
+	}
+
+	/**
+	 * \brief Get the size of the payload
+	 * \return Size of the payload in bytes
+	 */
+	size_t payload_size_bytes_() const
+	{
+		return artdaq_Fragment_ ? artdaq_Fragment_->dataSizeBytes() : payload_bytes_;
+	}
+
+	/**
+	 * \brief Get the UDPFragment::Metadata
+	 * \return Pointer to the Metadata, or nullptr if there is none
+	 */
+	Metadata const* metadata_() const
+	{
+		if (!artdaq_Fragment_) return payload_metadata_;
+		return artdaq_Fragment_->hasMetadata() ? artdaq_Fragment_->metadata<Metadata>() : nullptr;
+	}
+
+	/**
+	 * \brief Get the start of the payload as stored, which may be compressed
+	 * \return Pointer to the byte after the UDPFragment::Header
+	 */
+	uint8_t const* stored_begin_() const
+	{
+		return reinterpret_cast<uint8_t const*>(header_() + 1);
+	}
+
+	/**
+	 * \brief Get the size of the payload as stored, according to the Header::event_size
+	 * \return Number of bytes stored after the UDPFragment::Header
+	 */
+	size_t stored_bytes_() const
+	{
+		return (hdr_event_size() - hdr_size_words()) * bytes_per_word_();
 	}
 
 private:
 
-	artdaq::Fragment const& artdaq_Fragment_;
+	/**
+	 * \brief Decompress the payload into the overlay, if that hasn't been done yet
+	 * \return Start of the decompressed payload
+	 */
+	uint8_t const* inflated_begin_() const;
+
+	artdaq::Fragment const* artdaq_Fragment_; ///< The overlaid Fragment, or nullptr when overlaying a raw payload
+	uint8_t const* payload_begin_; ///< Start of the raw payload, when there is no Fragment
+	size_t payload_bytes_; ///< Size of the raw payload, when there is no Fragment
+	Metadata const* payload_metadata_; ///< Metadata of the raw payload, when there is no Fragment
+	detail::LazyInflation inflated_; ///< The decompressed payload, once dataBegin() has been called on a compressed one
 };
 
 #endif /* artdaq_core_ots_Overlays_UDPFragment_hh */
@@ -3,6 +3,10 @@
 
 #include "artdaq-core/Data/Fragment.hh"
 #include "artdaq-core-demo/Overlays/UDPFragment.hh"
+#include "artdaq-core-demo/Overlays/FragmentPool.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#include <cstring>
 
 namespace demo
 {
@@ -33,6 +37,15 @@ public:
 	 * \throws cet::exception if the Fragment does not contain UDPFragment::Metadata and nothing else
 	 */
 	explicit UDPFragmentWriter(artdaq::Fragment& f);
+
+	/**
+	 * \brief UDPFragmentWriter constructor for a Fragment whose UDPFragment::Header is already allocated
+	 * \param f artdaq::Fragment object to overlay, such as one from FragmentPool::acquire()
+	 * \throws cet::exception if input Fragment does not contain UDPFragment::Metadata, or is too small for the UDPFragment::Header
+	 *
+	 * Any payload beyond the UDPFragment::Header is dropped, keeping its storage, and the UDPFragment::Header is zeroed.
+	 */
+	UDPFragmentWriter(artdaq::Fragment& f, HeaderReserved);
 	
 	/**
 	 * \brief Get a pointer to the start of the UDP payload
@@ -57,21 +70,60 @@ public:
 	}
 
 	/**
-	 * \brief Setter for the Header::type field
-	 * \param dataType Value to set to Header::type
+	 * \brief Setter for the data type in the Header::type field, keeping its flags
+	 * \param dataType Value to set to the Header::data_type_mask bits of Header::type
 	 */
 	void set_hdr_type(Header::data_type_t dataType)
 	{
-		header_()->type = dataType & 0xF;
+		header_()->type = (header_()->type & ~Header::data_type_mask) | (dataType & Header::data_type_mask);
 	}
 
 	/**
-	 * \brief Resize the UDP payload to the given number of bytes
+	 * \brief Resize the UDP payload to the given number of bytes, stored uncompressed
 	 * \param nBytes Number of bytes to request for the UDP payload
+	 *
+	 * The bytes after the first nBytes, up to the end of the last word, are set to NUL, so that
+	 * textEnd() doesn't take in whatever a larger payload left there.
 	 */
 	void resize(size_t nBytes);
 
+	/**
+	 * \brief Store a payload compressed, instead of calling resize() and writing to dataBegin()
+	 * \param data The payload
+	 * \param nBytes Size of the payload
+	 * \return true if the payload was stored compressed, false if it was stored as it is because compressing didn't make it smaller
+	 *
+	 * The payload is compressed straight into the Fragment, which is grown to the largest size the
+	 * compressed payload could be and then shrunk to fit. Afterwards, dataBegin() and dataEnd() of the
+	 * writer are those of the stored, compressed bytes.
+	 *
+	 * If the payload is stored compressed, Header::compressed_flag is set in Header::type, and
+	 * resize() clears it again.
+	 */
+	bool write_compressed(uint8_t const* data, size_t nBytes);
+
+	/**
+	 * \brief Store a checksum of the Header and the payload, as stored, after them
+	 *
+	 * Call this once the payload and Header::type are written. The Fragment grows by a word to
+	 * hold the checksum, and Header::checksummed_flag is set in Header::type, before the checksum
+	 * is taken. resize() and write_compressed() drop it, and writing to the payload or
+	 * set_hdr_type() afterwards makes it wrong.
+	 */
+	void write_checksum();
+
 private:
+	/**
+	 * \brief Mark the payload as stored compressed and checksummed or not, by the flags in Header::type
+	 * \param compressed Whether the payload is stored compressed
+	 * \param checksummed Whether a checksum follows the payload
+	 */
+	void set_flags_(bool compressed, bool checksummed)
+	{
+		header_()->type = (header_()->type & Header::data_type_mask) |
+		                  (compressed ? Header::compressed_flag : 0) | (checksummed ? Header::checksummed_flag : 0);
+	}
+
 	/**
 	 * \brief Calculate the size of the UDPFragment payload in Header::data_t words
 	 * \param nBytes Number of bytes in the UDP payload
@@ -101,6 +153,22 @@ inline demo::UDPFragmentWriter::UDPFragmentWriter(artdaq::Fragment& f) :
 
 	// Allocate space for the header
 	artdaq_Fragment_.resizeBytes(sizeof(Header));
+	set_flags_(false, false);
+}
+
+inline demo::UDPFragmentWriter::UDPFragmentWriter(artdaq::Fragment& f, HeaderReserved) :
+								UDPFragment(f)
+								, artdaq_Fragment_(f)
+{
+	if (! f.hasMetadata() || f.dataSizeBytes() < sizeof(Header))
+	{
+		throw cet::exception("Error in UDPFragmentWriter: Raw artdaq::Fragment object does not appear to consist of its own header + the UDPFragment::Metadata object + space for the UDPFragment::Header");
+	}
+
+	// Shrinking keeps the storage
+	artdaq_Fragment_.resizeBytes(sizeof(Header));
+	memset(header_(), 0, sizeof(Header));
+	set_flags_(false, false);
 }
 
 
@@ -113,7 +181,7 @@ inline uint8_t* demo::UDPFragmentWriter::dataBegin()
 
 inline uint8_t* demo::UDPFragmentWriter::dataEnd()
 {
-	return dataBegin() + udp_data_words() * bytes_per_word_();
+	return dataBegin() + stored_bytes_();
 }
 
 
@@ -121,6 +189,36 @@ inline void demo::UDPFragmentWriter::resize(size_t nBytes)
 {
 	artdaq_Fragment_.resizeBytes(sizeof(Header::data_t) * calc_event_size_words_(nBytes));
 	header_()->event_size = calc_event_size_words_(nBytes);
+	memset(reinterpret_cast<uint8_t*>(header_() + 1) + nBytes, 0, bytes_to_words_(nBytes) * bytes_per_word_() - nBytes);
+	set_flags_(false, false);
+}
+
+inline bool demo::UDPFragmentWriter::write_compressed(uint8_t const* data, size_t nBytes)
+{
+	size_t const bound = compressedPayloadBound(nBytes);
+	artdaq_Fragment_.resizeBytes(sizeof(Header) + bound);
+	size_t const stored = compressPayload(data, nBytes, reinterpret_cast<uint8_t*>(header_() + 1), bound);
+
+	if (stored == 0 || stored >= nBytes)
+	{
+		resize(nBytes);
+		if (nBytes > 0) memcpy(dataBegin(), data, nBytes);
+		return false;
+	}
+
+	artdaq_Fragment_.resizeBytes(sizeof(Header::data_t) * calc_event_size_words_(stored));
+	header_()->event_size = calc_event_size_words_(stored);
+	set_flags_(true, false);
+	return true;
+}
+
+inline void demo::UDPFragmentWriter::write_checksum()
+{
+	size_t const bytes = header_()->event_size * sizeof(Header::data_t);
+	artdaq_Fragment_.resizeBytes(bytes + sizeof(uint32_t));
+	set_flags_(compressed(), true);
+	uint32_t const crc = crc32c(artdaq_Fragment_.dataBeginBytes(), bytes);
+	memcpy(artdaq_Fragment_.dataBeginBytes() + bytes, &crc, sizeof crc);
 }
 
 inline size_t demo::UDPFragmentWriter::calc_event_size_words_(size_t nBytes)
@@ -0,0 +1,79 @@
+#include "benchmarks/Bench.hh"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> allocation_count(0);
+
+	void* allocate_nothrow(size_t n) noexcept
+	{
+		allocation_count.fetch_add(1, std::memory_order_relaxed);
+		return malloc(n ? n : 1);
+	}
+
+	void* allocate(size_t n)
+	{
+		void* const p = allocate_nothrow(n);
+		if (p == nullptr) throw std::bad_alloc();
+		return p;
+	}
+}
+
+// Every allocation through new goes through these, so that allocations() can count them
+void* operator new(size_t n) { return allocate(n); }
+void* operator new[](size_t n) { return allocate(n); }
+void* operator new(size_t n, std::nothrow_t const&) noexcept { return allocate_nothrow(n); }
+void* operator new[](size_t n, std::nothrow_t const&) noexcept { return allocate_nothrow(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+uint64_t demo::bench::allocations()
+{
+	return allocation_count.load(std::memory_order_relaxed);
+}
+
+demo::bench::Runner::Runner(int argc, char** argv)
+	: min_seconds_(0.5)
+{
+	std::string const min_time = "--min-time=";
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string const arg = argv[i];
+		if (arg.compare(0, min_time.size(), min_time) == 0)
+		{
+			min_seconds_ = atof(arg.c_str() + min_time.size());
+		}
+		else
+		{
+			filter_ = arg;
+		}
+	}
+	printf("%-44s %12s %12s %12s\n", "case", "ns/item", "MB/s", "allocs/item");
+}
+
+bool demo::bench::Runner::selected(std::string const& name) const
+{
+	return name.find(filter_) != std::string::npos;
+}
+
+void demo::bench::Runner::print(std::string const& name, std::string const& text) const
+{
+	printf("%-44s %s\n", name.c_str(), text.c_str());
+	fflush(stdout);
+}
+
+void demo::bench::Runner::report_(std::string const& name, double seconds, uint64_t calls, size_t items, size_t bytes,
+								  uint64_t allocs) const
+{
+	double const n = static_cast<double>(calls) * items;
+	char rate[32] = "-";
+	if (bytes > 0) snprintf(rate, sizeof rate, "%.1f", calls * static_cast<double>(bytes) / seconds / 1e6);
+	printf("%-44s %12.2f %12s %12.3f\n", name.c_str(), seconds * 1e9 / n, rate, allocs / n);
+	fflush(stdout);
+}
@@ -0,0 +1,114 @@
+#ifndef artdaq_demo_benchmarks_Bench_hh
+#define artdaq_demo_benchmarks_Bench_hh
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace demo
+{
+	namespace bench
+	{
+		class Runner;
+
+		/**
+		 * \brief Count the heap allocations made so far, by any thread
+		 * \return Number of calls to the global operator new, which Bench.cc replaces to count them
+		 */
+		uint64_t allocations();
+
+		/**
+		 * \brief Stop the compiler from optimizing away the computation of a value
+		 * \param value The value, which is treated as read and possibly written
+		 */
+		template <class T>
+		inline void keep(T const& value)
+		{
+			asm volatile("" : : "r"(&value) : "memory");
+		}
+	}
+}
+
+/**
+ * \brief Runs and reports the cases of one benchmark program
+ *
+ * A case is a body that handles a fixed set of items, such as Fragments, each time it is called.
+ * The Runner calls the body once to warm up, then repeatedly, more times at each try, until the
+ * calls take at least the minimum time. It then prints the time per item, the rate at which the
+ * items' bytes were handled, and the heap allocations per item.
+ *
+ * The programs take two optional arguments: a substring, to run only the cases whose names contain
+ * it, and --min-time=seconds, which is 0.5 by default.
+ */
+class demo::bench::Runner
+{
+public:
+	/**
+	 * \brief Read the command line and print the column headings
+	 * \param argc As passed to main()
+	 * \param argv As passed to main()
+	 */
+	Runner(int argc, char** argv);
+
+	/**
+	 * \brief Time a case, if the filter selects it
+	 * \param name Name to report the case as
+	 * \param items Number of items the body handles each time it is called
+	 * \param bytes Number of bytes the body handles each time it is called, or 0 to report no rate
+	 * \param body Called with no arguments
+	 */
+	template <class Body>
+	void run(std::string const& name, size_t items, size_t bytes, Body body);
+
+	/**
+	 * \brief Whether the filter selects a case, for cases that do their own timing
+	 * \param name Name of the case
+	 * \return true if the case is to be run
+	 */
+	bool selected(std::string const& name) const;
+
+	/**
+	 * \brief Report a case that did its own timing
+	 * \param name Name of the case
+	 * \param text What to report after the name
+	 */
+	void print(std::string const& name, std::string const& text) const;
+
+	double min_seconds() const { return min_seconds_; } ///< The least time to spend on each case
+
+private:
+	void report_(std::string const& name, double seconds, uint64_t calls, size_t items, size_t bytes,
+				 uint64_t allocs) const;
+
+	std::string filter_;
+	double min_seconds_;
+};
+
+template <class Body>
+void demo::bench::Runner::run(std::string const& name, size_t items, size_t bytes, Body body)
+{
+	if (!selected(name)) return;
+
+	body();
+	uint64_t calls = 1;
+	for (;;)
+	{
+		uint64_t const allocs = allocations();
+		auto const start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < calls; ++i) body();
+		double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		uint64_t const allocated = allocations() - allocs;
+
+		if (seconds >= min_seconds_)
+		{
+			report_(name, seconds, calls, items, bytes, allocated);
+			return;
+		}
+
+		// Aim a little past the minimum time, growing at most tenfold at once
+		double const scale = seconds > 0 ? 1.2 * min_seconds_ / seconds : 10;
+		calls = static_cast<uint64_t>(calls * (scale < 10 ? scale : 10)) + 1;
+	}
+}
+
+#endif /* artdaq_demo_benchmarks_Bench_hh */
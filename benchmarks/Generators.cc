@@ -0,0 +1,99 @@
+#include "benchmarks/Generators.hh"
+
+#include "artdaq-core-demo/Overlays/AsciiFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTTimestamp.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/UDPFragmentWriter.hh"
+
+#include <cstring>
+#include <random>
+
+namespace
+{
+	// Printable text, with a newline about every 80 characters
+	void fillText(char* p, size_t n, std::mt19937& rng)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			p[i] = rng() % 80 == 0 ? '\n' : static_cast<char>(' ' + rng() % 95);
+		}
+	}
+}
+
+std::vector<artdaq::Fragment> demo::bench::crtFragments(size_t n, unsigned int nhit, unsigned int seed, bool checksum)
+{
+	std::mt19937 rng(seed);
+	std::vector<artdaq::Fragment> frags;
+	frags.reserve(n);
+
+	int32_t unixtime = CRT::earliest_unixtime + 1000;
+	uint32_t fifty_mhz_time = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		fifty_mhz_time += 1 + rng() % 50000;
+		if (fifty_mhz_time >= CRT::ticks_per_second)
+		{
+			fifty_mhz_time -= CRT::ticks_per_second;
+			++unixtime;
+		}
+
+		frags.emplace_back(i, 0, demo::FragmentType::CRT);
+		unsigned int const hits = nhit ? nhit : 1 + rng() % CRT::max_hits;
+		CRT::FragmentWriter writer(frags.back(), i % 32, unixtime, fifty_mhz_time, hits);
+		for (unsigned int h = 0; h < hits; ++h)
+		{
+			writer.add_hit(rng() % CRT::n_channels, rng() % CRT::adc_limit);
+		}
+		writer.finalize(checksum);
+	}
+	return frags;
+}
+
+std::vector<artdaq::Fragment> demo::bench::asciiFragments(size_t n, size_t nChars, unsigned int seed, bool checksum)
+{
+	std::mt19937 rng(seed);
+	std::vector<artdaq::Fragment> frags;
+	frags.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		AsciiFragment::Metadata metadata;
+		metadata.charsInLine = nChars;
+		frags.emplace_back(0, i, 0, demo::FragmentType::ASCII, metadata);
+		AsciiFragmentWriter writer(frags.back());
+		writer.set_hdr_line_number(i);
+		writer.resize(nChars);
+		fillText(writer.dataBegin(), nChars, rng);
+		if (checksum) writer.write_checksum();
+	}
+	return frags;
+}
+
+std::vector<artdaq::Fragment> demo::bench::udpFragments(size_t n, size_t nBytes, unsigned int seed, bool checksum)
+{
+	std::mt19937 rng(seed);
+	std::vector<artdaq::Fragment> frags;
+	frags.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		UDPFragment::Metadata metadata;
+		memset(&metadata, 0, sizeof metadata);
+		metadata.port = 6343;
+		frags.emplace_back(0, i, 0, demo::FragmentType::UDP, metadata);
+		UDPFragmentWriter writer(frags.back());
+		writer.set_hdr_type(static_cast<UDPFragment::Header::data_type_t>(UDPFragment::DataType::String));
+		writer.resize(nBytes);
+		fillText(reinterpret_cast<char*>(writer.dataBegin()), nBytes, rng);
+		if (checksum) writer.write_checksum();
+	}
+	return frags;
+}
+
+size_t demo::bench::payloadBytes(std::vector<artdaq::Fragment> const& frags)
+{
+	size_t bytes = 0;
+	for (auto const& frag : frags) bytes += frag.dataSizeBytes();
+	return bytes;
+}
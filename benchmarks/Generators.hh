@@ -0,0 +1,55 @@
+#ifndef artdaq_demo_benchmarks_Generators_hh
+#define artdaq_demo_benchmarks_Generators_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+
+#include <vector>
+
+/**
+ * Synthetic Fragments for the benchmarks, made with the package's own writers so that they are
+ * laid out exactly as real ones. The same seed always gives the same Fragments.
+ */
+namespace demo
+{
+	namespace bench
+	{
+		/**
+		 * \brief Make CRT Fragments with CRT::FragmentWriter
+		 * \param n Number of Fragments
+		 * \param nhit Hits in each Fragment, from 1 to CRT::max_hits, or 0 for a random number in that range
+		 * \param seed Seed for the channels, ADC values and hit counts
+		 * \param checksum Whether to give each Fragment a checksum trailer
+		 * \return Good CRT Fragments from modules 0 to 31, in time order
+		 */
+		std::vector<artdaq::Fragment> crtFragments(size_t n, unsigned int nhit, unsigned int seed = 1, bool checksum = false);
+
+		/**
+		 * \brief Make ASCII Fragments with AsciiFragmentWriter
+		 * \param n Number of Fragments
+		 * \param nChars Characters in each line, printable and broken by a newline about every 80
+		 * \param seed Seed for the text
+		 * \param checksum Whether to give each Fragment a checksum
+		 * \return ASCII Fragments with consecutive line numbers
+		 */
+		std::vector<artdaq::Fragment> asciiFragments(size_t n, size_t nChars, unsigned int seed = 1, bool checksum = false);
+
+		/**
+		 * \brief Make UDP Fragments with UDPFragmentWriter
+		 * \param n Number of Fragments
+		 * \param nBytes Bytes in each datagram, up to 9000 for jumbo frames
+		 * \param seed Seed for the payloads
+		 * \param checksum Whether to give each Fragment a checksum
+		 * \return UDP Fragments of type String holding printable text
+		 */
+		std::vector<artdaq::Fragment> udpFragments(size_t n, size_t nBytes, unsigned int seed = 1, bool checksum = false);
+
+		/**
+		 * \brief Add up the payload sizes of some Fragments
+		 * \param frags The Fragments
+		 * \return Total of their dataSizeBytes()
+		 */
+		size_t payloadBytes(std::vector<artdaq::Fragment> const& frags);
+	}
+}
+
+#endif /* artdaq_demo_benchmarks_Generators_hh */
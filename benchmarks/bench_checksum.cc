@@ -0,0 +1,73 @@
+// Benchmarks of the CRC-32C checksums: crc32c() over buffers of many sizes, crc32cBatch() against
+// crc32c() one buffer at a time, and verifyChecksums() over checksummed Fragments of each type.
+// crc32c/software runs the table lookup, to compare with the crc32 instruction where the CPU
+// has it. See Bench.hh for how to run them.
+
+#include "benchmarks/Bench.hh"
+#include "benchmarks/Generators.hh"
+
+#include "artdaq-core-demo/Overlays/Checksum.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+
+	std::mt19937 rng(1);
+	std::vector<uint8_t> data(1 << 20);
+	for (auto& b : data) b = static_cast<uint8_t>(rng());
+
+	for (size_t const n : {16u, 64u, 256u, 1472u, 9000u, 65536u, 1u << 20})
+	{
+		size_t const count = std::max<size_t>(1, (1 << 20) / n);
+		runner.run("crc32c/" + std::to_string(n), count, count * n, [&] {
+			uint32_t crc = 0;
+			for (size_t i = 0; i < count; ++i) crc ^= demo::crc32c(data.data() + i * n, n);
+			demo::bench::keep(crc);
+		});
+		runner.run("crc32c/software/" + std::to_string(n), count, count * n, [&] {
+			uint32_t crc = 0;
+			for (size_t i = 0; i < count; ++i) crc ^= demo::detail::crc32cSoftware(data.data() + i * n, n);
+			demo::bench::keep(crc);
+		});
+	}
+
+	// Many short buffers, like the Fragments of a CRT batch
+	for (size_t const n : {24u, 272u})
+	{
+		size_t const count = 3000;
+		std::vector<uint8_t const*> buffers;
+		std::vector<size_t> sizes(count, n);
+		for (size_t i = 0; i < count; ++i) buffers.push_back(data.data() + i * n);
+		std::vector<uint32_t> crcs(count);
+
+		runner.run("crc32c/one by one/" + std::to_string(n), count, count * n, [&] {
+			for (size_t i = 0; i < count; ++i) crcs[i] = demo::crc32c(buffers[i], sizes[i]);
+		});
+		runner.run("crc32cBatch/" + std::to_string(n), count, count * n, [&] {
+			demo::crc32cBatch(buffers.data(), sizes.data(), count, crcs.data());
+		});
+	}
+
+	std::vector<std::pair<std::string, std::vector<artdaq::Fragment>>> sets;
+	sets.emplace_back("CRT/1-64", demo::bench::crtFragments(1000, 0, 1, true));
+	sets.emplace_back("ASCII/80", demo::bench::asciiFragments(1000, 80, 1, true));
+	sets.emplace_back("UDP/1472", demo::bench::udpFragments(1000, 1472, 1, true));
+	sets.emplace_back("UDP/9000", demo::bench::udpFragments(1000, 9000, 1, true));
+	for (auto const& set : sets)
+	{
+		auto const& frags = set.second;
+		std::vector<artdaq::Fragment const*> pointers;
+		for (auto const& frag : frags) pointers.push_back(&frag);
+		std::vector<demo::ChecksumStatus> status(frags.size());
+		runner.run("verifyChecksums/" + set.first, frags.size(), demo::bench::payloadBytes(frags), [&] {
+			demo::bench::keep(demo::verifyChecksums(pointers.data(), pointers.size(), status.data()));
+		});
+		if (status[0] != demo::ChecksumStatus::Good) runner.print("verifyChecksums/" + set.first, "checksums not found");
+	}
+	return 0;
+}
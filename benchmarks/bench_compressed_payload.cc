@@ -0,0 +1,119 @@
+// Benchmarks of the compressed payloads: the ratio and speed of compressPayload() and
+// decompressPayload() on JSON-like text, as a slow-controls stream sends, and on random printable
+// text, which hardly compresses; and reading AsciiFragments stored compressed against stored as they
+// are. Bytes are those of the uncompressed text. See Bench.hh for how to run them.
+
+#include "benchmarks/Bench.hh"
+
+#include "artdaq-core-demo/Overlays/AsciiFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CompressedPayload.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// n bytes of one-line JSON records of a few readings each
+	std::string jsonText(size_t n, std::mt19937& rng)
+	{
+		std::string text;
+		char record[256];
+		for (unsigned int i = 0; text.size() < n; ++i)
+		{
+			snprintf(record, sizeof record,
+					 "{\"run\": 1042, \"event\": %u, \"crate\": %u, \"status\": {\"voltage\": %.2f, \"current\": %.3f, "
+					 "\"temperature\": %.1f, \"ok\": %s}, \"channels\": [%u, %u, %u]}\n",
+					 i, static_cast<unsigned>(rng() % 8), 1500 + (rng() % 1000) / 100., (rng() % 10000) / 1000.,
+					 20 + (rng() % 100) / 10., rng() % 50 ? "true" : "false", static_cast<unsigned>(rng() % 64),
+					 static_cast<unsigned>(rng() % 64), static_cast<unsigned>(rng() % 64));
+			text += record;
+		}
+		text.resize(n);
+		return text;
+	}
+
+	// n bytes of random printable characters
+	std::string randomText(size_t n, std::mt19937& rng)
+	{
+		std::string text(n, ' ');
+		for (auto& c : text) c = static_cast<char>(' ' + rng() % 95);
+		return text;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+	size_t const total = 1 << 20;
+
+	std::mt19937 rng(1);
+	std::vector<std::pair<std::string, std::string>> texts;
+	texts.emplace_back("json", jsonText(total, rng));
+	texts.emplace_back("random", randomText(total, rng));
+
+	for (auto const& text : texts)
+	{
+		uint8_t const* const raw = reinterpret_cast<uint8_t const*>(text.second.data());
+		for (size_t const n : {256u, 1472u, 9000u, 65536u})
+		{
+			std::string const name = "/" + text.first + "/" + std::to_string(n);
+			size_t const count = total / n;
+			size_t const bound = demo::compressedPayloadBound(n);
+			std::vector<uint8_t> stored(count * bound);
+			std::vector<size_t> sizes(count);
+
+			runner.run("compressPayload" + name, count, count * n, [&] {
+				for (size_t i = 0; i < count; ++i)
+					sizes[i] = demo::compressPayload(raw + i * n, n, stored.data() + i * bound, bound);
+			});
+
+			size_t stored_bytes = 0;
+			for (size_t const size : sizes) stored_bytes += size;
+			if (runner.selected("ratio" + name))
+			{
+				char ratio[64];
+				snprintf(ratio, sizeof ratio, "%.2f to 1", double(count * n) / stored_bytes);
+				runner.print("ratio" + name, ratio);
+			}
+
+			std::vector<uint8_t> out(n);
+			runner.run("decompressPayload" + name, count, count * n, [&] {
+				for (size_t i = 0; i < count; ++i)
+					demo::bench::keep(demo::decompressPayload(stored.data() + i * bound, sizes[i], out.data(), n));
+			});
+		}
+
+		// Counting line breaks reads the whole line, which inflates a compressed one first
+		for (bool const compressed : {false, true})
+		{
+			size_t const n = 1472, count = total / n;
+			std::vector<artdaq::Fragment> frags;
+			frags.reserve(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				demo::AsciiFragment::Metadata metadata;
+				metadata.charsInLine = n;
+				frags.emplace_back(0, i, 0, demo::FragmentType::ASCII, metadata);
+				demo::AsciiFragmentWriter writer(frags.back());
+				if (compressed)
+					writer.write_compressed(text.second.data() + i * n, n);
+				else
+				{
+					writer.resize(n);
+					std::copy(text.second.data() + i * n, text.second.data() + (i + 1) * n, writer.dataBegin());
+				}
+			}
+			runner.run(std::string("AsciiFragment/count_line_breaks/") + text.first + (compressed ? "/compressed" : "/plain"),
+					   count, count * n, [&] {
+						   size_t lines = 0;
+						   for (auto const& frag : frags) lines += demo::AsciiFragment(frag).count_line_breaks();
+						   demo::bench::keep(lines);
+					   });
+		}
+	}
+	return 0;
+}
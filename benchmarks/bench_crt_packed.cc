@@ -0,0 +1,78 @@
+// Benchmarks of the packed CRT format: its size per hit against CRT::Fragment's, and the speed of
+// pack(), unpack() and decoding either format, in hits. Build with -mssse3 or without to compare
+// the SIMD unpacking with the scalar one. See Bench.hh for how to run them.
+
+#include "benchmarks/Bench.hh"
+#include "benchmarks/Generators.hh"
+
+#include "artdaq-core-demo/Overlays/CRTHitDecoder.hh"
+#include "artdaq-core-demo/Overlays/CRTPackedFragment.hh"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+
+	for (unsigned int const nhit : {1u, 8u, 64u, 0u})
+	{
+		auto const frags = demo::bench::crtFragments(1000, nhit);
+		std::string const hits = "/" + (nhit ? std::to_string(nhit) : std::string("1-64"));
+
+		size_t n_hits = 0, packed_bytes = 0, plain_bytes = 0;
+		for (auto const& frag : frags)
+		{
+			n_hits += CRT::Fragment(frag).num_hits();
+			packed_bytes += CRT::packed_size(CRT::Fragment(frag).num_hits());
+			plain_bytes += CRT::packed_size(CRT::Fragment(frag).num_hits(), false);
+		}
+		size_t const bytes = demo::bench::payloadBytes(frags);
+
+		if (runner.selected("size" + hits))
+		{
+			char text[128];
+			snprintf(text, sizeof text, "bytes/hit: %.2f packed, %.2f packed with checksums, %.2f unpacked",
+					 double(plain_bytes) / n_hits, double(packed_bytes) / n_hits, double(bytes) / n_hits);
+			runner.print("size" + hits, text);
+		}
+
+		std::vector<uint8_t> packed(packed_bytes);
+		std::vector<size_t> offsets;
+		runner.run("pack" + hits, n_hits, bytes, [&] {
+			offsets.clear();
+			size_t at = 0;
+			for (auto const& frag : frags)
+			{
+				offsets.push_back(at);
+				at += CRT::pack(frag.dataBeginBytes(), frag.dataSizeBytes(), packed.data() + at);
+			}
+			offsets.push_back(at);
+		});
+
+		std::vector<uint8_t> unpacked(bytes);
+		runner.run("unpack" + hits, n_hits, packed_bytes, [&] {
+			size_t at = 0;
+			for (size_t i = 0; i + 1 < offsets.size(); ++i)
+			{
+				at += CRT::unpack(packed.data() + offsets[i], offsets[i + 1] - offsets[i], unpacked.data() + at);
+			}
+			demo::bench::keep(at);
+		});
+
+		CRT::DecodedHits decoded;
+		runner.run("decode/CRT::Fragment" + hits, n_hits, bytes, [&] {
+			decoded.clear();
+			CRT::decode(frags.data(), frags.size(), decoded);
+		});
+		runner.run("decode/PackedFragment" + hits, n_hits, packed_bytes, [&] {
+			decoded.clear();
+			for (size_t i = 0; i + 1 < offsets.size(); ++i)
+			{
+				CRT::decode(CRT::PackedFragment(packed.data() + offsets[i], offsets[i + 1] - offsets[i]), decoded);
+			}
+		});
+	}
+	return 0;
+}
@@ -0,0 +1,72 @@
+// Benchmarks of validating and decoding a batch of CRT Fragments with CRT::ParallelProcessor and
+// CRT::ParallelStream on 1 to N threads, against validate_batch() and decode() on the calling
+// thread. See Bench.hh for how to run them; the scaling only shows with as many cores as threads.
+
+#include "benchmarks/Bench.hh"
+#include "benchmarks/Generators.hh"
+
+#include "artdaq-core-demo/Overlays/CRTBatchValidator.hh"
+#include "artdaq-core-demo/Overlays/CRTHitDecoder.hh"
+#include "artdaq-core-demo/Overlays/CRTParallel.hh"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+
+	auto const frags = demo::bench::crtFragments(20000, 0);
+	size_t const bytes = demo::bench::payloadBytes(frags);
+	std::vector<artdaq::Fragment const*> pointers;
+	for (auto const& frag : frags) pointers.push_back(&frag);
+
+	std::vector<CRT::error_mask_t> masks(frags.size());
+	CRT::DecodedHits hits;
+	runner.run("serial", frags.size(), bytes, [&] {
+		CRT::validate_batch(pointers.data(), pointers.size(), masks.data());
+		hits.clear();
+		CRT::decode(pointers.data(), pointers.size(), hits);
+	});
+
+	size_t const cores = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<size_t> threads;
+	for (size_t n = 1; n < cores; n *= 2) threads.push_back(n);
+	threads.push_back(cores);
+	if (cores < 4) threads.push_back(4);
+
+	CRT::BatchResult result;
+	for (size_t const n : threads)
+	{
+		for (size_t const chunk : {16u, 64u, 256u})
+		{
+			std::string const name = "ParallelProcessor/threads:" + std::to_string(n) + "/chunk:" + std::to_string(chunk);
+			if (!runner.selected(name)) continue;
+			CRT::ParallelProcessor processor(n, chunk);
+			runner.run(name, frags.size(), bytes, [&] { processor.process(pointers.data(), pointers.size(), result); });
+		}
+	}
+
+	// The same Fragments as a stream of smaller batches, several in flight
+	size_t const per_batch = 1000;
+	for (size_t const n : threads)
+	{
+		std::string const name = "ParallelStream/threads:" + std::to_string(n);
+		if (!runner.selected(name)) continue;
+		CRT::ParallelProcessor processor(n);
+		runner.run(name, frags.size(), bytes, [&] {
+			CRT::ParallelStream stream(processor);
+			for (size_t i = 0; i < pointers.size(); i += per_batch)
+			{
+				if (stream.in_flight() == 4) stream.next(result);
+				stream.submit(pointers.data() + i, std::min(per_batch, pointers.size() - i));
+			}
+			while (stream.next(result))
+			{
+			}
+		});
+	}
+	return 0;
+}
@@ -0,0 +1,69 @@
+// Benchmarks of CRT::TimeIndex: building it, and finding the Fragments within a window of
+// triggers one at a time and in batches, against std::lower_bound over the sorted times and a
+// linear scan. See Bench.hh for how to run them.
+
+#include "benchmarks/Bench.hh"
+#include "benchmarks/Generators.hh"
+
+#include "artdaq-core-demo/Overlays/CRTTimeIndex.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+
+	uint64_t const half_width = 50000; // 1ms either side
+	auto const frags = demo::bench::crtFragments(200000, 0);
+
+	runner.run("build/200000", frags.size(), 0, [&] { CRT::TimeIndex const index(frags); demo::bench::keep(index); });
+
+	CRT::TimeIndex const index(frags);
+	std::vector<uint64_t> times;
+	for (size_t i = 0; i < index.size(); ++i) times.push_back(index.time(i));
+
+	std::mt19937_64 rng(1);
+	std::vector<uint64_t> triggers(100000);
+	for (auto& t : triggers) t = times.front() + rng() % (times.back() - times.front());
+	std::vector<uint64_t> sorted(triggers);
+	std::sort(sorted.begin(), sorted.end());
+
+	runner.run("window", triggers.size(), 0, [&] {
+		uint32_t n = 0;
+		for (auto t : triggers) n += index.window(t, half_width).size();
+		demo::bench::keep(n);
+	});
+	runner.run("std::lower_bound", triggers.size(), 0, [&] {
+		size_t n = 0;
+		for (auto t : triggers)
+		{
+			n += std::lower_bound(times.begin(), times.end(), t + half_width + 1) -
+				 std::lower_bound(times.begin(), times.end(), t - half_width);
+		}
+		demo::bench::keep(n);
+	});
+
+	std::vector<CRT::TimeRange> out(triggers.size());
+	std::vector<uint32_t> order;
+	runner.run("windows/sorted", triggers.size(), 0, [&] {
+		index.windows(sorted.data(), sorted.size(), half_width, out.data(), order);
+	});
+	runner.run("windows/unsorted", triggers.size(), 0, [&] {
+		index.windows(triggers.data(), triggers.size(), half_width, out.data(), order);
+	});
+
+	// What finding them without an index costs, over a few triggers
+	size_t const few = 100;
+	runner.run("linear scan", few, 0, [&] {
+		size_t n = 0;
+		for (size_t i = 0; i < few; ++i)
+		{
+			for (auto t : times) n += t + half_width >= triggers[i] && t <= triggers[i] + half_width;
+		}
+		demo::bench::keep(n);
+	});
+	return 0;
+}
@@ -0,0 +1,47 @@
+// Benchmarks of validating good CRT Fragments one at a time, with good_event() and
+// check_event(), against CRT::validate_batch(), whose hit checks use SSE2 or AVX2 as the build
+// targets. See Bench.hh for how to run them.
+
+#include "benchmarks/Bench.hh"
+#include "benchmarks/Generators.hh"
+
+#include "artdaq-core-demo/Overlays/CRTBatchValidator.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+
+	for (unsigned int const nhit : {1u, 16u, 64u, 0u})
+	{
+		auto const frags = demo::bench::crtFragments(1000, nhit);
+		size_t const bytes = demo::bench::payloadBytes(frags);
+		std::string const hits = "/" + (nhit ? std::to_string(nhit) : std::string("1-64"));
+
+		std::vector<artdaq::Fragment const*> pointers;
+		for (auto const& frag : frags) pointers.push_back(&frag);
+		std::vector<CRT::error_mask_t> masks(frags.size());
+
+		runner.run("good_event" + hits, frags.size(), bytes, [&] {
+			size_t good = 0;
+			for (auto const& frag : frags) good += CRT::Fragment(frag).good_event();
+			demo::bench::keep(good);
+		});
+		runner.run("check_event" + hits, frags.size(), bytes, [&] {
+			size_t good = 0;
+			for (auto const& frag : frags) good += CRT::check_event(frag).ok();
+			demo::bench::keep(good);
+		});
+		runner.run("validate_batch/contiguous" + hits, frags.size(), bytes, [&] {
+			demo::bench::keep(CRT::validate_batch(frags.data(), frags.size(), masks.data()));
+		});
+		runner.run("validate_batch/pointers" + hits, frags.size(), bytes, [&] {
+			demo::bench::keep(CRT::validate_batch(pointers.data(), pointers.size(), masks.data()));
+		});
+	}
+	return 0;
+}
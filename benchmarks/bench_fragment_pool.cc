@@ -0,0 +1,128 @@
+// Benchmarks of writing ASCII and UDP Fragments into Fragments from a FragmentPool, against
+// allocating a new Fragment for each, on one thread and handed from a producer thread to a
+// consumer that frees or releases them. See Bench.hh for how to run them.
+
+#include "benchmarks/Bench.hh"
+
+#include "artdaq-core-demo/Overlays/AsciiFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/FragmentPool.hh"
+#include "artdaq-core-demo/Overlays/FragmentQueue.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/UDPFragmentWriter.hh"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	size_t const batch = 1000;
+
+	// How to make and fill a Fragment of one overlay, with or without a pool
+	struct Ascii
+	{
+		typedef demo::AsciiFragment::Metadata Metadata;
+		static constexpr artdaq::Fragment::type_t type = demo::FragmentType::ASCII;
+		static constexpr size_t header_bytes = sizeof(demo::AsciiFragment::Header);
+
+		static Metadata metadata(size_t n)
+		{
+			Metadata m;
+			m.charsInLine = n;
+			return m;
+		}
+
+		template <typename... Tag>
+		static void write(artdaq::Fragment& frag, std::vector<char> const& text, Tag... tag)
+		{
+			demo::AsciiFragmentWriter writer(frag, tag...);
+			writer.resize(text.size());
+			memcpy(writer.dataBegin(), text.data(), text.size());
+		}
+	};
+
+	struct UDP
+	{
+		typedef demo::UDPFragment::Metadata Metadata;
+		static constexpr artdaq::Fragment::type_t type = demo::FragmentType::UDP;
+		static constexpr size_t header_bytes = sizeof(demo::UDPFragment::Header);
+
+		static Metadata metadata(size_t)
+		{
+			Metadata m;
+			memset(&m, 0, sizeof m);
+			return m;
+		}
+
+		template <typename... Tag>
+		static void write(artdaq::Fragment& frag, std::vector<char> const& text, Tag... tag)
+		{
+			demo::UDPFragmentWriter writer(frag, tag...);
+			writer.resize(text.size());
+			memcpy(writer.dataBegin(), text.data(), text.size());
+		}
+	};
+
+	template <typename Overlay>
+	artdaq::FragmentPtr fresh(std::vector<char> const& text, artdaq::Fragment::sequence_id_t seq)
+	{
+		auto frag = artdaq::Fragment::FragmentBytes(0, seq, 0, Overlay::type, Overlay::metadata(text.size()));
+		Overlay::write(*frag, text);
+		return frag;
+	}
+
+	template <typename Overlay>
+	artdaq::FragmentPtr pooled(demo::FragmentPool& pool, std::vector<char> const& text)
+	{
+		auto frag = pool.acquire();
+		Overlay::write(*frag, text, demo::headerReserved);
+		return frag;
+	}
+
+	template <typename Overlay>
+	void cases(demo::bench::Runner& runner, std::string const& overlay, size_t n)
+	{
+		std::vector<char> const text(n, 'x');
+		std::string const suffix = "/" + overlay + "/" + std::to_string(n);
+		demo::FragmentPool pool(Overlay::type, Overlay::metadata(n), Overlay::header_bytes, n, 64);
+
+		runner.run("fresh" + suffix, batch, batch * n, [&] {
+			for (size_t i = 0; i < batch; ++i) demo::bench::keep(fresh<Overlay>(text, i));
+		});
+		runner.run("pool" + suffix, batch, batch * n, [&] {
+			for (size_t i = 0; i < batch; ++i) pool.release(pooled<Overlay>(pool, text));
+		});
+
+		// A producer filling Fragments, and a consumer freeing or releasing them
+		demo::FragmentSPSCQueue queue(64);
+		runner.run("fresh/threaded" + suffix, batch, batch * n, [&] {
+			std::thread consumer([&] {
+				artdaq::FragmentPtr frag;
+				for (size_t i = 0; i < batch; ++i) queue.pop(frag);
+			});
+			for (size_t i = 0; i < batch; ++i) queue.push(fresh<Overlay>(text, i));
+			consumer.join();
+		});
+		runner.run("pool/threaded" + suffix, batch, batch * n, [&] {
+			std::thread consumer([&] {
+				artdaq::FragmentPtr frag;
+				for (size_t i = 0; i < batch; ++i)
+				{
+					queue.pop(frag);
+					pool.release(std::move(frag));
+				}
+			});
+			for (size_t i = 0; i < batch; ++i) queue.push(pooled<Overlay>(pool, text));
+			consumer.join();
+		});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+	for (size_t const n : {80u, 4096u}) cases<Ascii>(runner, "ASCII", n);
+	for (size_t const n : {1472u, 9000u}) cases<UDP>(runner, "UDP", n);
+	return 0;
+}
@@ -0,0 +1,151 @@
+// Benchmarks of handing items between threads with SPSCQueue and MPSCQueue, against a
+// mutex-guarded std::queue like the ones they replace: throughput, and the latency from push to
+// pop of items pushed at a steady rate. See Bench.hh for how to run them.
+
+#include "benchmarks/Bench.hh"
+
+#include "artdaq-core-demo/Overlays/FragmentQueue.hh"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// The baseline: a bounded std::queue behind a mutex, waiting on condition variables
+	template <typename T>
+	class MutexQueue
+	{
+	public:
+		explicit MutexQueue(size_t capacity) : capacity_(capacity) {}
+
+		void push(T&& item)
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			not_full_.wait(lock, [this] { return queue_.size() < capacity_; });
+			queue_.push(std::move(item));
+			not_empty_.notify_one();
+		}
+
+		bool pop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			not_empty_.wait(lock, [this] { return !queue_.empty(); });
+			item = std::move(queue_.front());
+			queue_.pop();
+			not_full_.notify_one();
+			return true;
+		}
+
+	private:
+		size_t capacity_;
+		std::mutex mutex_;
+		std::condition_variable not_full_, not_empty_;
+		std::queue<T> queue_;
+	};
+
+	size_t const capacity = 1024;
+	size_t const n_items = 100000;
+
+	uint64_t now_ns()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Pass the items through the queue, from 'producers' threads to this one
+	template <typename Queue, typename T>
+	void transfer(Queue& q, size_t producers, std::vector<T>& in, std::vector<T>& out)
+	{
+		size_t const per_producer = in.size() / producers;
+		std::vector<std::thread> threads;
+		for (size_t p = 0; p < producers; ++p)
+		{
+			threads.emplace_back([&, p] {
+				for (size_t i = p * per_producer; i < (p + 1) * per_producer; ++i) q.push(std::move(in[i]));
+			});
+		}
+		for (size_t i = 0; i < producers * per_producer; ++i) q.pop(out[i]);
+		for (auto& t : threads) t.join();
+		std::swap(in, out);
+	}
+
+	template <typename Queue>
+	void throughput(demo::bench::Runner& runner, std::string const& name, size_t producers)
+	{
+		if (!runner.selected(name)) return;
+		Queue q(capacity);
+		std::vector<artdaq::FragmentPtr> in, out(n_items);
+		for (size_t i = 0; i < n_items; ++i) in.emplace_back(new artdaq::Fragment(i, 0));
+		runner.run(name, n_items, 0, [&] { transfer(q, producers, in, out); });
+	}
+
+	// Push a timestamp every 'interval' ns from 'producers' threads, and report the percentiles of
+	// the time each one took to be popped
+	template <typename Queue>
+	void latency(demo::bench::Runner& runner, std::string const& name, size_t producers, uint64_t interval)
+	{
+		if (!runner.selected(name)) return;
+		Queue q(capacity);
+		size_t const per_producer = n_items / producers;
+		std::vector<uint64_t> latencies(producers * per_producer);
+
+		std::vector<std::thread> threads;
+		for (size_t p = 0; p < producers; ++p)
+		{
+			threads.emplace_back([&] {
+				uint64_t next = now_ns();
+				for (size_t i = 0; i < per_producer; ++i)
+				{
+					while (now_ns() < next)
+					{
+					}
+					uint64_t stamp = now_ns();
+					q.push(std::move(stamp));
+					next += interval * producers;
+				}
+			});
+		}
+		for (auto& l : latencies)
+		{
+			uint64_t stamp;
+			q.pop(stamp);
+			l = now_ns() - stamp;
+		}
+		for (auto& t : threads) t.join();
+
+		std::sort(latencies.begin(), latencies.end());
+		auto const at = [&](double f) { return static_cast<unsigned long long>(latencies[static_cast<size_t>(f * (latencies.size() - 1))]); };
+		char text[128];
+		snprintf(text, sizeof text, "latency ns: p50 %llu, p99 %llu, p99.9 %llu, max %llu", at(0.5), at(0.99), at(0.999), at(1));
+		runner.print(name, text);
+		if (std::thread::hardware_concurrency() < producers + 1)
+		{
+			runner.print(name, "(fewer cores than threads, so these are mostly scheduling delays)");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+
+	throughput<MutexQueue<artdaq::FragmentPtr>>(runner, "throughput/mutex/1", 1);
+	throughput<demo::FragmentSPSCQueue>(runner, "throughput/SPSCQueue/1", 1);
+	throughput<MutexQueue<artdaq::FragmentPtr>>(runner, "throughput/mutex/3", 3);
+	throughput<demo::FragmentMPSCQueue>(runner, "throughput/MPSCQueue/1", 1);
+	throughput<demo::FragmentMPSCQueue>(runner, "throughput/MPSCQueue/3", 3);
+
+	for (uint64_t const interval : {1000u, 10000u})
+	{
+		std::string const every = "/every" + std::to_string(interval) + "ns";
+		latency<MutexQueue<uint64_t>>(runner, "latency/mutex/1" + every, 1, interval);
+		latency<demo::SPSCQueue<uint64_t>>(runner, "latency/SPSCQueue/1" + every, 1, interval);
+		latency<MutexQueue<uint64_t>>(runner, "latency/mutex/3" + every, 3, interval);
+		latency<demo::MPSCQueue<uint64_t>>(runner, "latency/MPSCQueue/3" + every, 3, interval);
+	}
+	return 0;
+}
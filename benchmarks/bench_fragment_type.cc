@@ -0,0 +1,49 @@
+// Benchmarks of looking up Fragment types by name and names by type, through std::string and
+// through the overloads that don't allocate. See Bench.hh for how to run them.
+
+#include "benchmarks/Bench.hh"
+
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+
+	// Every name, in other cases too, and some that aren't names, one too long for the
+	// short-string optimization
+	std::vector<char const*> names;
+	for (auto name : demo::detail::fragmentTypeNames) names.push_back(name);
+	for (auto name : {"crt", "Udp", "udpcontainer", "", "X", "CRTPACKEDX", "NOT_A_FRAGMENT_TYPE_AT_ALL"}) names.push_back(name);
+
+	std::vector<std::string> strings(names.begin(), names.end());
+	std::vector<size_t> lengths;
+	for (auto name : names) lengths.push_back(strlen(name));
+
+	runner.run("toFragmentType(std::string const&)", names.size(), 0, [&] {
+		for (auto const& s : strings) demo::bench::keep(demo::toFragmentType(s));
+	});
+	runner.run("toFragmentType(std::string(char const*))", names.size(), 0, [&] {
+		for (auto name : names) demo::bench::keep(demo::toFragmentType(std::string(name)));
+	});
+	runner.run("toFragmentType(char const*, size_t)", names.size(), 0, [&] {
+		for (size_t i = 0; i < names.size(); ++i) demo::bench::keep(demo::toFragmentType(names[i], lengths[i]));
+	});
+	runner.run("toFragmentType(char const*)", names.size(), 0, [&] {
+		for (auto name : names) demo::bench::keep(demo::toFragmentType(name));
+	});
+
+	std::vector<demo::FragmentType> types;
+	for (auto name : names) types.push_back(demo::toFragmentType(name));
+	runner.run("fragmentTypeToString", types.size(), 0, [&] {
+		for (auto type : types) demo::bench::keep(demo::fragmentTypeToString(type));
+	});
+	runner.run("fragmentTypeName", types.size(), 0, [&] {
+		for (auto type : types) demo::bench::keep(demo::fragmentTypeName(type));
+	});
+	runner.run("makeFragmentTypeMap", 1, 0, [&] { demo::bench::keep(demo::makeFragmentTypeMap()); });
+	return 0;
+}
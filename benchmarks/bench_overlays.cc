@@ -0,0 +1,89 @@
+// Benchmarks of the basic overlay operations: validating CRT Fragments, sizing ASCII Fragments,
+// finding UDP payloads, looking up Fragment types and printing Fragments. See Bench.hh for how to
+// run them.
+
+#include "benchmarks/Bench.hh"
+#include "benchmarks/Generators.hh"
+
+#include "artdaq-core-demo/Overlays/AsciiFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTFragment.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/UDPFragment.hh"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	demo::bench::Runner runner(argc, argv);
+
+	for (unsigned int const nhit : {1u, 4u, 16u, 64u, 0u})
+	{
+		auto const frags = demo::bench::crtFragments(1000, nhit);
+		std::string const hits = nhit ? std::to_string(nhit) : "1-64";
+		runner.run("CRT::Fragment::good_event/" + hits, frags.size(), demo::bench::payloadBytes(frags), [&] {
+			size_t good = 0;
+			for (auto const& frag : frags) good += CRT::Fragment(frag).good_event();
+			demo::bench::keep(good);
+		});
+	}
+
+	// A writer is made for each line, as a generator would, on a Fragment that keeps its storage
+	for (size_t const nChars : {16u, 256u, 4096u, 65536u})
+	{
+		auto frags = demo::bench::asciiFragments(100, nChars);
+		runner.run("AsciiFragmentWriter::resize/" + std::to_string(nChars), frags.size(), frags.size() * nChars, [&] {
+			for (auto& frag : frags)
+			{
+				frag.resizeBytes(0);
+				demo::AsciiFragmentWriter writer(frag);
+				writer.resize(nChars);
+				demo::bench::keep(writer);
+			}
+		});
+	}
+
+	for (size_t const nBytes : {64u, 512u, 1472u, 9000u})
+	{
+		auto const frags = demo::bench::udpFragments(100, nBytes);
+		runner.run("UDPFragment::dataBegin/dataEnd/" + std::to_string(nBytes), frags.size(), frags.size() * nBytes, [&] {
+			size_t bytes = 0;
+			for (auto const& frag : frags)
+			{
+				demo::UDPFragment const udp(frag);
+				bytes += udp.dataEnd() - udp.dataBegin();
+			}
+			demo::bench::keep(bytes);
+		});
+	}
+
+	std::vector<std::string> names(demo::names);
+	names.push_back("crtpacked");
+	names.push_back("NOT_A_TYPE");
+	runner.run("toFragmentType(std::string)", names.size(), 0, [&] {
+		for (auto const& name : names) demo::bench::keep(demo::toFragmentType(name));
+	});
+	runner.run("fragmentTypeToString", names.size(), 0, [&] {
+		for (auto const& name : names) demo::bench::keep(demo::fragmentTypeToString(demo::toFragmentType(name)));
+	});
+
+	std::ostringstream os;
+	for (unsigned int const nhit : {1u, 64u})
+	{
+		auto const frags = demo::bench::crtFragments(100, nhit);
+		runner.run("operator<<(CRT::Fragment)/" + std::to_string(nhit), frags.size(), demo::bench::payloadBytes(frags), [&] {
+			os.str("");
+			for (auto const& frag : frags) os << CRT::Fragment(frag);
+		});
+	}
+	for (size_t const nChars : {80u, 4096u})
+	{
+		auto const frags = demo::bench::asciiFragments(100, nChars);
+		runner.run("operator<<(AsciiFragment)/" + std::to_string(nChars), frags.size(), frags.size() * nChars, [&] {
+			os.str("");
+			for (auto const& frag : frags) os << demo::AsciiFragment(frag);
+		});
+	}
+	return 0;
+}
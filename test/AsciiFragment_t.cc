@@ -0,0 +1,159 @@
+#include "artdaq-core-demo/Overlays/AsciiFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#define BOOST_TEST_MODULE(AsciiFragment_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// A Fragment holding the given line
+	std::unique_ptr<artdaq::Fragment> make(std::string const& line)
+	{
+		demo::AsciiFragment::Metadata metadata;
+		metadata.charsInLine = line.size();
+		auto frag = artdaq::Fragment::FragmentBytes(0, 0, 0, demo::FragmentType::ASCII, metadata);
+		demo::AsciiFragmentWriter writer(*frag);
+		writer.resize(line.size());
+		memcpy(reinterpret_cast<char*>(writer.header_() + 1), line.data(), line.size());
+		return frag;
+	}
+
+	// Lengths either side of the 16- and 32-byte blocks of the SIMD scans
+	std::vector<size_t> const lengths{0, 1, 15, 16, 17, 31, 32, 33, 47, 48, 49, 63, 64, 65, 100};
+}
+
+BOOST_AUTO_TEST_SUITE(AsciiFragment_test)
+
+// The first character that isn't padding, at each position, with NUL and
+// another padding character
+BOOST_AUTO_TEST_CASE(FirstNonPadding)
+{
+	for (char const pad : {'\0', ' '})
+	{
+		for (size_t const n : lengths)
+		{
+			BOOST_TEST_CONTEXT("pad " << int(pad) << ", length " << n)
+			{
+				auto frag = make(std::string(n, pad));
+				demo::AsciiFragment f(*frag);
+				BOOST_CHECK(f.first_non_padding(pad) == f.dataEnd());
+
+				for (size_t i = 0; i < n; ++i)
+				{
+					std::string line(n, pad);
+					line[i] = pad == '\0' ? ' ' : '\0';
+					if (i + 1 < n) line[n - 1] = 'x';
+					frag = make(line);
+					demo::AsciiFragment const g(*frag);
+					BOOST_CHECK_EQUAL(g.first_non_padding(pad) - g.dataBegin(), static_cast<ptrdiff_t>(i));
+				}
+			}
+		}
+	}
+}
+
+// count_line_breaks() and line_break_offsets() against a scan, with line
+// breaks and NULs at each position
+BOOST_AUTO_TEST_CASE(LineBreaks)
+{
+	for (size_t const n : lengths)
+	{
+		for (size_t i = 0; i <= n; ++i)
+		{
+			BOOST_TEST_CONTEXT("length " << n << ", position " << i)
+			{
+				std::string line(n, 'a');
+				for (size_t j = i; j < n; j += 7) line[j] = '\n';
+				for (size_t j = i + 3; j < n; j += 11) line[j] = '\0';
+
+				std::vector<size_t> expect;
+				for (size_t j = 0; j < n; ++j)
+					if (line[j] == '\n') expect.push_back(j);
+
+				auto frag = make(line);
+				demo::AsciiFragment const f(*frag);
+				std::vector<size_t> offsets{99};
+				BOOST_CHECK_EQUAL(f.count_line_breaks(), expect.size());
+				BOOST_CHECK_EQUAL(f.line_break_offsets(offsets), expect.size());
+				BOOST_CHECK(offsets == expect);
+			}
+		}
+	}
+}
+
+// all_printable() with a character that isn't printable at each position, the last one
+// included, so that it is found by the SIMD blocks and by the loop over what they leave
+BOOST_AUTO_TEST_CASE(AllPrintable)
+{
+	for (size_t const n : lengths)
+	{
+		std::string line(n, ' ');
+		for (size_t i = 0; i < n; ++i) line[i] = static_cast<char>(' ' + i % 95);
+		line.insert(0, n > 2 ? "\t\n\r" : "");
+		line.resize(n);
+
+		BOOST_TEST_CONTEXT("length " << n)
+		{
+			auto frag = make(line);
+			BOOST_CHECK(demo::AsciiFragment(*frag).all_printable());
+		}
+
+		for (char const bad : {'\0', '\x1f', '\x7f', '\x80', '\xff'})
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				BOOST_TEST_CONTEXT("length " << n << ", character " << int(bad) << " at " << i)
+				{
+					std::string l = line;
+					l[i] = bad;
+					auto frag = make(l);
+					BOOST_CHECK(!demo::AsciiFragment(*frag).all_printable());
+				}
+			}
+		}
+	}
+}
+
+// sizes_consistent() for lines either side of a 32-byte block, with the Metadata's line length
+// up to and beyond the line, and with a Header::event_size too small for the Header or too big
+// for the Fragment
+BOOST_AUTO_TEST_CASE(SizesConsistent)
+{
+	for (size_t const n : {31, 32, 33})
+	{
+		BOOST_TEST_CONTEXT("length " << n)
+		{
+			std::string line(n, 'x');
+			line[n - 1] = '\x01';
+			auto frag = make(line);
+			BOOST_CHECK(demo::AsciiFragment(*frag).sizes_consistent());
+			BOOST_CHECK(!demo::AsciiFragment(*frag).all_printable());
+
+			auto* const metadata = frag->metadata<demo::AsciiFragment::Metadata>();
+			metadata->charsInLine = n - 1;
+			BOOST_CHECK(demo::AsciiFragment(*frag).sizes_consistent());
+			metadata->charsInLine = n + 1;
+			BOOST_CHECK(!demo::AsciiFragment(*frag).sizes_consistent());
+			metadata->charsInLine = n;
+
+			// Overlaid without the Fragment or its Metadata, only the Header is checked
+			uint8_t const* const payload = frag->dataBeginBytes();
+			BOOST_CHECK(demo::AsciiFragment(payload, frag->dataSizeBytes()).sizes_consistent());
+			BOOST_CHECK(!demo::AsciiFragment(payload, sizeof(demo::AsciiFragment::Header) - 1).sizes_consistent());
+
+			auto* const header = reinterpret_cast<demo::AsciiFragment::Header*>(frag->dataBeginBytes());
+			header->event_size = frag->dataSizeBytes() + 1;
+			BOOST_CHECK(!demo::AsciiFragment(*frag).sizes_consistent());
+			header->event_size = demo::AsciiFragment::Header::size_words - 1;
+			BOOST_CHECK(!demo::AsciiFragment(*frag).sizes_consistent());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,151 @@
+#include "artdaq-core-demo/Overlays/CRTBatchValidator.hh"
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#define BOOST_TEST_MODULE(CRTBatchValidator_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace
+{
+  // A good fragment of nhit hits, with ADC values up to the largest allowed
+  artdaq::Fragment write(const unsigned int nhit, const bool checksum)
+  {
+    artdaq::Fragment frag(0, 0, demo::FragmentType::CRT);
+    CRT::FragmentWriter w(frag, 7, CRT::earliest_unixtime + 1000, 12345);
+    for(unsigned int i = 0; i < nhit; i++)
+      w.add_hit(i % CRT::n_channels, (i*997) % CRT::adc_limit);
+    w.finalize(checksum);
+    return frag;
+  }
+
+  CRT::Fragment::hit_t * hit(artdaq::Fragment& frag, const size_t i)
+  {
+    return reinterpret_cast<CRT::Fragment::hit_t *>(frag.dataBeginBytes()
+      + sizeof(CRT::Fragment::header_t)) + i;
+  }
+
+  // The error bits of what check_event() finds
+  CRT::error_mask_t expected(artdaq::Fragment const& frag)
+  {
+    return CRT::error_bit(CRT::check_event(frag).error);
+  }
+
+  // validate() and both validate_batch()es agree with check_event() on
+  // each fragment, and good_event() with whether it is good
+  void check(artdaq::Fragments const& frags)
+  {
+    std::vector<artdaq::Fragment const*> pointers;
+    for(auto const& f: frags) pointers.push_back(&f);
+
+    const std::vector<CRT::error_mask_t> masks = CRT::validate_batch(frags);
+    std::vector<CRT::error_mask_t> by_pointer(frags.size());
+    size_t nbad = 0;
+    for(size_t i = 0; i < frags.size(); i++){
+      BOOST_TEST_CONTEXT("fragment " << i << " of " << frags.size()
+                         << " hits " << CRT::Fragment(frags[i]).num_hits()){
+        const CRT::error_mask_t e = expected(frags[i]);
+        nbad += e != 0;
+        BOOST_CHECK_EQUAL(CRT::validate(frags[i]), e);
+        BOOST_CHECK_EQUAL(masks[i], e);
+        BOOST_CHECK_EQUAL(CRT::Fragment(frags[i]).good_event(), e == 0);
+      }
+    }
+    BOOST_CHECK_EQUAL(CRT::validate_batch(pointers.data(), pointers.size(),
+                                          by_pointer.data()), nbad);
+    BOOST_CHECK(by_pointer == masks);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTBatchValidator_test)
+
+// Good fragments of every size pass, with and without checksums
+BOOST_AUTO_TEST_CASE(Good)
+{
+  artdaq::Fragments frags;
+  for(unsigned int n = 1; n <= CRT::max_hits; n++){
+    frags.push_back(write(n, false));
+    frags.push_back(write(n, true));
+  }
+  check(frags);
+  for(auto const m: CRT::validate_batch(frags)) BOOST_CHECK_EQUAL(m, 0);
+}
+
+// A bad magic, channel 64 or ADC value 4096 at every position of fragments
+// of up to 18 hits, which covers the edges of the 4- and 8-hit SIMD blocks
+// and the hits left over after them
+BOOST_AUTO_TEST_CASE(BadHitEverywhere)
+{
+  artdaq::Fragments frags;
+  for(unsigned int n = 1; n <= 18; n++){
+    for(unsigned int i = 0; i < n; i++){
+      frags.push_back(write(n, false));
+      hit(frags.back(), i)->magic = 'h';
+      frags.push_back(write(n, false));
+      hit(frags.back(), i)->channel = CRT::n_channels;
+      frags.push_back(write(n, false));
+      hit(frags.back(), i)->adc = CRT::adc_limit;
+      frags.push_back(write(n, true));
+      hit(frags.back(), i)->adc = CRT::adc_limit;
+    }
+  }
+
+  const std::vector<CRT::error_mask_t> masks = CRT::validate_batch(frags);
+  for(size_t i = 0; i < frags.size(); i += 4){
+    BOOST_CHECK_EQUAL(masks[i], CRT::error_bit(CRT::bad_hit_magic));
+    BOOST_CHECK_EQUAL(masks[i + 1], CRT::error_bit(CRT::bad_channel));
+    BOOST_CHECK_EQUAL(masks[i + 2], CRT::error_bit(CRT::bad_adc));
+    // The checksum is checked after the hits, so only their error is found
+    BOOST_CHECK_EQUAL(masks[i + 3], CRT::error_bit(CRT::bad_adc)
+                      | CRT::error_bit(CRT::bad_checksum));
+  }
+
+  // check_event() stops at the first problem, so compare with it only where
+  // there is one
+  artdaq::Fragments single;
+  for(size_t i = 0; i < frags.size(); i += 4)
+    single.insert(single.end(), frags.begin() + i, frags.begin() + i + 3);
+  check(single);
+}
+
+// A bad hit just past the last one claimed, in the padding, is not looked at
+BOOST_AUTO_TEST_CASE(PaddingIgnored)
+{
+  artdaq::Fragments frags;
+  for(unsigned int n = 2; n <= 18; n += 2){
+    frags.push_back(write(n, false));
+    hit(frags.back(), n)->magic = 'h';
+    hit(frags.back(), n)->channel = 0xff;
+  }
+  check(frags);
+}
+
+// A checksum trailer that doesn't match, whether over the header, a hit or
+// the checksum itself, and one with the wrong magic, which is then not a
+// trailer and so makes the fragment the wrong size
+BOOST_AUTO_TEST_CASE(BadChecksum)
+{
+  artdaq::Fragments frags;
+  for(unsigned int n = 1; n <= 18; n++){
+    frags.push_back(write(n, true));
+    frags.back().dataBeginBytes()[offsetof(CRT::Fragment::header_t,
+                                           fifty_mhz_time)] ^= 1;
+    frags.push_back(write(n, true));
+    hit(frags.back(), n - 1)->adc ^= 1;
+    frags.push_back(write(n, true));
+    frags.back().dataEndBytes()[-1] ^= 0x80;
+    frags.push_back(write(n, true));
+    frags.back().dataEndBytes()[-int(sizeof(CRT::Fragment::trailer_t))] ^= 1;
+  }
+
+  const std::vector<CRT::error_mask_t> masks = CRT::validate_batch(frags);
+  for(size_t i = 0; i < frags.size(); i++)
+    BOOST_CHECK_EQUAL(masks[i], CRT::error_bit(i % 4 == 3? CRT::bad_size:
+                                               CRT::bad_checksum));
+  check(frags);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,146 @@
+#include "artdaq-core-demo/Overlays/CRTChannelHistograms.hh"
+
+#define BOOST_TEST_MODULE(CRTChannelHistograms_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const size_t n_modules = 2;
+
+  // One fragment's worth of hits, n of them, from random channels of
+  // module m
+  CRT::DecodedHits hits(const uint16_t m, const size_t n, std::mt19937& rng)
+  {
+    CRT::DecodedHits h;
+    for(size_t i = 0; i < n; i++){
+      h.channel.push_back(rng() % CRT::n_channels);
+      h.adc.push_back(rng() % 200);
+    }
+    h.module_num.push_back(m);
+    h.unixtime.push_back(0);
+    h.fifty_mhz_time.push_back(0);
+    h.hit_begin.push_back(n);
+    return h;
+  }
+
+  uint64_t total_entries(CRT::ChannelHistograms const& h)
+  {
+    uint64_t n = 0;
+    for(uint16_t m = 0; m < h.n_modules(); m++)
+      for(uint8_t c = 0; c < CRT::n_channels; c++) n += h.entries(m, c);
+    return n;
+  }
+
+  void check_equal(CRT::ChannelHistograms const& a,
+                   CRT::ChannelHistograms const& b)
+  {
+    for(uint16_t m = 0; m < a.n_modules(); m++){
+      for(uint8_t c = 0; c < CRT::n_channels; c++){
+        BOOST_REQUIRE_EQUAL(a.entries(m, c), b.entries(m, c));
+        BOOST_REQUIRE_EQUAL(a.pedestal(m, c), b.pedestal(m, c));
+        BOOST_REQUIRE(std::equal(a.histogram(m, c),
+                                 a.histogram(m, c) + CRT::ChannelHistograms::n_bins,
+                                 b.histogram(m, c)));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTChannelHistograms_test)
+
+BOOST_AUTO_TEST_CASE(Fill)
+{
+  CRT::ChannelHistograms h(n_modules);
+  h.fill(1, 5, 100);
+  h.fill(1, 5, 104);
+  h.fill(1, 5, -1);
+  h.fill(1, 5, CRT::ChannelHistograms::n_bins);
+  h.fill(n_modules, 5, 100);
+  h.fill(0, CRT::n_channels, 100);
+
+  BOOST_CHECK_EQUAL(h.entries(1, 5), 2u);
+  BOOST_CHECK_EQUAL(h.histogram(1, 5)[100], 1u);
+  BOOST_CHECK_EQUAL(h.histogram(1, 5)[104], 1u);
+  BOOST_CHECK_EQUAL(h.pedestal(1, 5), 102.);
+  BOOST_CHECK_EQUAL(h.rms(1, 5), 2.);
+  BOOST_CHECK_EQUAL(h.out_of_range(1, 5), 2u);
+  BOOST_CHECK_EQUAL(h.bad_module(), 1u);
+  BOOST_CHECK_EQUAL(h.bad_channel(), 1u);
+  BOOST_CHECK_EQUAL(h.entries(0, 5), 0u);
+  BOOST_CHECK_EQUAL(h.pedestal(0, 5), 0.);
+  BOOST_CHECK_EQUAL(h.rms(0, 5), 0.);
+
+  CRT::ChannelHistograms sum(n_modules);
+  sum.add(h);
+  sum.add(h);
+  BOOST_CHECK_EQUAL(sum.entries(1, 5), 4u);
+  BOOST_CHECK_EQUAL(sum.pedestal(1, 5), 102.);
+  BOOST_CHECK_EQUAL(sum.out_of_range(1, 5), 4u);
+  BOOST_CHECK_EQUAL(sum.bad_module(), 2u);
+
+  sum.clear();
+  BOOST_CHECK_EQUAL(total_entries(sum), 0u);
+  BOOST_CHECK_EQUAL(sum.histogram(1, 5)[100], 0u);
+  BOOST_CHECK_EQUAL(sum.bad_module(), 0u);
+}
+
+// Fillers on several threads while take() and snapshot() read them out:
+// no hit is lost or counted twice, and the takes add up to what was filled
+BOOST_AUTO_TEST_CASE(TakeWhileFilling)
+{
+  const size_t n_threads = 3, n_batches = 2000;
+  CRT::ChannelMonitor monitor(n_modules);
+
+  std::vector<CRT::ChannelMonitor::Filler *> fillers;
+  for(size_t t = 0; t < n_threads; t++) fillers.push_back(&monitor.filler());
+
+  // What each thread fills, worked out beforehand to compare with
+  CRT::ChannelHistograms expect(n_modules);
+  std::vector<std::vector<CRT::DecodedHits>> batches(n_threads);
+  std::mt19937 rng(1);
+  for(auto& b: batches){
+    for(size_t i = 0; i < n_batches; i++){
+      b.push_back(hits(rng() % n_modules, 1 + rng() % 64, rng));
+      expect.fill(b.back());
+    }
+  }
+
+  // Every so often the fillers wait for a take(), so that there are some
+  // during the fill even on one core
+  const size_t every = 100;
+  std::atomic<size_t> running(n_threads), takes(0);
+  std::vector<std::thread> threads;
+  for(size_t t = 0; t < n_threads; t++){
+    threads.emplace_back([&, t]{
+      for(size_t i = 0; i < n_batches; i++){
+        fillers[t]->fill(batches[t][i]);
+        while(i % every == 0 && takes <= i/every) std::this_thread::yield();
+      }
+      --running;
+    });
+  }
+
+  CRT::ChannelHistograms taken(n_modules);
+  while(running > 0){
+    BOOST_CHECK_LE(total_entries(monitor.snapshot()) + total_entries(taken),
+                   total_entries(expect));
+    taken.add(monitor.take());
+    takes++;
+    std::this_thread::yield();
+  }
+  for(auto& t: threads) t.join();
+  taken.add(monitor.take());
+
+  BOOST_CHECK_GE(takes, n_batches/every);
+  BOOST_CHECK_EQUAL(total_entries(taken), total_entries(expect));
+  check_equal(taken, expect);
+  BOOST_CHECK_EQUAL(total_entries(monitor.snapshot()), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,231 @@
+#include "artdaq-core-demo/Overlays/CRTClockCalibration.hh"
+#include "artdaq-core-demo/Overlays/CRTError.hh"
+
+#define BOOST_TEST_MODULE(CRTClockCalibration_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const int64_t ns_per_second = 1000000000;
+
+  // Start of the tests' clocks, a whole number of seconds after the epoch
+  const int64_t t0_ns = int64_t(CRT::earliest_unixtime + 1000)*ns_per_second;
+
+  // A module whose oscillator runs 'ppm' parts per million fast and whose
+  // counter is 'offset_ticks' ahead of the Unix clock at t0
+  struct SimulatedModule
+  {
+    double ppm;
+    int64_t offset_ticks;
+
+    // The full 50MHz count at a true time in ns
+    int64_t ticks(const int64_t ns) const
+    {
+      return t0_ns/CRT::ns_per_tick + offset_ticks
+        + std::llround((ns - t0_ns)*(1 + ppm*1e-6)/CRT::ns_per_tick);
+    }
+
+    int32_t unixtime(const int64_t ns) const { return ns/ns_per_second; }
+
+    uint32_t fifty_mhz_time(const int64_t ns) const
+    {
+      return static_cast<uint32_t>(ticks(ns));
+    }
+  };
+
+  // Feed 'cal' the fragments of 'module' for 'seconds' seconds: one each
+  // side of every second boundary, a few tens of microseconds from it, and
+  // one in the middle of the second
+  void observe(CRT::ClockCalibration& cal, const uint16_t module,
+               SimulatedModule const& sim, const int seconds,
+               std::mt19937& rng)
+  {
+    for(int s = 1; s <= seconds; s++){
+      const int64_t edge = t0_ns + s*ns_per_second;
+      for(const int64_t ns: { edge - 1000 - int64_t(rng() % 50000),
+                              edge + int64_t(rng() % 50000),
+                              edge + ns_per_second/2 }){
+        BOOST_REQUIRE(cal.observe(module, sim.unixtime(ns),
+                                  sim.fifty_mhz_time(ns)));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTClockCalibration_test)
+
+// A module 50 ppm fast and 25ms ahead, observed for five minutes and so
+// across three rollovers of its counter: its fitted drift is the true one,
+// and times anywhere in those five minutes, including either side of each
+// rollover, come out within two microseconds.  The nominal model would be
+// 15ms out by the end.
+BOOST_AUTO_TEST_CASE(KnownDrift)
+{
+  const SimulatedModule sim = { 50, 1250000 };
+  const int seconds = 300;
+  CRT::ClockCalibration cal(4);
+  std::mt19937 rng(1);
+  observe(cal, 2, sim, seconds, rng);
+
+  const CRT::ModuleClock c = cal.clock(2);
+  BOOST_CHECK(c.calibrated());
+  BOOST_CHECK_EQUAL(c.edges, unsigned(seconds));
+  BOOST_CHECK_CLOSE_FRACTION(c.drift, CRT::ns_per_tick/(1 + 50e-6)
+                             - CRT::ns_per_tick, 1e-3);
+
+  std::vector<int64_t> times;
+  for(int i = 0; i < 1000; i++)
+    times.push_back(t0_ns + ns_per_second
+                    + int64_t(rng() % (uint64_t(seconds - 1)*ns_per_second)));
+
+  int rollovers = 0;
+  for(int64_t ns = t0_ns + ns_per_second; ns < t0_ns + seconds*ns_per_second;
+      ns += ns_per_second){
+    if(sim.fifty_mhz_time(ns + ns_per_second) >= sim.fifty_mhz_time(ns))
+      continue;
+    // Find the rollover within the second to the nearest tick
+    int64_t lo = ns, hi = ns + ns_per_second;
+    while(hi - lo > CRT::ns_per_tick){
+      const int64_t mid = lo + (hi - lo)/2;
+      (sim.fifty_mhz_time(mid) >= sim.fifty_mhz_time(lo)? lo: hi) = mid;
+    }
+    for(const int64_t d: { -1000000, -1000, 0, 1000, 1000000 })
+      times.push_back(hi + d);
+    rollovers++;
+  }
+  BOOST_CHECK_GE(rollovers, 3);
+
+  const int64_t tolerance = 2000;
+  int64_t worst = 0;
+  for(const int64_t ns: times){
+    const int64_t got = cal.to_ns(2, sim.unixtime(ns), sim.fifty_mhz_time(ns));
+    worst = std::max(worst, std::abs(got - ns));
+  }
+  BOOST_TEST_MESSAGE("worst error " << worst << "ns");
+  BOOST_CHECK_LE(worst, tolerance);
+
+  // Uncalibrated and out of range modules keep the nominal model
+  const int64_t ns = t0_ns + 10*ns_per_second + 12340;
+  for(const uint16_t module: { 1, 4, 1000 }){
+    BOOST_CHECK(!cal.clock(module).calibrated());
+    BOOST_CHECK_EQUAL(cal.to_ns(module, sim.unixtime(ns),
+                                sim.fifty_mhz_time(ns)),
+                      int64_t(CRT::combined_time(sim.unixtime(ns),
+                                                 sim.fifty_mhz_time(ns)))
+                      *CRT::ns_per_tick);
+  }
+
+  cal.reset();
+  BOOST_CHECK(!cal.clock(2).calibrated());
+}
+
+// Until the drift is known well enough it stays nominal, and a fitted
+// drift beyond what any oscillator would do is not believed
+BOOST_AUTO_TEST_CASE(DriftGating)
+{
+  std::mt19937 rng(2);
+  CRT::ClockCalibration cal(2);
+  observe(cal, 0, SimulatedModule{ 50, 0 }, 2, rng);
+  BOOST_CHECK(cal.clock(0).calibrated());
+  BOOST_CHECK_EQUAL(cal.clock(0).drift, 0.);
+
+  observe(cal, 1, SimulatedModule{ 5000, 0 }, 300, rng);
+  BOOST_CHECK(cal.clock(1).calibrated());
+  BOOST_CHECK_EQUAL(cal.clock(1).drift, 0.);
+}
+
+// Batches of every length up to a few SIMD widths, and a long one, of
+// modules with and without a drift, out of range, and far enough from the
+// fitted base that the drift is left out, against one at a time
+BOOST_AUTO_TEST_CASE(BatchMatchesOne)
+{
+  std::mt19937 rng(3);
+  const std::vector<SimulatedModule> sims{
+    { 50, 1250000 }, { -20, -400000 }, { 0, 0 } };
+  CRT::ClockCalibration cal(sims.size());
+  observe(cal, 0, sims[0], 300, rng);
+  observe(cal, 1, sims[1], 300, rng);
+
+  CRT::ClockCalibration::Scratch scratch;
+  for(const size_t n: { 0, 1, 2, 3, 4, 5, 6, 7, 9, 11, 13, 1001 }){
+    std::vector<uint16_t> module(n);
+    std::vector<int32_t> unixtime(n);
+    std::vector<uint32_t> fifty_mhz_time(n);
+    for(size_t i = 0; i < n; i++){
+      module[i] = rng() % (sims.size() + 1);
+      int64_t ns = t0_ns + int64_t(rng() % (uint64_t(400)*ns_per_second));
+      if(i % 7 == 6) ns += int64_t(2*365*86400)*ns_per_second;
+      SimulatedModule const& sim = sims[std::min<size_t>(module[i], 2)];
+      unixtime[i] = sim.unixtime(ns);
+      fifty_mhz_time[i] = sim.fifty_mhz_time(ns);
+    }
+
+    std::vector<int64_t> ns(n + 1, -1);
+    cal.to_ns(module.data(), unixtime.data(), fifty_mhz_time.data(), n,
+              ns.data(), scratch);
+    for(size_t i = 0; i < n; i++){
+      BOOST_TEST_CONTEXT("batch of " << n << ", fragment " << i){
+        BOOST_CHECK_EQUAL(ns[i],
+          cal.to_ns(module[i], unixtime[i], fifty_mhz_time[i]));
+      }
+    }
+    BOOST_CHECK_EQUAL(ns[n], -1);
+  }
+}
+
+// A reader converting while another thread observes only ever sees a model
+// that observe() published, never a mix of two.  The writer relearns the
+// module from scratch several times, so that the reader overlaps many
+// publications.
+BOOST_AUTO_TEST_CASE(NoTornModels)
+{
+  const SimulatedModule sim = { 30, 5000 };
+  const int64_t probe = t0_ns + 150*ns_per_second + 777;
+  const int32_t probe_unixtime = sim.unixtime(probe);
+  const uint32_t probe_ticks = sim.fifty_mhz_time(probe);
+
+  CRT::ClockCalibration cal(1);
+  std::vector<int64_t> published{
+    cal.to_ns(0, probe_unixtime, probe_ticks) };
+  std::atomic<bool> started(false), done(false);
+
+  std::vector<int64_t> seen;
+  std::thread reader([&]{
+    started.store(true);
+    while(!done.load())
+      seen.push_back(cal.to_ns(0, probe_unixtime, probe_ticks));
+  });
+  while(!started.load()) std::this_thread::yield();
+
+  std::mt19937 rng(4);
+  for(int pass = 0; pass < 20; pass++){
+    cal.reset();
+    for(int s = 1; s <= 300; s++){
+      const int64_t edge = t0_ns + s*ns_per_second;
+      for(const int64_t ns: { edge - 1000 - int64_t(rng() % 50000),
+                              edge + int64_t(rng() % 50000) }){
+        cal.observe(0, sim.unixtime(ns), sim.fifty_mhz_time(ns));
+        published.push_back(cal.to_ns(0, probe_unixtime, probe_ticks));
+      }
+    }
+  }
+  done.store(true);
+  reader.join();
+
+  BOOST_TEST_MESSAGE(seen.size() << " conversions while observing");
+  BOOST_CHECK(!seen.empty());
+  std::sort(published.begin(), published.end());
+  size_t torn = 0;
+  for(const int64_t ns: seen)
+    torn += !std::binary_search(published.begin(), published.end(), ns);
+  BOOST_CHECK_EQUAL(torn, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,235 @@
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTTimestamp.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#define BOOST_TEST_MODULE(CRTFragmentWriter_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace
+{
+  // The contents of a fragment to write
+  struct Event
+  {
+    CRT::Fragment::header_t header;
+    std::vector<CRT::Fragment::hit_t> hits;
+  };
+
+  Event make_event(std::mt19937& rng, const unsigned int nhit)
+  {
+    Event e;
+    e.header.magic = 'M';
+    e.header.nhit = nhit;
+    e.header.module_num = rng() % 32;
+    e.header.unixtime = CRT::earliest_unixtime + rng() % 100000;
+    e.header.fifty_mhz_time = rng() % CRT::ticks_per_second;
+    for(unsigned int i = 0; i < nhit; i++){
+      CRT::Fragment::hit_t h;
+      h.magic = 'H';
+      h.channel = rng() % CRT::n_channels;
+      h.adc = rng() % CRT::adc_limit;
+      e.hits.push_back(h);
+    }
+    return e;
+  }
+
+  artdaq::Fragment write(Event const& e, const bool checksum)
+  {
+    artdaq::Fragment frag(0, 0, demo::FragmentType::CRT);
+    CRT::FragmentWriter w(frag, e.header.module_num, e.header.unixtime,
+                          e.header.fifty_mhz_time);
+    for(auto const& h: e.hits) w.add_hit(h.channel, h.adc);
+    w.finalize(checksum);
+    return frag;
+  }
+
+  // Check that the fragment passes check_event(), is the right size, and
+  // reads back as the event it was written from
+  void check(CRT::Fragment const& f, Event const& e, const bool checksum)
+  {
+    const CRT::ValidationResult r = CRT::check_event(f.data(), f.size());
+    BOOST_CHECK_EQUAL(CRT::error_name(r.error), CRT::error_name(CRT::no_error));
+    BOOST_CHECK_EQUAL(f.size(), CRT::fragment_bytes(e.hits.size())
+                      + (checksum? sizeof(CRT::Fragment::trailer_t): 0));
+    BOOST_CHECK_EQUAL(f.has_checksum(), checksum);
+    BOOST_CHECK(f.good_checksum());
+
+    BOOST_CHECK_EQUAL(f.module_num(), e.header.module_num);
+    BOOST_CHECK_EQUAL(f.unixtime(), e.header.unixtime);
+    BOOST_CHECK_EQUAL(f.fifty_mhz_time(), e.header.fifty_mhz_time);
+    BOOST_REQUIRE_EQUAL(f.num_hits(), e.hits.size());
+    for(size_t i = 0; i < e.hits.size(); i++){
+      BOOST_CHECK_EQUAL(f.hit(i)->magic, 'H');
+      BOOST_CHECK_EQUAL(f.channel(i), e.hits[i].channel);
+      BOOST_CHECK_EQUAL(f.adc(i), e.hits[i].adc);
+    }
+
+    // The padding after the hits is zeroed
+    const size_t used = sizeof(CRT::Fragment::header_t)
+      + e.hits.size()*sizeof(CRT::Fragment::hit_t);
+    for(size_t i = used; i < CRT::fragment_bytes(e.hits.size()); i++)
+      BOOST_CHECK_EQUAL(f.data()[i], 0);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTFragmentWriter_test)
+
+// Every number of hits, with and without a trailer, reads back as written,
+// and a corrupted byte fails the checksum
+BOOST_AUTO_TEST_CASE(Writer)
+{
+  std::mt19937 rng(1);
+  for(const bool checksum: { false, true }){
+    for(unsigned int nhit = 1; nhit <= CRT::max_hits; nhit++){
+      const Event e = make_event(rng, nhit);
+      artdaq::Fragment frag = write(e, checksum);
+      check(CRT::Fragment(frag), e, checksum);
+      BOOST_CHECK(CRT::check_event(frag).ok());
+
+      if(checksum){
+        // A byte after the header, which says where the trailer is
+        const size_t h = sizeof(CRT::Fragment::header_t);
+        frag.dataBeginBytes()[h + rng() % (CRT::fragment_bytes(nhit) - h)]
+          ^= 0x10;
+        BOOST_CHECK(!CRT::check_event(frag).ok());
+        BOOST_CHECK(!CRT::Fragment(frag).good_checksum());
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WriterLimits)
+{
+  artdaq::Fragment frag(0, 0, demo::FragmentType::CRT);
+  BOOST_CHECK_THROW(CRT::FragmentWriter(frag, 1, CRT::earliest_unixtime, 0,
+                                        CRT::max_hits + 1), cet::exception);
+
+  CRT::FragmentWriter w(frag, 1, CRT::earliest_unixtime, 0, 2);
+  w.add_hit(1, 1);
+  w.add_hit(2, 2);
+  BOOST_CHECK_THROW(w.add_hit(3, 3), cet::exception);
+  w.finalize(true);
+  BOOST_CHECK_THROW(w.add_hit(3, 3), cet::exception);
+  BOOST_CHECK(CRT::check_event(frag).ok());
+
+  // The Fragment has a payload now
+  BOOST_CHECK_THROW(CRT::FragmentWriter(frag, 1, CRT::earliest_unixtime, 0),
+                    cet::exception);
+}
+
+// Fragments built hit by hit and all at once, with and without trailers,
+// read back as written and are byte for byte what FragmentWriter writes,
+// overlaid and copied out, including after the buffer is reused
+BOOST_AUTO_TEST_CASE(Batch)
+{
+  std::mt19937 rng(2);
+  for(const bool checksum: { false, true }){
+    CRT::BatchBuilder batch(20, CRT::max_hits, checksum);
+    for(int round = 0; round < 2; round++){
+      // Big fragments first, so that small ones later go over their hits
+      std::vector<Event> events;
+      while(!batch.full()){
+        const unsigned int nhit = round == 0? CRT::max_hits - rng() % 4
+                                            : 1 + rng() % 8;
+        events.push_back(make_event(rng, nhit));
+        Event const& e = events.back();
+        size_t i;
+        if(events.size() % 2){
+          batch.begin(e.header.module_num, e.header.unixtime,
+                      e.header.fifty_mhz_time);
+          for(auto const& h: e.hits) batch.add_hit(h.channel, h.adc);
+          i = batch.end();
+        }
+        else{
+          i = batch.add(e.header, e.hits.data(), e.hits.size());
+        }
+        BOOST_CHECK_EQUAL(i, events.size() - 1);
+      }
+      BOOST_REQUIRE_EQUAL(batch.size(), events.size());
+
+      size_t bytes = 0;
+      for(size_t i = 0; i < batch.size(); i++){
+        const CRT::Fragment f = batch.fragment(i);
+        check(f, events[i], checksum);
+        BOOST_CHECK_EQUAL(size_t(f.data() - batch.data()), bytes);
+        bytes += f.size();
+
+        artdaq::Fragment copy(0, 0, demo::FragmentType::CRT);
+        batch.copy_to(i, copy);
+        BOOST_CHECK(CRT::check_event(copy).ok());
+        check(CRT::Fragment(copy), events[i], checksum);
+
+        const artdaq::Fragment written = write(events[i], checksum);
+        BOOST_REQUIRE_EQUAL(written.dataSizeBytes(), f.size());
+        BOOST_CHECK(std::equal(f.data(), f.data() + f.size(),
+                               written.dataBeginBytes()));
+      }
+      BOOST_CHECK_EQUAL(batch.bytes(), bytes);
+      batch.clear();
+      BOOST_CHECK_EQUAL(batch.size(), 0u);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BatchLimits)
+{
+  CRT::BatchBuilder batch(2, 2);
+  BOOST_CHECK_THROW(CRT::BatchBuilder(1, CRT::max_hits + 1), cet::exception);
+  BOOST_CHECK_THROW(batch.add_hit(1, 1), cet::exception);
+  BOOST_CHECK_THROW(batch.end(), cet::exception);
+
+  batch.begin(1, CRT::earliest_unixtime, 0);
+  BOOST_CHECK_THROW(batch.begin(1, CRT::earliest_unixtime, 0), cet::exception);
+  batch.add_hit(1, 1);
+  batch.add_hit(2, 2);
+  BOOST_CHECK_THROW(batch.add_hit(3, 3), cet::exception);
+  batch.end();
+
+  CRT::Fragment::hit_t hits[3] = {};
+  BOOST_CHECK_THROW(batch.add(*batch.fragment(0).header(), hits, 3),
+                    cet::exception);
+  batch.add(*batch.fragment(0).header(), batch.fragment(0).hit(0), 2);
+  BOOST_CHECK(batch.full());
+  BOOST_CHECK_THROW(batch.begin(1, CRT::earliest_unixtime, 0), cet::exception);
+  BOOST_CHECK(CRT::check_event(batch.fragment(1).data(),
+                               batch.fragment(1).size()).ok());
+}
+
+// good_event() agrees with check_event(), and each call is counted once,
+// whatever it finds
+BOOST_AUTO_TEST_CASE(GoodEvent)
+{
+  std::mt19937 rng(5);
+  const Event e = make_event(rng, 3);
+
+  std::vector<std::pair<artdaq::Fragment, CRT::Error> > cases;
+  cases.emplace_back(write(e, false), CRT::no_error);
+  cases.emplace_back(write(e, true), CRT::no_error);
+  cases.emplace_back(write(e, false), CRT::bad_channel);
+  const_cast<CRT::Fragment::hit_t *>(
+    CRT::Fragment(cases.back().first).hit(1))->channel = CRT::n_channels;
+  cases.emplace_back(write(e, false), CRT::bad_size);
+  cases.back().first.resizeBytes(sizeof(CRT::Fragment::header_t));
+  cases.emplace_back(write(e, true), CRT::bad_checksum);
+  // The low bit of the first hit's ADC value, which stays in range
+  cases.back().first.dataBeginBytes()[sizeof(CRT::Fragment::header_t)
+                                      + offsetof(CRT::Fragment::hit_t, adc)] ^= 1;
+
+  for(auto const& c: cases){
+    BOOST_TEST_CONTEXT(CRT::error_name(c.second)){
+      const CRT::ValidationCounts before = CRT::validation_counts();
+      BOOST_CHECK_EQUAL(CRT::Fragment(c.first).good_event(),
+                        c.second == CRT::no_error);
+      const CRT::ValidationCounts after = CRT::validation_counts();
+      BOOST_CHECK_EQUAL(after.checked - before.checked, 1u);
+      BOOST_CHECK_EQUAL(after.errors[c.second] - before.errors[c.second], 1u);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTHitDecoder.hh"
+#include "artdaq-core-demo/Overlays/CRTTimestamp.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#define BOOST_TEST_MODULE(CRTHitDecoder_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+  // A fragment of nhit hits.  The decoder doesn't validate, so the hits take
+  // any channel byte and any ADC value, negative ones included.
+  artdaq::Fragment write(std::mt19937& rng, const unsigned int nhit)
+  {
+    artdaq::Fragment frag(0, 0, demo::FragmentType::CRT);
+    CRT::FragmentWriter w(frag, rng() % 32, CRT::earliest_unixtime + rng() % 1000,
+                          rng() % CRT::ticks_per_second);
+    for(unsigned int i = 0; i < nhit; i++)
+      w.add_hit(rng(), rng());
+    w.finalize();
+    return frag;
+  }
+
+  // The hits of fragment f of out are those of frag, as the overlay reads them
+  void check(CRT::DecodedHits const& out, const size_t f,
+             artdaq::Fragment const& frag)
+  {
+    CRT::Fragment const crt(frag);
+    BOOST_CHECK_EQUAL(out.module_num[f], crt.module_num());
+    BOOST_CHECK_EQUAL(out.unixtime[f], crt.unixtime());
+    BOOST_CHECK_EQUAL(out.fifty_mhz_time[f], crt.fifty_mhz_time());
+    BOOST_REQUIRE_EQUAL(out.hit_begin[f + 1] - out.hit_begin[f], crt.num_hits());
+    for(unsigned int i = 0; i < crt.num_hits(); i++){
+      BOOST_TEST_CONTEXT("hit " << i << " of " << crt.num_hits()){
+        BOOST_CHECK_EQUAL(out.channel[out.hit_begin[f] + i], crt.channel(i));
+        BOOST_CHECK_EQUAL(out.adc[out.hit_begin[f] + i], crt.adc(i));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTHitDecoder_test)
+
+// Fragments of every size from 1 to 64 hits, across the 8-hit SIMD blocks
+// and the hits left over after them, decode to what the overlay reads
+BOOST_AUTO_TEST_CASE(MatchesOverlay)
+{
+  std::mt19937 rng(1);
+  artdaq::Fragments frags;
+  for(unsigned int n = 1; n <= CRT::max_hits; n++) frags.push_back(write(rng, n));
+
+  CRT::DecodedHits one;
+  for(size_t f = 0; f < frags.size(); f++){
+    BOOST_REQUIRE(CRT::decode(frags[f], one));
+    check(one, f, frags[f]);
+  }
+
+  CRT::DecodedHits batch;
+  BOOST_CHECK_EQUAL(CRT::decode(frags.data(), frags.size(), batch), frags.size());
+  BOOST_CHECK(batch.channel == one.channel);
+  BOOST_CHECK(batch.adc == one.adc);
+  BOOST_CHECK(batch.hit_begin == one.hit_begin);
+
+  std::vector<artdaq::Fragment const*> pointers;
+  for(auto const& f: frags) pointers.push_back(&f);
+  CRT::DecodedHits by_pointer;
+  BOOST_CHECK_EQUAL(CRT::decode(pointers.data(), pointers.size(), by_pointer),
+                    frags.size());
+  BOOST_CHECK(by_pointer.channel == one.channel);
+  BOOST_CHECK(by_pointer.adc == one.adc);
+  BOOST_CHECK(by_pointer.hit_begin == one.hit_begin);
+}
+
+// A fragment too short for the hits it claims is skipped, and the ones after
+// it still line up
+BOOST_AUTO_TEST_CASE(ShortSkipped)
+{
+  std::mt19937 rng(2);
+  artdaq::Fragments frags;
+  frags.push_back(write(rng, 9));
+  frags.push_back(write(rng, 20));
+  frags.back().resizeBytes(sizeof(CRT::Fragment::header_t)
+                           + 19*sizeof(CRT::Fragment::hit_t));
+  frags.push_back(write(rng, 17));
+
+  CRT::DecodedHits out;
+  BOOST_CHECK(!CRT::decode(frags[1], out));
+  BOOST_CHECK_EQUAL(out.n_fragments(), 0u);
+  BOOST_CHECK_EQUAL(out.n_hits(), 0u);
+
+  BOOST_CHECK_EQUAL(CRT::decode(frags.data(), frags.size(), out), 2u);
+  BOOST_REQUIRE_EQUAL(out.n_fragments(), 2u);
+  BOOST_CHECK_EQUAL(out.n_hits(), 26u);
+  check(out, 0, frags[0]);
+  check(out, 1, frags[2]);
+}
+
+// Appending a fragment at a time grows the columns geometrically, not on
+// every call, and clear() keeps what they have grown to
+BOOST_AUTO_TEST_CASE(Growth)
+{
+  std::mt19937 rng(3);
+  const artdaq::Fragment frag = write(rng, 5);
+
+  CRT::DecodedHits out;
+  size_t reallocations = 0;
+  for(int i = 0; i < 4096; i++){
+    const uint8_t * const before = out.channel.data();
+    BOOST_REQUIRE_EQUAL(CRT::decode(&frag, 1, out), 1u);
+    reallocations += out.channel.data() != before;
+  }
+  BOOST_CHECK_EQUAL(out.n_hits(), 5u*4096);
+  BOOST_CHECK_LE(reallocations, 16u);
+
+  const size_t capacity = out.channel.capacity();
+  out.clear();
+  BOOST_CHECK_EQUAL(out.n_hits(), 0u);
+  BOOST_CHECK_EQUAL(out.hit_begin.size(), 1u);
+  BOOST_CHECK_EQUAL(out.channel.capacity(), capacity);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,263 @@
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTMerger.hh"
+#include "artdaq-core-demo/Overlays/CRTTimestamp.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#define BOOST_TEST_MODULE(CRTMerger_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+  // Start of the tests' clocks: a whole number of seconds after the epoch,
+  // so that the 50MHz counter and the Unix time agree
+  const uint64_t t0 = uint64_t(CRT::earliest_unixtime + 1000)
+    *CRT::ticks_per_second;
+
+  // A one-hit fragment from 'module' at 'ticks' since the epoch, with the
+  // counter truncated to 32 bits as the hardware does
+  artdaq::Fragment make(const uint16_t module, const uint64_t ticks)
+  {
+    artdaq::Fragment frag(0, 0, demo::FragmentType::CRT);
+    CRT::FragmentWriter w(frag, module, ticks/CRT::ticks_per_second,
+                          static_cast<uint32_t>(ticks), 1);
+    w.add_hit(1, 100);
+    w.finalize();
+    return frag;
+  }
+
+  CRT::TimedFragment timed(artdaq::Fragment const& frag)
+  {
+    CRT::Fragment const f(frag);
+    return CRT::TimedFragment{CRT::combined_time(f.unixtime(),
+                                                 f.fifty_mhz_time()),
+                              &frag, 0};
+  }
+
+  // The times of the fragments in a coincidence, relative to t0
+  std::vector<uint64_t> times(CRT::Coincidence const& c)
+  {
+    std::vector<uint64_t> t;
+    for(auto const& tf: c.fragments) t.push_back(tf.time - t0);
+    return t;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTMerger_test)
+
+// A module's counter, read every ten seconds for long enough to roll over
+// several times, unwraps to a continuous count, whether its clock keeps
+// time or runs 50 ppm fast
+BOOST_AUTO_TEST_CASE(Unwrapper)
+{
+  for(const double drift: { 0., 50e-6 }){
+    CRT::TimestampUnwrapper unwrap;
+    for(int i = 0; i < 60; i++){
+      const uint64_t elapsed = uint64_t(i)*10*CRT::ticks_per_second;
+      const uint64_t counter = t0 + elapsed + uint64_t(elapsed*drift);
+      const int32_t unixtime = (t0 + elapsed)/CRT::ticks_per_second;
+      BOOST_CHECK_EQUAL(unwrap(unixtime, static_cast<uint32_t>(counter)),
+                        counter);
+    }
+
+    // After reset() it starts again from the Unix time
+    unwrap.reset();
+    BOOST_CHECK_EQUAL(unwrap(t0/CRT::ticks_per_second + 1, 12345),
+                      CRT::combined_time(t0/CRT::ticks_per_second + 1, 12345));
+  }
+
+  BOOST_CHECK_EQUAL(CRT::tick_difference(5, 0xfffffffb), 10);
+  BOOST_CHECK_EQUAL(CRT::tick_difference(0xfffffffb, 5), -10);
+  BOOST_CHECK_EQUAL(CRT::nearest_ticks(5, (uint64_t(7) << 32) - 5),
+                    (uint64_t(7) << 32) + 5);
+}
+
+// Streams of random times, fed unevenly, come out merged in time order,
+// across a rollover of the 50MHz counter.  No stream fills up, which would
+// let pop() go ahead of an empty one.
+BOOST_AUTO_TEST_CASE(Merger)
+{
+  const size_t nstreams = 4;
+  std::mt19937 rng(3);
+  std::vector<std::vector<artdaq::Fragment> > input(nstreams);
+  uint64_t start = (t0 | 0xffffffffull) - 1000000;
+  for(size_t s = 0; s < nstreams; s++){
+    uint64_t t = start;
+    for(int i = 0; i < 200; i++){
+      t += rng() % 20000;
+      input[s].push_back(make(s, t));
+    }
+  }
+
+  CRT::FragmentMerger merger(nstreams, 200);
+  CRT::TimedFragment tf;
+  BOOST_CHECK(!merger.pop(tf));
+
+  std::vector<uint64_t> out;
+  std::vector<size_t> next(nstreams, 0);
+  size_t remaining = nstreams*200;
+  while(remaining > 0){
+    const size_t s = rng() % nstreams;
+    if(next[s] < input[s].size()){
+      BOOST_REQUIRE(merger.push(s, input[s][next[s]]));
+      if(++next[s] == input[s].size()) merger.close(s);
+    }
+    while(merger.pop(tf)){
+      BOOST_CHECK_EQUAL(CRT::Fragment(*tf.frag).module_num(), tf.stream);
+      out.push_back(tf.time);
+      remaining--;
+    }
+  }
+  BOOST_CHECK_EQUAL(merger.size(), 0u);
+  BOOST_CHECK(!merger.pop_any(tf));
+  BOOST_REQUIRE_EQUAL(out.size(), nstreams*200);
+  BOOST_CHECK(std::is_sorted(out.begin(), out.end()));
+  BOOST_CHECK(out.front() > start && out.back() > (t0 | 0xffffffffull));
+}
+
+BOOST_AUTO_TEST_CASE(MergerWaits)
+{
+  const artdaq::Fragment a = make(0, t0 + 100), b = make(1, t0 + 50);
+  CRT::FragmentMerger merger(2, 1);
+  CRT::TimedFragment tf;
+
+  BOOST_REQUIRE(merger.push(0, a));
+  BOOST_CHECK(!merger.push(0, a));
+
+  // Stream 0 is full, so its fragment can go even though stream 1 is empty
+  BOOST_CHECK(merger.pop(tf));
+  BOOST_CHECK(tf.frag == &a);
+
+  BOOST_REQUIRE(merger.push(0, a));
+  BOOST_REQUIRE(merger.push(1, b));
+  BOOST_REQUIRE(merger.pop(tf));
+  BOOST_CHECK(tf.frag == &b);
+
+  // Stream 1 is open and empty again: only pop_any() takes the rest
+  CRT::FragmentMerger merger2(2, 4);
+  BOOST_REQUIRE(merger2.push(0, a));
+  BOOST_CHECK(!merger2.pop(tf));
+  merger2.close(1);
+  BOOST_CHECK(merger2.pop(tf));
+  BOOST_REQUIRE(merger2.push(0, a));
+  BOOST_REQUIRE(merger2.push(1, b));
+  BOOST_CHECK(merger2.pop(tf));
+  BOOST_CHECK(tf.frag == &b);
+  BOOST_CHECK(!merger2.pop(tf));
+  BOOST_CHECK(merger2.pop_any(tf));
+  BOOST_CHECK(tf.frag == &a);
+  BOOST_CHECK(!merger2.pop_any(tf));
+}
+
+// Module 1 at 0 and 95, module 2 at 105: 95 and 105 are a coincidence,
+// though 105 is more than the window after the first fragment
+BOOST_AUTO_TEST_CASE(SlidingWindow)
+{
+  const std::vector<artdaq::Fragment> frags{
+    make(1, t0), make(1, t0 + 95), make(2, t0 + 105), make(3, t0 + 1000)};
+  CRT::CoincidenceFinder finder(100);
+  CRT::Coincidence c;
+  BOOST_CHECK(!finder.add(timed(frags[0]), c));
+  BOOST_CHECK(!finder.add(timed(frags[1]), c));
+  BOOST_CHECK(!finder.add(timed(frags[2]), c));
+  BOOST_REQUIRE(finder.add(timed(frags[3]), c));
+  BOOST_CHECK(times(c) == (std::vector<uint64_t>{95, 105}));
+  BOOST_CHECK(c.modules == (std::vector<uint16_t>{1, 2}));
+  BOOST_CHECK_EQUAL(c.begin - t0, 95u);
+  BOOST_CHECK_EQUAL(c.end - t0, 105u);
+  BOOST_CHECK(!finder.flush(c));
+}
+
+// A coincidence goes on for as long as the modules keep firing together,
+// and a module firing by itself never makes one, however often it fires
+BOOST_AUTO_TEST_CASE(Extend)
+{
+  std::vector<artdaq::Fragment> frags;
+  for(uint64_t t = 0; t < 2000; t += 30) frags.push_back(make(1, t0 + t));
+  for(uint64_t t = 500; t <= 800; t += 60) frags.push_back(make(2, t0 + t));
+  std::stable_sort(frags.begin(), frags.end(),
+                   [](artdaq::Fragment const& a, artdaq::Fragment const& b)
+                   { return timed(a).time < timed(b).time; });
+
+  CRT::CoincidenceFinder finder(100);
+  std::vector<CRT::Coincidence> found;
+  CRT::Coincidence c;
+  for(auto const& f: frags) if(finder.add(timed(f), c)) found.push_back(c);
+  if(finder.flush(c)) found.push_back(c);
+
+  // From the first of module 1's within the window of module 2's first, to
+  // the last within the window of module 2's last
+  BOOST_REQUIRE_EQUAL(found.size(), 1u);
+  BOOST_CHECK_EQUAL(found[0].begin - t0, 420u);
+  BOOST_CHECK_EQUAL(found[0].end - t0, 900u);
+  BOOST_CHECK(found[0].modules == (std::vector<uint16_t>{1, 2}));
+  BOOST_CHECK_EQUAL(finder.dropped(), 0u);
+}
+
+// Groups found with the sliding window, against looking at every fragment
+// in every window: each coincidence found holds min_modules modules within
+// the window, no fragment is in two, and every window that does hold them
+// overlaps one that was found
+BOOST_AUTO_TEST_CASE(AgainstBruteForce)
+{
+  std::mt19937 rng(4);
+  std::vector<artdaq::Fragment> frags;
+  uint64_t t = t0;
+  for(int i = 0; i < 3000; i++){
+    t += rng() % 200;
+    frags.push_back(make(rng() % 6, t));
+  }
+
+  const uint64_t window = 150;
+  const unsigned int min_modules = 3;
+  CRT::CoincidenceFinder finder(window, min_modules);
+  std::vector<CRT::Coincidence> found;
+  CRT::Coincidence c;
+  for(auto const& f: frags) if(finder.add(timed(f), c)) found.push_back(c);
+  if(finder.flush(c)) found.push_back(c);
+  BOOST_REQUIRE(!found.empty());
+
+  std::vector<int> in_group(frags.size(), 0);
+  for(auto const& g: found){
+    BOOST_CHECK(g.modules.size() >= min_modules);
+    const std::vector<uint64_t> t = times(g);
+    BOOST_CHECK(std::is_sorted(t.begin(), t.end()));
+    for(auto const& tf: g.fragments) in_group[tf.frag - frags.data()]++;
+  }
+  BOOST_CHECK(std::all_of(in_group.begin(), in_group.end(),
+                          [](int n){ return n <= 1; }));
+
+  for(size_t last = 0; last < frags.size(); last++){
+    std::vector<uint16_t> modules;
+    bool any_found = false;
+    const uint64_t end = timed(frags[last]).time;
+    for(size_t i = last + 1; i-- > 0 && end - timed(frags[i]).time <= window;){
+      const uint16_t m = CRT::Fragment(frags[i]).module_num();
+      if(std::find(modules.begin(), modules.end(), m) == modules.end())
+        modules.push_back(m);
+      any_found |= in_group[i] > 0;
+    }
+    if(modules.size() >= min_modules) BOOST_CHECK(any_found);
+  }
+}
+
+// Past max_fragments, fragments are counted but not kept
+BOOST_AUTO_TEST_CASE(Bounded)
+{
+  std::vector<artdaq::Fragment> frags;
+  for(int i = 0; i < 10; i++) frags.push_back(make(i % 2, t0 + i));
+
+  CRT::CoincidenceFinder finder(100, 2, 4);
+  CRT::Coincidence c;
+  for(auto const& f: frags) BOOST_CHECK(!finder.add(timed(f), c));
+  BOOST_REQUIRE(finder.flush(c));
+  BOOST_CHECK_EQUAL(c.fragments.size(), 4u);
+  BOOST_CHECK_EQUAL(finder.dropped(), 6u);
+
+  BOOST_CHECK_THROW(CRT::CoincidenceFinder(100, 2, 0), cet::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,153 @@
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTPackedFragment.hh"
+
+#define BOOST_TEST_MODULE(CRTPackedFragment_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+  const int32_t unixtime = 1600000000;
+
+  // Pack fragment i of the batch, unpack it, and check that it comes back
+  // as it was, through unpack() and through decode()
+  void round_trip(CRT::BatchBuilder const& batch, const size_t i)
+  {
+    CRT::Fragment const crt = batch.fragment(i);
+    const uint8_t * const data = crt.data();
+
+    for(const bool checksum: { false, true }){
+      std::vector<uint8_t> packed(CRT::packed_size(crt.num_hits(), checksum));
+      BOOST_REQUIRE_EQUAL(CRT::pack(data, crt.size(), packed.data(), checksum),
+                          packed.size());
+      BOOST_REQUIRE(CRT::check_packed(packed.data(), packed.size()).ok());
+
+      std::vector<uint8_t> unpacked(crt.size());
+      BOOST_REQUIRE_EQUAL(CRT::unpack(packed.data(), packed.size(),
+                                      unpacked.data()), crt.size());
+      BOOST_CHECK(std::equal(unpacked.begin(), unpacked.end(), data));
+
+      CRT::PackedFragment const p(packed.data(), packed.size());
+      BOOST_CHECK_EQUAL(p.has_checksum(), checksum);
+      BOOST_CHECK_LE(packed.size(), crt.size() + (checksum? 8: 0));
+      CRT::DecodedHits hits;
+      BOOST_REQUIRE(CRT::decode(p, hits));
+      for(unsigned int k = 0; k < crt.num_hits(); k++){
+        BOOST_CHECK_EQUAL(p.channel(k), crt.channel(k));
+        BOOST_CHECK_EQUAL(p.adc(k), crt.adc(k));
+        BOOST_CHECK_EQUAL(hits.channel[k], crt.channel(k));
+        BOOST_CHECK_EQUAL(hits.adc[k], crt.adc(k));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTPackedFragment_test)
+
+// Every channel with every ADC value, in fragments of every size, so that
+// each value lands in each position of a group of four and of the SIMD
+// groups of eight
+BOOST_AUTO_TEST_CASE(FullRange)
+{
+  CRT::BatchBuilder batch(64);
+  unsigned int n = 0, nhit = 1;
+  for(unsigned int channel = 0; channel < CRT::n_channels; channel++){
+    for(int adc = 0; adc < CRT::adc_limit; adc++){
+      if(n == 0) batch.begin(channel, unixtime, adc);
+      batch.add_hit(channel, adc);
+      if(++n < nhit) continue;
+
+      round_trip(batch, batch.end());
+      if(batch.full()) batch.clear();
+      n = 0;
+      nhit = nhit%CRT::max_hits + 1;
+    }
+  }
+}
+
+// The extremes of both fields next to each other, in every arrangement of a
+// group of four
+BOOST_AUTO_TEST_CASE(Extremes)
+{
+  const uint8_t channels[] = { 0, 63 };
+  const int16_t adcs[] = { 0, 4095 };
+  CRT::BatchBuilder batch(1);
+  for(unsigned int bits = 0; bits < 256; bits++){
+    batch.clear();
+    batch.begin(1, unixtime, 0);
+    for(int k = 0; k < 4; k++)
+      batch.add_hit(channels[bits >> 2*k & 1], adcs[bits >> (2*k + 1) & 1]);
+    round_trip(batch, batch.end());
+  }
+}
+
+// A negative ADC value used to sign-extend over the hits after it
+BOOST_AUTO_TEST_CASE(NegativeADCRejected)
+{
+  CRT::BatchBuilder batch(1);
+  batch.begin(1, unixtime, 0);
+  const int16_t adcs[] = { 100, -1, 200, 300 };
+  for(int k = 0; k < 4; k++) batch.add_hit(k, adcs[k]);
+  batch.end();
+
+  CRT::Fragment const crt = batch.fragment(0);
+  std::vector<uint8_t> packed(CRT::packed_size(4));
+  BOOST_CHECK_EQUAL(CRT::pack(crt.data(), crt.size(), packed.data()), 0u);
+
+  artdaq::Fragment in, out;
+  in.resizeBytes(crt.size());
+  std::copy(crt.data(), crt.data() + crt.size(), in.dataBeginBytes());
+  BOOST_CHECK(!CRT::pack(in, out));
+  BOOST_CHECK_EQUAL(out.dataSizeBytes(), 0u);
+}
+
+// Without a checksum, one hit takes no more room packed than unpacked, and
+// the checksum takes a word only where the padding has no room for it
+BOOST_AUTO_TEST_CASE(Sizes)
+{
+  BOOST_CHECK_EQUAL(CRT::packed_size(1, false), 16u);
+  BOOST_CHECK_EQUAL(CRT::packed_size(1, true), 24u);
+  BOOST_CHECK_EQUAL(CRT::packed_size(2, true), 24u);
+  BOOST_CHECK_EQUAL(CRT::packed_size(CRT::max_hits, false), 160u);
+  BOOST_CHECK_EQUAL(CRT::packed_size(CRT::max_hits, true), 160u);
+}
+
+// The checksum is the CRC-32C of the header and of what follows it, and
+// a change to any bit after the magic is caught
+BOOST_AUTO_TEST_CASE(Checksum)
+{
+  for(const int nhit: { 1, 5, 64 }){
+    CRT::BatchBuilder batch(1);
+    batch.begin(7, unixtime, 12345);
+    for(int k = 0; k < nhit; k++) batch.add_hit(k % CRT::n_channels, 40*k);
+    batch.end();
+    CRT::Fragment const crt = batch.fragment(0);
+
+    std::vector<uint8_t> packed(CRT::packed_size(nhit));
+    BOOST_REQUIRE_EQUAL(CRT::pack(crt.data(), crt.size(), packed.data()),
+                        packed.size());
+    const size_t header = sizeof(CRT::PackedFragment::header_t);
+    std::vector<uint8_t> covered(packed.begin(), packed.begin() + header);
+    covered.insert(covered.end(), packed.begin() + header + 4, packed.end());
+    CRT::PackedFragment const p(packed.data(), packed.size());
+    BOOST_CHECK_EQUAL(p.checksum(),
+                      demo::crc32c(covered.data(), covered.size()));
+
+    for(size_t bit = 8; bit < 8*packed.size(); bit++){
+      packed[bit/8] ^= 1 << bit%8;
+      BOOST_CHECK(!CRT::check_packed(packed.data(), packed.size()).ok());
+      packed[bit/8] ^= 1 << bit%8;
+    }
+    BOOST_CHECK(CRT::check_packed(packed.data(), packed.size()).ok());
+
+    // Claiming a checksum that isn't there, or leaving one out, changes
+    // the size
+    packed[0] = CRT::packed_magic;
+    BOOST_CHECK_EQUAL(CRT::check_packed(packed.data(), packed.size()).ok(),
+                      CRT::packed_size(nhit, false) == packed.size());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,185 @@
+#include "artdaq-core-demo/Overlays/CRTBatchValidator.hh"
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTParallel.hh"
+#include "artdaq-core-demo/Overlays/CRTTimestamp.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#define BOOST_TEST_MODULE(CRTParallel_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  // n CRT fragments of 1 to 64 hits, about one in eight of them corrupt in
+  // one of several ways
+  artdaq::Fragments make(const size_t n, const unsigned int seed)
+  {
+    std::mt19937 rng(seed);
+    artdaq::Fragments frags;
+    for(size_t i = 0; i < n; i++){
+      frags.emplace_back(i, 0, demo::FragmentType::CRT);
+      const unsigned int nhit = 1 + rng() % CRT::max_hits;
+      CRT::FragmentWriter w(frags.back(), i % 32, CRT::earliest_unixtime + 1,
+                            rng() % CRT::ticks_per_second, nhit);
+      for(unsigned int h = 0; h < nhit; h++)
+        w.add_hit(rng() % CRT::n_channels, rng() % CRT::adc_limit);
+      w.finalize(rng() % 2);
+
+      uint8_t * const data = frags.back().dataBeginBytes();
+      switch(rng() % 40){
+      case 0: data[0] = 'X'; break; // header magic
+      case 1: data[sizeof(CRT::Fragment::header_t)] = 'X'; break; // hit magic
+      case 2: frags.back().resizeBytes(sizeof(artdaq::RawDataType)); break;
+      case 3: data[1] = 0; break; // no hits
+      case 4: data[frags.back().dataSizeBytes() - 1] ^= 1; break; // caught by a checksum
+      default: break;
+      }
+    }
+    return frags;
+  }
+
+  std::vector<artdaq::Fragment const*> pointers(artdaq::Fragments const& frags)
+  {
+    std::vector<artdaq::Fragment const*> p;
+    for(auto const& f: frags) p.push_back(&f);
+    return p;
+  }
+
+  // What validate_batch() and decode() give one fragment after another
+  CRT::BatchResult serial(artdaq::Fragment const* const* frags, const size_t n)
+  {
+    CRT::BatchResult r;
+    r.masks.resize(n);
+    CRT::validate_batch(frags, n, r.masks.data());
+    for(size_t i = 0; i < n; i++){
+      if(r.masks[i]) continue;
+      BOOST_REQUIRE(CRT::decode(*frags[i], r.hits));
+      r.fragment_index.push_back(i);
+    }
+    return r;
+  }
+
+  void check_equal(CRT::BatchResult const& got, CRT::BatchResult const& want)
+  {
+    BOOST_CHECK(got.masks == want.masks);
+    BOOST_CHECK(got.fragment_index == want.fragment_index);
+    BOOST_CHECK(got.hits.channel == want.hits.channel);
+    BOOST_CHECK(got.hits.adc == want.hits.adc);
+    BOOST_CHECK(got.hits.module_num == want.hits.module_num);
+    BOOST_CHECK(got.hits.unixtime == want.hits.unixtime);
+    BOOST_CHECK(got.hits.fifty_mhz_time == want.hits.fifty_mhz_time);
+    BOOST_CHECK(got.hits.hit_begin == want.hits.hit_begin);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTParallel_test)
+
+// process() gives what validating and decoding one fragment after another
+// does, in input order, for chunks smaller and bigger than the batch, and
+// reusing the result
+BOOST_AUTO_TEST_CASE(Process)
+{
+  artdaq::Fragments const frags = make(1000, 1);
+  auto const all = pointers(frags);
+
+  size_t bad = 0;
+  for(const auto m: serial(all.data(), all.size()).masks) bad += m != 0;
+  BOOST_REQUIRE_GT(bad, 50u);
+
+  CRT::BatchResult out;
+  for(const size_t threads: { 1, 2, 4 }){
+    for(const size_t chunk: { 1, 7, 64, 5000 }){
+      BOOST_TEST_CONTEXT(threads << " threads, chunks of " << chunk)
+      {
+        CRT::ParallelProcessor processor(threads, chunk);
+        for(const size_t n: { 1000, 0, 1, 333 }){
+          processor.process(all.data(), n, out);
+          check_equal(out, serial(all.data(), n));
+        }
+      }
+    }
+  }
+
+  CRT::ParallelProcessor processor(2);
+  processor.process(frags, out);
+  check_equal(out, serial(all.data(), all.size()));
+}
+
+// Results come back from next() in the order the batches went in, each as
+// process() gives it
+BOOST_AUTO_TEST_CASE(Stream)
+{
+  artdaq::Fragments const frags = make(2000, 2);
+  auto const all = pointers(frags);
+  CRT::ParallelProcessor processor(3, 16);
+
+  std::mt19937 rng(3);
+  std::vector<std::pair<size_t, size_t>> batches;
+  for(size_t at = 0; at < all.size();){
+    const size_t n = std::min<size_t>(rng() % 300, all.size() - at);
+    batches.emplace_back(at, n);
+    at += n;
+  }
+
+  CRT::ParallelStream stream(processor, 3);
+  CRT::BatchResult out;
+  BOOST_CHECK(!stream.next(out));
+
+  size_t returned = 0;
+  for(auto const& b: batches){
+    if(stream.in_flight() == 3){
+      BOOST_REQUIRE(stream.next(out));
+      auto const& r = batches[returned++];
+      check_equal(out, serial(all.data() + r.first, r.second));
+    }
+    stream.submit(all.data() + b.first, b.second);
+  }
+  while(stream.next(out)){
+    auto const& r = batches[returned++];
+    check_equal(out, serial(all.data() + r.first, r.second));
+  }
+  BOOST_CHECK_EQUAL(returned, batches.size());
+  BOOST_CHECK_EQUAL(stream.in_flight(), 0u);
+}
+
+// submit() waits while max_in_flight batches are waiting for next()
+BOOST_AUTO_TEST_CASE(InFlightBound)
+{
+  artdaq::Fragments const frags = make(100, 4);
+  auto const all = pointers(frags);
+  CRT::ParallelProcessor processor(2);
+  CRT::ParallelStream stream(processor, 2);
+
+  stream.submit(all.data(), 50);
+  stream.submit(all.data() + 50, 50);
+  BOOST_CHECK_EQUAL(stream.in_flight(), 2u);
+
+  std::atomic<bool> submitted(false);
+  std::thread producer([&]{
+    stream.submit(all.data(), 100);
+    submitted = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_CHECK(!submitted);
+  BOOST_CHECK_EQUAL(stream.in_flight(), 2u);
+
+  CRT::BatchResult out;
+  BOOST_REQUIRE(stream.next(out));
+  producer.join();
+  BOOST_CHECK(submitted);
+  check_equal(out, serial(all.data(), 50));
+
+  BOOST_REQUIRE(stream.next(out));
+  check_equal(out, serial(all.data() + 50, 50));
+  BOOST_REQUIRE(stream.next(out));
+  check_equal(out, serial(all.data(), 100));
+  BOOST_CHECK(!stream.next(out));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,74 @@
+#include "artdaq-core-demo/Overlays/CRTStreamFramer.hh"
+
+#define BOOST_TEST_MODULE(CRTStreamFramer_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  // Append a frame of nhit hits to the stream
+  void add_frame(std::vector<uint8_t>& stream, const uint16_t module,
+                 const unsigned int nhit)
+  {
+    CRT::Fragment::header_t h;
+    h.magic = 'M';
+    h.nhit = nhit;
+    h.module_num = module;
+    h.unixtime = 1600000000;
+    h.fifty_mhz_time = 1000*module;
+    const uint8_t * const hp = reinterpret_cast<const uint8_t *>(&h);
+    stream.insert(stream.end(), hp, hp + sizeof h);
+
+    for(unsigned int i = 0; i < nhit; i++){
+      CRT::Fragment::hit_t hit;
+      hit.magic = 'H';
+      hit.channel = i;
+      hit.adc = 100 + i;
+      const uint8_t * const p = reinterpret_cast<const uint8_t *>(&hit);
+      stream.insert(stream.end(), p, p + sizeof hit);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTStreamFramer_test)
+
+// Frames with more hits than the BatchBuilder takes are dropped, and the
+// framer stays in step for the frames after them, however the stream is cut
+BOOST_AUTO_TEST_CASE(FrameTooBigForBuilder)
+{
+  std::vector<uint8_t> stream;
+  add_frame(stream, 1, 4);
+  add_frame(stream, 2, 20);
+  add_frame(stream, 3, 8);
+  add_frame(stream, 4, 64);
+  add_frame(stream, 5, 1);
+
+  for(size_t chunk = 1; chunk <= stream.size(); chunk++){
+    CRT::BatchBuilder out(16, 8);
+    CRT::StreamFramer framer(out);
+    for(size_t i = 0; i < stream.size(); i += chunk){
+      const size_t n = std::min(chunk, stream.size() - i);
+      BOOST_REQUIRE_EQUAL(framer.push(stream.data() + i, n), n);
+    }
+
+    BOOST_REQUIRE_EQUAL(out.size(), 3u);
+    BOOST_CHECK_EQUAL(out.fragment(0).module_num(), 1);
+    BOOST_CHECK_EQUAL(out.fragment(1).module_num(), 3);
+    BOOST_CHECK_EQUAL(out.fragment(2).module_num(), 5);
+
+    CRT::FramerStats const& s = framer.stats();
+    BOOST_CHECK_EQUAL(s.bytes, stream.size());
+    BOOST_CHECK_EQUAL(s.frames, 3u);
+    BOOST_CHECK_EQUAL(s.hits, 13u);
+    BOOST_CHECK_EQUAL(s.rejected, 2u);
+    BOOST_CHECK_EQUAL(s.skipped_bytes, 2*sizeof(CRT::Fragment::header_t)
+                      + 84*sizeof(CRT::Fragment::hit_t));
+    BOOST_CHECK_EQUAL(s.resyncs, 0u);
+    BOOST_CHECK_EQUAL(framer.pending(), 0u);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,179 @@
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTTimeIndex.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#define BOOST_TEST_MODULE(CRTTimeIndex_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+  // n CRT fragments from 'modules' modules, each module's in time order,
+  // a random few thousand ticks apart so that some share a time
+  artdaq::Fragments make(const size_t n, const unsigned int modules,
+                         const unsigned int seed)
+  {
+    std::mt19937 rng(seed);
+    artdaq::Fragments frags;
+    int32_t unixtime = CRT::earliest_unixtime + 1000;
+    uint32_t fifty_mhz_time = 0;
+    for(size_t i = 0; i < n; i++){
+      fifty_mhz_time += rng() % 4000;
+      if(fifty_mhz_time >= CRT::ticks_per_second){
+        fifty_mhz_time -= CRT::ticks_per_second;
+        unixtime++;
+      }
+      frags.emplace_back(i, 0, demo::FragmentType::CRT);
+      CRT::FragmentWriter w(frags.back(), i % modules, unixtime,
+                            fifty_mhz_time, 2);
+      w.add_hit(rng() % CRT::n_channels, rng() % CRT::adc_limit);
+      w.finalize();
+    }
+    return frags;
+  }
+
+  // The entries of 'index' with begin <= time < end, by looking at each one
+  CRT::TimeRange scan(CRT::TimeIndex const& index, const uint64_t begin,
+                      const uint64_t end)
+  {
+    CRT::TimeRange r = { 0, 0 };
+    while(r.begin < index.size() && index.time(r.begin) < begin) r.begin++;
+    r.end = r.begin;
+    while(r.end < index.size() && index.time(r.end) < end) r.end++;
+    return r;
+  }
+
+  void check_range(CRT::TimeRange const& got, CRT::TimeRange const& want)
+  {
+    BOOST_CHECK_EQUAL(got.begin, want.begin);
+    BOOST_CHECK_EQUAL(got.end, want.end);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTTimeIndex_test)
+
+// Entries are in time order, and each fragment is in the index once
+BOOST_AUTO_TEST_CASE(Order)
+{
+  artdaq::Fragments const frags = make(500, 4, 1);
+  CRT::TimeIndex const index(frags);
+  BOOST_REQUIRE_EQUAL(index.size(), frags.size());
+  BOOST_CHECK_EQUAL(index.skipped(), 0u);
+
+  std::vector<bool> seen(frags.size(), false);
+  for(size_t i = 0; i < index.size(); i++){
+    if(i > 0) BOOST_CHECK_LE(index.time(i - 1), index.time(i));
+    const size_t f = index.fragment(i);
+    BOOST_REQUIRE_LT(f, frags.size());
+    BOOST_CHECK(!seen[f]);
+    seen[f] = true;
+    BOOST_CHECK_EQUAL(index.module(i), CRT::Fragment(frags[f]).module_num());
+  }
+}
+
+// Fragments of other types, and CRT fragments without room for their
+// header or hits, are left out, and the latter are counted
+BOOST_AUTO_TEST_CASE(BadFragments)
+{
+  artdaq::Fragments frags = make(20, 2, 2);
+
+  // No payload, one word less than a header, and a header whose hits
+  // don't all fit
+  frags.emplace_back(100, 0, demo::FragmentType::CRT);
+  frags.emplace_back(101, 0, demo::FragmentType::CRT);
+  frags.back().resizeBytes(sizeof(artdaq::RawDataType));
+  frags.emplace_back(102, 0, demo::FragmentType::CRT);
+  {
+    CRT::FragmentWriter w(frags.back(), 0, CRT::earliest_unixtime, 0, 4);
+    for(int i = 0; i < 4; i++) w.add_hit(i, i);
+    w.finalize();
+  }
+  frags.back().resizeBytes(2*sizeof(artdaq::RawDataType));
+  frags.emplace_back(103, 0, demo::FragmentType::ASCII);
+  frags.back().resizeBytes(sizeof(CRT::Fragment::header_t));
+
+  std::vector<size_t> good;
+  for(size_t i = 0; i < 10; i++) good.push_back(i);
+  for(size_t i = 10; i < 20; i++) good.push_back(i + 4);
+  artdaq::Fragments mixed;
+  for(size_t i = 0; i < 10; i++) mixed.push_back(frags[i]);
+  for(size_t i = 20; i < frags.size(); i++) mixed.push_back(frags[i]);
+  for(size_t i = 10; i < 20; i++) mixed.push_back(frags[i]);
+
+  CRT::TimeIndex const index(mixed);
+  BOOST_CHECK_EQUAL(index.size(), 20u);
+  BOOST_CHECK_EQUAL(index.skipped(), 3u);
+
+  std::vector<size_t> indexed;
+  for(size_t i = 0; i < index.size(); i++)
+    indexed.push_back(index.fragment(i));
+  std::sort(indexed.begin(), indexed.end());
+  BOOST_CHECK(indexed == good);
+}
+
+BOOST_AUTO_TEST_CASE(Empty)
+{
+  CRT::TimeIndex const index(artdaq::Fragments{});
+  BOOST_CHECK_EQUAL(index.size(), 0u);
+  BOOST_CHECK_EQUAL(index.lower_bound(0), 0u);
+  BOOST_CHECK(index.window(1000, 10).empty());
+}
+
+// lower_bound(), range() and window() against a scan, at the entries'
+// times, either side of them and beyond both ends
+BOOST_AUTO_TEST_CASE(Lookups)
+{
+  for(const size_t n: { 1, 2, 3, 7, 8, 9, 100, 1000 }){
+    artdaq::Fragments const frags = make(n, 3, n);
+    CRT::TimeIndex const index(frags);
+    BOOST_REQUIRE_EQUAL(index.size(), n);
+
+    std::vector<uint64_t> ts = { 0, UINT64_MAX };
+    for(size_t i = 0; i < n; i++){
+      ts.push_back(index.time(i) - 1);
+      ts.push_back(index.time(i));
+      ts.push_back(index.time(i) + 1);
+    }
+    for(const uint64_t t: ts){
+      BOOST_CHECK_EQUAL(index.lower_bound(t), scan(index, t, t).begin);
+      check_range(index.range(t, t + 5000), scan(index, t, t + 5000));
+      for(const uint64_t w: { 0, 1, 2000 }){
+        check_range(index.window(t, w),
+                    scan(index, t > w? t - w: 0,
+                         t + w < t || t + w == UINT64_MAX? UINT64_MAX:
+                         t + w + 1));
+      }
+    }
+  }
+}
+
+// windows() gives the same as window() one at a time, with the triggers
+// in order and not
+BOOST_AUTO_TEST_CASE(Windows)
+{
+  artdaq::Fragments const frags = make(1000, 4, 3);
+  CRT::TimeIndex const index(frags);
+
+  std::mt19937 rng(4);
+  const uint64_t first = index.time(0), last = index.time(index.size() - 1);
+  std::vector<uint64_t> triggers;
+  for(size_t i = 0; i < 300; i++)
+    triggers.push_back(first - 10000 + rng() % (last - first + 20000));
+
+  std::vector<uint32_t> order;
+  std::vector<CRT::TimeRange> out(triggers.size());
+  for(const bool sorted: { true, false }){
+    if(sorted) std::sort(triggers.begin(), triggers.end());
+    else std::shuffle(triggers.begin(), triggers.end(), rng);
+    for(const uint64_t w: { 0, 500, 50000 }){
+      index.windows(triggers.data(), triggers.size(), w, out.data(), order);
+      for(size_t i = 0; i < triggers.size(); i++)
+        check_range(out[i], index.window(triggers[i], w));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
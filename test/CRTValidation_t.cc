@@ -0,0 +1,104 @@
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#define BOOST_TEST_MODULE(CRTValidation_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  int64_t steady_second()
+  {
+    return std::chrono::duration_cast<std::chrono::seconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CRTValidation_test)
+
+// Hex dumps are off until a rate is set
+BOOST_AUTO_TEST_CASE(HexDumpsOffByDefault)
+{
+  for(int i = 0; i < 1000; i++) BOOST_REQUIRE(!CRT::hex_dump_allowed());
+}
+
+// With a rate of n, threads asking all at once for over two seconds get no
+// more than n dumps in each second, and at least n in the one whole second,
+// and none once the rate is set back to zero
+BOOST_AUTO_TEST_CASE(HexDumpRate)
+{
+  const unsigned int rate = 5;
+  CRT::set_hex_dump_rate(rate);
+
+  std::atomic<unsigned int> allowed(0);
+  const int64_t first = steady_second();
+  const auto stop = std::chrono::steady_clock::now()
+    + std::chrono::milliseconds(2200);
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 4; t++)
+    threads.emplace_back([&]{
+      while(std::chrono::steady_clock::now() < stop)
+        if(CRT::hex_dump_allowed()) allowed++;
+    });
+  for(auto & t: threads) t.join();
+  const int64_t last = steady_second();
+
+  BOOST_CHECK_LE(allowed.load(), rate*(last - first + 1));
+  BOOST_CHECK_GE(allowed.load(), rate);
+
+  CRT::set_hex_dump_rate(0);
+  for(int i = 0; i < 1000; i++) BOOST_REQUIRE(!CRT::hex_dump_allowed());
+}
+
+// Validations counted on several threads, by error and by mask, and through
+// check_event(), all add up, including those of threads that have exited
+BOOST_AUTO_TEST_CASE(CountsAcrossThreads)
+{
+  artdaq::Fragment bad(0, 0, demo::FragmentType::CRT);
+  {
+    CRT::FragmentWriter w(bad, 1, CRT::earliest_unixtime, 0);
+    w.add_hit(CRT::n_channels - 1, 1);
+    w.finalize();
+  }
+  bad.dataBeginBytes()[0] = 'm';
+
+  const int nthreads = 4, n = 1000;
+  const CRT::error_mask_t two = CRT::error_bit(CRT::bad_channel)
+                              | CRT::error_bit(CRT::bad_adc);
+
+  // Boost.Test's checks aren't for use on other threads
+  std::atomic<int> wrong(0);
+  const CRT::ValidationCounts before = CRT::validation_counts();
+  std::vector<std::thread> threads;
+  for(int t = 0; t < nthreads; t++)
+    threads.emplace_back([&]{
+      for(int i = 0; i < n; i++){
+        CRT::count_validation(static_cast<CRT::Error>(i % CRT::n_errors));
+        CRT::count_validation(two);
+        CRT::count_validation(CRT::error_mask_t(0));
+        if(CRT::check_event(bad).error != CRT::bad_header_magic) wrong++;
+      }
+    });
+  for(auto & t: threads) t.join();
+  const CRT::ValidationCounts after = CRT::validation_counts();
+
+  BOOST_CHECK_EQUAL(wrong.load(), 0);
+  BOOST_CHECK_EQUAL(after.checked - before.checked, 4u*nthreads*n);
+  for(int e = 0; e < CRT::n_errors; e++){
+    BOOST_TEST_CONTEXT(CRT::error_name(static_cast<CRT::Error>(e))){
+      uint64_t expect = 0;
+      for(int i = 0; i < n; i++) expect += i % CRT::n_errors == e;
+      if(e == CRT::no_error) expect += n;
+      if(e == CRT::bad_channel || e == CRT::bad_adc) expect += n;
+      if(e == CRT::bad_header_magic) expect += n;
+      BOOST_CHECK_EQUAL(after.errors[e] - before.errors[e], nthreads*expect);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
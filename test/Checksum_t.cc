@@ -0,0 +1,283 @@
+#include "artdaq-core-demo/Overlays/AsciiFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/Checksum.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/OverlayDecoders.hh"
+#include "artdaq-core-demo/Overlays/UDPFragmentWriter.hh"
+
+#define BOOST_TEST_MODULE(Checksum_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::vector<uint8_t> random_bytes(size_t n, unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+		std::vector<uint8_t> v(n);
+		for (auto& b : v) b = static_cast<uint8_t>(rng());
+		return v;
+	}
+
+	std::unique_ptr<artdaq::Fragment> ascii(std::string const& line, bool checksum)
+	{
+		demo::AsciiFragment::Metadata metadata;
+		metadata.charsInLine = line.size();
+		auto frag = artdaq::Fragment::FragmentBytes(0, 0, 0, demo::FragmentType::ASCII, metadata);
+		demo::AsciiFragmentWriter writer(*frag);
+		writer.resize(line.size());
+		memcpy(reinterpret_cast<char*>(writer.header_() + 1), line.data(), line.size());
+		if (checksum) writer.write_checksum();
+		return frag;
+	}
+
+	std::unique_ptr<artdaq::Fragment> udp(std::string const& datagram, bool checksum)
+	{
+		demo::UDPFragment::Metadata metadata;
+		memset(&metadata, 0, sizeof metadata);
+		auto frag = artdaq::Fragment::FragmentBytes(0, 0, 0, demo::FragmentType::UDP, metadata);
+		demo::UDPFragmentWriter writer(*frag);
+		writer.resize(datagram.size());
+		memcpy(reinterpret_cast<char*>(writer.header_() + 1), datagram.data(), datagram.size());
+		if (checksum) writer.write_checksum();
+		return frag;
+	}
+
+	std::unique_ptr<artdaq::Fragment> crt(size_t nhit, bool checksum)
+	{
+		std::unique_ptr<artdaq::Fragment> frag(new artdaq::Fragment(0, 0, demo::FragmentType::CRT));
+		CRT::FragmentWriter w(*frag, 3, CRT::earliest_unixtime + 1000, 12345, nhit);
+		for (size_t i = 0; i < nhit; ++i) w.add_hit(i % CRT::n_channels, 100 + i);
+		w.finalize(checksum);
+		return frag;
+	}
+
+	std::vector<demo::ChecksumStatus> verify(std::vector<std::unique_ptr<artdaq::Fragment>> const& frags, size_t& nbad)
+	{
+		std::vector<artdaq::Fragment const*> pointers;
+		for (auto const& f : frags) pointers.push_back(f.get());
+		std::vector<demo::ChecksumStatus> status(frags.size());
+		nbad = demo::verifyChecksums(pointers.data(), pointers.size(), status.data());
+		return status;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(Checksum_test)
+
+// The check value of CRC-32C, whole and in pieces
+BOOST_AUTO_TEST_CASE(CheckValue)
+{
+	char const* const s = "123456789";
+	BOOST_CHECK_EQUAL(demo::crc32c(s, 9), 0xE3069283u);
+	BOOST_CHECK_EQUAL(demo::detail::crc32cSoftware(s, 9), 0xE3069283u);
+	BOOST_CHECK_EQUAL(demo::crc32c(s + 4, 5, demo::crc32c(s, 4)), 0xE3069283u);
+	BOOST_CHECK_EQUAL(demo::crc32c(s, 0), 0u);
+}
+
+// The crc32 instruction, where the CPU has it, against the table lookup, either side of where
+// the three streams of long and short blocks start and stop, and from unaligned starts
+BOOST_AUTO_TEST_CASE(HardwareMatchesSoftware)
+{
+	BOOST_TEST_MESSAGE("crc32c() uses " << (demo::detail::crc32cHardware() ? "SSE4.2" : "the table lookup"));
+
+	size_t const blocks[] = {0, 3 * 256, 2 * 3 * 256, 3 * 8192, 3 * 8192 + 3 * 256, 2 * 3 * 8192};
+	std::vector<uint8_t> const data = random_bytes(2 * 3 * 8192 + 64, 1);
+	for (size_t const block : blocks)
+	{
+		for (size_t n = block < 9 ? 0 : block - 9; n <= block + 9; ++n)
+		{
+			for (size_t const offset : {0, 1, 3, 7})
+			{
+				BOOST_TEST_CONTEXT("length " << n << ", offset " << offset)
+				{
+					uint8_t const* const p = data.data() + offset;
+					BOOST_CHECK_EQUAL(demo::crc32c(p, n), demo::detail::crc32cSoftware(p, n));
+					BOOST_CHECK_EQUAL(demo::crc32c(p + n / 2, n - n / 2, demo::crc32c(p, n / 2)), demo::detail::crc32cSoftware(p, n));
+				}
+			}
+		}
+	}
+}
+
+// crc32cBatch() against crc32c() one by one, for every count up to a few groups of three, with
+// buffers of mixed sizes, empty ones included
+BOOST_AUTO_TEST_CASE(Batch)
+{
+	std::vector<uint8_t> const data = random_bytes(1 << 16, 2);
+	std::mt19937 rng(3);
+	for (size_t n = 0; n <= 10; ++n)
+	{
+		std::vector<uint8_t const*> buffers;
+		std::vector<size_t> sizes;
+		for (size_t i = 0; i < n; ++i)
+		{
+			sizes.push_back(i % 4 == 3 ? 0 : rng() % 2000);
+			buffers.push_back(data.data() + rng() % (data.size() - sizes.back()));
+		}
+
+		std::vector<uint32_t> crcs(n + 1, 0xdeadbeef);
+		demo::crc32cBatch(buffers.data(), sizes.data(), n, crcs.data());
+		for (size_t i = 0; i < n; ++i)
+		{
+			BOOST_TEST_CONTEXT("count " << n << ", buffer " << i)
+			{
+				BOOST_CHECK_EQUAL(crcs[i], demo::crc32c(buffers[i], sizes[i]));
+			}
+		}
+		BOOST_CHECK_EQUAL(crcs[n], 0xdeadbeefu);
+	}
+}
+
+// Fragments of each type, with and without checksums, good, corrupted and cut short, more than
+// verifyChecksums() takes in one chunk
+BOOST_AUTO_TEST_CASE(VerifyChecksums)
+{
+	std::vector<std::unique_ptr<artdaq::Fragment>> frags;
+	std::vector<demo::ChecksumStatus> expected;
+	for (int i = 0; i < 20; ++i)
+	{
+		bool const checksum = i % 2 == 0;
+		auto const status = checksum ? demo::ChecksumStatus::Good : demo::ChecksumStatus::None;
+		frags.push_back(ascii(std::string(i + 1, 'a' + i), checksum));
+		frags.push_back(udp(std::string(3 * i + 1, 'A' + i), checksum));
+		frags.push_back(crt(i + 1, checksum));
+		expected.insert(expected.end(), 3, status);
+	}
+
+	// Another type, which never has a checksum
+	frags.emplace_back(new artdaq::Fragment(4, 0, demo::FragmentType::CRTPACKED));
+	expected.push_back(demo::ChecksumStatus::None);
+
+	size_t nbad;
+	BOOST_CHECK(verify(frags, nbad) == expected);
+	BOOST_CHECK_EQUAL(nbad, 0u);
+
+	// A changed byte just past the header of each checksummed Fragment of the first twelve
+	size_t const header_bytes[] = {sizeof(demo::AsciiFragment::Header), sizeof(demo::UDPFragment::Header),
+	                               sizeof(CRT::Fragment::header_t)};
+	for (size_t i = 0; i < 12; ++i)
+	{
+		if (expected[i] != demo::ChecksumStatus::Good) continue;
+		frags[i]->dataBeginBytes()[header_bytes[i % 3]] ^= 0x10;
+		expected[i] = demo::ChecksumStatus::Bad;
+	}
+
+	// Cut short, without room for the checksum. A CRT::Fragment cut short has no trailer, so
+	// has no checksum.
+	for (size_t i = 12; i < 15; ++i) frags[i]->resizeBytes(frags[i]->dataSizeBytes() - sizeof(artdaq::RawDataType));
+	expected[12] = expected[13] = demo::ChecksumStatus::Bad;
+	expected[14] = demo::ChecksumStatus::None;
+
+	size_t want_bad = 0;
+	for (auto const s : expected) want_bad += s == demo::ChecksumStatus::Bad;
+	BOOST_CHECK(verify(frags, nbad) == expected);
+	BOOST_CHECK_EQUAL(nbad, want_bad);
+	BOOST_CHECK_EQUAL(want_bad, 8u);
+}
+
+// An AsciiFragment written before the flags existed, with the checksummed flag's bit set but no
+// format marker, has no checksum
+BOOST_AUTO_TEST_CASE(LegacyHasNone)
+{
+	std::vector<std::unique_ptr<artdaq::Fragment>> frags;
+	frags.push_back(ascii("legacy", true));
+	reinterpret_cast<demo::AsciiFragment::Header*>(frags.back()->dataBeginBytes())->checksummed = 1;
+	reinterpret_cast<demo::AsciiFragment::Header*>(frags.back()->dataBeginBytes())->format = 0;
+
+	size_t nbad;
+	std::vector<demo::ChecksumStatus> const status = verify(frags, nbad);
+	BOOST_CHECK(status[0] == demo::ChecksumStatus::None);
+	BOOST_CHECK_EQUAL(nbad, 0u);
+	BOOST_CHECK(demo::AsciiFragment(*frags[0]).checksum_ok());
+}
+
+// A UDP Fragment written before checksums existed, whose unused Metadata bits happen to hold what
+// was once taken for the format marker 0x2a55 and a set checksummed flag, has no checksum and
+// reads back intact
+BOOST_AUTO_TEST_CASE(UDPLegacyMetadataHasNone)
+{
+	std::vector<std::unique_ptr<artdaq::Fragment>> frags;
+	frags.push_back(udp("legacy datagram", false));
+	frags.back()->metadata<demo::UDPFragment::Metadata>()->unused = 0x2a55 << 2 | 0x2;
+
+	BOOST_REQUIRE_EQUAL(frags[0]->type(), demo::FragmentType::UDP);
+	size_t nbad;
+	std::vector<demo::ChecksumStatus> const status = verify(frags, nbad);
+	BOOST_CHECK(status[0] == demo::ChecksumStatus::None);
+	BOOST_CHECK_EQUAL(nbad, 0u);
+
+	demo::UDPFragment const f(*frags[0]);
+	BOOST_CHECK(!f.checksummed());
+	BOOST_CHECK(!f.compressed());
+	BOOST_CHECK(f.checksum_ok());
+	BOOST_CHECK(demo::findOverlayDecoder(*frags[0])->check(*frags[0]));
+	BOOST_CHECK_EQUAL(std::string(f.textBegin(), f.textEnd()), "legacy datagram");
+}
+
+// The checksum is marked by a flag in Header::type, with or without compression, beside the data
+// type. The Fragment stays of type UDP, and resize() drops the checksum.
+BOOST_AUTO_TEST_CASE(UDPFlags)
+{
+	auto frag = udp("datagram", true);
+	BOOST_CHECK_EQUAL(frag->type(), demo::FragmentType::UDP);
+	BOOST_CHECK_EQUAL(reinterpret_cast<demo::UDPFragment::Header*>(frag->dataBeginBytes())->type & 0xCu, 0x4u);
+	BOOST_CHECK(demo::UDPFragment(*frag).checksummed());
+	BOOST_CHECK(!demo::UDPFragment(*frag).compressed());
+
+	std::string const text(1000, 'x');
+	demo::UDPFragmentWriter writer(*frag, demo::headerReserved);
+	writer.set_hdr_type(static_cast<demo::UDPFragment::Header::data_type_t>(demo::UDPFragment::DataType::String));
+	BOOST_REQUIRE(writer.write_compressed(reinterpret_cast<uint8_t const*>(text.data()), text.size()));
+	BOOST_CHECK(!demo::UDPFragment(*frag).checksummed());
+	writer.write_checksum();
+	BOOST_CHECK_EQUAL(writer.header_()->type, 0x8u | 0x4u | 2u);
+
+	demo::UDPFragment const f(*frag);
+	BOOST_CHECK(f.checksummed());
+	BOOST_CHECK(f.compressed());
+	BOOST_CHECK(f.checksum_ok());
+	BOOST_CHECK(f.data_type() == demo::UDPFragment::DataType::String);
+	BOOST_CHECK(demo::findOverlayDecoder(*frag)->check(*frag));
+	BOOST_CHECK_EQUAL(std::string(f.textBegin(), f.textEnd()), text);
+
+	// Overlaid outside the Fragment, the payload says it is checksummed
+	demo::UDPFragment const raw(frag->dataBeginBytes(), frag->dataSizeBytes(), frag->metadata<demo::UDPFragment::Metadata>());
+	BOOST_CHECK(raw.checksummed());
+	BOOST_CHECK(raw.checksum_ok());
+
+	// The flags are in the Header, so the checksum covers them, and changing the data type breaks it
+	writer.set_hdr_type(static_cast<demo::UDPFragment::Header::data_type_t>(demo::UDPFragment::DataType::JSON));
+	BOOST_CHECK(demo::UDPFragment(*frag).checksummed());
+	BOOST_CHECK(!demo::UDPFragment(*frag).checksum_ok());
+
+	writer.resize(3);
+	BOOST_CHECK_EQUAL(frag->type(), demo::FragmentType::UDP);
+	BOOST_CHECK_EQUAL(writer.header_()->type, 1u);
+	BOOST_CHECK(!demo::UDPFragment(*frag).checksummed());
+}
+
+// A UDP Fragment written before the flags existed holds just its data type in Header::type, so has
+// no checksum, whatever follows its payload
+BOOST_AUTO_TEST_CASE(UDPLegacyHeaderHasNone)
+{
+	for (demo::UDPFragment::Header::data_type_t type = 0; type < 3; ++type)
+	{
+		auto frag = udp("legacy", false);
+		reinterpret_cast<demo::UDPFragment::Header*>(frag->dataBeginBytes())->type = type;
+		frag->resizeBytes(frag->dataSizeBytes() + sizeof(artdaq::RawDataType));
+
+		demo::UDPFragment const f(*frag);
+		BOOST_CHECK(!f.checksummed());
+		BOOST_CHECK(!f.compressed());
+		BOOST_CHECK(f.checksum_ok());
+		BOOST_CHECK_EQUAL(f.hdr_data_type(), type);
+		BOOST_CHECK_EQUAL(std::string(f.textBegin(), f.textEnd()), "legacy");
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
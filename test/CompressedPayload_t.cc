@@ -0,0 +1,478 @@
+#include "artdaq-core-demo/Overlays/AsciiFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CompressedPayload.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/UDPFragmentWriter.hh"
+
+#include "cetlib/exception.h"
+
+#define BOOST_TEST_MODULE(CompressedPayload_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef std::vector<uint8_t> Bytes;
+
+	// Inputs for only literals, short and long matches, matches overlapping their own output,
+	// and matches near the largest offset
+	std::vector<Bytes> samples()
+	{
+		std::mt19937 rng(1);
+		std::vector<Bytes> out;
+
+		out.push_back(Bytes());
+		for (size_t n = 1; n <= 20; ++n) out.push_back(Bytes(n, 'a'));
+
+		Bytes random(5000);
+		for (auto& b : random) b = static_cast<uint8_t>(rng());
+		out.push_back(random);
+
+		std::string text;
+		while (text.size() < 100000)
+		{
+			text += "{\"run\": " + std::to_string(rng() % 1000) + ", \"status\": \"ok\", \"voltage\": " +
+			        std::to_string(rng() % 5000) + "}\n";
+		}
+		out.push_back(Bytes(text.begin(), text.end()));
+
+		out.push_back(Bytes(1 << 20, 0));
+
+		// A random block repeated after almost 64 kB, and again after more than that
+		Bytes far(200000);
+		for (size_t i = 0; i < 70000; ++i) far[i] = static_cast<uint8_t>(rng());
+		for (size_t i = 70000; i < far.size(); ++i) far[i] = far[i - 65535];
+		out.push_back(far);
+
+		Bytes pattern(30000);
+		for (size_t i = 0; i < pattern.size(); ++i) pattern[i] = "abcab"[i % 5];
+		out.push_back(pattern);
+		return out;
+	}
+
+	Bytes compress(Bytes const& raw)
+	{
+		Bytes stored(demo::compressedPayloadBound(raw.size()));
+		size_t const n = demo::compressPayload(raw.data(), raw.size(), stored.data(), stored.size());
+		BOOST_REQUIRE(n > 0);
+		stored.resize(n);
+		return stored;
+	}
+
+	demo::CompressedPayloadHeader header(Bytes const& stored)
+	{
+		demo::CompressedPayloadHeader h;
+		memcpy(&h, stored.data(), sizeof h);
+		return h;
+	}
+
+	// Inputs for the reference vectors below: only literals, a short match, a long run, a literal
+	// run and a match both longer than 15 + 255, a match overlapping its own output, and text
+	// that lz4's fast and high-compression modes parse differently
+	Bytes vectorInput(size_t k)
+	{
+		switch (k)
+		{
+			case 0:
+				return Bytes{'a', 'b', 'c'};
+			case 1:
+			{
+				std::string const hello = "Hello, Hello, Hello, Hello, world!\n";
+				return Bytes(hello.begin(), hello.end());
+			}
+			case 2:
+				return Bytes(1000, 'a');
+			case 3:
+			{
+				Bytes twice(600);
+				uint32_t x = 1;
+				for (size_t i = 0; i < 300; ++i)
+				{
+					x = x * 1103515245u + 12345u;
+					twice[i] = static_cast<uint8_t>(x >> 16);
+				}
+				for (size_t i = 300; i < twice.size(); ++i) twice[i] = twice[i - 300];
+				return twice;
+			}
+			case 4:
+			{
+				Bytes pattern(100);
+				for (size_t i = 0; i < pattern.size(); ++i) pattern[i] = "abcab"[i % 5];
+				return pattern;
+			}
+			default:
+			{
+				std::string text;
+				char const* const words[] = {"run", "subrun", "event", "fragment", "type", "UDP", "CRT"};
+				for (size_t i = 0; text.size() < 400; ++i)
+				{
+					text += std::string(words[i * i % 7]) + "=" + std::to_string(i * 37 % 101) + (i % 3 ? ", " : "\n");
+				}
+				return Bytes(text.begin(), text.end());
+			}
+		}
+	}
+
+	/**
+	 * \brief An LZ4 block of vectorInput(input)
+	 *
+	 * The blocks made by the reference lz4 are from its command line tool, v1.9.4: "lz4 -l" (fast
+	 * mode) or "lz4 -l -12" (high compression), with the 8-byte legacy frame header taken off.
+	 * Those marked ours are what lz4Compress() makes, and decompressed back to the input by
+	 * "lz4 -d" after putting the same header on. If lz4Compress() changes what it makes, check the
+	 * new blocks that way before changing them here.
+	 */
+	struct Lz4Vector
+	{
+		size_t input;
+		char const* block; ///< In hex
+		bool ours; ///< lz4Compress() makes exactly this block
+		char const* source;
+	};
+
+	Lz4Vector const lz4Vectors[] = {
+	    {0, "30616263", true, "lz4 -l, and ours"},
+	    {1, "7f48656c6c6f2c2007000270776f726c64210a", true, "lz4 -l, and ours"},
+	    {2, "1f610100ffffffd2506161616161", true, "lz4 -l, and ours"},
+	    {3,
+	     "ffff1ec67e816b4bfbe2fb54f6bddf7c1ce18701bf31de56720f4767668759aa883c59ea56137bd285a1d83c54552f37"
+	     "ae655bda027998cce31a768e5fd9998f1f3f36ee43784d0dfabea6dae4868edc296d4eff56e17020fb8fb1580590c509"
+	     "dc53cdaa3b489952d3529d069feab5c206139849b2011eac3288319c52469571368f57f6391d16fa8874f5987c175c41"
+	     "bb6d718e0f7059c7011b2f333d91c01da50d0dab338d7e5e8f3ee66874a63ab1c39311a864c7dbcae060e1f3bf090067"
+	     "a2e325a0213187d562c5a84f7e2e096b949fb06da99e5a0b467080b6cf470ca6a52ad8acfba0ebb779247223924880c5"
+	     "a6a785b7d78c90e4ab63445266e39c3325f95eaaba73605d4b717ebea98c571971c3ca5ee52a33ac885166a17b756764"
+	     "9a69ef6f5642a01d51c502f7bb92452c01ff155002f7bb9245",
+	     true, "lz4 -l, and ours"},
+	    {4, "5f6162636162050047506162636162", true, "lz4 -l, and ours"},
+	    {5,
+	     "9072756e3d300a7375620900f20733372c20747970653d37342c206576656e743d31300a090014341c004338342c2030"
+	     "003032300a370025353712002339344200143338002436374b0013331b00153470004037372c20410025313341003135"
+	     "300a820015383700243233410013361c00163970002233334200153754001436660005370014388b0014311c00163570"
+	     "001239c30025323682001436a8002431303900243336830014371d0014393401223436820016385400223139c4001535"
+	     "370015398d0013321c00163671001232410014335300503d37362c20",
+	     false, "lz4 -l"},
+	    {5,
+	     "9072756e3d300a7375620900f20733372c20747970653d37342c206576656e743d31300a090014341c004338342c2030"
+	     "003032300a070025353712002339342600143338002436374b0013331b00153470004037372c20080025313341003235"
+	     "300a66000537002432330a0013361c00163970002233334200153754001436660005370014388b0014311c00263533b1"
+	     "0002c30025323612001436a80024313039002433364c0014371d00143970002234368200163854003231390a67000537"
+	     "00253933ce00031c00263636460102410014335300503d37362c20",
+	     false, "lz4 -l -12"},
+	    {5,
+	     "9072756e3d300a7375620900f20733372c20747970653d37342c206576656e743d31300a090014341c004338342c2030"
+	     "003032300a370025353712002339344200143338002436374b0013331b003334300a40004037372c2041002531334100"
+	     "3135300a8200153837002432330a0013361c00163970002233334200153754001436660005370014388b0014311c0016"
+	     "3570001239c30025323682001436a8002431303900243336830014371d001439c400223436820016385400223139c400"
+	     "1535370015398d0013321c00163671001232410014335300503d37362c20",
+	     true, "ours"},
+	};
+
+	Bytes unhex(char const* hex)
+	{
+		Bytes out;
+		for (; hex[0] && hex[1]; hex += 2) out.push_back(static_cast<uint8_t>(std::stoul(std::string(hex, 2), nullptr, 16)));
+		return out;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(CompressedPayload_test)
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+	for (auto const& raw : samples())
+	{
+		Bytes const stored = compress(raw);
+		demo::CompressedPayloadHeader const h = header(stored);
+		BOOST_CHECK_EQUAL(h.raw_bytes, raw.size());
+		BOOST_CHECK(demo::compressedPayloadComplete(stored.data(), stored.size()));
+		BOOST_CHECK(raw.size() <= demo::lz4DecompressBound(h.compressed_bytes));
+
+		Bytes out(raw.size());
+		BOOST_CHECK_EQUAL(demo::decompressPayload(stored.data(), stored.size(), out.data(), out.size()), raw.size());
+		BOOST_CHECK(out == raw);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(CompressesRepetitiveInput)
+{
+	Bytes const zeros(1 << 20, 0);
+	BOOST_CHECK(compress(zeros).size() < zeros.size() / 200);
+}
+
+BOOST_AUTO_TEST_CASE(CapacityTooSmall)
+{
+	Bytes const raw(1000, 'x');
+	Bytes out(20);
+	BOOST_CHECK_EQUAL(demo::compressPayload(raw.data(), raw.size(), out.data(), 4), 0u);
+
+	Bytes const stored = compress(raw);
+	BOOST_CHECK_THROW(demo::decompressPayload(stored.data(), stored.size(), out.data(), out.size()), cet::exception);
+}
+
+BOOST_AUTO_TEST_CASE(TruncatedBlock)
+{
+	for (auto const& raw : samples())
+	{
+		if (raw.empty()) continue;
+		Bytes const stored = compress(raw);
+		uint8_t const* block = stored.data() + sizeof(demo::CompressedPayloadHeader);
+		size_t const n = stored.size() - sizeof(demo::CompressedPayloadHeader);
+
+		Bytes out(raw.size());
+		size_t const step = n > 1000 ? n / 1000 : 1;
+		for (size_t m = 0; m < n; m += step) BOOST_CHECK(!demo::lz4Decompress(block, m, out.data(), out.size()));
+
+		BOOST_CHECK(!demo::compressedPayloadComplete(stored.data(), stored.size() - 1));
+		BOOST_CHECK_THROW(demo::decompressPayload(stored.data(), stored.size() - 1, out.data(), out.size()), cet::exception);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(CorruptBlock)
+{
+	// A literal, then a match reaching back before the start of the output
+	uint8_t const before_start[] = {0x10, 'a', 2, 0, 0x00};
+	uint8_t out[64];
+	BOOST_CHECK(!demo::lz4Decompress(before_start, sizeof before_start, out, 5));
+
+	// Offset 0 is never valid
+	uint8_t const zero_offset[] = {0x10, 'a', 0, 0, 0x00};
+	BOOST_CHECK(!demo::lz4Decompress(zero_offset, sizeof zero_offset, out, 5));
+
+	// A literal length running off the end of the block
+	uint8_t const long_literal[] = {0xf0, 255, 255};
+	BOOST_CHECK(!demo::lz4Decompress(long_literal, sizeof long_literal, out, sizeof out));
+
+	// Random damage must never read or write outside the buffers; the sanitizers check that
+	std::mt19937 rng(2);
+	for (auto const& raw : samples())
+	{
+		if (raw.size() < 16 || raw.size() > 200000) continue;
+		Bytes const good = compress(raw);
+		Bytes dst(raw.size());
+		for (int trial = 0; trial < 200; ++trial)
+		{
+			Bytes bad = good;
+			for (int k = 0; k < 4; ++k)
+			{
+				size_t const i = sizeof(demo::CompressedPayloadHeader) + rng() % (bad.size() - sizeof(demo::CompressedPayloadHeader));
+				bad[i] ^= static_cast<uint8_t>(1 + rng() % 255);
+			}
+			try
+			{
+				demo::decompressPayload(bad.data(), bad.size(), dst.data(), dst.size());
+			}
+			catch (cet::exception const&)
+			{
+			}
+		}
+	}
+}
+
+// Blocks made by the reference lz4 decompress to their inputs, whichever way it parsed them
+BOOST_AUTO_TEST_CASE(ReferenceBlocksDecompress)
+{
+	for (auto const& v : lz4Vectors)
+	{
+		BOOST_TEST_CONTEXT("input " << v.input << " from " << v.source)
+		{
+			Bytes const raw = vectorInput(v.input);
+			Bytes const block = unhex(v.block);
+			Bytes out(raw.size());
+			BOOST_CHECK(demo::lz4Decompress(block.data(), block.size(), out.data(), out.size()));
+			BOOST_CHECK(out == raw);
+
+			// The size must be exactly right
+			Bytes longer(raw.size() + 1);
+			BOOST_CHECK(!demo::lz4Decompress(block.data(), block.size(), longer.data(), longer.size()));
+		}
+	}
+}
+
+// lz4Compress() makes the blocks that the reference lz4 was checked to decompress
+BOOST_AUTO_TEST_CASE(BlocksReferenceDecompresses)
+{
+	for (auto const& v : lz4Vectors)
+	{
+		if (!v.ours) continue;
+		BOOST_TEST_CONTEXT("input " << v.input)
+		{
+			Bytes const raw = vectorInput(v.input);
+			Bytes block(demo::lz4CompressBound(raw.size()));
+			block.resize(demo::lz4Compress(raw.data(), raw.size(), block.data(), block.size()));
+			BOOST_CHECK(block == unhex(v.block));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ImplausibleRawSize)
+{
+	Bytes stored = compress(Bytes(100, 'y'));
+	demo::CompressedPayloadHeader h = header(stored);
+	h.raw_bytes = 4000000000u;
+	memcpy(stored.data(), &h, sizeof h);
+
+	BOOST_CHECK(!demo::compressedPayloadComplete(stored.data(), stored.size()));
+	Bytes out(100);
+	BOOST_CHECK_THROW(demo::decompressPayload(stored.data(), stored.size(), out.data(), out.size()), cet::exception);
+
+	// The lazy view must refuse before allocating raw_bytes
+	demo::AsciiFragment::Metadata metadata;
+	metadata.charsInLine = 1000;
+	auto frag = artdaq::Fragment::FragmentBytes(0, 0, 0, demo::FragmentType::ASCII, metadata);
+	std::string const line(1000, 'z');
+	demo::AsciiFragmentWriter writer(*frag);
+	BOOST_REQUIRE(writer.write_compressed(line.data(), line.size()));
+
+	uint8_t* const payload = frag->dataBeginBytes() + sizeof(demo::AsciiFragment::Header);
+	memcpy(&h, payload, sizeof h);
+	h.raw_bytes = 4000000000u;
+	memcpy(payload, &h, sizeof h);
+
+	demo::AsciiFragment const f(*frag);
+	BOOST_CHECK(!f.sizes_consistent());
+	BOOST_CHECK_THROW(f.dataBegin(), cet::exception);
+}
+
+BOOST_AUTO_TEST_CASE(AsciiFragmentRoundTrip)
+{
+	std::string line;
+	for (int i = 0; i < 200; ++i) line += "line " + std::to_string(i % 7) + " of the run\n";
+
+	demo::AsciiFragment::Metadata metadata;
+	metadata.charsInLine = line.size();
+	auto frag = artdaq::Fragment::FragmentBytes(0, 0, 0, demo::FragmentType::ASCII, metadata);
+	demo::AsciiFragmentWriter writer(*frag);
+	writer.set_hdr_line_number(42);
+	BOOST_REQUIRE(writer.write_compressed(line.data(), line.size()));
+	BOOST_CHECK(frag->dataSizeBytes() < line.size());
+
+	demo::AsciiFragment const f(*frag);
+	BOOST_CHECK(f.compressed());
+	BOOST_CHECK(f.sizes_consistent());
+	BOOST_CHECK_EQUAL(f.hdr_line_number(), 42u);
+	BOOST_CHECK_EQUAL(std::string(f.dataBegin(), f.dataEnd()), line);
+
+	std::vector<char> out(line.size());
+	BOOST_CHECK_EQUAL(f.decompress_into(out.data(), out.size()), line.size());
+	BOOST_CHECK_EQUAL(std::string(out.begin(), out.end()), line);
+}
+
+// Threads racing to read a compressed line all get the same, whole copy of it, and an overlay
+// that hasn't decompressed anything holds nothing but a null pointer for it
+BOOST_AUTO_TEST_CASE(LazyInflationRace)
+{
+	BOOST_CHECK_EQUAL(sizeof(demo::detail::LazyInflation), sizeof(void*));
+
+	std::string line;
+	for (int i = 0; i < 2000; ++i) line += "event " + std::to_string(i % 13) + " ok\n";
+
+	demo::AsciiFragment::Metadata metadata;
+	metadata.charsInLine = line.size();
+	auto frag = artdaq::Fragment::FragmentBytes(0, 0, 0, demo::FragmentType::ASCII, metadata);
+	demo::AsciiFragmentWriter writer(*frag);
+	BOOST_REQUIRE(writer.write_compressed(line.data(), line.size()));
+
+	for (int round = 0; round < 20; ++round)
+	{
+		demo::AsciiFragment const f(*frag);
+		std::vector<char const*> begins(8);
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < begins.size(); ++t)
+		{
+			threads.emplace_back([&f, &begins, t] { begins[t] = f.dataBegin(); });
+		}
+		for (auto& t : threads) t.join();
+
+		for (auto b : begins) BOOST_CHECK(b == begins[0]);
+		BOOST_CHECK_EQUAL(std::string(begins[0], begins[0] + line.size()), line);
+
+		// A copy decompresses for itself
+		demo::AsciiFragment const copy(f);
+		BOOST_CHECK(copy.dataBegin() != f.dataBegin());
+		BOOST_CHECK_EQUAL(std::string(copy.dataBegin(), copy.dataEnd()), line);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(UDPFragmentRoundTrip)
+{
+	std::string json;
+	for (int i = 0; i < 100; ++i) json += "{\"channel\": " + std::to_string(i % 4) + ", \"value\": 17}";
+
+	demo::UDPFragment::Metadata metadata;
+	memset(&metadata, 0, sizeof metadata);
+	auto frag = artdaq::Fragment::FragmentBytes(0, 0, 0, demo::FragmentType::UDP, metadata);
+	demo::UDPFragmentWriter writer(*frag);
+	writer.set_hdr_type(static_cast<demo::UDPFragment::Header::data_type_t>(demo::UDPFragment::DataType::JSON));
+	BOOST_REQUIRE(writer.write_compressed(reinterpret_cast<uint8_t const*>(json.data()), json.size()));
+
+	// Marked in the Header, not by the Fragment type, and the data type is kept
+	BOOST_CHECK_EQUAL(frag->type(), demo::FragmentType::UDP);
+	BOOST_CHECK_EQUAL(writer.header_()->type, 0x8u | 1u);
+
+	demo::UDPFragment const f(*frag);
+	BOOST_CHECK(f.compressed());
+	BOOST_CHECK(f.data_type() == demo::UDPFragment::DataType::JSON);
+	BOOST_CHECK_EQUAL(f.hdr_data_type(), 1u);
+	BOOST_CHECK_EQUAL(std::string(f.textBegin(), f.textEnd()), json);
+	demo::JSONValue value;
+	BOOST_REQUIRE(f.jsonValue("channel", value));
+	BOOST_CHECK_EQUAL(std::string(value.begin, value.end), "0");
+
+	// Overlaid outside the Fragment, the payload says it is compressed
+	demo::UDPFragment const raw(frag->dataBeginBytes(), frag->dataSizeBytes(), frag->metadata<demo::UDPFragment::Metadata>());
+	BOOST_CHECK(raw.compressed());
+	BOOST_CHECK_EQUAL(std::string(raw.textBegin(), raw.textEnd()), json);
+
+	// Setting the data type afterwards keeps the flag
+	writer.set_hdr_type(static_cast<demo::UDPFragment::Header::data_type_t>(demo::UDPFragment::DataType::String));
+	BOOST_CHECK(demo::UDPFragment(*frag).compressed());
+	BOOST_CHECK(demo::UDPFragment(*frag).data_type() == demo::UDPFragment::DataType::String);
+
+	// Stored as it is again, it is not compressed
+	writer.resize(5);
+	memcpy(writer.dataBegin(), "[1,2]", 5);
+	BOOST_CHECK_EQUAL(writer.header_()->type, 2u);
+	BOOST_CHECK(!demo::UDPFragment(*frag).compressed());
+}
+
+BOOST_AUTO_TEST_CASE(UDPLegacyMetadataIgnored)
+{
+	// Written before the flags existed, with the unused Metadata bits set: the payload is still
+	// read as stored
+	demo::UDPFragment::Metadata metadata;
+	memset(&metadata, 0, sizeof metadata);
+	auto frag = artdaq::Fragment::FragmentBytes(0, 0, 0, demo::FragmentType::UDP, metadata);
+	demo::UDPFragmentWriter writer(*frag);
+	writer.resize(5);
+	memcpy(writer.dataBegin(), "plain", 5);
+	frag->metadata<demo::UDPFragment::Metadata>()->unused = 0xffff;
+
+	demo::UDPFragment const f(*frag);
+	BOOST_CHECK(!f.compressed());
+	BOOST_CHECK_EQUAL(std::string(f.textBegin(), f.textEnd()), "plain");
+}
+
+BOOST_AUTO_TEST_CASE(UnmarkedFlagsIgnored)
+{
+	// Written before the flags existed: whatever is in their bits, the line is read as stored
+	demo::AsciiFragment::Metadata metadata;
+	metadata.charsInLine = 5;
+	auto frag = artdaq::Fragment::FragmentBytes(0, 0, 0, demo::FragmentType::ASCII, metadata);
+	demo::AsciiFragmentWriter writer(*frag);
+	writer.resize(5);
+	memcpy(writer.dataBegin(), "plain", 5);
+	writer.header_()->format = 0;
+	writer.header_()->compressed = 1;
+	writer.header_()->checksummed = 1;
+
+	demo::AsciiFragment const f(*frag);
+	BOOST_CHECK(!f.compressed());
+	BOOST_CHECK(!f.checksummed());
+	BOOST_CHECK_EQUAL(std::string(f.dataBegin(), f.dataEnd()), "plain");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
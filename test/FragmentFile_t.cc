@@ -0,0 +1,134 @@
+#include "artdaq-core-demo/Overlays/FragmentFile.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#include "cetlib/exception.h"
+
+#define BOOST_TEST_MODULE(FragmentFile_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+	typedef std::vector<char> Bytes;
+
+	// A file of three Fragments, removed when done with
+	struct TestFile
+	{
+		std::string path;
+
+		TestFile()
+			: path("FragmentFile_t_" + std::to_string(getpid()) + ".frags")
+		{
+			demo::FragmentFileWriter writer(path);
+			for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 3; ++seq)
+			{
+				uint64_t metadata = seq;
+				auto frag = artdaq::Fragment::FragmentBytes(10 * seq, seq, 0, demo::FragmentType::UDP, metadata);
+				writer.write(*frag);
+			}
+			writer.close();
+		}
+
+		~TestFile() { remove(path.c_str()); }
+
+		Bytes read() const
+		{
+			std::ifstream in(path, std::ios::binary);
+			return Bytes(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		}
+
+		void write(Bytes const& bytes) const
+		{
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			out.write(bytes.data(), bytes.size());
+		}
+
+		demo::FragmentFileFormat::FileHeader* header(Bytes& bytes) const
+		{
+			return reinterpret_cast<demo::FragmentFileFormat::FileHeader*>(bytes.data());
+		}
+
+		uint64_t* index(Bytes& bytes) const { return reinterpret_cast<uint64_t*>(bytes.data() + header(bytes)->index_offset); }
+
+		demo::FragmentFileFormat::RecordHeader* record(Bytes& bytes, uint64_t offset) const
+		{
+			return reinterpret_cast<demo::FragmentFileFormat::RecordHeader*>(bytes.data() + offset);
+		}
+	};
+}
+
+BOOST_AUTO_TEST_SUITE(FragmentFile_test)
+
+BOOST_AUTO_TEST_CASE(ReadBack)
+{
+	TestFile const file;
+	demo::FragmentFileReader const reader(file.path);
+	BOOST_REQUIRE_EQUAL(reader.size(), 3u);
+	BOOST_CHECK(!reader.truncated());
+	BOOST_CHECK_EQUAL(reader.find(demo::FragmentType::UDP, 2).size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(IndexEntryPastEnd)
+{
+	TestFile const file;
+	Bytes bytes = file.read();
+	for (uint64_t const offset : {uint64_t(bytes.size() + 8), uint64_t(bytes.size() + (1 << 20)), uint64_t(-8)})
+	{
+		Bytes bad = bytes;
+		file.index(bad)[1] = offset;
+		file.write(bad);
+		BOOST_CHECK_THROW(demo::FragmentFileReader reader(file.path), cet::exception);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(RecordPastEnd)
+{
+	TestFile const file;
+	Bytes bytes = file.read();
+	for (uint32_t const size : {uint32_t(bytes.size()), uint32_t(0xffffffff)})
+	{
+		Bytes bad = bytes;
+		file.record(bad, file.index(bad)[2])->payload_bytes = size;
+		file.write(bad);
+		BOOST_CHECK_THROW(demo::FragmentFileReader reader(file.path), cet::exception);
+
+		bad = bytes;
+		file.record(bad, file.index(bad)[2])->metadata_bytes = size;
+		file.record(bad, file.index(bad)[2])->payload_bytes = size;
+		file.write(bad);
+		BOOST_CHECK_THROW(demo::FragmentFileReader reader(file.path), cet::exception);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(UnindexedScan)
+{
+	TestFile const file;
+	Bytes bytes = file.read();
+	uint64_t const index_offset = file.header(bytes)->index_offset;
+	uint64_t const second = file.index(bytes)[1];
+
+	// As left by a writer that stopped before writing its index
+	Bytes unindexed = bytes;
+	file.header(unindexed)->index_offset = 0;
+	file.write(unindexed);
+	{
+		demo::FragmentFileReader const reader(file.path);
+		BOOST_CHECK_EQUAL(reader.size(), 3u);
+	}
+
+	// A record claiming more than is left stops the scan instead of reading past the end
+	file.record(unindexed, second)->metadata_bytes = 0xffffffff;
+	file.record(unindexed, second)->payload_bytes = 0xffffffff;
+	unindexed.resize(index_offset);
+	file.write(unindexed);
+	demo::FragmentFileReader const reader(file.path);
+	BOOST_CHECK_EQUAL(reader.size(), 1u);
+	BOOST_CHECK(reader.truncated());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
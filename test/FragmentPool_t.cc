@@ -0,0 +1,212 @@
+#include "artdaq-core-demo/Overlays/AsciiFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/FragmentPool.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/UDPFragmentWriter.hh"
+
+#define BOOST_TEST_MODULE(FragmentPool_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace
+{
+	// Whether a Fragment is as acquire() should hand it out: the pool's type, no sequence or
+	// Fragment ID or timestamp, the pool's Metadata, and a zeroed header and nothing else
+	template <typename Metadata>
+	void check_fresh(artdaq::Fragment const& frag, artdaq::Fragment::type_t type, Metadata const& metadata,
+	                 size_t header_bytes)
+	{
+		artdaq::Fragment const prototype(0, 0, type);
+		BOOST_CHECK_EQUAL(frag.type(), type);
+		BOOST_CHECK_EQUAL(frag.sequenceID(), prototype.sequenceID());
+		BOOST_CHECK_EQUAL(frag.fragmentID(), prototype.fragmentID());
+		BOOST_CHECK_EQUAL(frag.timestamp(), prototype.timestamp());
+		BOOST_REQUIRE(frag.hasMetadata());
+		BOOST_CHECK(memcmp(frag.metadata<Metadata>(), &metadata, sizeof metadata) == 0);
+		BOOST_REQUIRE_EQUAL(frag.dataSizeBytes(), (header_bytes + sizeof(artdaq::RawDataType) - 1) /
+		                                              sizeof(artdaq::RawDataType) * sizeof(artdaq::RawDataType));
+		BOOST_CHECK(std::all_of(frag.dataBeginBytes(), frag.dataEndBytes(), [](uint8_t b) { return b == 0; }));
+	}
+
+	// Something that compresses well
+	std::string repetitive(size_t n)
+	{
+		std::string s;
+		while (s.size() < n) s += "{\"channel\": 12, \"adc\": 345} ";
+		return s.substr(0, n);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(FragmentPool_test)
+
+// An AsciiFragment written compressed and checksummed, with IDs and Metadata changed, comes back
+// from the pool with none of it, and a short line written to it has nothing of the long one
+BOOST_AUTO_TEST_CASE(AsciiNothingStale)
+{
+	demo::AsciiFragment::Metadata metadata;
+	memset(&metadata, 0, sizeof metadata);
+	metadata.charsInLine = 0;
+	size_t const max_chars = 4096;
+	demo::FragmentPool pool(demo::FragmentType::ASCII, metadata, sizeof(demo::AsciiFragment::Header), max_chars);
+
+	auto frag = pool.acquire();
+	artdaq::Fragment const* const first = frag.get();
+	check_fresh(*frag, demo::FragmentType::ASCII, metadata, sizeof(demo::AsciiFragment::Header));
+	{
+		std::string const line = repetitive(max_chars);
+		frag->setSequenceID(17);
+		frag->setFragmentID(3);
+		frag->setTimestamp(123456);
+		frag->metadata<demo::AsciiFragment::Metadata>()->charsInLine = line.size();
+		demo::AsciiFragmentWriter writer(*frag, demo::headerReserved);
+		BOOST_REQUIRE(writer.write_compressed(line.data(), line.size()));
+		writer.write_checksum();
+		demo::AsciiFragment const f(*frag);
+		BOOST_REQUIRE(f.compressed());
+		BOOST_REQUIRE(f.checksummed());
+	}
+	pool.release(std::move(frag));
+
+	frag = pool.acquire();
+	BOOST_CHECK(frag.get() == first);
+	check_fresh(*frag, demo::FragmentType::ASCII, metadata, sizeof(demo::AsciiFragment::Header));
+	{
+		demo::AsciiFragment const f(*frag);
+		BOOST_CHECK(!f.compressed());
+		BOOST_CHECK(!f.checksummed());
+		BOOST_CHECK_EQUAL(f.hdr_event_size(), 0u);
+	}
+
+	// Written up to the reserved size, it doesn't move
+	demo::AsciiFragmentWriter writer(*frag, demo::headerReserved);
+	uint8_t const* const storage = frag->dataBeginBytes();
+	writer.resize(max_chars);
+	BOOST_CHECK(frag->dataBeginBytes() == storage);
+
+	frag->metadata<demo::AsciiFragment::Metadata>()->charsInLine = 5;
+	writer.resize(5);
+	memcpy(writer.dataBegin(), "short", 5);
+	demo::AsciiFragment const f(*frag);
+	BOOST_CHECK(!f.compressed());
+	BOOST_CHECK(!f.checksummed());
+	BOOST_CHECK(f.sizes_consistent());
+	BOOST_CHECK_EQUAL(std::string(f.dataBegin(), f.dataEnd()), "short");
+
+	auto const stats = pool.stats();
+	BOOST_CHECK_EQUAL(stats.allocated, 1u);
+	BOOST_CHECK_EQUAL(stats.acquired, 2u);
+	BOOST_CHECK_EQUAL(stats.released, 1u);
+	BOOST_CHECK_EQUAL(stats.available, 0u);
+}
+
+// A UDPFragment stored compressed and checksummed, and so with both flags set in its Header, comes back
+// from the pool as a plain UDP Fragment with the pool's Metadata
+BOOST_AUTO_TEST_CASE(UDPNothingStale)
+{
+	demo::UDPFragment::Metadata metadata;
+	memset(&metadata, 0, sizeof metadata);
+	metadata.port = 5000;
+	metadata.address = 0x0100007f;
+	size_t const max_bytes = 9000;
+	demo::FragmentPool pool(demo::FragmentType::UDP, metadata, sizeof(demo::UDPFragment::Header), max_bytes, 1);
+	BOOST_CHECK_EQUAL(pool.stats().available, 1u);
+
+	auto frag = pool.acquire();
+	artdaq::Fragment const* const first = frag.get();
+	check_fresh(*frag, demo::FragmentType::UDP, metadata, sizeof(demo::UDPFragment::Header));
+	{
+		std::string const datagram = repetitive(max_bytes);
+		frag->setSequenceID(99);
+		frag->setTimestamp(42);
+		frag->metadata<demo::UDPFragment::Metadata>()->port = 6000;
+		demo::UDPFragmentWriter writer(*frag, demo::headerReserved);
+		writer.set_hdr_type(static_cast<demo::UDPFragment::Header::data_type_t>(demo::UDPFragment::DataType::JSON));
+		BOOST_REQUIRE(writer.write_compressed(reinterpret_cast<uint8_t const*>(datagram.data()), datagram.size()));
+		writer.write_checksum();
+		BOOST_REQUIRE(demo::UDPFragment(*frag).compressed());
+		BOOST_REQUIRE(demo::UDPFragment(*frag).checksummed());
+	}
+	pool.release(std::move(frag));
+
+	frag = pool.acquire();
+	BOOST_CHECK(frag.get() == first);
+	check_fresh(*frag, demo::FragmentType::UDP, metadata, sizeof(demo::UDPFragment::Header));
+	{
+		demo::UDPFragment const f(*frag);
+		BOOST_CHECK(!f.compressed());
+		BOOST_CHECK(!f.checksummed());
+		BOOST_CHECK_EQUAL(f.hdr_event_size(), 0u);
+		BOOST_CHECK_EQUAL(f.hdr_data_type(), 0u);
+	}
+
+	demo::UDPFragmentWriter writer(*frag, demo::headerReserved);
+	uint8_t const* const storage = frag->dataBeginBytes();
+	writer.resize(max_bytes);
+	BOOST_CHECK(frag->dataBeginBytes() == storage);
+
+	writer.resize(2);
+	memcpy(writer.header_() + 1, "{}", 2);
+	demo::UDPFragment const f(*frag);
+	BOOST_CHECK_EQUAL(frag->type(), demo::FragmentType::UDP);
+	BOOST_CHECK(!f.compressed());
+	BOOST_CHECK(!f.checksummed());
+	BOOST_CHECK_EQUAL(std::string(f.textBegin(), f.textEnd()), "{}");
+}
+
+// Newly allocated Fragments, up front and on demand, have their header zeroed. The heap is dirtied
+// first, as growing a Fragment doesn't initialise the new storage and what it reuses may well be
+// zero anyway.
+BOOST_AUTO_TEST_CASE(NewFragmentsZeroed)
+{
+	demo::UDPFragment::Metadata metadata;
+	memset(&metadata, 0, sizeof metadata);
+	metadata.port = 8000;
+	size_t const max_bytes = 1500;
+	for (int i = 0; i < 16; ++i)
+	{
+		std::unique_ptr<artdaq::Fragment> dirty(new artdaq::Fragment(max_bytes / sizeof(artdaq::RawDataType) + 8, 0, 0,
+		                                                             demo::FragmentType::UDP, metadata));
+		memset(dirty->dataBeginBytes(), 0xff, dirty->dataSizeBytes());
+	}
+
+	demo::FragmentPool pool(demo::FragmentType::UDP, metadata, sizeof(demo::UDPFragment::Header), max_bytes, 2);
+	std::vector<artdaq::FragmentPtr> frags;
+	for (int i = 0; i < 4; ++i)
+	{
+		frags.push_back(pool.acquire());
+		check_fresh(*frags.back(), demo::FragmentType::UDP, metadata, sizeof(demo::UDPFragment::Header));
+	}
+	BOOST_CHECK_EQUAL(pool.stats().allocated, 4u);
+}
+
+// Fragments without Metadata aren't kept, and a null one is ignored, but one with as much
+// Metadata as the pool's is made over into one of the pool's
+BOOST_AUTO_TEST_CASE(ForeignFragments)
+{
+	demo::UDPFragment::Metadata metadata;
+	memset(&metadata, 0, sizeof metadata);
+	metadata.port = 7000;
+	demo::FragmentPool pool(demo::FragmentType::UDP, metadata, sizeof(demo::UDPFragment::Header), 1500);
+
+	pool.release(artdaq::FragmentPtr(new artdaq::Fragment(4)));
+	pool.release(nullptr);
+	BOOST_CHECK_EQUAL(pool.stats().released, 0u);
+	BOOST_CHECK_EQUAL(pool.stats().available, 0u);
+
+	demo::AsciiFragment::Metadata ascii;
+	memset(&ascii, 0xff, sizeof ascii);
+	auto frag = artdaq::Fragment::FragmentBytes(64, 5, 6, demo::FragmentType::ASCII, ascii, 7);
+	memset(frag->dataBeginBytes(), 'x', frag->dataSizeBytes());
+	artdaq::Fragment const* const foreign = frag.get();
+	pool.release(std::move(frag));
+	BOOST_CHECK_EQUAL(pool.stats().available, 1u);
+
+	frag = pool.acquire();
+	BOOST_CHECK(frag.get() == foreign);
+	check_fresh(*frag, demo::FragmentType::UDP, metadata, sizeof(demo::UDPFragment::Header));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,195 @@
+#include "artdaq-core-demo/Overlays/FragmentQueue.hh"
+
+#define BOOST_TEST_MODULE(FragmentQueue_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Items to pass through each queue; enough to wrap a small queue many times
+	size_t const n_items = 1 << 18;
+
+	// Push 0 to n - 1 in random batches, some of them bigger than the queue
+	template <typename Queue>
+	void produce(Queue& q, uint64_t first, uint64_t n, unsigned seed)
+	{
+		std::mt19937 rng(seed);
+		std::vector<std::unique_ptr<uint64_t>> batch;
+		uint64_t next = first;
+		demo::Backoff backoff;
+		while (next < first + n)
+		{
+			if (rng() % 4 == 0)
+			{
+				q.push(std::unique_ptr<uint64_t>(new uint64_t(next++)));
+				continue;
+			}
+			batch.clear();
+			size_t const k = std::min<uint64_t>(1 + rng() % 40, first + n - next);
+			for (size_t i = 0; i < k; ++i) batch.emplace_back(new uint64_t(next + i));
+			size_t done = 0;
+			while (done < k)
+			{
+				size_t const pushed = q.try_push(batch.data() + done, k - done);
+				if (pushed == 0) backoff.pause();
+				else backoff.reset();
+				done += pushed;
+			}
+			next += k;
+		}
+	}
+
+	// Pop n items in random batches, passing each to check
+	template <typename Queue, typename Check>
+	void consume(Queue& q, uint64_t n, unsigned seed, Check check)
+	{
+		std::mt19937 rng(seed);
+		std::vector<std::unique_ptr<uint64_t>> batch(64);
+		uint64_t seen = 0;
+		while (seen < n)
+		{
+			if (rng() % 4 == 0)
+			{
+				std::unique_ptr<uint64_t> item;
+				BOOST_REQUIRE(q.pop(item, std::chrono::seconds(10)));
+				check(*item);
+				++seen;
+				continue;
+			}
+			size_t const k = q.try_pop(batch.data(), 1 + rng() % batch.size());
+			for (size_t i = 0; i < k; ++i) check(*batch[i]);
+			seen += k;
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(FragmentQueue_test)
+
+BOOST_AUTO_TEST_CASE(Capacity)
+{
+	demo::SPSCQueue<int> q(5);
+	BOOST_CHECK_EQUAL(q.capacity(), 8u);
+	int items[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	BOOST_CHECK_EQUAL(q.try_push(items, 10), 8u);
+	BOOST_CHECK(!q.try_push(10));
+
+	int out[10];
+	BOOST_CHECK_EQUAL(q.try_pop(out, 10), 8u);
+	BOOST_CHECK_EQUAL(out[7], 7);
+	BOOST_CHECK(!q.pop(out[0], std::chrono::milliseconds(1)));
+
+	demo::QueueStats const s = q.stats();
+	BOOST_CHECK_EQUAL(s.pushed, 8u);
+	BOOST_CHECK_EQUAL(s.popped, 8u);
+	BOOST_CHECK_EQUAL(s.high_water, 8u);
+	BOOST_CHECK_EQUAL(s.size, 0u);
+}
+
+// One producer and one consumer racing through a small queue: every item arrives once, in order
+BOOST_AUTO_TEST_CASE(SPSCStress)
+{
+	for (size_t const capacity : {2u, 16u, 1024u})
+	{
+		demo::SPSCQueue<std::unique_ptr<uint64_t>> q(capacity);
+		std::thread producer([&] { produce(q, 0, n_items, 1); });
+
+		uint64_t expected = 0;
+		bool in_order = true;
+		consume(q, n_items, 2, [&](uint64_t v) { in_order = in_order && v == expected++; });
+		producer.join();
+
+		BOOST_CHECK(in_order);
+		BOOST_CHECK_EQUAL(expected, n_items);
+		demo::QueueStats const s = q.stats();
+		BOOST_CHECK_EQUAL(s.pushed, n_items);
+		BOOST_CHECK_EQUAL(s.popped, n_items);
+		BOOST_CHECK_EQUAL(s.size, 0u);
+		BOOST_CHECK(s.high_water <= q.capacity());
+	}
+}
+
+// Several producers into one consumer: every item arrives once, and each producer's in order
+BOOST_AUTO_TEST_CASE(MPSCStress)
+{
+	size_t const n_producers = 4;
+	uint64_t const per_producer = n_items / n_producers;
+	for (size_t const capacity : {2u, 16u, 1024u})
+	{
+		demo::MPSCQueue<std::unique_ptr<uint64_t>> q(capacity);
+		std::vector<std::thread> producers;
+		for (size_t p = 0; p < n_producers; ++p)
+		{
+			producers.emplace_back([&, p] { produce(q, p * per_producer, per_producer, 10 + p); });
+		}
+
+		std::vector<uint64_t> next(n_producers);
+		for (size_t p = 0; p < n_producers; ++p) next[p] = p * per_producer;
+		bool in_order = true;
+		consume(q, n_producers * per_producer, 3, [&](uint64_t v) {
+			uint64_t& expected = next[v / per_producer];
+			in_order = in_order && v == expected++;
+		});
+		for (auto& t : producers) t.join();
+
+		BOOST_CHECK(in_order);
+		for (size_t p = 0; p < n_producers; ++p) BOOST_CHECK_EQUAL(next[p], (p + 1) * per_producer);
+		demo::QueueStats const s = q.stats();
+		BOOST_CHECK_EQUAL(s.pushed, n_producers * per_producer);
+		BOOST_CHECK_EQUAL(s.popped, n_producers * per_producer);
+		BOOST_CHECK_EQUAL(s.size, 0u);
+	}
+}
+
+// Several producers into a queue never full enough to refuse a push, while the consumer pops what
+// they have pushed, maybe before a producer has finished pushing it: the high-water mark stays
+// below capacity and the number of items pushed
+BOOST_AUTO_TEST_CASE(MPSCHighWater)
+{
+	size_t const n_producers = 8;
+	uint64_t const per_producer = 1 << 12;
+	size_t const capacity = 1 << 16;
+	for (unsigned round = 0; round < 8; ++round)
+	{
+		demo::MPSCQueue<std::unique_ptr<uint64_t>> q(capacity);
+		std::vector<std::thread> producers;
+		for (size_t p = 0; p < n_producers; ++p)
+		{
+			producers.emplace_back([&, p] { produce(q, p * per_producer, per_producer, 20 + round * n_producers + p); });
+		}
+		consume(q, n_producers * per_producer, round, [](uint64_t) {});
+		for (auto& t : producers) t.join();
+
+		demo::QueueStats const s = q.stats();
+		BOOST_REQUIRE_EQUAL(s.full, 0u);
+		BOOST_CHECK_LE(s.high_water, n_producers * per_producer);
+		BOOST_CHECK_LT(s.high_water, s.capacity);
+	}
+}
+
+// Fragments themselves, as the queues are meant for
+BOOST_AUTO_TEST_CASE(FragmentPtrs)
+{
+	demo::FragmentSPSCQueue q(4);
+	std::thread producer([&] {
+		for (artdaq::Fragment::sequence_id_t seq = 0; seq < 10000; ++seq)
+		{
+			artdaq::FragmentPtr frag(new artdaq::Fragment(seq, 0));
+			q.push(std::move(frag));
+		}
+	});
+	bool in_order = true;
+	for (artdaq::Fragment::sequence_id_t seq = 0; seq < 10000; ++seq)
+	{
+		artdaq::FragmentPtr frag;
+		BOOST_REQUIRE(q.pop(frag, std::chrono::seconds(10)));
+		in_order = in_order && frag->sequenceID() == seq;
+	}
+	producer.join();
+	BOOST_CHECK(in_order);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,106 @@
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+
+#define BOOST_TEST_MODULE(FragmentType_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <cstring>
+#include <string>
+
+namespace
+{
+	// Look a name up with all three overloads, checking that they agree
+	demo::FragmentType lookup(std::string const& name)
+	{
+		demo::FragmentType const type = demo::toFragmentType(name);
+		BOOST_CHECK_EQUAL(demo::toFragmentType(name.data(), name.size()), type);
+		BOOST_CHECK_EQUAL(demo::toFragmentType(name.c_str()), type);
+		return type;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(FragmentType_test)
+
+// Every name in the table looks up its own type, whose name is the same again. "UNKNOWN" is
+// the name of INVALID, which fragmentTypeName() calls "INVALID/UNKNOWN".
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+	size_t const n = sizeof(demo::detail::fragmentTypeNames) / sizeof(demo::detail::fragmentTypeNames[0]);
+	for (size_t i = 0; i < n; ++i)
+	{
+		std::string const name = demo::detail::fragmentTypeNames[i];
+		BOOST_TEST_CONTEXT(name)
+		{
+			demo::FragmentType const type = lookup(name);
+			BOOST_CHECK_EQUAL(static_cast<size_t>(type), demo::FragmentType::MISSED + i);
+			if (type == demo::FragmentType::INVALID)
+			{
+				BOOST_CHECK_EQUAL(name, "UNKNOWN");
+				BOOST_CHECK_EQUAL(std::string(demo::fragmentTypeName(type)), "INVALID/UNKNOWN");
+			}
+			else
+			{
+				BOOST_CHECK_EQUAL(std::string(demo::fragmentTypeName(type)), name);
+				BOOST_CHECK_EQUAL(demo::fragmentTypeToString(type), name);
+			}
+		}
+	}
+	BOOST_CHECK_EQUAL(lookup("UNKNOWN"), demo::FragmentType::INVALID);
+}
+
+// demo::names is the same table, as strings
+BOOST_AUTO_TEST_CASE(Names)
+{
+	size_t const n = sizeof(demo::detail::fragmentTypeNames) / sizeof(demo::detail::fragmentTypeNames[0]);
+	BOOST_REQUIRE_EQUAL(demo::names.size(), n);
+	for (size_t i = 0; i < n; ++i) BOOST_CHECK_EQUAL(demo::names[i], demo::detail::fragmentTypeNames[i]);
+}
+
+// Case doesn't matter
+BOOST_AUTO_TEST_CASE(MixedCase)
+{
+	BOOST_CHECK_EQUAL(lookup("udp"), demo::FragmentType::UDP);
+	BOOST_CHECK_EQUAL(lookup("Crt"), demo::FragmentType::CRT);
+	BOOST_CHECK_EQUAL(lookup("toy2"), demo::FragmentType::TOY2);
+	BOOST_CHECK_EQUAL(lookup("UdpContainer"), demo::FragmentType::UDPCONTAINER);
+	BOOST_CHECK_EQUAL(lookup("crtPACKED"), demo::FragmentType::CRTPACKED);
+}
+
+// Only whole names match: not a prefix of one, nor a name with more after it, nor one that
+// isn't there at all
+BOOST_AUTO_TEST_CASE(NotNames)
+{
+	for (char const* name : {"", "TOY", "UDPCOMP", "UDPCOMPRESSEDCHECK", "C", "UDPX", "CRTPACKEDX",
+	                         "TOY12", "UDP ", " UDP", "FOO", "PHOTON"})
+	{
+		BOOST_TEST_CONTEXT('"' << name << '"')
+		{
+			BOOST_CHECK_EQUAL(lookup(name), demo::FragmentType::INVALID);
+		}
+	}
+}
+
+// The name passed with its length needn't end in a NUL, and a NUL within the length is part of it
+BOOST_AUTO_TEST_CASE(Length)
+{
+	char const names[] = "UDPCRTTOY1";
+	BOOST_CHECK_EQUAL(demo::toFragmentType(names, 3), demo::FragmentType::UDP);
+	BOOST_CHECK_EQUAL(demo::toFragmentType(names + 3, 3), demo::FragmentType::CRT);
+	BOOST_CHECK_EQUAL(demo::toFragmentType(names + 6, 4), demo::FragmentType::TOY1);
+	BOOST_CHECK_EQUAL(demo::toFragmentType(names + 6, 3), demo::FragmentType::INVALID);
+	BOOST_CHECK_EQUAL(demo::toFragmentType(names, 0), demo::FragmentType::INVALID);
+	BOOST_CHECK_EQUAL(demo::toFragmentType(names, strlen(names)), demo::FragmentType::INVALID);
+
+	BOOST_CHECK_EQUAL(demo::toFragmentType(std::string("UDP\0", 4)), demo::FragmentType::INVALID);
+	BOOST_CHECK_EQUAL(demo::toFragmentType("UDP\0", 4), demo::FragmentType::INVALID);
+	BOOST_CHECK_EQUAL(demo::toFragmentType("UDP\0CRT"), demo::FragmentType::UDP);
+}
+
+// Types past the end of the table have no name
+BOOST_AUTO_TEST_CASE(OutOfRange)
+{
+	BOOST_CHECK_EQUAL(std::string(demo::fragmentTypeName(demo::FragmentType::INVALID)), "INVALID/UNKNOWN");
+	BOOST_CHECK_EQUAL(std::string(demo::fragmentTypeName(static_cast<demo::FragmentType>(demo::FragmentType::INVALID + 1))),
+	                  "INVALID/UNKNOWN");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
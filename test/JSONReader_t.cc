@@ -0,0 +1,157 @@
+#include "artdaq-core-demo/Overlays/JSONReader.hh"
+
+#define BOOST_TEST_MODULE(JSONReader_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+	typedef demo::JSONReader::Event Event;
+
+	// The document last searched by find(), which the values found point into
+	std::string document;
+
+	bool find(std::string const& json, char const* path, demo::JSONValue& value)
+	{
+		document = json;
+		return demo::findJSONValue(document.data(), document.data() + document.size(), path, value);
+	}
+
+	std::string str(demo::JSONValue const& value) { return std::string(value.begin, value.end); }
+
+	// The events of a whole document
+	std::vector<Event> events(std::string const& json)
+	{
+		demo::JSONReader reader(json.data(), json.data() + json.size());
+		std::vector<Event> out;
+		do
+			out.push_back(reader.next());
+		while (out.back() != Event::End && out.back() != Event::Error);
+		return out;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(JSONReader_test)
+
+BOOST_AUTO_TEST_CASE(Events)
+{
+	std::vector<Event> const expect{Event::StartObject, Event::Key, Event::StartArray, Event::Value, Event::Value,
+									Event::StartObject, Event::EndObject, Event::EndArray, Event::Key, Event::Value,
+									Event::EndObject, Event::End};
+	BOOST_CHECK(events(" {\"a\": [1, \"x\", {}], \"b\" : null }\n") == expect);
+
+	for (char const* bad : {"", "{", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "[1 2]", "{1:2}", "]", "tru", "1 1", "{\"a\":1]"})
+	{
+		BOOST_TEST_CONTEXT(bad) { BOOST_CHECK(events(bad).back() == Event::Error); }
+	}
+
+	std::string const deep = std::string(demo::JSONReader::max_depth, '[') + std::string(demo::JSONReader::max_depth, ']');
+	BOOST_CHECK(events(deep).back() == Event::End);
+	BOOST_CHECK(events("[" + deep + "]").back() == Event::Error);
+}
+
+BOOST_AUTO_TEST_CASE(Find)
+{
+	std::string const json =
+		"{\"run\": 12, \"status\": {\"voltage\": -1.5e2, \"ok\": true, \"name\": \"crate \\\"A\\\"\","
+		" \"channels\": [1, [2], {\"x\": 3}], \"off\": false}, \"big\": 9223372036854775808}";
+	demo::JSONValue v;
+	int64_t i;
+	double d;
+
+	BOOST_REQUIRE(find(json, "run", v));
+	BOOST_REQUIRE(v.asInt64(i));
+	BOOST_CHECK_EQUAL(i, 12);
+
+	BOOST_REQUIRE(find(json, "status.voltage", v));
+	BOOST_CHECK(!v.asInt64(i));
+	BOOST_REQUIRE(v.asDouble(d));
+	BOOST_CHECK_EQUAL(d, -150.);
+
+	BOOST_REQUIRE(find(json, "status.ok", v));
+	BOOST_CHECK(v.type == demo::JSONValue::Type::True);
+	BOOST_REQUIRE(find(json, "status.off", v));
+	BOOST_CHECK(v.type == demo::JSONValue::Type::False);
+
+	BOOST_REQUIRE(find(json, "status.name", v));
+	BOOST_CHECK(v.equals("crate \"A\""));
+	BOOST_CHECK(!v.equals("crate \"A"));
+
+	BOOST_REQUIRE(find(json, "status.channels", v));
+	BOOST_CHECK(v.type == demo::JSONValue::Type::Array);
+	BOOST_CHECK_EQUAL(str(v), "[1, [2], {\"x\": 3}]");
+
+	BOOST_REQUIRE(find(json, "big", v));
+	BOOST_CHECK(!v.asInt64(i));
+
+	BOOST_CHECK(!find(json, "status.missing", v));
+	BOOST_CHECK(!find(json, "run.x", v));
+	BOOST_CHECK(!find(json, "stat", v));
+	BOOST_CHECK(!find("{\"a\": [1,, 2], \"b\": 1}", "b", v));
+}
+
+BOOST_AUTO_TEST_CASE(Unescape)
+{
+	demo::JSONValue v;
+	BOOST_REQUIRE(find("{\"s\": \"a\\n\\t\\/\\u00e9\\u20ac\\ud83d\\ude00\"}", "s", v));
+	std::vector<char> buf(v.end - v.begin);
+	std::string const got(buf.data(), v.unescape(buf.data()));
+	BOOST_CHECK_EQUAL(got, "a\n\t/\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+	BOOST_CHECK(v.equals(got.c_str()));
+}
+
+// Strings long enough for the SSE2 scan, with the closing quote, an escape
+// and a control character at each position in and either side of the
+// 16-byte blocks
+BOOST_AUTO_TEST_CASE(LongStrings)
+{
+	demo::JSONValue v;
+	for (size_t n = 0; n <= 50; ++n)
+	{
+		BOOST_TEST_CONTEXT("length " << n)
+		{
+			std::string const plain(n, 'a');
+			BOOST_REQUIRE(find("{\"k\":\"" + plain + "\"}", "k", v));
+			BOOST_CHECK_EQUAL(str(v), plain);
+
+			// Followed by enough text that the scan finds the quote in a block
+			BOOST_REQUIRE(find("{\"k\":\"" + plain + "\",\"z\":\"" + std::string(40, 'b') + "\"}", "z", v));
+			BOOST_CHECK_EQUAL(v.end - v.begin, 40);
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				std::string s = plain;
+				s.insert(i, "\\\"");
+				BOOST_REQUIRE(find("{\"k\":\"" + s + "\"}", "k", v));
+				BOOST_CHECK_EQUAL(str(v), s);
+				std::string unescaped = plain;
+				unescaped.insert(i, "\"");
+				BOOST_CHECK(v.equals(unescaped.c_str()));
+
+				s = plain;
+				s.insert(i, "\\\\");
+				BOOST_REQUIRE(find("{\"k\":\"" + s + "\"}", "k", v));
+				BOOST_CHECK_EQUAL(str(v), s);
+
+				for (char const c : {'\0', '\n', '\x1f'})
+				{
+					s = plain;
+					s[i] = c;
+					BOOST_CHECK(!find("{\"k\":\"" + s + "\"}", "k", v));
+				}
+
+				s = plain;
+				s[i] = '\x80';
+				BOOST_CHECK(find("{\"k\":\"" + s + "\"}", "k", v));
+			}
+
+			// Unterminated, ending in the text or in an escape
+			BOOST_CHECK(!find("{\"k\":\"" + plain, "k", v));
+			BOOST_CHECK(!find("{\"k\":\"" + plain + "\\", "k", v));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
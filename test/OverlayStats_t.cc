@@ -0,0 +1,153 @@
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTValidation.hh"
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/OverlayStats.hh"
+
+#define BOOST_TEST_MODULE(OverlayStats_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// Built twice (see test/CMakeLists.txt): against the overlays as the build configures them, and
+// against a copy built with the other DEMO_OVERLAY_STATS setting, so that both are tested.
+
+namespace
+{
+	bool contains(std::string const& text, std::string const& line)
+	{
+		return text.find(line + "\n") != std::string::npos;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(OverlayStats_test)
+
+// Each value lands in the bin holding [2^(b-1), 2^b), and values too large for the others in the last
+BOOST_AUTO_TEST_CASE(BinEdges)
+{
+	BOOST_CHECK_EQUAL(demo::Log2Histogram::bin(0), 0u);
+	BOOST_CHECK_EQUAL(demo::Log2Histogram::bin(1), 1u);
+	for (size_t b = 2; b < demo::Log2Histogram::n_bins; ++b)
+	{
+		BOOST_TEST_CONTEXT("bin " << b)
+		{
+			BOOST_CHECK_EQUAL(demo::Log2Histogram::bin((uint64_t(1) << (b - 1)) - 1), b - 1);
+			BOOST_CHECK_EQUAL(demo::Log2Histogram::bin(uint64_t(1) << (b - 1)), b);
+			BOOST_CHECK_EQUAL(demo::Log2Histogram::bin((uint64_t(1) << b) - 1), b);
+		}
+	}
+	BOOST_CHECK_EQUAL(demo::Log2Histogram::bin(uint64_t(1) << 32), demo::Log2Histogram::n_bins - 1);
+	BOOST_CHECK_EQUAL(demo::Log2Histogram::bin(~uint64_t(0)), demo::Log2Histogram::n_bins - 1);
+}
+
+// Counts made on several threads, some of which have exited, add up, in the bins they belong in
+BOOST_AUTO_TEST_CASE(ThreadsMerge)
+{
+	demo::FragmentType const type = demo::FragmentType::TOY1;
+	demo::OverlayTypeStats const before = demo::overlayStats()[type];
+
+	size_t const nthreads = 4, n = 1000;
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < nthreads; ++t)
+	{
+		threads.emplace_back([type] {
+			for (size_t i = 0; i < n; ++i)
+			{
+				demo::countOverlayFragment(type, 1000, i % 3);
+				if (i % 10 == 0) demo::countOverlayFailure(type);
+				demo::countOverlayTime(type, demo::OverlayPhase::Decode, 5);
+			}
+		});
+	}
+	for (auto& t : threads) t.join();
+
+	// Type codes this package doesn't define are ignored
+	demo::countOverlayFragment(static_cast<demo::FragmentType>(demo::FragmentType::INVALID), 1, 1);
+	demo::countOverlayFailure(static_cast<demo::FragmentType>(demo::FragmentType::MISSED - 1));
+
+	demo::OverlayTypeStats const after = demo::overlayStats()[type];
+	BOOST_CHECK_EQUAL(after.fragments - before.fragments, nthreads * n);
+	BOOST_CHECK_EQUAL(after.failed - before.failed, nthreads * n / 10);
+
+	// 1000 is in [512, 1024), bin 10
+	BOOST_CHECK_EQUAL(after.bytes.bins[10] - before.bytes.bins[10], nthreads * n);
+	BOOST_CHECK_EQUAL(after.bytes.sum - before.bytes.sum, nthreads * n * 1000);
+	BOOST_CHECK_EQUAL(after.bytes.count() - before.bytes.count(), nthreads * n);
+
+	// 0, 1 and 2 are in bins 0, 1 and 2
+	for (size_t b = 0; b < 3; ++b)
+	{
+		BOOST_CHECK_EQUAL(after.items.bins[b] - before.items.bins[b], nthreads * ((n + 2 - b) / 3));
+	}
+	BOOST_CHECK_EQUAL(after.items.bins[3] - before.items.bins[3], 0u);
+
+	// 5 is in [4, 8), bin 3
+	size_t const decode = static_cast<size_t>(demo::OverlayPhase::Decode);
+	BOOST_CHECK_EQUAL(after.nanoseconds[decode].bins[3] - before.nanoseconds[decode].bins[3], nthreads * n);
+	size_t const validate = static_cast<size_t>(demo::OverlayPhase::Validate);
+	BOOST_CHECK_EQUAL(after.nanoseconds[validate].count() - before.nanoseconds[validate].count(), 0u);
+}
+
+// The text has cumulative buckets whose "le" is the largest integer in them, and leaves out types
+// with nothing counted
+BOOST_AUTO_TEST_CASE(Text)
+{
+	demo::FragmentType const type = demo::FragmentType::TOY2;
+	demo::countOverlayFragment(type, 0, 1);
+	demo::countOverlayFragment(type, 3, 2);
+	demo::countOverlayFragment(type, 4, 3);
+	demo::countOverlayFailure(type);
+
+	std::string const text = demo::overlayStats().text();
+	BOOST_TEST_MESSAGE(text);
+	BOOST_CHECK(contains(text, "demo_overlay_fragments_total{type=\"TOY2\"} 3"));
+	BOOST_CHECK(contains(text, "demo_overlay_failed_total{type=\"TOY2\"} 1"));
+	BOOST_CHECK(contains(text, "demo_overlay_bytes_bucket{type=\"TOY2\",le=\"0\"} 1"));
+	BOOST_CHECK(contains(text, "demo_overlay_bytes_bucket{type=\"TOY2\",le=\"1\"} 1"));
+	BOOST_CHECK(contains(text, "demo_overlay_bytes_bucket{type=\"TOY2\",le=\"3\"} 2"));
+	BOOST_CHECK(contains(text, "demo_overlay_bytes_bucket{type=\"TOY2\",le=\"7\"} 3"));
+	BOOST_CHECK(contains(text, "demo_overlay_bytes_bucket{type=\"TOY2\",le=\"2147483647\"} 3"));
+	BOOST_CHECK(contains(text, "demo_overlay_bytes_bucket{type=\"TOY2\",le=\"+Inf\"} 3"));
+	BOOST_CHECK(contains(text, "demo_overlay_bytes_sum{type=\"TOY2\"} 7"));
+	BOOST_CHECK(contains(text, "demo_overlay_bytes_count{type=\"TOY2\"} 3"));
+	BOOST_CHECK(contains(text, "demo_overlay_items_bucket{type=\"TOY2\",le=\"1\"} 1"));
+	BOOST_CHECK(contains(text, "demo_overlay_items_sum{type=\"TOY2\"} 6"));
+	BOOST_CHECK(contains(text, "demo_overlay_decode_ns_count{type=\"TOY2\"} 0"));
+	BOOST_CHECK(text.find("type=\"MISSED\"") == std::string::npos);
+}
+
+// The overlays count what they handle when DEMO_OVERLAY_STATS is defined, and leave the statistics
+// alone when it isn't
+BOOST_AUTO_TEST_CASE(Overlays)
+{
+	artdaq::Fragment good(0, 0, demo::FragmentType::CRT);
+	{
+		CRT::FragmentWriter w(good, 1, CRT::earliest_unixtime, 0);
+		for (int i = 0; i < 5; ++i) w.add_hit(i, 100);
+		w.finalize();
+	}
+	artdaq::Fragment bad(good);
+	bad.dataBeginBytes()[0] = 'm';
+
+	demo::OverlayTypeStats const before = demo::overlayStats()[demo::FragmentType::CRT];
+	BOOST_CHECK(CRT::check_event(good).ok());
+	BOOST_CHECK(!CRT::check_event(bad).ok());
+	demo::OverlayTypeStats const after = demo::overlayStats()[demo::FragmentType::CRT];
+
+	size_t const validate = static_cast<size_t>(demo::OverlayPhase::Validate);
+#if defined(DEMO_OVERLAY_STATS)
+	BOOST_CHECK_EQUAL(after.fragments - before.fragments, 2u);
+	BOOST_CHECK_EQUAL(after.failed - before.failed, 1u);
+	BOOST_CHECK_EQUAL(after.bytes.sum - before.bytes.sum, 2 * good.dataSizeBytes());
+	BOOST_CHECK_EQUAL(after.items.bins[3] - before.items.bins[3], 2u);
+	BOOST_CHECK_EQUAL(after.nanoseconds[validate].count() - before.nanoseconds[validate].count(), 2u);
+#else
+	BOOST_CHECK_EQUAL(after.fragments, before.fragments);
+	BOOST_CHECK_EQUAL(after.failed, before.failed);
+	BOOST_CHECK_EQUAL(after.bytes.count(), before.bytes.count());
+	BOOST_CHECK_EQUAL(after.nanoseconds[validate].count(), before.nanoseconds[validate].count());
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,156 @@
+#include "artdaq-core-demo/Overlays/AsciiFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/CRTFragmentWriter.hh"
+#include "artdaq-core-demo/Overlays/OverlayVisitor.hh"
+
+#define BOOST_TEST_MODULE(OverlayVisitor_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// A CRT Fragment whose module number is its sequence ID
+	artdaq::Fragment crt(artdaq::Fragment::sequence_id_t seq)
+	{
+		artdaq::Fragment frag(seq, 0, demo::FragmentType::CRT);
+		CRT::FragmentWriter writer(frag, seq, CRT::earliest_unixtime, 0, 1);
+		writer.add_hit(1, 100);
+		writer.finalize();
+		return frag;
+	}
+
+	artdaq::Fragment packed(artdaq::Fragment::sequence_id_t seq)
+	{
+		artdaq::Fragment frag(seq, 0, demo::FragmentType::CRTPACKED);
+		BOOST_REQUIRE(CRT::pack(crt(seq), frag));
+		return frag;
+	}
+
+	artdaq::Fragment ascii(artdaq::Fragment::sequence_id_t seq)
+	{
+		demo::AsciiFragment::Metadata metadata;
+		metadata.charsInLine = 2;
+		auto frag = artdaq::Fragment::FragmentBytes(0, seq, 0, demo::FragmentType::ASCII, metadata);
+		demo::AsciiFragmentWriter writer(*frag);
+		writer.resize(2);
+		memcpy(writer.dataBegin(), "hi", 2);
+		return *frag;
+	}
+
+	// A Fragment of a type with no overlay, or not from this package
+	artdaq::Fragment other(artdaq::Fragment::sequence_id_t seq, artdaq::Fragment::type_t type)
+	{
+		return artdaq::Fragment(seq, 0, type);
+	}
+
+	typedef std::pair<std::string, artdaq::Fragment::sequence_id_t> Call;
+
+	// A visitor with handlers for some of the overlays, which records what it is called with
+	auto recorder(std::vector<Call>& calls)
+	{
+		return demo::overloaded(
+			[&calls](CRT::Fragment const& f) {
+				calls.emplace_back("CRT", f.module_num());
+				return 1;
+			},
+			[&calls](CRT::PackedFragment const& f) {
+				calls.emplace_back("CRTPACKED", f.module_num());
+				return 2;
+			},
+			[&calls](demo::AsciiFragment const& f) {
+				calls.emplace_back("ASCII " + std::string(f.dataBegin(), f.dataEnd()), 0);
+				return 3;
+			},
+			[&calls](artdaq::Fragment const& f) {
+				calls.emplace_back("other " + std::to_string(f.type()), f.sequenceID());
+				return 0;
+			});
+	}
+
+	std::string str(std::vector<Call> const& calls)
+	{
+		std::string s;
+		for (auto const& c : calls) s += c.first + ":" + std::to_string(c.second) + " ";
+		return s;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(OverlayVisitor_test)
+
+// Each type goes to the handler for its overlay, and to the one for artdaq::Fragment if it has no
+// overlay, is not from this package, or the visitor has no handler for its overlay
+BOOST_AUTO_TEST_CASE(Visit)
+{
+	std::vector<Call> calls;
+	auto visitor = recorder(calls);
+
+	BOOST_CHECK_EQUAL(demo::visit(crt(7), visitor), 1);
+	BOOST_CHECK_EQUAL(demo::visit(packed(8), visitor), 2);
+	BOOST_CHECK_EQUAL(demo::visit(ascii(9), visitor), 3);
+	BOOST_CHECK_EQUAL(demo::visit(other(10, demo::FragmentType::UDP), visitor), 0);
+	BOOST_CHECK_EQUAL(demo::visit(other(11, demo::FragmentType::TOY1), visitor), 0);
+	BOOST_CHECK_EQUAL(demo::visit(other(12, demo::FragmentType::MISSED - 1), visitor), 0);
+	BOOST_CHECK_EQUAL(demo::visit(other(13, demo::FragmentType::INVALID), visitor), 0);
+	BOOST_CHECK_EQUAL(demo::visit(other(14, artdaq::Fragment::DataFragmentType), visitor), 0);
+
+	std::string const expect = "CRT:7 CRTPACKED:8 ASCII hi:0 other " + std::to_string(demo::FragmentType::UDP) + ":10 other " +
+	                           std::to_string(demo::FragmentType::TOY1) + ":11 other " +
+	                           std::to_string(demo::FragmentType::MISSED - 1) + ":12 other " +
+	                           std::to_string(demo::FragmentType::INVALID) + ":13 other " +
+	                           std::to_string(artdaq::Fragment::DataFragmentType) + ":14 ";
+	BOOST_CHECK_EQUAL(str(calls), expect);
+}
+
+// With a list of only some of the overlays, the others go to the artdaq::Fragment handler
+BOOST_AUTO_TEST_CASE(CustomList)
+{
+	typedef demo::OverlayList<demo::OverlayBinding<demo::FragmentType::CRT, CRT::Fragment>> OnlyCRT;
+	std::vector<Call> calls;
+	auto visitor = recorder(calls);
+
+	demo::visit<OnlyCRT>(crt(1), visitor);
+	demo::visit<OnlyCRT>(packed(2), visitor);
+	demo::visit<OnlyCRT>(ascii(3), visitor);
+	BOOST_CHECK_EQUAL(str(calls), "CRT:1 other " + std::to_string(demo::FragmentType::CRTPACKED) + ":2 other " +
+	                                  std::to_string(demo::FragmentType::ASCII) + ":3 ");
+}
+
+// visitBatch() calls the same handlers as visit(), grouped by type in the order of FragmentType,
+// types not from this package last, and in input order within each type
+BOOST_AUTO_TEST_CASE(Batch)
+{
+	artdaq::Fragments frags;
+	frags.push_back(other(1, artdaq::Fragment::DataFragmentType));
+	frags.push_back(crt(2));
+	frags.push_back(ascii(3));
+	frags.push_back(packed(4));
+	frags.push_back(crt(5));
+	frags.push_back(other(6, demo::FragmentType::TOY1));
+	frags.push_back(other(7, demo::FragmentType::INVALID));
+	frags.push_back(ascii(8));
+	frags.push_back(crt(9));
+	frags.push_back(other(10, demo::FragmentType::MISSED - 1));
+
+	std::vector<Call> calls;
+	demo::visitBatch(frags, recorder(calls));
+	std::string const toy1 = std::to_string(demo::FragmentType::TOY1);
+	std::string const invalid = std::to_string(demo::FragmentType::INVALID);
+	std::string const data = std::to_string(artdaq::Fragment::DataFragmentType);
+	std::string const below = std::to_string(demo::FragmentType::MISSED - 1);
+	BOOST_CHECK_EQUAL(str(calls), "other " + toy1 + ":6 ASCII hi:0 ASCII hi:0 CRT:2 CRT:5 CRT:9 CRTPACKED:4 other " + data +
+	                                  ":1 other " + invalid + ":7 other " + below + ":10 ");
+
+	// The same through the pointer overload, reusing the scratch space, with an empty batch first
+	std::vector<artdaq::Fragment const*> pointers, scratch;
+	calls.clear();
+	auto visitor = recorder(calls);
+	demo::visitBatch(pointers.data(), 0, visitor, scratch);
+	BOOST_CHECK(calls.empty());
+	for (auto const& f : frags) pointers.push_back(&f);
+	demo::visitBatch(pointers.data(), 3, visitor, scratch);
+	BOOST_CHECK_EQUAL(str(calls), "ASCII hi:0 CRT:2 other " + data + ":1 ");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
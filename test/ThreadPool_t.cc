@@ -0,0 +1,83 @@
+#include "artdaq-core-demo/Overlays/ThreadPool.hh"
+
+#define BOOST_TEST_MODULE(ThreadPool_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ThreadPool_test)
+
+// Every index is run exactly once, however many threads share them
+BOOST_AUTO_TEST_CASE(ParallelFor)
+{
+	for (size_t const threads : {1, 2, 4})
+	{
+		demo::ThreadPool pool(threads);
+		BOOST_CHECK_EQUAL(pool.size(), threads);
+		for (size_t const n : {0, 1, 7, 1000})
+		{
+			std::vector<std::atomic<int>> calls(n);
+			for (auto& c : calls) c = 0;
+			pool.parallel_for(n, [&calls](size_t i) { ++calls[i]; });
+			for (size_t i = 0; i < n; ++i) BOOST_CHECK_EQUAL(calls[i].load(), 1);
+		}
+		BOOST_CHECK_GE(pool.stats().executed, 1008u);
+	}
+}
+
+// An exception from the body comes out of parallel_for() once every call has finished, and only
+// the first one if there are several
+BOOST_AUTO_TEST_CASE(Exceptions)
+{
+	demo::ThreadPool pool(3);
+	for (size_t const throwing : {1, 5, 100})
+	{
+		size_t const n = 100;
+		std::atomic<size_t> finished(0);
+		std::string what;
+		try
+		{
+			pool.parallel_for(n, [&](size_t i) {
+				if (i % (n / throwing) == 0) throw std::runtime_error("call " + std::to_string(i));
+				++finished;
+			});
+		}
+		catch (std::runtime_error const& e)
+		{
+			what = e.what();
+		}
+		BOOST_CHECK_EQUAL(what.compare(0, 5, "call "), 0);
+		BOOST_CHECK_EQUAL(finished.load(), n - throwing);
+	}
+
+	// The pool is still usable afterwards
+	std::atomic<size_t> calls(0);
+	pool.parallel_for(10, [&calls](size_t) { ++calls; });
+	BOOST_CHECK_EQUAL(calls.load(), 10u);
+}
+
+// parallel_for() from inside a parallel_for() body doesn't deadlock, even with every worker
+// waiting in one
+BOOST_AUTO_TEST_CASE(Nested)
+{
+	demo::ThreadPool pool(2);
+	std::atomic<size_t> calls(0);
+	pool.parallel_for(8, [&](size_t) { pool.parallel_for(8, [&calls](size_t) { ++calls; }); });
+	BOOST_CHECK_EQUAL(calls.load(), 64u);
+}
+
+// The destructor runs the tasks still queued
+BOOST_AUTO_TEST_CASE(Submit)
+{
+	std::atomic<size_t> calls(0);
+	{
+		demo::ThreadPool pool(2);
+		for (int i = 0; i < 1000; ++i) pool.submit([&calls] { ++calls; });
+	}
+	BOOST_CHECK_EQUAL(calls.load(), 1000u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,224 @@
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/UDPBatchReceiver.hh"
+
+#include "cetlib/exception.h"
+
+#define BOOST_TEST_MODULE(UDPBatchReceiver_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <arpa/inet.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+	// A UDP socket, bound to an ephemeral port on 127.0.0.1 if asked
+	struct Socket
+	{
+		explicit Socket(bool bound)
+			: fd(socket(AF_INET, SOCK_DGRAM, 0))
+		{
+			BOOST_REQUIRE(fd >= 0);
+			memset(&address, 0, sizeof address);
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			if (!bound) return;
+
+			BOOST_REQUIRE_EQUAL(bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof address), 0);
+			socklen_t len = sizeof address;
+			BOOST_REQUIRE_EQUAL(getsockname(fd, reinterpret_cast<sockaddr*>(&address), &len), 0);
+
+			// Wait no more than this for the first datagram, so that a lost one fails the test
+			// instead of hanging it
+			timeval timeout{2, 0};
+			BOOST_REQUIRE_EQUAL(setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout), 0);
+			int const buffer = 1 << 20;
+			setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof buffer);
+		}
+
+		~Socket() { close(fd); }
+
+		void send(Socket const& to, std::string const& data) const
+		{
+			BOOST_REQUIRE_EQUAL(sendto(fd, data.data(), data.size(), 0, reinterpret_cast<sockaddr const*>(&to.address),
+			                           sizeof to.address),
+			                    static_cast<ssize_t>(data.size()));
+		}
+
+		int fd;
+		sockaddr_in address;
+	};
+
+	// n bytes that differ from datagram to datagram
+	std::string datagram(size_t n, char first)
+	{
+		std::string s(n, ' ');
+		for (size_t i = 0; i < n; ++i) s[i] = static_cast<char>(first + i % 26);
+		return s;
+	}
+
+	// The payload of a UDP Fragment as a string, and whether the rest of its last word is NUL
+	std::string payload(artdaq::Fragment const& frag, bool& padded)
+	{
+		demo::UDPFragment const f(frag);
+		std::string const words(reinterpret_cast<char const*>(f.dataBegin()), reinterpret_cast<char const*>(f.dataEnd()));
+		std::string const text(f.textBegin(), f.textEnd());
+		padded = words.substr(text.size()) == std::string(words.size() - text.size(), '\0') &&
+		         words.size() - text.size() < sizeof(demo::UDPFragment::Header::data_t);
+		return text;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(UDPBatchReceiver_test)
+
+// Datagrams of 1 and 3 bytes, which leave 3 and 1 bytes of padding, and a jumbo one, received in
+// one batch, each into its own Fragment. Datagrams sent over loopback are queued by the time
+// sendto() returns, so one receive() gets them all.
+BOOST_AUTO_TEST_CASE(Batch)
+{
+	Socket const rx(true), tx(false);
+	demo::UDPBatchReceiver receiver(rx.fd, 4, 9000, 3);
+
+	// Leave something other than NUL where the short datagrams' padding goes
+	tx.send(rx, std::string(9000, 'x'));
+	BOOST_REQUIRE_EQUAL(receiver.receive(), 1u);
+
+	std::vector<std::string> const sent{datagram(1, 'a'), datagram(3, 'b'), datagram(9000, 'c')};
+	for (auto const& s : sent) tx.send(rx, s);
+	BOOST_REQUIRE_EQUAL(receiver.receive(), sent.size());
+	BOOST_REQUIRE_EQUAL(receiver.size(), sent.size());
+
+	for (size_t i = 0; i < sent.size(); ++i)
+	{
+		BOOST_TEST_CONTEXT("datagram " << i)
+		{
+			artdaq::Fragment const& frag = receiver.fragment(i);
+			demo::UDPFragment const f(frag);
+			BOOST_CHECK_EQUAL(frag.type(), demo::FragmentType::UDP);
+			BOOST_CHECK_EQUAL(f.hdr_data_type(), 3u);
+			BOOST_CHECK_EQUAL(frag.metadata<demo::UDPFragment::Metadata>()->port, ntohs(rx.address.sin_port));
+			BOOST_CHECK_EQUAL(frag.metadata<demo::UDPFragment::Metadata>()->address, rx.address.sin_addr.s_addr);
+
+			bool padded;
+			BOOST_CHECK(payload(frag, padded) == sent[i]);
+			BOOST_CHECK(padded);
+		}
+	}
+	BOOST_CHECK_EQUAL(receiver.truncated(), 0u);
+}
+
+// A released Fragment is trimmed to its datagram and stays as it was, while its slot gets a new
+// Fragment that the next batch is received into
+BOOST_AUTO_TEST_CASE(Release)
+{
+	Socket const rx(true), tx(false);
+	demo::UDPBatchReceiver receiver(rx.fd, 2, 1500);
+
+	tx.send(rx, "hello");
+	tx.send(rx, "world!");
+	BOOST_REQUIRE_EQUAL(receiver.receive(), 2u);
+	artdaq::Fragment const* const pooled = &receiver.fragment(0);
+
+	artdaq::FragmentPtr const first = receiver.release(0);
+	BOOST_CHECK(first.get() == pooled);
+	BOOST_CHECK(&receiver.fragment(0) != pooled);
+	size_t const word = sizeof(artdaq::RawDataType);
+	BOOST_CHECK_EQUAL(first->dataSizeBytes(), (sizeof(demo::UDPFragment::Header) + 8 + word - 1) / word * word);
+	BOOST_CHECK_THROW(receiver.release(2), cet::exception);
+
+	tx.send(rx, "again");
+	BOOST_REQUIRE_EQUAL(receiver.receive(), 1u);
+	BOOST_CHECK_THROW(receiver.release(1), cet::exception);
+
+	bool padded;
+	BOOST_CHECK_EQUAL(payload(*first, padded), "hello");
+	BOOST_CHECK(padded);
+	BOOST_CHECK_EQUAL(payload(receiver.fragment(0), padded), "again");
+	BOOST_CHECK(padded);
+	BOOST_CHECK_EQUAL(payload(*receiver.release(0), padded), "again");
+}
+
+// A Fragment given back with recycle() refills the next slot released, so that receiving
+// goes on without allocating
+BOOST_AUTO_TEST_CASE(Recycle)
+{
+	Socket const rx(true), tx(false);
+	demo::UDPBatchReceiver receiver(rx.fd, 1, 1500, 2);
+	BOOST_CHECK_EQUAL(receiver.poolStats().allocated, 1u);
+
+	tx.send(rx, datagram(1000, 'a'));
+	BOOST_REQUIRE_EQUAL(receiver.receive(), 1u);
+	artdaq::FragmentPtr frag = receiver.release(0);
+	BOOST_CHECK_EQUAL(receiver.poolStats().allocated, 2u);
+	artdaq::Fragment const* const recycled = frag.get();
+	receiver.recycle(std::move(frag));
+
+	tx.send(rx, "b");
+	BOOST_REQUIRE_EQUAL(receiver.receive(), 1u);
+	BOOST_CHECK(receiver.release(0) != nullptr);
+	BOOST_CHECK(&receiver.fragment(0) == recycled);
+	BOOST_CHECK_EQUAL(receiver.poolStats().allocated, 2u);
+
+	// The recycled Fragment is ready to receive into like a new one, with the same Metadata
+	tx.send(rx, "cc");
+	BOOST_REQUIRE_EQUAL(receiver.receive(), 1u);
+	artdaq::Fragment const& f = receiver.fragment(0);
+	BOOST_CHECK_EQUAL(f.type(), demo::FragmentType::UDP);
+	BOOST_CHECK_EQUAL(demo::UDPFragment(f).hdr_data_type(), 2u);
+	BOOST_CHECK_EQUAL(f.metadata<demo::UDPFragment::Metadata>()->port, ntohs(rx.address.sin_port));
+	bool padded;
+	BOOST_CHECK_EQUAL(payload(f, padded), "cc");
+	BOOST_CHECK(padded);
+
+	// Fragments laid out otherwise are not kept
+	receiver.recycle(artdaq::FragmentPtr(new artdaq::Fragment(4)));
+	BOOST_CHECK_EQUAL(receiver.poolStats().available, 0u);
+}
+
+// A datagram longer than the Fragments hold is cut to fit and counted
+BOOST_AUTO_TEST_CASE(Truncated)
+{
+	Socket const rx(true), tx(false);
+	demo::UDPBatchReceiver receiver(rx.fd, 1, 16);
+
+	tx.send(rx, datagram(100, 'a'));
+	BOOST_REQUIRE_EQUAL(receiver.receive(), 1u);
+	BOOST_CHECK_EQUAL(receiver.truncated(), 1u);
+
+	bool padded;
+	BOOST_CHECK(payload(receiver.fragment(0), padded) == datagram(16, 'a'));
+}
+
+// With nothing to receive, receive() returns 0 when the socket's timeout expires or at once if
+// asked not to wait, and the last batch is gone
+BOOST_AUTO_TEST_CASE(Timeout)
+{
+	Socket const rx(true), tx(false);
+	timeval timeout{0, 50000};
+	BOOST_REQUIRE_EQUAL(setsockopt(rx.fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout), 0);
+	demo::UDPBatchReceiver receiver(rx.fd, 4, 1500);
+
+	tx.send(rx, "x");
+	BOOST_REQUIRE_EQUAL(receiver.receive(), 1u);
+
+	BOOST_CHECK_EQUAL(receiver.receive(), 0u);
+	BOOST_CHECK_EQUAL(receiver.size(), 0u);
+	BOOST_CHECK_EQUAL(receiver.receive(MSG_DONTWAIT), 0u);
+
+	tx.send(rx, "y");
+	BOOST_REQUIRE_EQUAL(receiver.receive(), 1u);
+	bool padded;
+	BOOST_CHECK_EQUAL(payload(receiver.fragment(0), padded), "y");
+}
+
+BOOST_AUTO_TEST_CASE(BadSocket)
+{
+	BOOST_CHECK_THROW(demo::UDPBatchReceiver(-1, 0), cet::exception);
+	demo::UDPBatchReceiver receiver(-1, 1);
+	BOOST_CHECK_THROW(receiver.receive(), cet::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,131 @@
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/OverlayDecoders.hh"
+#include "artdaq-core-demo/Overlays/UDPContainerFragmentWriter.hh"
+
+#include "cetlib/exception.h"
+
+#define BOOST_TEST_MODULE(UDPContainerFragment_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <string>
+
+namespace
+{
+	typedef demo::UDPContainerFragment::Header Header;
+
+	// A Fragment holding "a", "hello" and 9 bytes, with an index if asked
+	artdaq::Fragment make(bool indexed)
+	{
+		artdaq::Fragment frag(0, 0, demo::FragmentType::UDPCONTAINER);
+		demo::UDPContainerFragmentWriter writer(frag);
+		writer.append("a", 1, 1000, 0x7f000001, 1);
+		writer.append("hello", 5, 1001, 0x7f000001, 2);
+		writer.append("123456789", 9, 1002, 0x7f000001, 3);
+		if (indexed) writer.finalize();
+		return frag;
+	}
+
+	Header* header(artdaq::Fragment& frag) { return reinterpret_cast<Header*>(frag.dataBeginBytes()); }
+	Header const* header(artdaq::Fragment const& frag) { return reinterpret_cast<Header const*>(frag.dataBeginBytes()); }
+
+	bool good(artdaq::Fragment const& frag)
+	{
+		bool const consistent = demo::UDPContainerFragment(frag).consistent();
+		BOOST_CHECK_EQUAL(demo::findOverlayDecoder(frag)->check(frag), consistent);
+		return consistent;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(UDPContainerFragment_test)
+
+BOOST_AUTO_TEST_CASE(ReadBack)
+{
+	for (bool const indexed : {false, true})
+	{
+		artdaq::Fragment const frag = make(indexed);
+		BOOST_REQUIRE(good(frag));
+
+		demo::UDPContainerFragment const f(frag);
+		BOOST_CHECK_EQUAL(f.indexed(), indexed);
+		BOOST_REQUIRE_EQUAL(f.n_datagrams(), 3u);
+		auto const d = f.datagram(1);
+		BOOST_CHECK_EQUAL(std::string(d.dataBegin(), d.dataEnd()), "hello");
+		BOOST_CHECK_EQUAL(d.port(), 1001);
+		BOOST_CHECK_EQUAL(d.timestamp(), 2u);
+
+		size_t n = 0, bytes = 0;
+		for (auto const& datagram : f)
+		{
+			++n;
+			bytes += datagram.size();
+		}
+		BOOST_CHECK_EQUAL(n, 3u);
+		BOOST_CHECK_EQUAL(bytes, 15u);
+		BOOST_CHECK_THROW(f.datagram(3), cet::exception);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(CorruptIndexOffset)
+{
+	artdaq::Fragment const valid = make(true);
+	size_t const total = valid.dataSizeBytes();
+	for (uint32_t const offset : {0x40000000u, 0xfffffffcu, uint32_t(total + 4), uint32_t(total), uint32_t(total - 4),
+								  uint32_t(header(valid)->used_bytes - 8),
+								  uint32_t(header(valid)->used_bytes + 2)})
+	{
+		artdaq::Fragment frag = valid;
+		header(frag)->index_offset = offset;
+		BOOST_CHECK(!good(frag));
+	}
+
+	// An index pointing at the wrong datagram
+	artdaq::Fragment frag = valid;
+	reinterpret_cast<uint32_t*>(frag.dataBeginBytes() + header(frag)->index_offset)[1] += 8;
+	BOOST_CHECK(!good(frag));
+}
+
+BOOST_AUTO_TEST_CASE(CorruptDatagramCount)
+{
+	for (bool const indexed : {false, true})
+	{
+		artdaq::Fragment const valid = make(indexed);
+		for (uint32_t const n : {0u, 2u, 4u, 0x40000000u, 0xffffffffu})
+		{
+			artdaq::Fragment frag = valid;
+			header(frag)->n_datagrams = n;
+			BOOST_CHECK(!good(frag));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(CorruptUsedBytes)
+{
+	for (bool const indexed : {false, true})
+	{
+		artdaq::Fragment const valid = make(indexed);
+		uint32_t const used = header(valid)->used_bytes;
+		for (uint32_t const u : {0u, 8u, uint32_t(sizeof(Header)), used - 8, used + 1, used + 8, 0x40000000u, 0xfffffff8u})
+		{
+			artdaq::Fragment frag = valid;
+			header(frag)->used_bytes = u;
+			BOOST_CHECK(!good(frag));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(CorruptDatagramSize)
+{
+	artdaq::Fragment frag = make(false);
+	auto dh = reinterpret_cast<demo::UDPContainerFragment::DatagramHeader*>(frag.dataBeginBytes() + sizeof(Header));
+	dh->size = 0xffff;
+	BOOST_CHECK(!good(frag));
+}
+
+BOOST_AUTO_TEST_CASE(TooShort)
+{
+	artdaq::Fragment frag(0, 0, demo::FragmentType::UDPCONTAINER);
+	frag.resizeBytes(8);
+	BOOST_CHECK(!good(frag));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
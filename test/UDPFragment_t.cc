@@ -0,0 +1,86 @@
+#include "artdaq-core-demo/Overlays/FragmentType.hh"
+#include "artdaq-core-demo/Overlays/UDPFragmentWriter.hh"
+
+#define BOOST_TEST_MODULE(UDPFragment_t)
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <cstring>
+#include <string>
+
+namespace
+{
+	artdaq::Fragment make()
+	{
+		demo::UDPFragment::Metadata metadata;
+		memset(&metadata, 0, sizeof metadata);
+		return artdaq::Fragment(0, 0, 0, demo::FragmentType::UDP, metadata);
+	}
+
+	void set_type(demo::UDPFragmentWriter& writer, demo::UDPFragment::DataType type)
+	{
+		writer.set_hdr_type(static_cast<demo::UDPFragment::Header::data_type_t>(type));
+	}
+
+	// The payload, without UDPFragmentWriter::dataBegin()'s check for at
+	// least a word of it
+	char* payload(artdaq::Fragment& frag)
+	{
+		return reinterpret_cast<char*>(frag.dataBeginBytes() + sizeof(demo::UDPFragment::Header));
+	}
+
+	std::string text(artdaq::Fragment const& frag)
+	{
+		demo::UDPFragment const f(frag);
+		return std::string(f.textBegin(), f.textEnd());
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(UDPFragment_test)
+
+// Shrinking the payload leaves no bytes of the larger one in the padding
+// of the last word, where textEnd() would take them for text
+BOOST_AUTO_TEST_CASE(ResizePadsWithNul)
+{
+	artdaq::Fragment frag = make();
+	demo::UDPFragmentWriter writer(frag);
+	set_type(writer, demo::UDPFragment::DataType::JSON);
+
+	writer.resize(8);
+	memcpy(writer.dataBegin(), "xxxxxxxx", 8);
+	writer.resize(7);
+	memcpy(writer.dataBegin(), "{\"a\":2}", 7);
+	BOOST_CHECK_EQUAL(text(frag), "{\"a\":2}");
+
+	demo::JSONValue value;
+	int64_t a;
+	BOOST_REQUIRE(demo::UDPFragment(frag).jsonValue("a", value));
+	BOOST_REQUIRE(value.asInt64(a));
+	BOOST_CHECK_EQUAL(a, 2);
+
+	for (size_t n = 0; n <= 12; ++n)
+	{
+		writer.resize(16);
+		memset(writer.dataBegin(), 'x', 16);
+		writer.resize(n);
+		memset(payload(frag), 'y', n);
+		BOOST_CHECK_EQUAL(text(frag), std::string(n, 'y'));
+	}
+}
+
+// The text ends at the first of the trailing NULs, and NULs before it are
+// part of it
+BOOST_AUTO_TEST_CASE(TextEnd)
+{
+	artdaq::Fragment frag = make();
+	demo::UDPFragmentWriter writer(frag);
+	set_type(writer, demo::UDPFragment::DataType::String);
+
+	writer.resize(9);
+	memcpy(writer.dataBegin(), "a\0cdefgh\0", 9);
+	BOOST_CHECK_EQUAL(text(frag), std::string("a\0cdefgh", 8));
+
+	writer.resize(0);
+	BOOST_CHECK_EQUAL(text(frag), "");
+}
+
+BOOST_AUTO_TEST_SUITE_END()